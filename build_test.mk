@@ -49,6 +49,13 @@ endif
 include common_features.mk
 include $(TMK_PATH)/common.mk
 include $(QUANTUM_PATH)/serial_link/tests/rules.mk
+include $(QUANTUM_PATH)/split_common/tests/rules.mk
+include $(DRIVER_PATH)/arm/tests/rules.mk
+include $(QUANTUM_PATH)/visualizer/tests/rules.mk
+include $(QUANTUM_PATH)/audio/tests/rules.mk
+include $(TMK_PATH)/protocol/midi/tests/rules.mk
+include $(QUANTUM_PATH)/api/tests/rules.mk
+include $(TMK_PATH)/common/chibios/tests/rules.mk
 ifneq ($(filter $(FULL_TESTS),$(TEST)),)
 include build_full_test.mk
 endif
@@ -20,9 +20,12 @@ SERIAL_SRC += $(wildcard $(SERIAL_PATH)/system/*.c)
 SERIAL_DEFS += -DSERIAL_LINK_ENABLE
 COMMON_VPATH += $(SERIAL_PATH)
 
+SPLIT_PATH := $(QUANTUM_PATH)/split_common
+
 ifeq ($(strip $(API_SYSEX_ENABLE)), yes)
     OPT_DEFS += -DAPI_SYSEX_ENABLE
     SRC += $(QUANTUM_DIR)/api/api_sysex.c
+    SRC += $(QUANTUM_DIR)/api/api_stream.c
     OPT_DEFS += -DAPI_ENABLE
     SRC += $(QUANTUM_DIR)/api.c
     MIDI_ENABLE=yes
@@ -38,6 +41,7 @@ ifeq ($(strip $(AUDIO_ENABLE)), yes)
         SRC += $(QUANTUM_DIR)/audio/audio.c
     else
         SRC += $(QUANTUM_DIR)/audio/audio_arm.c
+        SRC += $(QUANTUM_DIR)/audio/wavetable.c
     endif
     SRC += $(QUANTUM_DIR)/audio/voices.c
     SRC += $(QUANTUM_DIR)/audio/luts.c
@@ -105,14 +109,25 @@ ifeq ($(strip $(RGBLIGHT_ENABLE)), yes)
     OPT_DEFS += -DRGBLIGHT_ENABLE
     SRC += $(QUANTUM_DIR)/rgblight.c
     CIE1931_CURVE = yes
-    LED_BREATHING_TABLE = yes
+    EXP_SIN_CURVE = yes
     ifeq ($(strip $(RGBLIGHT_CUSTOM_DRIVER)), yes)
         OPT_DEFS += -DRGBLIGHT_CUSTOM_DRIVER
     else
 	    SRC += ws2812.c
+        ifeq ($(PLATFORM),CHIBIOS)
+            SRC += ws2812_encode.c
+        endif
     endif
 endif
 
+ifeq ($(strip $(RGB_MATRIX_ENABLE)), yes)
+    ifneq ($(strip $(RGBLIGHT_ENABLE)), yes)
+        $(error RGB_MATRIX_ENABLE requires RGBLIGHT_ENABLE)
+    endif
+    OPT_DEFS += -DRGB_MATRIX_ENABLE
+    SRC += $(QUANTUM_DIR)/rgb_matrix.c
+endif
+
 ifeq ($(strip $(TAP_DANCE_ENABLE)), yes)
     OPT_DEFS += -DTAP_DANCE_ENABLE
     SRC += $(QUANTUM_DIR)/process_keycode/process_tap_dance.c
@@ -137,6 +152,12 @@ ifeq ($(strip $(AUTO_SHIFT_ENABLE)), yes)
     endif
 endif
 
+ifeq ($(strip $(SPLIT_KEYBOARD)), yes)
+    OPT_DEFS += -DSPLIT_KEYBOARD
+    VPATH += $(SPLIT_PATH)
+    SRC += $(QUANTUM_DIR)/split_common/split_transport.c
+endif
+
 ifeq ($(strip $(SERIAL_LINK_ENABLE)), yes)
     SRC += $(patsubst $(QUANTUM_PATH)/%,%,$(SERIAL_SRC))
     OPT_DEFS += $(SERIAL_DEFS)
@@ -169,6 +190,11 @@ ifeq ($(strip $(CIE1931_CURVE)), yes)
     LED_TABLES = yes
 endif
 
+ifeq ($(strip $(EXP_SIN_CURVE)), yes)
+    OPT_DEFS += -DUSE_EXP_SIN_CURVE
+    LED_TABLES = yes
+endif
+
 ifeq ($(strip $(LED_BREATHING_TABLE)), yes)
     OPT_DEFS += -DUSE_LED_BREATHING_TABLE
     LED_TABLES = yes
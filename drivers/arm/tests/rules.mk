@@ -0,0 +1,3 @@
+ws2812_encode_SRC :=\
+	$(DRIVER_PATH)/arm/tests/ws2812_encode_tests.cpp \
+	$(DRIVER_PATH)/arm/ws2812_encode.c
@@ -0,0 +1,86 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include <vector>
+extern "C" {
+#include "arm/ws2812_encode.h"
+}
+
+static const uint16_t ZERO = 29;
+static const uint16_t ONE = 58;
+
+class WS2812Encode : public testing::Test {
+public:
+    WS2812Encode() {
+        timing.zero = ZERO;
+        timing.one = ONE;
+        timing.reset_slots = 4;
+    }
+
+    std::vector<uint16_t> encode(const std::vector<uint8_t>& data) {
+        // One extra slot to catch writes past the end
+        std::vector<uint16_t> out(WS2812_SLOTS(data.size(), timing.reset_slots) + 1, 0xFFFF);
+        ws2812_encode(data.data(), data.size(), &timing, out.data());
+        EXPECT_EQ(out.back(), 0xFFFF);
+        out.pop_back();
+        return out;
+    }
+
+    ws2812_timing_t timing;
+};
+
+TEST_F(WS2812Encode, SlotCount) {
+    EXPECT_EQ(WS2812_SLOTS(0, 0), 0);
+    EXPECT_EQ(WS2812_SLOTS(3, 0), 24);
+    EXPECT_EQ(WS2812_SLOTS(3 * 10, 224), 464);
+}
+
+TEST_F(WS2812Encode, SendsTheMostSignificantBitFirst) {
+    std::vector<uint16_t> out = encode({0x80});
+    std::vector<uint16_t> expected = {ONE, ZERO, ZERO, ZERO, ZERO, ZERO, ZERO, ZERO, 0, 0, 0, 0};
+    EXPECT_EQ(out, expected);
+}
+
+TEST_F(WS2812Encode, EncodesAllBits) {
+    std::vector<uint16_t> out = encode({0xA5});
+    std::vector<uint16_t> expected = {ONE, ZERO, ONE, ZERO, ZERO, ONE, ZERO, ONE, 0, 0, 0, 0};
+    EXPECT_EQ(out, expected);
+}
+
+TEST_F(WS2812Encode, KeepsTheByteOrder) {
+    // An LED is sent as green, red, blue, in the order of struct cRGB
+    std::vector<uint16_t> out = encode({0xFF, 0x00, 0x01});
+    ASSERT_EQ(out.size(), 28u);
+    for (int i = 0; i < 8; i++) {
+        EXPECT_EQ(out[i], ONE);
+        EXPECT_EQ(out[8 + i], ZERO);
+        EXPECT_EQ(out[16 + i], i == 7 ? ONE : ZERO);
+    }
+}
+
+TEST_F(WS2812Encode, EndsWithTheResetSlots) {
+    timing.reset_slots = 50;
+    std::vector<uint16_t> out = encode({0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF});
+    ASSERT_EQ(out.size(), 48u + 50u);
+    for (size_t i = 48; i < out.size(); i++) {
+        EXPECT_EQ(out[i], 0);
+    }
+}
+
+TEST_F(WS2812Encode, EmptyFrameIsOnlyAReset) {
+    std::vector<uint16_t> out = encode({});
+    std::vector<uint16_t> expected = {0, 0, 0, 0};
+    EXPECT_EQ(out, expected);
+}
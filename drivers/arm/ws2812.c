@@ -0,0 +1,106 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ch.h"
+#include "hal.h"
+#include "ws2812.h"
+#include "ws2812_encode.h"
+
+#define WS2812_TICKS_PER_BIT (WS2812_PWM_FREQUENCY / 800000)
+// 0.4us high for a 0, 0.8us high for a 1
+#define WS2812_DUTY_ZERO (WS2812_TICKS_PER_BIT * 8 / 25)
+#define WS2812_DUTY_ONE (WS2812_TICKS_PER_BIT * 16 / 25)
+
+#define WS2812_BUFFER_SLOTS WS2812_SLOTS(RGBLED_NUM * sizeof(LED_TYPE), WS2812_RESET_SLOTS)
+
+static const ws2812_timing_t timing = {
+    .zero = WS2812_DUTY_ZERO,
+    .one = WS2812_DUTY_ONE,
+    .reset_slots = WS2812_RESET_SLOTS,
+};
+
+static uint16_t buffers[2][WS2812_BUFFER_SLOTS];
+static uint8_t back = 0;
+static bool initialized = false;
+// Taken while a frame is being sent
+static binary_semaphore_t idle;
+
+static const PWMConfig pwm_config = {
+    .frequency = WS2812_PWM_FREQUENCY,
+    .period = WS2812_TICKS_PER_BIT,
+    .callback = NULL,
+    .channels = {
+        [WS2812_PWM_CHANNEL - 1] = { .mode = PWM_OUTPUT_ACTIVE_HIGH, .callback = NULL },
+    },
+    .cr2 = 0,
+    // A DMA request on every update event loads the next duty cycle
+    .dier = TIM_DIER_UDE,
+};
+
+static void ws2812_dma_done(void *param, uint32_t flags) {
+    (void)param;
+    (void)flags;
+    // The last slots are zeros, so the line stays low from here on
+    chSysLockFromISR();
+    dmaStreamDisable(WS2812_DMA_STREAM);
+    chBSemSignalI(&idle);
+    chSysUnlockFromISR();
+}
+
+static void ws2812_init(void) {
+    chBSemObjectInit(&idle, false);
+
+    palSetLineMode(RGB_DI_PIN, PAL_MODE_ALTERNATE(WS2812_PWM_PAL_MODE) | PAL_STM32_OTYPE_PUSHPULL);
+    pwmStart(&WS2812_PWM_DRIVER, &pwm_config);
+    pwmEnableChannel(&WS2812_PWM_DRIVER, WS2812_PWM_CHANNEL - 1, 0);
+
+    dmaStreamAllocate(WS2812_DMA_STREAM, 10, ws2812_dma_done, NULL);
+    dmaStreamSetPeripheral(WS2812_DMA_STREAM, &(WS2812_PWM_DRIVER.tim->CCR[WS2812_PWM_CHANNEL - 1]));
+    initialized = true;
+}
+
+static void ws2812_send(LED_TYPE *ledarray, uint16_t leds) {
+    if (!initialized) {
+        ws2812_init();
+    }
+    if (leds > RGBLED_NUM) {
+        leds = RGBLED_NUM;
+    }
+
+    // Encoded while the previous frame may still be going out of the other buffer
+    uint16_t *buffer = buffers[back];
+    uint16_t length = leds * sizeof(LED_TYPE);
+    ws2812_encode((const uint8_t *)ledarray, length, &timing, buffer);
+
+    chBSemWait(&idle);
+    dmaStreamSetMemory0(WS2812_DMA_STREAM, buffer);
+    dmaStreamSetTransactionSize(WS2812_DMA_STREAM, WS2812_SLOTS(length, WS2812_RESET_SLOTS));
+    dmaStreamSetMode(WS2812_DMA_STREAM,
+#ifdef STM32_DMA_CR_CHSEL
+                     STM32_DMA_CR_CHSEL(WS2812_DMA_CHANNEL) |
+#endif
+                     STM32_DMA_CR_DIR_M2P | STM32_DMA_CR_PSIZE_WORD | STM32_DMA_CR_MSIZE_HWORD |
+                     STM32_DMA_CR_MINC | STM32_DMA_CR_TCIE | STM32_DMA_CR_PL(3));
+    dmaStreamEnable(WS2812_DMA_STREAM);
+    back ^= 1;
+}
+
+void ws2812_setleds(LED_TYPE *ledarray, uint16_t leds) {
+    ws2812_send(ledarray, leds);
+}
+
+void ws2812_setleds_rgbw(LED_TYPE *ledarray, uint16_t leds) {
+    // LED_TYPE already has the white channel when RGBW is defined
+    ws2812_send(ledarray, leds);
+}
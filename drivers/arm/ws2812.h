@@ -0,0 +1,63 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WS2812_H
+#define WS2812_H
+
+#include <stdint.h>
+#include "rgblight_types.h"
+
+/*
+ * WS2812 driver for ChibiOS (STM32)
+ *
+ * A timer channel generates the bit stream in PWM mode, and a DMA stream
+ * triggered by the timer's update event loads the duty cycle of every bit.
+ * Frames are encoded into one of two buffers while the other one is being
+ * sent, so ws2812_setleds only waits if the previous frame isn't done yet.
+ *
+ * RGB_DI_PIN is a PAL line, e.g. PAL_LINE(GPIOA, 1), connected to channel
+ * WS2812_PWM_CHANNEL of WS2812_PWM_DRIVER. WS2812_DMA_STREAM has to be the
+ * stream serving that timer's update (TIMx_UP) request.
+ */
+
+#ifndef WS2812_PWM_DRIVER
+#define WS2812_PWM_DRIVER PWMD2
+#endif
+#ifndef WS2812_PWM_CHANNEL
+#define WS2812_PWM_CHANNEL 2
+#endif
+#ifndef WS2812_PWM_PAL_MODE
+#define WS2812_PWM_PAL_MODE 1
+#endif
+#ifndef WS2812_DMA_STREAM
+#define WS2812_DMA_STREAM STM32_DMA1_STREAM2
+#endif
+#ifndef WS2812_DMA_CHANNEL
+#define WS2812_DMA_CHANNEL 2
+#endif
+
+// Timer clock, the bit period of 1.25us has to be a whole number of ticks
+#ifndef WS2812_PWM_FREQUENCY
+#define WS2812_PWM_FREQUENCY STM32_SYSCLK
+#endif
+
+// Low periods after a frame, 224 (280us) is enough for the newer WS2812B and SK6812 parts
+#ifndef WS2812_RESET_SLOTS
+#define WS2812_RESET_SLOTS 224
+#endif
+
+void ws2812_setleds(LED_TYPE *ledarray, uint16_t number_of_leds);
+void ws2812_setleds_rgbw(LED_TYPE *ledarray, uint16_t number_of_leds);
+
+#endif
@@ -0,0 +1,31 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ws2812_encode.h"
+
+void ws2812_encode(const uint8_t *data, uint16_t length, const ws2812_timing_t *timing, uint16_t *out) {
+    const uint16_t zero = timing->zero;
+    const uint16_t one = timing->one;
+
+    while (length--) {
+        uint8_t byte = *data++;
+        for (uint8_t i = 0; i < 8; i++) {
+            *out++ = (byte & 0x80) ? one : zero;
+            byte <<= 1;
+        }
+    }
+    for (uint16_t i = 0; i < timing->reset_slots; i++) {
+        *out++ = 0;
+    }
+}
@@ -0,0 +1,39 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WS2812_ENCODE_H
+#define WS2812_ENCODE_H
+
+#include <stdint.h>
+
+/*
+ * Encodes LED data into the PWM duty cycles of a WS2812 bit stream, one
+ * timer period (1.25us) per bit, sent MSB first in the order of the bytes.
+ * The stream ends with reset_slots periods held low, which latch the data
+ * and keep the line low after the DMA transfer is done.
+ */
+
+// Timer periods needed for length bytes of LED data
+#define WS2812_SLOTS(length, reset_slots) ((length) * 8 + (reset_slots))
+
+typedef struct {
+    uint16_t zero;  // duty cycle of a 0 bit, in timer ticks
+    uint16_t one;   // duty cycle of a 1 bit, in timer ticks
+    uint16_t reset_slots;
+} ws2812_timing_t;
+
+// Writes WS2812_SLOTS(length, timing->reset_slots) duty cycles to out
+void ws2812_encode(const uint8_t *data, uint16_t length, const ws2812_timing_t *timing, uint16_t *out);
+
+#endif
@@ -262,25 +262,15 @@ void ws2812_sendarray(uint8_t *data,uint16_t datlen)
 #define w_nop8  w_nop4 w_nop4
 #define w_nop16 w_nop8 w_nop8
 
-void inline ws2812_sendarray_mask(uint8_t *data,uint16_t datlen,uint8_t maskhi)
+// Sends a single byte, MSB first. Interrupts have to be disabled.
+static inline void ws2812_send_byte(uint8_t curbyte, uint8_t maskhi, uint8_t masklo)
 {
-  uint8_t curbyte,ctr,masklo;
-  uint8_t sreg_prev;
-
-  // masklo  =~maskhi&ws2812_PORTREG;
-  // maskhi |=        ws2812_PORTREG;
-  masklo  =~maskhi&_SFR_IO8((RGB_DI_PIN >> 4) + 2);
-  maskhi |=        _SFR_IO8((RGB_DI_PIN >> 4) + 2);
-  sreg_prev=SREG;
-  cli();
-
-  while (datlen--) {
-    curbyte=(*data++);
+  uint8_t ctr;
 
-    asm volatile(
-    "       ldi   %0,8  \n\t"
-    "loop%=:            \n\t"
-    "       out   %2,%3 \n\t"    //  '1' [01] '0' [01] - re
+  asm volatile(
+  "       ldi   %0,8  \n\t"
+  "loop%=:            \n\t"
+  "       out   %2,%3 \n\t"    //  '1' [01] '0' [01] - re
 #if (w1_nops&1)
 w_nop1
 #endif
@@ -296,9 +286,9 @@ w_nop8
 #if (w1_nops&16)
 w_nop16
 #endif
-    "       sbrs  %1,7  \n\t"    //  '1' [03] '0' [02]
-    "       out   %2,%4 \n\t"    //  '1' [--] '0' [03] - fe-low
-    "       lsl   %1    \n\t"    //  '1' [04] '0' [04]
+  "       sbrs  %1,7  \n\t"    //  '1' [03] '0' [02]
+  "       out   %2,%4 \n\t"    //  '1' [--] '0' [03] - fe-low
+  "       lsl   %1    \n\t"    //  '1' [04] '0' [04]
 #if (w2_nops&1)
   w_nop1
 #endif
@@ -314,7 +304,7 @@ w_nop16
 #if (w2_nops&16)
   w_nop16
 #endif
-    "       out   %2,%4 \n\t"    //  '1' [+1] '0' [+1] - fe-high
+  "       out   %2,%4 \n\t"    //  '1' [+1] '0' [+1] - fe-high
 #if (w3_nops&1)
 w_nop1
 #endif
@@ -331,12 +321,118 @@ w_nop8
 w_nop16
 #endif
 
-    "       dec   %0    \n\t"    //  '1' [+2] '0' [+2]
-    "       brne  loop%=\n\t"    //  '1' [+3] '0' [+4]
-    :	"=&d" (ctr)
-    :	"r" (curbyte), "I" (_SFR_IO_ADDR(_SFR_IO8((RGB_DI_PIN >> 4) + 2))), "r" (maskhi), "r" (masklo)
-    );
+  "       dec   %0    \n\t"    //  '1' [+2] '0' [+2]
+  "       brne  loop%=\n\t"    //  '1' [+3] '0' [+4]
+  :	"=&d" (ctr)
+  :	"r" (curbyte), "I" (_SFR_IO_ADDR(_SFR_IO8((RGB_DI_PIN >> 4) + 2))), "r" (maskhi), "r" (masklo)
+  );
+}
+
+#ifdef WS2812_CHUNKED
+#include <avr/timer_avr.h>
+
+static ws2812_stats_t stats;
+static bool frame_skipped;
+
+bool ws2812_frame_skipped(void)
+{
+  return frame_skipped;
+}
+
+void ws2812_get_stats(ws2812_stats_t *out)
+{
+  uint8_t sreg_prev = SREG;
+  cli();
+  *out = stats;
+  SREG = sreg_prev;
+}
+
+// Timer0 ticks between two reads of TIMER_RAW, which counts up to TIMER_RAW_TOP
+static inline uint8_t ws2812_ticks(uint8_t before, uint8_t after)
+{
+  return after >= before ? after - before : after + TIMER_RAW_TOP + 1 - before;
+}
+
+/*
+  Sends WS2812_CHUNK_SIZE bytes at a time with interrupts disabled, and lets
+  pending interrupts run in between. The strip latches when the line stays
+  low for too long, so the gap is timed with Timer0. If it may have been
+  longer than WS2812_MAX_GAP_TICKS, the line is held low for a full reset
+  and the frame starts over. After WS2812_MAX_RESTARTS restarts in a row,
+  the frame is given up, so that interrupts are never held off for more than
+  a chunk. The strip keeps the LEDs it has latched, and the caller sends the
+  frame again later when ws2812_frame_skipped returns true.
+*/
+static void ws2812_sendarray_chunked(uint8_t *data, uint16_t datlen, uint8_t pinmask)
+{
+  uint8_t maskhi, masklo;
+  uint8_t sreg_prev = SREG;
+  uint8_t restarts = 0;
+  uint16_t sent = 0;
+
+  cli();
+  while (sent < datlen) {
+    // Other pins of the port may have been changed by an interrupt
+    masklo = ~pinmask & _SFR_IO8((RGB_DI_PIN >> 4) + 2);
+    maskhi =  pinmask | _SFR_IO8((RGB_DI_PIN >> 4) + 2);
+
+    uint16_t end = sent + WS2812_CHUNK_SIZE;
+    if (end > datlen || !(sreg_prev & _BV(SREG_I))) {
+      end = datlen;
+    }
+    while (sent < end) {
+      ws2812_send_byte(data[sent++], maskhi, masklo);
+    }
+    if (sent == datlen) {
+      break;
+    }
+
+    uint8_t before = TIMER_RAW;
+    sei();
+    // One more instruction runs after sei before the pending interrupts are serviced
+    asm volatile("nop");
+    cli();
+    if (ws2812_ticks(before, TIMER_RAW) > WS2812_MAX_GAP_TICKS) {
+      sei();
+      _delay_us(WS2812_RESET_US);
+      cli();
+      if (restarts == WS2812_MAX_RESTARTS) {
+        break;
+      }
+      restarts++;
+      stats.restarts++;
+      sent = 0;
+    }
+  }
+  frame_skipped = sent < datlen;
+  if (frame_skipped) {
+    stats.skipped++;
+  }
+  stats.frames++;
+
+  SREG = sreg_prev;
+}
+#endif
+
+void inline ws2812_sendarray_mask(uint8_t *data,uint16_t datlen,uint8_t maskhi)
+{
+#ifdef WS2812_CHUNKED
+  ws2812_sendarray_chunked(data, datlen, maskhi);
+#else
+  uint8_t masklo;
+  uint8_t sreg_prev;
+
+  // masklo  =~maskhi&ws2812_PORTREG;
+  // maskhi |=        ws2812_PORTREG;
+  masklo  =~maskhi&_SFR_IO8((RGB_DI_PIN >> 4) + 2);
+  maskhi |=        _SFR_IO8((RGB_DI_PIN >> 4) + 2);
+  sreg_prev=SREG;
+  cli();
+
+  while (datlen--) {
+    ws2812_send_byte(*data++, maskhi, masklo);
   }
 
   SREG=sreg_prev;
+#endif
 }
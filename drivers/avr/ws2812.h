@@ -25,6 +25,7 @@
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <stdbool.h>
 //#include "ws2812_config.h"
 //#include "i2cmaster.h"
 
@@ -58,6 +59,48 @@ void ws2812_setleds_rgbw(LED_TYPE *ledarray, uint16_t number_of_leds);
 void ws2812_sendarray     (uint8_t *array,uint16_t length);
 void ws2812_sendarray_mask(uint8_t *array,uint16_t length, uint8_t pinmask);
 
+/*
+ * Chunked output
+ *
+ * With WS2812_CHUNKED defined, interrupts are only disabled for
+ * WS2812_CHUNK_SIZE bytes (10us each) at a time instead of the whole strip.
+ * If an interrupt makes the gap between two chunks long enough for the strip
+ * to latch, the frame is sent again from the start.
+ */
+#ifdef WS2812_CHUNKED
+
+#ifndef WS2812_CHUNK_SIZE
+#define WS2812_CHUNK_SIZE 3
+#endif
+
+// Longest gap between chunks that is accepted, in Timer0 ticks (4us at 16MHz)
+#ifndef WS2812_MAX_GAP_TICKS
+#define WS2812_MAX_GAP_TICKS 1
+#endif
+
+// Low time that resets the strip before a frame is sent again, in us
+#ifndef WS2812_RESET_US
+#define WS2812_RESET_US 300
+#endif
+
+// Restarts of a frame before it's given up until the next try
+#ifndef WS2812_MAX_RESTARTS
+#define WS2812_MAX_RESTARTS 3
+#endif
+
+typedef struct {
+  uint16_t frames;
+  uint16_t restarts;  // frames sent again because an interrupt took too long
+  uint16_t skipped;   // frames given up after WS2812_MAX_RESTARTS restarts
+} ws2812_stats_t;
+
+void ws2812_get_stats(ws2812_stats_t *stats);
+// Whether the last frame was given up, the strip shows it only partially
+// until it's sent again
+bool ws2812_frame_skipped(void);
+
+#endif
+
 
 /*
  * Internal defines
@@ -98,6 +98,11 @@ extern const uint8_t CIE1931_CURVE[];
 
 #define IS31_LED_MASK_SIZE 0x12
 
+// The PWM registers are tracked in blocks of one matrix row, so that only
+// the rows that changed are written
+#define IS31_PWM_BLOCK_SIZE 0x10
+#define IS31_PWM_BLOCKS (IS31_PWM_SIZE / IS31_PWM_BLOCK_SIZE)
+
 #define IS31
 
 /*===========================================================================*/
@@ -106,8 +111,14 @@ extern const uint8_t CIE1931_CURVE[];
 
 typedef struct{
     uint8_t write_buffer_offset;
+    // The PWM registers as they should be, after the backlight and the curve
     uint8_t write_buffer[IS31_FRAME_SIZE];
     uint8_t frame_buffer[GDISP_SCREEN_HEIGHT * GDISP_SCREEN_WIDTH];
+    // CIE1931_CURVE scaled by the backlight
+    uint8_t curve[256];
+    // The blocks of each of the two pages that differ from write_buffer
+    uint16_t dirty_blocks[2];
+    // The page being displayed
     uint8_t page;
 }__attribute__((__packed__)) PrivData;
 
@@ -139,6 +150,35 @@ static GFXINLINE void write_ram(GDisplay *g, uint8_t page, uint16_t offset, uint
     write_data(g, (uint8_t*)PRIV(g), length + 1);
 }
 
+// Writes length PWM registers from write_buffer, starting at start. The
+// register address is sent from the byte before, which is saved and restored.
+static GFXINLINE void write_pwm(GDisplay *g, uint8_t page, uint8_t start, uint8_t length) {
+    uint8_t* tx = &PRIV(g)->write_buffer[start] - 1;
+    uint8_t saved = *tx;
+    *tx = IS31_PWM_REG + start;
+    write_page(g, page);
+    write_data(g, tx, length + 1);
+    *tx = saved;
+}
+
+static void update_curve(GDisplay *g) {
+    for (uint16_t i = 0; i < 256; i++) {
+        PRIV(g)->curve[i] = CIE1931_CURVE[i * g->g.Backlight / 100];
+    }
+}
+
+static GFXINLINE void set_pwm(GDisplay *g, coord_t x, coord_t y, uint8_t value) {
+    uint8_t address = get_led_address(g, x, y);
+    uint8_t pwm = PRIV(g)->curve[value];
+    if (PRIV(g)->write_buffer[address] != pwm) {
+        PRIV(g)->write_buffer[address] = pwm;
+        uint16_t block = 1 << (address / IS31_PWM_BLOCK_SIZE);
+        PRIV(g)->dirty_blocks[0] |= block;
+        PRIV(g)->dirty_blocks[1] |= block;
+        g->flags |= GDISP_FLG_NEEDFLUSH;
+    }
+}
+
 LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
     // The private area is the display surface.
     g->priv = gfxAlloc(sizeof(PrivData));
@@ -182,6 +222,10 @@ LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
     g->g.Powermode = powerOff;
     g->g.Backlight = GDISP_INITIAL_BACKLIGHT;
     g->g.Contrast = GDISP_INITIAL_CONTRAST;
+
+    // From now on write_buffer holds the PWM registers, which are all zero
+    __builtin_memset(PRIV(g)->write_buffer, 0, sizeof(PRIV(g)->write_buffer));
+    update_curve(g);
     return TRUE;
 }
 
@@ -191,25 +235,33 @@ LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
         if (!(g->flags & GDISP_FLG_NEEDFLUSH))
             return;
 
-        PRIV(g)->page++;
-        PRIV(g)->page %= 2;
-        // TODO: some smarter algorithm for this
-        // We should run only one physical page at a time
-        // This way we don't need to send so much data, and
-        // we could use slightly less memory
-        uint8_t* src = PRIV(g)->frame_buffer;
-        for (int y=0;y<GDISP_SCREEN_HEIGHT;y++) {
-            for (int x=0;x<GDISP_SCREEN_WIDTH;x++) {
-                uint8_t val = (uint16_t)*src * g->g.Backlight / 100;
-                PRIV(g)->write_buffer[get_led_address(g, x, y)]=CIE1931_CURVE[val];
-                ++src;
+        g->flags &= ~GDISP_FLG_NEEDFLUSH;
+
+        // The hidden page is brought up to date and then displayed. It only
+        // needs the blocks that changed since it was written the last time,
+        // the pixels were converted to PWM values as they were drawn.
+        uint8_t page = PRIV(g)->page ^ 1;
+        uint16_t dirty = PRIV(g)->dirty_blocks[page];
+        if (!dirty)
+            return;
+        uint8_t block = 0;
+        while (dirty) {
+            if (!(dirty & 1)) {
+                dirty >>= 1;
+                block++;
+                continue;
+            }
+            // A run of consecutive blocks goes in one transfer
+            uint8_t first = block;
+            while (dirty & 1) {
+                dirty >>= 1;
+                block++;
             }
+            write_pwm(g, page, first * IS31_PWM_BLOCK_SIZE, (block - first) * IS31_PWM_BLOCK_SIZE);
         }
-        write_ram(g, PRIV(g)->page, IS31_PWM_REG, IS31_PWM_SIZE);
-        gfxSleepMilliseconds(1);
-        write_register(g, IS31_FUNCTIONREG, IS31_REG_PICTDISP, PRIV(g)->page);
-
-        g->flags &= ~GDISP_FLG_NEEDFLUSH;
+        PRIV(g)->dirty_blocks[page] = 0;
+        write_register(g, IS31_FUNCTIONREG, IS31_REG_PICTDISP, page);
+        PRIV(g)->page = page;
     }
 #endif
 
@@ -228,8 +280,9 @@ LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
             y = g->p.y;
             break;
         }
-        PRIV(g)->frame_buffer[y * GDISP_SCREEN_WIDTH + x] = gdispColor2Native(g->p.color);
-        g->flags |= GDISP_FLG_NEEDFLUSH;
+        uint8_t value = gdispColor2Native(g->p.color);
+        PRIV(g)->frame_buffer[y * GDISP_SCREEN_WIDTH + x] = value;
+        set_pwm(g, x, y, value);
     }
 #endif
 
@@ -299,7 +352,13 @@ LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
                 return;
             unsigned val = (unsigned)g->p.ptr;
             g->g.Backlight = val > 100 ? 100 : val;
-            g->flags |= GDISP_FLG_NEEDFLUSH;
+            update_curve(g);
+            uint8_t* src = PRIV(g)->frame_buffer;
+            for (coord_t y = 0; y < GDISP_SCREEN_HEIGHT; y++) {
+                for (coord_t x = 0; x < GDISP_SCREEN_WIDTH; x++) {
+                    set_pwm(g, x, y, *src++);
+                }
+            }
             return;
         }
     }
@@ -56,11 +56,21 @@
 /* Driver local functions.                                                   */
 /*===========================================================================*/
 
+#define ST7565_PAGES                (GDISP_SCREEN_HEIGHT / 8)
+
+// The columns of a page that differ from the display, empty when start > end
+typedef struct{
+    uint8_t start;
+    uint8_t end;
+}DirtySpan;
+
 typedef struct{
     bool_t buffer2;
     uint8_t data_pos;
     uint8_t data[16];
     uint8_t ram[GDISP_SCREEN_HEIGHT * GDISP_SCREEN_WIDTH / 8];
+    // One set of spans for each half of the display RAM
+    DirtySpan dirty[2][ST7565_PAGES];
 }PrivData;
 
 // Some common routines and macros
@@ -86,6 +96,41 @@ static GFXINLINE void flush_cmd(GDisplay* g) {
 #define xyaddr(x, y)        ((x) + ((y)>>3)*GDISP_SCREEN_WIDTH)
 #define xybit(y)            (1<<((y)&7))
 
+static st7565_flush_stats_t flush_stats;
+
+void st7565_get_flush_stats(st7565_flush_stats_t* stats) {
+    *stats = flush_stats;
+}
+
+static GFXINLINE void clear_spans(DirtySpan* spans) {
+    for (unsigned p = 0; p < ST7565_PAGES; p++) {
+        spans[p].start = GDISP_SCREEN_WIDTH - 1;
+        spans[p].end = 0;
+    }
+}
+
+static GFXINLINE void mark_dirty(GDisplay* g, coord_t x, coord_t y) {
+    for (unsigned i = 0; i < 2; i++) {
+        DirtySpan* span = &PRIV(g)->dirty[i][y >> 3];
+        if (x < span->start)
+            span->start = x;
+        if (x > span->end)
+            span->end = x;
+    }
+    g->flags |= GDISP_FLG_NEEDFLUSH;
+}
+
+static GFXINLINE void set_pixel(GDisplay* g, coord_t x, coord_t y, bool_t on) {
+    uint8_t* dst = &RAM(g)[xyaddr(x, y)];
+    uint8_t old = *dst;
+    if (on)
+        *dst |= xybit(y);
+    else
+        *dst &= ~xybit(y);
+    if (*dst != old)
+        mark_dirty(g, x, y);
+}
+
 /*===========================================================================*/
 /* Driver exported functions.                                                */
 /*===========================================================================*/
@@ -102,6 +147,13 @@ LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
     g->priv = gfxAlloc(sizeof(PrivData));
     PRIV(g)->buffer2 = false;
     PRIV(g)->data_pos = 0;
+    // Nothing is known about the display RAM, so everything goes out on the first flushes
+    for (unsigned i = 0; i < 2; i++) {
+        for (unsigned p = 0; p < ST7565_PAGES; p++) {
+            PRIV(g)->dirty[i][p].start = 0;
+            PRIV(g)->dirty[i][p].end = GDISP_SCREEN_WIDTH - 1;
+        }
+    }
 
     // Initialise the board interface
     init_board(g);
@@ -156,19 +208,30 @@ LLDSPEC void gdisp_lld_flush(GDisplay *g) {
     if (!(g->flags & GDISP_FLG_NEEDFLUSH))
         return;
 
+    // Only the columns that changed since this half of the display RAM was
+    // written the last time are sent
     acquire_bus(g);
     enter_cmd_mode(g);
-    unsigned dstOffset = (PRIV(g)->buffer2 ? 4 : 0);
-    for (p = 0; p < 4; p++) {
+    unsigned dstOffset = (PRIV(g)->buffer2 ? ST7565_PAGES : 0);
+    DirtySpan* spans = PRIV(g)->dirty[PRIV(g)->buffer2 ? 1 : 0];
+    for (p = 0; p < ST7565_PAGES; p++) {
+        unsigned start = spans[p].start;
+        if (start > spans[p].end)
+            continue;
+        unsigned length = spans[p].end - start + 1;
         write_cmd(g, ST7565_PAGE | (p + dstOffset));
-        write_cmd(g, ST7565_COLUMN_MSB | 0);
-        write_cmd(g, ST7565_COLUMN_LSB | 0);
+        write_cmd(g, ST7565_COLUMN_MSB | (start >> 4));
+        write_cmd(g, ST7565_COLUMN_LSB | (start & 0xF));
         write_cmd(g, ST7565_RMW);
         flush_cmd(g);
         enter_data_mode(g);
-        write_data(g, RAM(g) + (p*GDISP_SCREEN_WIDTH), GDISP_SCREEN_WIDTH);
+        write_data(g, RAM(g) + (p*GDISP_SCREEN_WIDTH) + start, length);
         enter_cmd_mode(g);
+        flush_stats.bytes_sent += length;
     }
+    clear_spans(spans);
+    flush_stats.flushes++;
+    flush_stats.bytes_full += ST7565_PAGES * GDISP_SCREEN_WIDTH;
     unsigned line = (PRIV(g)->buffer2 ? 32 : 0);
     write_cmd(g, ST7565_START_LINE | line);
     flush_cmd(g);
@@ -202,11 +265,7 @@ LLDSPEC void gdisp_lld_draw_pixel(GDisplay *g) {
         y = g->p.x;
         break;
     }
-    if (gdispColor2Native(g->p.color) != Black)
-        RAM(g)[xyaddr(x, y)] |= xybit(y);
-    else
-        RAM(g)[xyaddr(x, y)] &= ~xybit(y);
-    g->flags |= GDISP_FLG_NEEDFLUSH;
+    set_pixel(g, x, y, gdispColor2Native(g->p.color) != Black);
 }
 #endif
 
@@ -250,18 +309,11 @@ LLDSPEC void gdisp_lld_blit_area(GDisplay *g) {
             uint8_t src = buffer[srcbit / 8];
             uint8_t bit = 7-(srcbit % 8);
             uint8_t bitset = (src >> bit) & 1;
-            uint8_t* dst = &(RAM(g)[xyaddr(dstx, dsty)]);
-            if (bitset) {
-                *dst |= xybit(dsty);
-            }
-            else {
-                *dst &= ~xybit(dsty);
-            }
+            set_pixel(g, dstx, dsty, bitset);
             dstx++;
             srcbit++;
         }
     }
-    g->flags |= GDISP_FLG_NEEDFLUSH;
 }
 
 #if GDISP_NEED_CONTROL && GDISP_HARDWARE_CONTROL
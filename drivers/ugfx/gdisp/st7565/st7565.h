@@ -36,4 +36,13 @@
 
 #define ST7565_RESET                0xE2
 
+// Data bytes sent by the flushes, and how many full screen flushes would have sent
+typedef struct {
+    uint32_t flushes;
+    uint32_t bytes_sent;
+    uint32_t bytes_full;
+} st7565_flush_stats_t;
+
+void st7565_get_flush_stats(st7565_flush_stats_t* stats);
+
 #endif /* _ST7565_H */
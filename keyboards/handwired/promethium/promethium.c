@@ -4,9 +4,9 @@
 #include "matrix.h"
 #include "musical_notes.h"
 
-float fauxclicky_pressed_note[2] = MUSICAL_NOTE(_A4, 0.0625);
-float fauxclicky_released_note[2] = MUSICAL_NOTE(_A4, 0.0625);
-float fauxclicky_beep_note[2] = MUSICAL_NOTE(_C6, 0.25);
+float fauxclicky_pressed_note[2] = {NOTE_A4, 0.0625};
+float fauxclicky_released_note[2] = {NOTE_A4, 0.0625};
+float fauxclicky_beep_note[2] = {NOTE_C6, 0.25};
 
 // cubic fit {3.3, 0}, {3.5, 2.9}, {3.6, 5}, {3.7, 8.6}, {3.8, 36},  {3.9, 62}, {4.0, 73}, {4.05, 83}, {4.1, 89}, {4.15, 94}, {4.2, 100}
 
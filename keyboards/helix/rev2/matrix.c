@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "util.h"
 #include "matrix.h"
 #include "split_util.h"
+#include "split_transport.h"
 #include "pro_micro.h"
 #include "config.h"
 
@@ -153,7 +154,7 @@ int i2c_transaction(void) {
     int err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_WRITE);
     if (err) goto i2c_error;
 
-    // start of matrix stored at 0x00
+    // start of the split transport buffer stored at 0x00
     err = i2c_master_write(0x00);
     if (err) goto i2c_error;
 
@@ -162,12 +163,21 @@ int i2c_transaction(void) {
     if (err) goto i2c_error;
 
     if (!err) {
-        int i;
-        for (i = 0; i < ROWS_PER_HAND-1; ++i) {
-            matrix[slaveOffset+i] = i2c_master_read(I2C_ACK);
+        // Only read the rows when the slave reports a change, see split_transport.h
+        split_transport_header_t header;
+        uint8_t rows[SPLIT_TRANSPORT_ROWS_SIZE];
+        header.seq = i2c_master_read(I2C_ACK);
+        header.changed = i2c_master_read(I2C_ACK);
+        uint8_t count = split_transport_rows_to_read(&header);
+        uint8_t size = count * sizeof(matrix_row_t);
+        header.checksum = i2c_master_read(size ? I2C_ACK : I2C_NACK);
+        for (uint8_t i = 0; i < size; ++i) {
+            rows[i] = i2c_master_read(i < size - 1 ? I2C_ACK : I2C_NACK);
         }
-        matrix[slaveOffset+i] = i2c_master_read(I2C_NACK);
         i2c_master_stop();
+        if (!split_transport_apply(&header, (matrix_row_t*)rows, count, &matrix[slaveOffset])) {
+            return 1;
+        }
     } else {
 i2c_error: // the cable is disconnceted, or something else went wrong
         i2c_reset_state();
@@ -254,6 +264,7 @@ uint8_t matrix_master_scan(void) {
             for (int i = 0; i < ROWS_PER_HAND; ++i) {
                 matrix[slaveOffset+i] = 0;
             }
+            split_transport_reset();
         }
     } else {
         // turn off the indicator led on no error
@@ -270,10 +281,7 @@ void matrix_slave_scan(void) {
     int offset = (isLeftHand) ? 0 : ROWS_PER_HAND;
 
 #ifdef USE_MATRIX_I2C
-    for (int i = 0; i < ROWS_PER_HAND; ++i) {
-        /* i2c_slave_buffer[i] = matrix[offset+i]; */
-        i2c_slave_buffer[i] = matrix[offset+i];
-    }
+    split_transport_slave_update(i2c_slave_buffer, &matrix[offset]);
 #else // USE_SERIAL
     for (int i = 0; i < ROWS_PER_HAND; ++i) {
         serial_slave_buffer[i] = matrix[offset+i];
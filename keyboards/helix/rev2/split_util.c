@@ -8,6 +8,7 @@
 #include "matrix.h"
 #include "keyboard.h"
 #include "config.h"
+#include "split_transport.h"
 
 #ifdef USE_MATRIX_I2C
 #  include "i2c.h"
@@ -42,6 +43,7 @@ static void keyboard_master_setup(void) {
 static void keyboard_slave_setup(void) {
 
 #ifdef USE_MATRIX_I2C
+    split_transport_slave_init(i2c_slave_buffer);
     i2c_slave_init(SLAVE_I2C_ADDRESS);
 #else
     serial_slave_init();
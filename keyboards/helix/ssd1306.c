@@ -24,11 +24,21 @@
 //static uint32_t vbat;
 //#define BatteryUpdateInterval 10000 /* milliseconds */
 #define ScreenOffInterval 300000 /* milliseconds */
+// Max time one call to matrix_render spends sending changed characters,
+// whatever is left over is sent by the following calls
+#ifndef SSD1306_RENDER_BUDGET
+#define SSD1306_RENDER_BUDGET 2 /* milliseconds */
+#endif
 #if DEBUG_TO_SCREEN
 static uint8_t displaying;
 #endif
 static uint16_t last_flush;
 
+// What is currently shown on the screen, so that only changed characters are sent
+static uint8_t rendered[MatrixRows][MatrixCols];
+// Bitmask of the rows where the contents of rendered are valid
+static uint8_t rendered_rows;
+
 // Write command sequence.
 // Returns true on success.
 static inline bool _send_cmd1(uint8_t cmd) {
@@ -102,6 +112,8 @@ static void clear_display(void) {
   }
 
   display.dirty = false;
+  // The screen is blank now, which doesn't match any characters
+  rendered_rows = 0;
 
 done:
   i2c_master_stop();
@@ -260,16 +272,13 @@ void iota_gfx_clear_screen(void) {
   matrix_clear(&display);
 }
 
-void matrix_render(struct CharacterMatrix *matrix) {
-  last_flush = timer_read();
-  iota_gfx_on();
-#if DEBUG_TO_SCREEN
-  ++displaying;
-#endif
+// Send the characters first_col to last_col of one row.
+// Returns true on success
+static bool render_span(const uint8_t *chars, uint8_t row, uint8_t first_col, uint8_t last_col) {
+  bool res = false;
 
-  // Move to the home position
-  send_cmd3(PageAddr, 0, MatrixRows - 1);
-  send_cmd3(ColumnAddr, 0, (MatrixCols * FontWidth) - 1);
+  send_cmd3(PageAddr, row, row);
+  send_cmd3(ColumnAddr, first_col * FontWidth, ((last_col + 1) * FontWidth) - 1);
 
   if (i2c_start_write(SSD1306_ADDRESS)) {
     goto done;
@@ -279,27 +288,64 @@ void matrix_render(struct CharacterMatrix *matrix) {
     goto done;
   }
 
-  for (uint8_t row = 0; row < MatrixRows; ++row) {
-    for (uint8_t col = 0; col < MatrixCols; ++col) {
-      const uint8_t *glyph = font + (matrix->display[row][col] * FontWidth);
+  for (uint8_t col = first_col; col <= last_col; ++col) {
+    const uint8_t *glyph = font + (chars[col] * FontWidth);
+
+    for (uint8_t glyphCol = 0; glyphCol < FontWidth; ++glyphCol) {
+      uint8_t colBits = pgm_read_byte(glyph + glyphCol);
+      i2c_master_write(colBits);
+    }
+  }
+  res = true;
 
-      for (uint8_t glyphCol = 0; glyphCol < FontWidth; ++glyphCol) {
-        uint8_t colBits = pgm_read_byte(glyph + glyphCol);
-        i2c_master_write(colBits);
+done:
+  i2c_master_stop();
+  return res;
+}
+
+void matrix_render(struct CharacterMatrix *matrix) {
+  last_flush = timer_read();
+  iota_gfx_on();
+#if DEBUG_TO_SCREEN
+  ++displaying;
+#endif
+
+  bool sent = false;
+  for (uint8_t row = 0; row < MatrixRows; ++row) {
+    // Find the changed part of the row
+    uint8_t first_col = 0;
+    uint8_t last_col = MatrixCols - 1;
+    if (rendered_rows & (1 << row)) {
+      while (first_col < MatrixCols && matrix->display[row][first_col] == rendered[row][first_col]) {
+        ++first_col;
+      }
+      if (first_col == MatrixCols) {
+        continue;
       }
+      while (matrix->display[row][last_col] == rendered[row][last_col]) {
+        --last_col;
+      }
+    }
 
-      // 1 column of space between chars (it's not included in the glyph)
-      //i2c_master_write(0);
+    // Always make some progress, but leave the rest for later when out of time
+    if (sent && timer_elapsed(last_flush) >= SSD1306_RENDER_BUDGET) {
+      goto done;
     }
+    if (!render_span(matrix->display[row], row, first_col, last_col)) {
+      goto done;
+    }
+    memcpy(&rendered[row][first_col], &matrix->display[row][first_col], last_col - first_col + 1);
+    rendered_rows |= (1 << row);
+    sent = true;
   }
 
   matrix->dirty = false;
 
 done:
-  i2c_master_stop();
 #if DEBUG_TO_SCREEN
   --displaying;
 #endif
+  return;
 }
 
 void iota_gfx_flush(void) {
@@ -8,6 +8,7 @@
 #include "matrix.h"
 #include "keyboard.h"
 #include "config.h"
+#include "split_transport.h"
 #include "timer.h"
 
 #ifdef USE_I2C
@@ -45,8 +46,10 @@ static void keyboard_master_setup(void) {
 static void keyboard_slave_setup(void) {
   timer_init();
 #ifdef USE_I2C
+    split_transport_slave_init(&i2c_slave_buffer[1]);
     i2c_slave_init(SLAVE_I2C_ADDRESS);
 #else
+    split_transport_slave_init(serial_slave_buffer);
     serial_slave_init();
 #endif
 }
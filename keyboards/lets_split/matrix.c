@@ -27,6 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "util.h"
 #include "matrix.h"
 #include "split_util.h"
+#include "split_transport.h"
 #include "pro_micro.h"
 #include "config.h"
 #include "timer.h"
@@ -203,7 +204,7 @@ int i2c_transaction(void) {
     int err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_WRITE);
     if (err) goto i2c_error;
 
-    // start of matrix stored at 0x00
+    // start of the split transport buffer stored at 0x00
     err = i2c_master_write(0x00);
     if (err) goto i2c_error;
 
@@ -212,12 +213,21 @@ int i2c_transaction(void) {
     if (err) goto i2c_error;
 
     if (!err) {
-        int i;
-        for (i = 0; i < ROWS_PER_HAND-1; ++i) {
-            matrix[slaveOffset+i] = i2c_master_read(I2C_ACK);
+        // Only read the rows when the slave reports a change, see split_transport.h
+        split_transport_header_t header;
+        uint8_t rows[SPLIT_TRANSPORT_ROWS_SIZE];
+        header.seq = i2c_master_read(I2C_ACK);
+        header.changed = i2c_master_read(I2C_ACK);
+        uint8_t count = split_transport_rows_to_read(&header);
+        uint8_t size = count * sizeof(matrix_row_t);
+        header.checksum = i2c_master_read(size ? I2C_ACK : I2C_NACK);
+        for (uint8_t i = 0; i < size; ++i) {
+            rows[i] = i2c_master_read(i < size - 1 ? I2C_ACK : I2C_NACK);
         }
-        matrix[slaveOffset+i] = i2c_master_read(I2C_NACK);
         i2c_master_stop();
+        if (!split_transport_apply(&header, (matrix_row_t*)rows, count, &matrix[slaveOffset])) {
+            return 1;
+        }
     } else {
 i2c_error: // the cable is disconnceted, or something else went wrong
         i2c_reset_state();
@@ -232,15 +242,22 @@ i2c_error: // the cable is disconnceted, or something else went wrong
 int serial_transaction(void) {
     int slaveOffset = (isLeftHand) ? (ROWS_PER_HAND) : 0;
 
-    if (serial_update_buffers()) {
+    // Only the rows the master is missing come back, see split_transport.h
+    uint8_t length = split_transport_master_request((uint8_t*)serial_master_buffer);
+    if (serial_update_buffers(length, &length)) {
         return 1;
     }
 
-    for (int i = 0; i < ROWS_PER_HAND; ++i) {
-        matrix[slaveOffset+i] = serial_slave_buffer[i];
+    if (!split_transport_master_response((uint8_t*)serial_slave_buffer, length, &matrix[slaveOffset])) {
+        return 1;
     }
     return 0;
 }
+
+// Called from the serial interrupt, the slave's half is published in serial_slave_buffer
+uint8_t serial_slave_respond(const uint8_t* request, uint8_t length, uint8_t* response) {
+    return split_transport_slave_response(serial_slave_buffer, request, length, response);
+}
 #endif
 
 uint8_t matrix_scan(void)
@@ -263,6 +280,7 @@ uint8_t matrix_scan(void)
             for (int i = 0; i < ROWS_PER_HAND; ++i) {
                 matrix[slaveOffset+i] = 0;
             }
+            split_transport_reset();
         }
     } else {
         // turn off the indicator led on no error
@@ -279,13 +297,15 @@ void matrix_slave_scan(void) {
     int offset = (isLeftHand) ? 0 : ROWS_PER_HAND;
 
 #ifdef USE_I2C
-    for (int i = 0; i < ROWS_PER_HAND; ++i) {
-        i2c_slave_buffer[i] = matrix[offset+i];
-    }
+    split_transport_slave_update(i2c_slave_buffer, &matrix[offset]);
 #else // USE_SERIAL
-    for (int i = 0; i < ROWS_PER_HAND; ++i) {
-        serial_slave_buffer[i] = matrix[offset+i];
+    uint8_t request[SERIAL_MASTER_BUFFER_LENGTH];
+    uint8_t length = serial_slave_receive(request);
+    if (length) {
+        // Layer, LED, backlight and RGB light state from the master
+        split_transport_slave_apply(request, length);
     }
+    split_transport_slave_update(serial_slave_buffer, &matrix[offset]);
 #endif
 }
 
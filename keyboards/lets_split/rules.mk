@@ -71,6 +71,7 @@ USE_I2C = yes
 SLEEP_LED_ENABLE = no    # Breathing sleep LED during USB suspend
 
 CUSTOM_MATRIX = yes
+SPLIT_KEYBOARD = yes
 
 LAYOUTS = ortho_4x12
 
@@ -15,6 +15,7 @@
  */
 
 #include "api.h"
+#include "api_stream.h"
 #include "quantum.h"
 
 void dword_to_bytes(uint32_t dword, uint8_t * bytes) {
@@ -170,6 +171,10 @@ void process_api(uint16_t length, uint8_t * data) {
             break;
         case MT_EXE_ACTION_ACK:
             break;
+        case MT_STREAM:
+            if (length >= 2)
+                api_stream_process(data[1], data + 2, length - 2);
+            break;
         case MT_TYPE_ERROR:
             break;
         default: ; // command not recognised
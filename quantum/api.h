@@ -28,6 +28,7 @@ enum MESSAGE_TYPE {
     MT_SEND_DATA_ACK = 0x31, // returned data/action confirmation (ACK)
     MT_EXE_ACTION =    0x40, // executing actions on keyboard
     MT_EXE_ACTION_ACK =0x41, // return confirmation/value (ACK)
+    MT_STREAM =        0x50, // transferring a large object in chunks (api_stream.h)
     MT_TYPE_ERROR =    0x80 // type not recofgnised (ACK)
 };
 
@@ -0,0 +1,254 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "api_stream.h"
+
+#if API_STREAM_WINDOW < 1 || API_STREAM_WINDOW > 127
+    #error "API_STREAM_WINDOW has to be between 1 and 127"
+#endif
+
+static struct {
+    uint8_t opcode;    // ST_SET or ST_GET while a transfer is going on, 0 otherwise
+    bool uploaded;     // the last transfer was an upload that completed
+    uint8_t data_type;
+    uint32_t length;
+    uint32_t offset;   // bytes received in order, or acknowledged by the host
+    uint8_t sequence;  // the sequence number of the chunk at offset
+    uint8_t received;  // chunks received since the last acknowledgement
+    uint8_t sent;      // chunks sent after offset
+} stream;
+
+__attribute__ ((weak))
+bool api_stream_set_begin(uint8_t data_type, uint32_t length) {
+    return false;
+}
+
+__attribute__ ((weak))
+bool api_stream_set_write(uint8_t data_type, uint32_t offset, uint8_t * data, uint8_t length) {
+    return false;
+}
+
+__attribute__ ((weak))
+void api_stream_set_end(uint8_t data_type, bool complete) {
+}
+
+__attribute__ ((weak))
+uint32_t api_stream_get_length(uint8_t data_type) {
+    return 0;
+}
+
+__attribute__ ((weak))
+bool api_stream_get_read(uint8_t data_type, uint32_t offset, uint8_t * data, uint8_t length) {
+    return false;
+}
+
+static void put_dword(uint8_t * bytes, uint32_t dword) {
+    bytes[0] = (dword >> 24) & 0xFF;
+    bytes[1] = (dword >> 16) & 0xFF;
+    bytes[2] = (dword >> 8) & 0xFF;
+    bytes[3] = (dword >> 0) & 0xFF;
+}
+
+static uint32_t get_dword(uint8_t * bytes) {
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | (uint32_t)bytes[3];
+}
+
+static void send_ack(uint8_t data_type, uint8_t status, uint8_t sequence) {
+    uint8_t ack[3] = {ST_ACK, status, sequence};
+    api_stream_send(data_type, ack, sizeof(ack));
+}
+
+static uint8_t chunk_length(uint32_t offset) {
+    uint32_t left = stream.length - offset;
+    return left < API_STREAM_CHUNK_SIZE ? left : API_STREAM_CHUNK_SIZE;
+}
+
+static void end_transfer(bool complete) {
+    if (stream.opcode == ST_SET) {
+        api_stream_set_end(stream.data_type, complete);
+        stream.uploaded = complete;
+    }
+    stream.opcode = 0;
+}
+
+static void abandon_transfer(void) {
+    uint8_t data_type = stream.data_type;
+    end_transfer(false);
+    send_ack(data_type, SS_ERROR, 0);
+}
+
+// Sends the chunks after the ones in flight, until the window is full
+static void send_window(void) {
+    uint8_t chunk[2 + API_STREAM_CHUNK_SIZE];
+    chunk[0] = ST_DATA;
+    while (stream.sent < API_STREAM_WINDOW) {
+        uint32_t offset = stream.offset + (uint32_t)stream.sent * API_STREAM_CHUNK_SIZE;
+        if (offset >= stream.length) {
+            return;
+        }
+        uint8_t length = chunk_length(offset);
+        chunk[1] = stream.sequence + stream.sent;
+        if (!api_stream_get_read(stream.data_type, offset, chunk + 2, length)) {
+            abandon_transfer();
+            return;
+        }
+        api_stream_send(stream.data_type, chunk, 2 + length);
+        stream.sent++;
+    }
+}
+
+static void process_set(uint8_t data_type, uint8_t * data, uint8_t length) {
+    if (length < 5) {
+        return;
+    }
+    end_transfer(false);
+    uint32_t object_length = get_dword(data + 1);
+    if (!api_stream_set_begin(data_type, object_length)) {
+        send_ack(data_type, SS_REFUSED, 0);
+        return;
+    }
+    stream.opcode = ST_SET;
+    stream.data_type = data_type;
+    stream.length = object_length;
+    stream.offset = 0;
+    stream.sequence = 0;
+    stream.received = 0;
+    if (object_length == 0) {
+        end_transfer(true);
+        send_ack(data_type, SS_DONE, 0);
+    } else {
+        send_ack(data_type, SS_OK, 0);
+    }
+}
+
+static void process_get(uint8_t data_type) {
+    end_transfer(false);
+    uint8_t reply[5] = {ST_GET};
+    uint32_t object_length = api_stream_get_length(data_type);
+    if (object_length == 0) {
+        send_ack(data_type, SS_REFUSED, 0);
+        return;
+    }
+    put_dword(reply + 1, object_length);
+    api_stream_send(data_type, reply, sizeof(reply));
+
+    stream.opcode = ST_GET;
+    stream.data_type = data_type;
+    stream.length = object_length;
+    stream.offset = 0;
+    stream.sequence = 0;
+    stream.sent = 0;
+    send_window();
+}
+
+static void process_data(uint8_t * data, uint8_t length) {
+    if (length < 2) {
+        return;
+    }
+    uint8_t sequence = data[1];
+    if (sequence != stream.sequence) {
+        // Lost or repeated chunks, asks for the chunk it expects again
+        stream.received = 0;
+        send_ack(stream.data_type, SS_OK, stream.sequence);
+        return;
+    }
+    uint8_t chunk = length - 2;
+    if (chunk != chunk_length(stream.offset) ||
+        !api_stream_set_write(stream.data_type, stream.offset, data + 2, chunk)) {
+        abandon_transfer();
+        return;
+    }
+    stream.offset += chunk;
+    stream.sequence++;
+    stream.received++;
+    if (stream.offset == stream.length) {
+        end_transfer(true);
+        send_ack(stream.data_type, SS_DONE, stream.sequence);
+    } else if (stream.received == API_STREAM_WINDOW) {
+        stream.received = 0;
+        send_ack(stream.data_type, SS_OK, stream.sequence);
+    }
+}
+
+static void process_ack(uint8_t * data, uint8_t length) {
+    if (length < 3) {
+        return;
+    }
+    if (data[1] != SS_OK) {
+        end_transfer(false);
+        return;
+    }
+    uint8_t acknowledged = data[2] - stream.sequence;
+    if (acknowledged > stream.sent) {
+        return;
+    }
+    if (acknowledged == 0) {
+        // The host is missing the first chunk in flight, so all of them go again
+        stream.sent = 0;
+    } else {
+        stream.offset += (uint32_t)acknowledged * API_STREAM_CHUNK_SIZE;
+        stream.sequence += acknowledged;
+        stream.sent -= acknowledged;
+        if (stream.offset >= stream.length) {
+            end_transfer(true);
+            return;
+        }
+    }
+    send_window();
+}
+
+void api_stream_process(uint8_t data_type, uint8_t * data, uint8_t length) {
+    if (length < 1) {
+        return;
+    }
+    uint8_t opcode = data[0];
+    if (opcode == ST_SET || opcode == ST_GET) {
+        stream.uploaded = false;
+    }
+    if (opcode == ST_SET) {
+        process_set(data_type, data, length);
+        return;
+    }
+    if (opcode == ST_GET) {
+        process_get(data_type);
+        return;
+    }
+    if (stream.opcode == 0 && stream.uploaded && data_type == stream.data_type && opcode == ST_DATA) {
+        // The host has missed the end of the upload
+        send_ack(data_type, SS_DONE, stream.sequence);
+        return;
+    }
+    if (stream.opcode == 0 || data_type != stream.data_type) {
+        // Nothing to continue, so that the host stops
+        if (opcode == ST_DATA || opcode == ST_ACK) {
+            send_ack(data_type, SS_ERROR, 0);
+        }
+        return;
+    }
+    switch (opcode) {
+        case ST_DATA:
+            if (stream.opcode == ST_SET) {
+                process_data(data, length);
+            }
+            break;
+        case ST_ACK:
+            if (stream.opcode == ST_GET) {
+                process_ack(data, length);
+            }
+            break;
+        case ST_ABORT:
+            end_transfer(false);
+            break;
+    }
+}
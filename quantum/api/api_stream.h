@@ -0,0 +1,85 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _API_STREAM_H_
+#define _API_STREAM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Transfers objects larger than one API message, such as keymaps, macros or
+ * LED maps, as MT_STREAM messages. The host starts an upload with ST_SET or
+ * a download with ST_GET, and the object is then sent in numbered ST_DATA
+ * chunks. The receiver acknowledges every API_STREAM_WINDOW chunks with an
+ * ST_ACK of the sequence number it expects next, so the sender never has
+ * more than a window of chunks that aren't acknowledged yet. A chunk that is
+ * out of order is answered with an ST_ACK that doesn't move on, and the
+ * sender goes back to the first chunk that isn't acknowledged.
+ *
+ * The keyboard has no timeouts, the host resends its last message when it
+ * doesn't hear back. Only one transfer runs at a time.
+ *
+ * Every message has the stream opcode first:
+ *   ST_SET   host to keyboard, the length of the object as a dword
+ *   ST_GET   host to keyboard, answered by an ST_GET with the length
+ *   ST_DATA  the sequence number and up to API_STREAM_CHUNK_SIZE bytes
+ *   ST_ACK   a STREAM_STATUS and the sequence number expected next
+ *   ST_ABORT ends the transfer
+ */
+
+// Bytes in each chunk, the whole chunk has to fit in one API message
+#ifndef API_STREAM_CHUNK_SIZE
+    #define API_STREAM_CHUNK_SIZE (API_SYSEX_MAX_SIZE - 2)
+#endif
+
+// Chunks the sender can send before it waits for an acknowledgement
+#ifndef API_STREAM_WINDOW
+    #define API_STREAM_WINDOW 4
+#endif
+
+enum STREAM_OPCODE {
+    ST_SET = 0x01,
+    ST_GET,
+    ST_DATA,
+    ST_ACK,
+    ST_ABORT
+};
+
+enum STREAM_STATUS {
+    SS_OK = 0x00,  // send on from the sequence number
+    SS_DONE,       // the whole object has been received
+    SS_REFUSED,    // the data type can't be transferred
+    SS_ERROR       // the transfer has been abandoned
+};
+
+// Handles the bytes of an MT_STREAM message after the data_type
+void api_stream_process(uint8_t data_type, uint8_t * data, uint8_t length);
+
+// Sends an MT_STREAM message, implemented by the transport
+void api_stream_send(uint8_t data_type, uint8_t * data, uint8_t length);
+
+// An upload of length bytes is starting, false refuses it
+bool api_stream_set_begin(uint8_t data_type, uint32_t length);
+// The next bytes of the upload, false abandons it
+bool api_stream_set_write(uint8_t data_type, uint32_t offset, uint8_t * data, uint8_t length);
+// The upload is over, complete is false when it was abandoned
+void api_stream_set_end(uint8_t data_type, bool complete);
+
+// The length of the object to download, 0 refuses the download
+uint32_t api_stream_get_length(uint8_t data_type);
+// Reads length bytes of the object, false abandons the download
+bool api_stream_get_read(uint8_t data_type, uint32_t offset, uint8_t * data, uint8_t length);
+
+#endif
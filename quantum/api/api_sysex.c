@@ -14,60 +14,62 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "api_sysex.h"
+#include "api_stream.h"
 #include "sysex_tools.h"
-#include "print.h"
 #include "qmk_midi.h"
 
+// USB-MIDI carries sysex in packets of 3 bytes, only the last packet of a
+// message can be shorter
+typedef struct {
+    uint8_t bytes[3];
+    uint8_t count;
+} sysex_packet_t;
+
+static void sysex_packet_put(sysex_packet_t* packet, uint8_t byte) {
+    packet->bytes[packet->count++] = byte;
+    if (packet->count == 3) {
+        midi_send_data(&midi_device, 3, packet->bytes[0], packet->bytes[1], packet->bytes[2]);
+        packet->count = 0;
+    }
+}
+
+static void sysex_packet_put_group(sysex_packet_t* packet, sysex_encoder_t* encoder, uint8_t length) {
+    for (uint8_t i = 0; i < length; i++) {
+        sysex_packet_put(packet, encoder->group[i]);
+    }
+}
+
 void send_bytes_sysex(uint8_t message_type, uint8_t data_type, uint8_t * bytes, uint16_t length) {
     // SEND_STRING("\nTX: ");
     // for (uint8_t i = 0; i < length; i++) {
     //     send_byte(bytes[i]);
     //     SEND_STRING(" ");
     // }
-    if (length > API_SYSEX_MAX_SIZE) {
-        xprintf("Sysex msg too big %d %d %d", message_type, data_type, length);
-        return;
-    }
-
 
-    // The buffer size required is calculated as the following
-    // API_SYSEX_MAX_SIZE is the maximum length
-    // In addition to that we have a two byte message header consisting of the message_type and data_type
-    // This has to be encoded with an additional overhead of one byte for every starting 7 bytes
-    // We just add one extra byte in case it's not divisible by 7
-    // Then we have an unencoded header consisting of 4 bytes
-    // Plus a one byte terminator
-    const unsigned message_header = 2;
-    const unsigned unencoded_message = API_SYSEX_MAX_SIZE + message_header;
-    const unsigned encoding_overhead = unencoded_message / 7 + 1;
-    const unsigned encoded_size = unencoded_message + encoding_overhead;
-    const unsigned unencoded_header = 4;
-    const unsigned terminator = 1;
-    const unsigned buffer_size = encoded_size + unencoded_header + terminator;
-    uint8_t buffer[encoded_size + unencoded_header + terminator];
-    // The unencoded header
-    buffer[0] = 0xF0;
-    buffer[1] = 0x00;
-    buffer[2] = 0x00;
-    buffer[3] = 0x00;
+    // The message is encoded and sent 7 bytes at a time, so it can be of any
+    // length. It starts with an unencoded header of 4 bytes, followed by the
+    // encoded message_type, data_type and bytes, and a one byte terminator.
+    sysex_packet_t packet = { .count = 0 };
+    sysex_packet_put(&packet, 0xF0);
+    sysex_packet_put(&packet, 0x00);
+    sysex_packet_put(&packet, 0x00);
+    sysex_packet_put(&packet, 0x00);
 
-    // We copy the message to the end of the array, this way we can do an inplace encoding, using the same
-    // buffer for both input and output
-    const unsigned message_size = length + message_header;
-    uint8_t* unencoded_start = buffer + buffer_size - message_size;
-    uint8_t* ptr = unencoded_start;
-    *(ptr++) = message_type;
-    *(ptr++) = data_type;
-    memcpy(ptr, bytes, length);
+    sysex_encoder_t encoder;
+    sysex_encoder_init(&encoder);
+    sysex_packet_put_group(&packet, &encoder, sysex_encoder_push(&encoder, message_type));
+    sysex_packet_put_group(&packet, &encoder, sysex_encoder_push(&encoder, data_type));
+    for (uint16_t i = 0; i < length; i++) {
+        sysex_packet_put_group(&packet, &encoder, sysex_encoder_push(&encoder, bytes[i]));
+    }
+    sysex_packet_put_group(&packet, &encoder, sysex_encoder_flush(&encoder));
 
-    unsigned encoded_length = sysex_encode(buffer + unencoded_header, unencoded_start, message_size);
-    unsigned final_size = unencoded_header + encoded_length + terminator;
-    buffer[final_size - 1] = 0xF7;
-    midi_send_array(&midi_device, final_size, buffer);
+    sysex_packet_put(&packet, 0xF7);
+    if (packet.count) {
+        midi_send_data(&midi_device, packet.count, packet.bytes[0], packet.bytes[1], packet.bytes[2]);
+    }
+}
 
-    // SEND_STRING("\nTD: ");
-    // for (uint8_t i = 0; i < encoded_length + 5; i++) {
-    //     send_byte(buffer[i]);
-    //     SEND_STRING(" ");
-    // }
+void api_stream_send(uint8_t data_type, uint8_t * data, uint8_t length) {
+    send_bytes_sysex(MT_STREAM, data_type, data, length);
 }
@@ -0,0 +1,215 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "api_stream_client.h"
+#include <stddef.h>
+#include <algorithm>
+extern "C" {
+#include "sysex_tools.h"
+}
+
+StreamClient::StreamClient(uint8_t data_type, SendFunction send) :
+    data_type_(data_type), send_(send), state_(IDLE), uploading_(false), length_(0),
+    offset_(0), sequence_(0), chunks_(0), went_back_to_(-1), asked_for_(-1),
+    chunks_sent_(0), acks_sent_(0), resends_(0) {
+}
+
+StreamClient::Bytes StreamClient::encode(uint8_t message_type, uint8_t data_type, const uint8_t* data, uint8_t length) {
+    Bytes sysex = {0xF0, 0x00, 0x00, 0x00};
+    sysex_encoder_t encoder;
+    sysex_encoder_init(&encoder);
+    auto push = [&](uint8_t byte) {
+        uint8_t encoded = sysex_encoder_push(&encoder, byte);
+        sysex.insert(sysex.end(), encoder.group, encoder.group + encoded);
+    };
+    push(message_type);
+    push(data_type);
+    for (uint8_t i = 0; i < length; i++) {
+        push(data[i]);
+    }
+    uint8_t encoded = sysex_encoder_flush(&encoder);
+    sysex.insert(sysex.end(), encoder.group, encoder.group + encoded);
+    sysex.push_back(0xF7);
+    return sysex;
+}
+
+StreamClient::Bytes StreamClient::decode(const Bytes& sysex) {
+    if (sysex.size() < 5 || sysex[0] != 0xF0 || sysex.back() != 0xF7) {
+        return Bytes();
+    }
+    Bytes message(sysex.size());
+    sysex_decoder_t decoder;
+    sysex_decoder_init(&decoder, message.data(), message.size());
+    for (size_t i = 4; i < sysex.size() - 1; i++) {
+        sysex_decoder_push(&decoder, sysex[i]);
+    }
+    message.resize(decoder.length);
+    return message;
+}
+
+void StreamClient::send(const Bytes& payload) {
+    send_(encode(MT_STREAM, data_type_, payload.data(), payload.size()));
+}
+
+void StreamClient::upload(const Bytes& object) {
+    object_ = object;
+    length_ = object.size();
+    uploading_ = true;
+    state_ = STARTING;
+    send({ST_SET, (uint8_t)(length_ >> 24), (uint8_t)(length_ >> 16), (uint8_t)(length_ >> 8), (uint8_t)length_});
+}
+
+void StreamClient::download() {
+    object_.clear();
+    uploading_ = false;
+    state_ = STARTING;
+    send({ST_GET});
+}
+
+void StreamClient::send_window() {
+    while (chunks_ < API_STREAM_WINDOW) {
+        uint32_t offset = offset_ + chunks_ * API_STREAM_CHUNK_SIZE;
+        if (offset >= length_) {
+            return;
+        }
+        uint32_t length = std::min<uint32_t>(API_STREAM_CHUNK_SIZE, length_ - offset);
+        Bytes chunk = {ST_DATA, (uint8_t)(sequence_ + chunks_)};
+        chunk.insert(chunk.end(), object_.begin() + offset, object_.begin() + offset + length);
+        send(chunk);
+        chunks_++;
+        chunks_sent_++;
+    }
+}
+
+void StreamClient::send_ack(uint8_t status) {
+    asked_for_ = sequence_;
+    chunks_ = 0;
+    send({ST_ACK, status, sequence_});
+    acks_sent_++;
+}
+
+void StreamClient::receive(const Bytes& sysex) {
+    Bytes message = decode(sysex);
+    if (message.size() < 3 || message[0] != MT_STREAM || message[1] != data_type_ || finished()) {
+        return;
+    }
+    Bytes payload(message.begin() + 2, message.end());
+    if (uploading_) {
+        process_upload(payload);
+    } else {
+        process_download(payload);
+    }
+}
+
+void StreamClient::process_upload(const Bytes& payload) {
+    if (payload[0] != ST_ACK || payload.size() < 3) {
+        return;
+    }
+    uint8_t status = payload[1];
+    if (status == SS_REFUSED || status == SS_ERROR) {
+        state_ = FAILED;
+        return;
+    }
+    if (state_ == STARTING) {
+        state_ = UPLOADING;
+        offset_ = 0;
+        sequence_ = 0;
+        chunks_ = 0;
+        went_back_to_ = -1;
+    }
+    uint8_t acknowledged = payload[2] - sequence_;
+    if (acknowledged > chunks_) {
+        return;
+    }
+    offset_ += acknowledged * API_STREAM_CHUNK_SIZE;
+    sequence_ += acknowledged;
+    chunks_ -= acknowledged;
+    if (status == SS_DONE) {
+        state_ = offset_ >= length_ ? DONE : FAILED;
+        return;
+    }
+    if (acknowledged == 0 && chunks_ > 0) {
+        // The keyboard missed a chunk, only goes back once for each of them,
+        // as every chunk after it is answered the same way
+        if (went_back_to_ == sequence_) {
+            return;
+        }
+        went_back_to_ = sequence_;
+        chunks_ = 0;
+        resends_++;
+    }
+    send_window();
+}
+
+void StreamClient::process_download(const Bytes& payload) {
+    if (payload[0] == ST_ACK) {
+        state_ = FAILED;
+        return;
+    }
+    if (payload[0] == ST_GET) {
+        if (state_ == STARTING && payload.size() >= 5) {
+            length_ = ((uint32_t)payload[1] << 24) | ((uint32_t)payload[2] << 16) | ((uint32_t)payload[3] << 8) | payload[4];
+            state_ = DOWNLOADING;
+            offset_ = 0;
+            sequence_ = 0;
+            chunks_ = 0;
+            asked_for_ = -1;
+        }
+        return;
+    }
+    if (payload[0] != ST_DATA || state_ != DOWNLOADING) {
+        return;
+    }
+    if (payload[1] != sequence_) {
+        // Asks for the chunk it expects once, the timeout asks again
+        if (asked_for_ != sequence_) {
+            send_ack(SS_OK);
+        }
+        return;
+    }
+    uint32_t length = std::min<uint32_t>(API_STREAM_CHUNK_SIZE, length_ - offset_);
+    if (payload.size() - 2 != length) {
+        state_ = FAILED;
+        return;
+    }
+    object_.insert(object_.end(), payload.begin() + 2, payload.end());
+    offset_ += length;
+    sequence_++;
+    chunks_++;
+    if (offset_ == length_) {
+        send_ack(SS_DONE);
+        state_ = DONE;
+    } else if (chunks_ == API_STREAM_WINDOW) {
+        send_ack(SS_OK);
+    }
+}
+
+void StreamClient::timeout() {
+    if (finished()) {
+        return;
+    }
+    resends_++;
+    if (state_ == STARTING) {
+        if (uploading_) {
+            upload(object_);
+        } else {
+            download();
+        }
+    } else if (state_ == UPLOADING) {
+        chunks_ = 0;
+        send_window();
+    } else {
+        send_ack(SS_OK);
+    }
+}
@@ -0,0 +1,86 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef API_STREAM_CLIENT_H
+#define API_STREAM_CLIENT_H
+
+#include <stdint.h>
+#include <functional>
+#include <vector>
+extern "C" {
+#include "api_stream.h"
+}
+
+// The host side of api_stream.h, as a reference for host programs. It sends
+// and receives whole sysex messages, with the 4 byte header and the encoded
+// API message, and it keeps the timeouts of both directions.
+class StreamClient {
+public:
+    typedef std::vector<uint8_t> Bytes;
+    typedef std::function<void(const Bytes& sysex)> SendFunction;
+
+    enum { MT_STREAM = 0x50 };
+
+    StreamClient(uint8_t data_type, SendFunction send);
+
+    void upload(const Bytes& object);
+    void download();
+    // A sysex message from the keyboard
+    void receive(const Bytes& sysex);
+    // Nothing has come from the keyboard for too long
+    void timeout();
+
+    bool finished() const { return state_ == DONE || state_ == FAILED; }
+    bool succeeded() const { return state_ == DONE; }
+    const Bytes& object() const { return object_; }
+    // Chunks and acknowledgements sent, and times the client went back
+    uint32_t chunks_sent() const { return chunks_sent_; }
+    uint32_t acks_sent() const { return acks_sent_; }
+    uint32_t resends() const { return resends_; }
+
+    // The sysex message of an API message
+    static Bytes encode(uint8_t message_type, uint8_t data_type, const uint8_t* data, uint8_t length);
+    // The API message of a sysex message, empty when it isn't one
+    static Bytes decode(const Bytes& sysex);
+
+private:
+    enum State { IDLE, STARTING, UPLOADING, DOWNLOADING, DONE, FAILED };
+
+    void send(const Bytes& payload);
+    void send_window();
+    void send_ack(uint8_t status);
+    void process_upload(const Bytes& payload);
+    void process_download(const Bytes& payload);
+
+    uint8_t data_type_;
+    SendFunction send_;
+    State state_;
+    bool uploading_;
+    Bytes object_;
+    uint32_t length_;
+    // Upload: acknowledged bytes and chunks sent after them. Download: bytes
+    // received in order and chunks received since the last acknowledgement.
+    uint32_t offset_;
+    uint8_t sequence_;
+    uint8_t chunks_;
+    // Upload: the sequence number the client last went back to
+    int went_back_to_;
+    // Download: the sequence number the last acknowledgement asked for
+    int asked_for_;
+    uint32_t chunks_sent_;
+    uint32_t acks_sent_;
+    uint32_t resends_;
+};
+
+#endif
@@ -0,0 +1,249 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include <deque>
+#include <map>
+#include <random>
+#include "api_stream_client.h"
+extern "C" {
+#include "sysex_tools.h"
+}
+
+static const uint8_t DATA_TYPE = 0x0E;
+
+// The keyboard side objects, by data type
+static std::map<uint8_t, StreamClient::Bytes> objects;
+static std::map<uint8_t, bool> complete;
+static std::deque<StreamClient::Bytes> to_host;
+
+extern "C" {
+void api_stream_send(uint8_t data_type, uint8_t* data, uint8_t length) {
+    to_host.push_back(StreamClient::encode(StreamClient::MT_STREAM, data_type, data, length));
+}
+
+bool api_stream_set_begin(uint8_t data_type, uint32_t length) {
+    if (data_type == 0 || length > 10000) {
+        return false;
+    }
+    objects[data_type].assign(length, 0);
+    complete[data_type] = false;
+    return true;
+}
+
+bool api_stream_set_write(uint8_t data_type, uint32_t offset, uint8_t* data, uint8_t length) {
+    StreamClient::Bytes& object = objects[data_type];
+    EXPECT_LE(offset + length, object.size());
+    std::copy(data, data + length, object.begin() + offset);
+    return true;
+}
+
+void api_stream_set_end(uint8_t data_type, bool done) {
+    complete[data_type] = done;
+}
+
+uint32_t api_stream_get_length(uint8_t data_type) {
+    return objects[data_type].size();
+}
+
+bool api_stream_get_read(uint8_t data_type, uint32_t offset, uint8_t* data, uint8_t length) {
+    StreamClient::Bytes& object = objects[data_type];
+    std::copy(object.begin() + offset, object.begin() + offset + length, data);
+    return true;
+}
+}
+
+class ApiStream : public testing::Test {
+public:
+    ApiStream() : client(DATA_TYPE, [this](const StreamClient::Bytes& sysex) { to_keyboard.push_back(sysex); }) {
+        objects.clear();
+        complete.clear();
+        to_host.clear();
+    }
+
+    // Delivers the messages both ways until the transfer is over, lost is
+    // asked about every message, and the client times out whenever nothing
+    // is on the way
+    void run(std::function<bool(int)> lost = [](int) { return false; }) {
+        int steps = 0;
+        while (!client.finished() && steps++ < 100000) {
+            if (to_keyboard.empty() && to_host.empty()) {
+                client.timeout();
+                timeouts++;
+                continue;
+            }
+            while (!to_keyboard.empty()) {
+                StreamClient::Bytes message = StreamClient::decode(to_keyboard.front());
+                to_keyboard.pop_front();
+                ASSERT_GE(message.size(), 2u);
+                ASSERT_EQ(message[0], StreamClient::MT_STREAM);
+                if (!lost(messages++)) {
+                    api_stream_process(message[1], message.data() + 2, message.size() - 2);
+                }
+            }
+            while (!to_host.empty()) {
+                StreamClient::Bytes sysex = to_host.front();
+                to_host.pop_front();
+                EXPECT_LE(sysex.size(), sysex_size(API_SYSEX_MAX_SIZE));
+                if (!lost(messages++)) {
+                    client.receive(sysex);
+                }
+            }
+        }
+    }
+
+    // Header, encoded message_type, data_type and bytes, and terminator
+    static size_t sysex_size(size_t length) {
+        return 4 + sysex_encoded_length(length + 2) + 1;
+    }
+
+    static StreamClient::Bytes make_object(size_t length) {
+        StreamClient::Bytes object(length);
+        for (size_t i = 0; i < length; i++) {
+            object[i] = i * 37 + (i >> 8);
+        }
+        return object;
+    }
+
+    StreamClient client;
+    std::deque<StreamClient::Bytes> to_keyboard;
+    int messages = 0;
+    int timeouts = 0;
+};
+
+TEST_F(ApiStream, ChunkFitsInOneMessage) {
+    EXPECT_EQ(API_STREAM_CHUNK_SIZE + 2, API_SYSEX_MAX_SIZE);
+}
+
+TEST_F(ApiStream, Upload) {
+    StreamClient::Bytes object = make_object(5000);
+    client.upload(object);
+    run();
+    EXPECT_TRUE(client.succeeded());
+    EXPECT_TRUE(complete[DATA_TYPE]);
+    EXPECT_EQ(objects[DATA_TYPE], object);
+    // Every chunk once, an acknowledgement for every window of them
+    uint32_t chunks = (5000 + API_STREAM_CHUNK_SIZE - 1) / API_STREAM_CHUNK_SIZE;
+    EXPECT_EQ(client.chunks_sent(), chunks);
+    EXPECT_EQ(client.resends(), 0u);
+    EXPECT_EQ(timeouts, 0);
+}
+
+TEST_F(ApiStream, Download) {
+    objects[DATA_TYPE] = make_object(3001);
+    client.download();
+    run();
+    EXPECT_TRUE(client.succeeded());
+    EXPECT_EQ(client.object(), objects[DATA_TYPE]);
+    uint32_t chunks = (3001 + API_STREAM_CHUNK_SIZE - 1) / API_STREAM_CHUNK_SIZE;
+    EXPECT_EQ(client.acks_sent(), (chunks + API_STREAM_WINDOW - 1) / API_STREAM_WINDOW);
+    EXPECT_EQ(timeouts, 0);
+}
+
+TEST_F(ApiStream, EmptyUpload) {
+    client.upload(StreamClient::Bytes());
+    run();
+    EXPECT_TRUE(client.succeeded());
+    EXPECT_TRUE(complete[DATA_TYPE]);
+}
+
+TEST_F(ApiStream, RefusedTransfers) {
+    client.upload(make_object(20000));
+    run();
+    EXPECT_TRUE(client.finished());
+    EXPECT_FALSE(client.succeeded());
+
+    // Nothing to download
+    StreamClient download(DATA_TYPE, [this](const StreamClient::Bytes& sysex) { to_keyboard.push_back(sysex); });
+    download.download();
+    api_stream_process(DATA_TYPE, StreamClient::decode(to_keyboard.front()).data() + 2, 1);
+    ASSERT_EQ(to_host.size(), 1u);
+    download.receive(to_host.front());
+    EXPECT_TRUE(download.finished());
+    EXPECT_FALSE(download.succeeded());
+}
+
+TEST_F(ApiStream, UploadWithLostMessages) {
+    StreamClient::Bytes object = make_object(4000);
+    client.upload(object);
+    // One in 6 messages, either way
+    std::minstd_rand random(1);
+    run([&random](int) { return random() % 6 == 0; });
+    EXPECT_TRUE(client.succeeded());
+    EXPECT_TRUE(complete[DATA_TYPE]);
+    EXPECT_EQ(objects[DATA_TYPE], object);
+    EXPECT_GT(client.resends(), 0u);
+}
+
+TEST_F(ApiStream, DownloadWithLostMessages) {
+    objects[DATA_TYPE] = make_object(4000);
+    client.download();
+    std::minstd_rand random(2);
+    run([&random](int) { return random() % 4 == 0; });
+    EXPECT_TRUE(client.succeeded());
+    EXPECT_EQ(client.object(), objects[DATA_TYPE]);
+    EXPECT_GT(client.resends(), 0u);
+}
+
+TEST_F(ApiStream, LostEndOfUpload) {
+    // Loses the acknowledgement of the last chunk
+    StreamClient::Bytes object = make_object(API_STREAM_CHUNK_SIZE * 2);
+    client.upload(object);
+    int last = -1;
+    run([&last](int message) {
+        // SET, its acknowledgement, 2 chunks, and the acknowledgement that is lost
+        return message == 4 && (last = message) >= 0;
+    });
+    EXPECT_EQ(last, 4);
+    EXPECT_TRUE(client.succeeded());
+    EXPECT_TRUE(complete[DATA_TYPE]);
+    EXPECT_EQ(objects[DATA_TYPE], object);
+}
+
+TEST_F(ApiStream, NewTransferAbandonsTheOldOne) {
+    client.upload(make_object(1000));
+    // Only the SET and the first window
+    for (int i = 0; i < 2; i++) {
+        while (!to_keyboard.empty()) {
+            StreamClient::Bytes message = StreamClient::decode(to_keyboard.front());
+            to_keyboard.pop_front();
+            api_stream_process(message[1], message.data() + 2, message.size() - 2);
+        }
+        while (!to_host.empty()) {
+            client.receive(to_host.front());
+            to_host.pop_front();
+        }
+    }
+    ASSERT_EQ(complete.count(DATA_TYPE), 1u);
+    EXPECT_FALSE(complete[DATA_TYPE]);
+
+    StreamClient other(DATA_TYPE + 1, [this](const StreamClient::Bytes& sysex) { to_keyboard.push_back(sysex); });
+    StreamClient::Bytes object = make_object(100);
+    other.upload(object);
+    to_host.clear();
+    while (!other.finished()) {
+        while (!to_keyboard.empty()) {
+            StreamClient::Bytes message = StreamClient::decode(to_keyboard.front());
+            to_keyboard.pop_front();
+            api_stream_process(message[1], message.data() + 2, message.size() - 2);
+        }
+        while (!to_host.empty()) {
+            other.receive(to_host.front());
+            to_host.pop_front();
+        }
+    }
+    EXPECT_TRUE(other.succeeded());
+    EXPECT_EQ(objects[DATA_TYPE + 1], object);
+    EXPECT_FALSE(complete[DATA_TYPE]);
+}
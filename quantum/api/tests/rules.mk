@@ -0,0 +1,8 @@
+api_stream_SRC :=\
+	$(QUANTUM_PATH)/api/tests/api_stream_tests.cpp \
+	$(QUANTUM_PATH)/api/tests/api_stream_client.cpp \
+	$(QUANTUM_PATH)/api/api_stream.c \
+	$(TMK_PATH)/protocol/midi/sysex_tools.c
+
+api_stream_INC := $(TMK_PATH)/protocol/midi
+api_stream_DEFS := -DAPI_SYSEX_MAX_SIZE=32
@@ -65,11 +65,25 @@
 #ifdef C6_AUDIO
     #define TIMER_3_PERIOD     ICR3
     #define TIMER_3_DUTY_CYCLE OCR3A
+    #define TIMER_3_COUNTER    TCNT3
 #endif
 
 #ifdef B5_AUDIO
     #define TIMER_1_PERIOD     ICR1
     #define TIMER_1_DUTY_CYCLE OCR1A
+    #define TIMER_1_COUNTER    TCNT1
+#endif
+
+// Timer ticks per second
+#define TIMER_FREQUENCY (F_CPU / CPU_PRESCALER)
+// The longest period of the 16 bit timers, about 30.5Hz at 16MHz
+#define MAX_PERIOD 0xFFFF
+// Rests are timed in steps of 1ms
+#define REST_PERIOD (TIMER_FREQUENCY / 1000)
+// The glissando moves the period by period^2 >> GLISSANDO_SHIFT every
+// period, which slides about an octave in 1/20s at 16MHz
+#ifndef GLISSANDO_SHIFT
+    #define GLISSANDO_SHIFT 17
 #endif
 
 
@@ -77,40 +91,57 @@
 
 
 int voices = 0;
-int voice_place = 0;
-float frequency = 0;
-float frequency_alt = 0;
 int volume = 0;
-long position = 0;
 
 float frequencies[8] = {0, 0, 0, 0, 0, 0, 0, 0};
 int volumes[8] = {0, 0, 0, 0, 0, 0, 0, 0};
-bool sliding = false;
 
-float place = 0;
+// The interrupts only work with timer periods, which are worked out from the
+// float frequencies and durations when a note starts
+
+// Timer periods of the notes started with play_note
+static uint16_t periods[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+// The periods currently played, which slide towards the note with glissando
+static uint16_t period = 0;
+#ifdef B5_AUDIO
+static uint16_t period_alt = 0;
+#endif
+// The duty cycle, 256 is the whole period
+static uint16_t duty_fraction = 128;
 
 uint8_t * sample;
 uint16_t sample_length = 0;
 
 bool     playing_notes = false;
 bool     playing_note = false;
-float    note_frequency = 0;
-float    note_length = 0;
 uint8_t  note_tempo = TEMPO_DEFAULT;
 float    note_timbre = TIMBRE_DEFAULT;
-uint16_t note_position = 0;
 float (* notes_pointer)[][2];
+// Set instead of notes_pointer when a compact song is playing
+static const song_note_t* compact_notes = NULL;
 uint16_t notes_count;
 bool     notes_repeat;
-bool     note_resting = false;
 
-uint8_t current_note = 0;
-uint8_t rest_counter = 0;
+uint16_t current_note = 0;
+// The period of the note played by play_notes, 0 for a rest
+static uint16_t note_period = 0;
+// Timer ticks left in the note
+static uint32_t note_ticks_left = 0;
+// A short silence before a note that repeats the previous one
+static bool note_gap = false;
+// Timer ticks per unit of note duration, where a quarter note is 16, at the current tempo
+static uint32_t duration_ticks = 0;
 
 #ifdef VIBRATO_ENABLE
-float vibrato_counter = 0;
 float vibrato_strength = .5;
 float vibrato_rate = 0.125;
+// Period multipliers of the vibrato, 1 << 14 is 1.0
+static uint16_t vibrato_periods[VIBRATO_LUT_LENGTH];
+// Position in the vibrato, 8.8 fixed point
+static uint16_t vibrato_counter = 0;
+// Vibrato steps of the notes started with play_note and of the note played by play_notes
+static uint16_t vibrato_steps[8];
+static uint16_t note_vibrato_step = 0;
 #endif
 
 float polyphony_rate = 0;
@@ -122,6 +153,14 @@ audio_config_t audio_config;
 uint16_t envelope_index = 0;
 bool glissando = true;
 
+#ifdef AUDIO_VOICES
+extern voice_type voice;
+#endif
+
+#ifdef AUDIO_ISR_PROFILE
+static volatile uint16_t isr_max_ticks = 0;
+#endif
+
 #ifndef STARTUP_SONG
     #define STARTUP_SONG SONG(STARTUP_SOUND)
 #endif
@@ -131,9 +170,59 @@ bool glissando = true;
 #ifndef AUDIO_OFF_SONG
     #define AUDIO_OFF_SONG SONG(AUDIO_OFF_SOUND)
 #endif
-float startup_song[][2] = STARTUP_SONG;
-float audio_on_song[][2] = AUDIO_ON_SONG;
-float audio_off_song[][2] = AUDIO_OFF_SONG;
+const song_note_t startup_song[] PROGMEM = STARTUP_SONG;
+const song_note_t audio_on_song[] PROGMEM = AUDIO_ON_SONG;
+const song_note_t audio_off_song[] PROGMEM = AUDIO_OFF_SONG;
+
+static uint16_t frequency_to_period(float freq)
+{
+    if (freq <= (float)TIMER_FREQUENCY / MAX_PERIOD) {
+        return MAX_PERIOD;
+    }
+    return (uint16_t)((float)TIMER_FREQUENCY / freq);
+}
+
+// Timer periods of the lowest octave of MIDI note numbers, every octave above
+// halves them
+#define OCTAVE_PERIOD(freq) ((uint32_t)((float)TIMER_FREQUENCY / (freq)))
+static const uint32_t octave_periods[12] PROGMEM = {
+    OCTAVE_PERIOD(8.1758f),  OCTAVE_PERIOD(8.6620f),  OCTAVE_PERIOD(9.1770f),
+    OCTAVE_PERIOD(9.7227f),  OCTAVE_PERIOD(10.3009f), OCTAVE_PERIOD(10.9134f),
+    OCTAVE_PERIOD(11.5623f), OCTAVE_PERIOD(12.2499f), OCTAVE_PERIOD(12.9783f),
+    OCTAVE_PERIOD(13.7500f), OCTAVE_PERIOD(14.5676f), OCTAVE_PERIOD(15.4339f)
+};
+
+static uint16_t note_number_to_period(uint8_t number)
+{
+    uint32_t p = pgm_read_dword(&octave_periods[number % 12]) >> (number / 12);
+    return p > MAX_PERIOD ? MAX_PERIOD : p;
+}
+
+static void update_duration_ticks(void)
+{
+    // A duration of 4 at tempo 100 is 0xFFFF timer ticks
+    duration_ticks = (uint32_t)note_tempo * 0xFFFF / 400;
+}
+
+#ifdef VIBRATO_ENABLE
+
+static void update_vibrato_periods(void)
+{
+    for (uint8_t i = 0; i < VIBRATO_LUT_LENGTH; i++) {
+        #ifdef VIBRATO_STRENGTH_ENABLE
+            vibrato_periods[i] = (uint16_t)((1 << 14) / pow(vibrato_lut[i], vibrato_strength));
+        #else
+            vibrato_periods[i] = (uint16_t)((1 << 14) / vibrato_lut[i]);
+        #endif
+    }
+}
+
+static uint16_t vibrato_step(float freq)
+{
+    return (uint16_t)(vibrato_rate * (1.0 + 440.0 / freq) * 256);
+}
+
+#endif
 
 void audio_init()
 {
@@ -189,6 +278,11 @@ void audio_init()
             TIMER_1_DUTY_CYCLE = (uint16_t)((((float)F_CPU) / (440 * CPU_PRESCALER)) * note_timbre);
         #endif
 
+        update_duration_ticks();
+        #ifdef VIBRATO_ENABLE
+            update_vibrato_periods();
+        #endif
+
         audio_initialized = true;
     }
 
@@ -220,13 +314,16 @@ void stop_all_notes()
 
     playing_notes = false;
     playing_note = false;
-    frequency = 0;
-    frequency_alt = 0;
+    period = 0;
+    #ifdef B5_AUDIO
+        period_alt = 0;
+    #endif
     volume = 0;
 
     for (uint8_t i = 0; i < 8; i++)
     {
         frequencies[i] = 0;
+        periods[i] = 0;
         volumes[i] = 0;
     }
 }
@@ -239,234 +336,254 @@ void stop_note(float freq)
         if (!audio_initialized) {
             audio_init();
         }
+        #ifdef C6_AUDIO
+            DISABLE_AUDIO_COUNTER_3_ISR;
+        #endif
+        #ifdef B5_AUDIO
+            DISABLE_AUDIO_COUNTER_1_ISR;
+        #endif
         for (int i = 7; i >= 0; i--) {
             if (frequencies[i] == freq) {
-                frequencies[i] = 0;
-                volumes[i] = 0;
                 for (int j = i; (j < 7); j++) {
                     frequencies[j] = frequencies[j+1];
-                    frequencies[j+1] = 0;
+                    periods[j] = periods[j+1];
                     volumes[j] = volumes[j+1];
-                    volumes[j+1] = 0;
+                    #ifdef VIBRATO_ENABLE
+                        vibrato_steps[j] = vibrato_steps[j+1];
+                    #endif
                 }
+                frequencies[7] = 0;
+                periods[7] = 0;
+                volumes[7] = 0;
                 break;
             }
         }
         voices--;
         if (voices < 0)
             voices = 0;
-        if (voice_place >= voices) {
-            voice_place = 0;
-        }
         if (voices == 0) {
             #ifdef C6_AUDIO
-                DISABLE_AUDIO_COUNTER_3_ISR;
                 DISABLE_AUDIO_COUNTER_3_OUTPUT;
             #endif
             #ifdef B5_AUDIO
-                DISABLE_AUDIO_COUNTER_1_ISR;
                 DISABLE_AUDIO_COUNTER_1_OUTPUT;
             #endif
-            frequency = 0;
-            frequency_alt = 0;
+            period = 0;
+            #ifdef B5_AUDIO
+                period_alt = 0;
+            #endif
             volume = 0;
             playing_note = false;
+        } else {
+            #ifdef C6_AUDIO
+                ENABLE_AUDIO_COUNTER_3_ISR;
+            #endif
+            #ifdef B5_AUDIO
+                #ifdef C6_AUDIO
+                if (voices > 1) {
+                    ENABLE_AUDIO_COUNTER_1_ISR;
+                }
+                #else
+                ENABLE_AUDIO_COUNTER_1_ISR;
+                #endif
+            #endif
         }
     }
 }
 
+// The interrupts below run once per period of the tone they play, so they
+// only do integer arithmetic on values prepared when the notes started.
+// Only moving to the next note of a song looks its period up, and converts
+// its float frequency for notes not written with the note macros.
+
+// Moves the period towards the target when glissando is on
+static inline uint16_t slide(uint16_t current, uint16_t target)
+{
+    if (!glissando || current == 0) {
+        return target;
+    }
+    uint16_t step = ((uint32_t)current * current) >> GLISSANDO_SHIFT;
+    if (step == 0) {
+        step = 1;
+    }
+    if ((uint32_t)current + step < target) {
+        return current + step;
+    }
+    if (current > (uint32_t)target + step) {
+        return current - step;
+    }
+    return target;
+}
+
 #ifdef VIBRATO_ENABLE
+static inline uint16_t vibrato(uint16_t p, uint16_t step)
+{
+    uint32_t vibrated = ((uint32_t)p * vibrato_periods[vibrato_counter >> 8]) >> 14;
+    vibrato_counter += step;
+    if (vibrato_counter >= (VIBRATO_LUT_LENGTH << 8)) {
+        vibrato_counter -= VIBRATO_LUT_LENGTH << 8;
+    }
+    return vibrated > MAX_PERIOD ? MAX_PERIOD : vibrated;
+}
+#endif
+
+// Applies the envelope of the voice, and sets the duty cycle
+static inline uint16_t envelope(uint16_t p)
+{
+    if (envelope_index < 65535) {
+        envelope_index++;
+    }
+    #ifdef AUDIO_VOICES
+        if (voice != default_voice) {
+            // The other voices are written for float frequencies, and are a lot slower
+            float freq = voice_envelope((float)TIMER_FREQUENCY / p);
+            duty_fraction = (uint16_t)(note_timbre * 256);
+            return frequency_to_period(freq);
+        }
+    #endif
+    // What voice_envelope does for the default voice
+    glissando = false;
+    duty_fraction = TIMBRE_50 * 256;
+    return p;
+}
 
-float mod(float a, int b)
+static inline uint16_t duty_cycle(uint16_t p)
 {
-    float r = fmod(a, b);
-    return r < 0 ? r + b : r;
+    return ((uint32_t)p * duty_fraction) >> 8;
 }
 
-float vibrato(float average_freq) {
-    #ifdef VIBRATO_STRENGTH_ENABLE
-        float vibrated_freq = average_freq * pow(vibrato_lut[(int)vibrato_counter], vibrato_strength);
-    #else
-        float vibrated_freq = average_freq * vibrato_lut[(int)vibrato_counter];
+// Prepares the current note of the song, returns false at the end of the song
+static bool start_song_note(void)
+{
+    if (current_note >= notes_count) {
+        if (!notes_repeat) {
+            return false;
+        }
+        current_note = 0;
+    }
+    uint16_t previous_period = note_period;
+    if (compact_notes) {
+        uint8_t number = -(int8_t)pgm_read_byte(&compact_notes[current_note].note);
+        note_period = number ? note_number_to_period(number) : 0;
+        note_ticks_left = pgm_read_byte(&compact_notes[current_note].duration) * duration_ticks;
+    } else {
+        // The note macros store negated note numbers, raw frequencies are positive
+        float value = (*notes_pointer)[current_note][0];
+        if (value < 0) {
+            note_period = note_number_to_period((uint8_t)-value);
+        } else {
+            note_period = value > 0 ? frequency_to_period(value) : 0;
+        }
+        note_ticks_left = (uint32_t)((*notes_pointer)[current_note][1] * 16) * duration_ticks / 16;
+    }
+    note_gap = note_period != 0 && note_period == previous_period;
+    #ifdef VIBRATO_ENABLE
+        if (note_period) {
+            note_vibrato_step = vibrato_step((float)TIMER_FREQUENCY / note_period);
+        }
     #endif
-    vibrato_counter = mod((vibrato_counter + vibrato_rate * (1.0 + 440.0/average_freq)), VIBRATO_LUT_LENGTH);
-    return vibrated_freq;
+    envelope_index = 0;
+    return true;
 }
 
+// The period to play next for the song, 0 for silence. Returns false at the end of the song.
+static inline bool song_step(uint16_t* p)
+{
+    uint16_t elapsed = REST_PERIOD;
+    *p = 0;
+    if (note_gap) {
+        note_gap = false;
+        return true;
+    }
+    if (note_period) {
+        *p = note_period;
+        #ifdef VIBRATO_ENABLE
+            if (vibrato_strength > 0) {
+                *p = vibrato(*p, note_vibrato_step);
+            }
+        #endif
+        *p = envelope(*p);
+        elapsed = *p;
+    }
+    if (note_ticks_left > elapsed) {
+        note_ticks_left -= elapsed;
+        return true;
+    }
+    current_note++;
+    return start_song_note();
+}
+
+#ifdef AUDIO_ISR_PROFILE
+    // The timer counts to its period in CPU_PRESCALER cycles, and
+    // starts again from 0
+    #define PROFILE_START(counter, top) \
+        uint16_t profile_start = counter; \
+        uint16_t profile_top = top;
+    #define PROFILE_END(counter) { \
+        uint16_t profile_end = counter; \
+        uint16_t ticks = profile_end >= profile_start ? \
+            profile_end - profile_start : profile_end + profile_top + 1 - profile_start; \
+        if (ticks > isr_max_ticks) { \
+            isr_max_ticks = ticks; \
+        } \
+    }
+#else
+    #define PROFILE_START(counter, top)
+    #define PROFILE_END(counter)
 #endif
 
 #ifdef C6_AUDIO
 ISR(TIMER3_COMPA_vect)
 {
-    float freq;
+    PROFILE_START(TIMER_3_COUNTER, TIMER_3_PERIOD);
+    uint16_t p = 0;
 
     if (playing_note) {
         if (voices > 0) {
 
             #ifdef B5_AUDIO
-            float freq_alt = 0;
                 if (voices > 1) {
-                    if (polyphony_rate == 0) {
-                        if (glissando) {
-                            if (frequency_alt != 0 && frequency_alt < frequencies[voices - 2] && frequency_alt < frequencies[voices - 2] * pow(2, -440/frequencies[voices - 2]/12/2)) {
-                                frequency_alt = frequency_alt * pow(2, 440/frequency_alt/12/2);
-                            } else if (frequency_alt != 0 && frequency_alt > frequencies[voices - 2] && frequency_alt > frequencies[voices - 2] * pow(2, 440/frequencies[voices - 2]/12/2)) {
-                                frequency_alt = frequency_alt * pow(2, -440/frequency_alt/12/2);
-                            } else {
-                                frequency_alt = frequencies[voices - 2];
-                            }
-                        } else {
-                            frequency_alt = frequencies[voices - 2];
+                    period_alt = slide(period_alt, periods[voices - 2]);
+                    uint16_t p_alt = period_alt;
+                    #ifdef VIBRATO_ENABLE
+                        if (vibrato_strength > 0) {
+                            p_alt = vibrato(p_alt, vibrato_steps[voices - 2]);
                         }
+                    #endif
+                    p_alt = envelope(p_alt);
 
-                        #ifdef VIBRATO_ENABLE
-                            if (vibrato_strength > 0) {
-                                freq_alt = vibrato(frequency_alt);
-                            } else {
-                                freq_alt = frequency_alt;
-                            }
-                        #else
-                            freq_alt = frequency_alt;
-                        #endif
-                    }
-
-                    if (envelope_index < 65535) {
-                        envelope_index++;
-                    }
-
-                    freq_alt = voice_envelope(freq_alt);
-
-                    if (freq_alt < 30.517578125) {
-                        freq_alt = 30.52;
-                    }
-
-                    TIMER_1_PERIOD = (uint16_t)(((float)F_CPU) / (freq_alt * CPU_PRESCALER));
-                    TIMER_1_DUTY_CYCLE = (uint16_t)((((float)F_CPU) / (freq_alt * CPU_PRESCALER)) * note_timbre);
+                    TIMER_1_PERIOD = p_alt;
+                    TIMER_1_DUTY_CYCLE = duty_cycle(p_alt);
                 }
             #endif
 
-            if (polyphony_rate > 0) {
-                if (voices > 1) {
-                    voice_place %= voices;
-                    if (place++ > (frequencies[voice_place] / polyphony_rate / CPU_PRESCALER)) {
-                        voice_place = (voice_place + 1) % voices;
-                        place = 0.0;
-                    }
-                }
-
-                #ifdef VIBRATO_ENABLE
-                    if (vibrato_strength > 0) {
-                        freq = vibrato(frequencies[voice_place]);
-                    } else {
-                        freq = frequencies[voice_place];
-                    }
-                #else
-                    freq = frequencies[voice_place];
-                #endif
-            } else {
-                if (glissando) {
-                    if (frequency != 0 && frequency < frequencies[voices - 1] && frequency < frequencies[voices - 1] * pow(2, -440/frequencies[voices - 1]/12/2)) {
-                        frequency = frequency * pow(2, 440/frequency/12/2);
-                    } else if (frequency != 0 && frequency > frequencies[voices - 1] && frequency > frequencies[voices - 1] * pow(2, 440/frequencies[voices - 1]/12/2)) {
-                        frequency = frequency * pow(2, -440/frequency/12/2);
-                    } else {
-                        frequency = frequencies[voices - 1];
-                    }
-                } else {
-                    frequency = frequencies[voices - 1];
-                }
-
-                #ifdef VIBRATO_ENABLE
-                    if (vibrato_strength > 0) {
-                        freq = vibrato(frequency);
-                    } else {
-                        freq = frequency;
-                    }
-                #else
-                    freq = frequency;
-                #endif
-            }
-
-            if (envelope_index < 65535) {
-                envelope_index++;
-            }
-
-            freq = voice_envelope(freq);
-
-            if (freq < 30.517578125) {
-                freq = 30.52;
-            }
-
-            TIMER_3_PERIOD = (uint16_t)(((float)F_CPU) / (freq * CPU_PRESCALER));
-            TIMER_3_DUTY_CYCLE = (uint16_t)((((float)F_CPU) / (freq * CPU_PRESCALER)) * note_timbre);
-        }
-    }
-
-    if (playing_notes) {
-        if (note_frequency > 0) {
+            period = slide(period, periods[voices - 1]);
+            p = period;
             #ifdef VIBRATO_ENABLE
                 if (vibrato_strength > 0) {
-                    freq = vibrato(note_frequency);
-                } else {
-                    freq = note_frequency;
+                    p = vibrato(p, vibrato_steps[voices - 1]);
                 }
-            #else
-                    freq = note_frequency;
             #endif
-
-            if (envelope_index < 65535) {
-                envelope_index++;
-            }
-            freq = voice_envelope(freq);
-
-            TIMER_3_PERIOD = (uint16_t)(((float)F_CPU) / (freq * CPU_PRESCALER));
-            TIMER_3_DUTY_CYCLE = (uint16_t)((((float)F_CPU) / (freq * CPU_PRESCALER)) * note_timbre);
-        } else {
-            TIMER_3_PERIOD = 0;
-            TIMER_3_DUTY_CYCLE = 0;
+            p = envelope(p);
         }
+    }
 
-        note_position++;
-        bool end_of_note = false;
-        if (TIMER_3_PERIOD > 0) {
-            if (!note_resting) 
-                end_of_note = (note_position >= (note_length / TIMER_3_PERIOD * 0xFFFF - 1));
-            else
-                end_of_note = (note_position >= (note_length));
-        } else {
-            end_of_note = (note_position >= (note_length));
+    if (playing_notes) {
+        if (!song_step(&p)) {
+            DISABLE_AUDIO_COUNTER_3_ISR;
+            DISABLE_AUDIO_COUNTER_3_OUTPUT;
+            playing_notes = false;
+            return;
         }
+    }
 
-        if (end_of_note) {
-            current_note++;
-            if (current_note >= notes_count) {
-                if (notes_repeat) {
-                    current_note = 0;
-                } else {
-                    DISABLE_AUDIO_COUNTER_3_ISR;
-                    DISABLE_AUDIO_COUNTER_3_OUTPUT;
-                    playing_notes = false;
-                    return;
-                }
-            }
-            if (!note_resting) {
-                note_resting = true;
-                current_note--;
-                if ((*notes_pointer)[current_note][0] == (*notes_pointer)[current_note + 1][0]) {
-                    note_frequency = 0;
-                    note_length = 1;
-                } else {
-                    note_frequency = (*notes_pointer)[current_note][0];
-                    note_length = 1;
-                }
-            } else {
-                note_resting = false;
-                envelope_index = 0;
-                note_frequency = (*notes_pointer)[current_note][0];
-                note_length = ((*notes_pointer)[current_note][1] / 4) * (((float)note_tempo) / 100);
-            }
-
-            note_position = 0;
+    if (playing_note || playing_notes) {
+        if (p) {
+            TIMER_3_PERIOD = p;
+            TIMER_3_DUTY_CYCLE = duty_cycle(p);
+        } else {
+            TIMER_3_PERIOD = REST_PERIOD;
+            TIMER_3_DUTY_CYCLE = 0;
         }
     }
 
@@ -474,6 +591,7 @@ ISR(TIMER3_COMPA_vect)
         playing_notes = false;
         playing_note = false;
     }
+    PROFILE_END(TIMER_3_COUNTER);
 }
 #endif
 
@@ -481,132 +599,38 @@ ISR(TIMER3_COMPA_vect)
 ISR(TIMER1_COMPA_vect)
 {
     #if defined(B5_AUDIO) && !defined(C6_AUDIO)
-    float freq = 0;
+    PROFILE_START(TIMER_1_COUNTER, TIMER_1_PERIOD);
+    uint16_t p = 0;
 
     if (playing_note) {
         if (voices > 0) {
-            if (polyphony_rate > 0) {
-                if (voices > 1) {
-                    voice_place %= voices;
-                    if (place++ > (frequencies[voice_place] / polyphony_rate / CPU_PRESCALER)) {
-                        voice_place = (voice_place + 1) % voices;
-                        place = 0.0;
-                    }
-                }
-
-                #ifdef VIBRATO_ENABLE
-                    if (vibrato_strength > 0) {
-                        freq = vibrato(frequencies[voice_place]);
-                    } else {
-                        freq = frequencies[voice_place];
-                    }
-                #else
-                    freq = frequencies[voice_place];
-                #endif
-            } else {
-                if (glissando) {
-                    if (frequency != 0 && frequency < frequencies[voices - 1] && frequency < frequencies[voices - 1] * pow(2, -440/frequencies[voices - 1]/12/2)) {
-                        frequency = frequency * pow(2, 440/frequency/12/2);
-                    } else if (frequency != 0 && frequency > frequencies[voices - 1] && frequency > frequencies[voices - 1] * pow(2, 440/frequencies[voices - 1]/12/2)) {
-                        frequency = frequency * pow(2, -440/frequency/12/2);
-                    } else {
-                        frequency = frequencies[voices - 1];
-                    }
-                } else {
-                    frequency = frequencies[voices - 1];
-                }
-
-                #ifdef VIBRATO_ENABLE
-                    if (vibrato_strength > 0) {
-                        freq = vibrato(frequency);
-                    } else {
-                        freq = frequency;
-                    }
-                #else
-                    freq = frequency;
-                #endif
-            }
-
-            if (envelope_index < 65535) {
-                envelope_index++;
-            }
-
-            freq = voice_envelope(freq);
-
-            if (freq < 30.517578125) {
-                freq = 30.52;
-            }
-
-            TIMER_1_PERIOD = (uint16_t)(((float)F_CPU) / (freq * CPU_PRESCALER));
-            TIMER_1_DUTY_CYCLE = (uint16_t)((((float)F_CPU) / (freq * CPU_PRESCALER)) * note_timbre);
-        }
-    }
-
-    if (playing_notes) {
-        if (note_frequency > 0) {
+            period = slide(period, periods[voices - 1]);
+            p = period;
             #ifdef VIBRATO_ENABLE
                 if (vibrato_strength > 0) {
-                    freq = vibrato(note_frequency);
-                } else {
-                    freq = note_frequency;
+                    p = vibrato(p, vibrato_steps[voices - 1]);
                 }
-            #else
-                    freq = note_frequency;
             #endif
-
-            if (envelope_index < 65535) {
-                envelope_index++;
-            }
-            freq = voice_envelope(freq);
-
-            TIMER_1_PERIOD = (uint16_t)(((float)F_CPU) / (freq * CPU_PRESCALER));
-            TIMER_1_DUTY_CYCLE = (uint16_t)((((float)F_CPU) / (freq * CPU_PRESCALER)) * note_timbre);
-        } else {
-            TIMER_1_PERIOD = 0;
-            TIMER_1_DUTY_CYCLE = 0;
+            p = envelope(p);
         }
+    }
 
-        note_position++;
-        bool end_of_note = false;
-        if (TIMER_1_PERIOD > 0) {
-            if (!note_resting) 
-                end_of_note = (note_position >= (note_length / TIMER_1_PERIOD * 0xFFFF - 1));
-            else
-                end_of_note = (note_position >= (note_length));
-        } else {
-            end_of_note = (note_position >= (note_length));
+    if (playing_notes) {
+        if (!song_step(&p)) {
+            DISABLE_AUDIO_COUNTER_1_ISR;
+            DISABLE_AUDIO_COUNTER_1_OUTPUT;
+            playing_notes = false;
+            return;
         }
+    }
 
-        if (end_of_note) {
-            current_note++;
-            if (current_note >= notes_count) {
-                if (notes_repeat) {
-                    current_note = 0;
-                } else {
-                    DISABLE_AUDIO_COUNTER_1_ISR;
-                    DISABLE_AUDIO_COUNTER_1_OUTPUT;
-                    playing_notes = false;
-                    return;
-                }
-            }
-            if (!note_resting) {
-                note_resting = true;
-                current_note--;
-                if ((*notes_pointer)[current_note][0] == (*notes_pointer)[current_note + 1][0]) {
-                    note_frequency = 0;
-                    note_length = 1;
-                } else {
-                    note_frequency = (*notes_pointer)[current_note][0];
-                    note_length = 1;
-                }
-            } else {
-                note_resting = false;
-                envelope_index = 0;
-                note_frequency = (*notes_pointer)[current_note][0];
-                note_length = ((*notes_pointer)[current_note][1] / 4) * (((float)note_tempo) / 100);
-            }
-
-            note_position = 0;
+    if (playing_note || playing_notes) {
+        if (p) {
+            TIMER_1_PERIOD = p;
+            TIMER_1_DUTY_CYCLE = duty_cycle(p);
+        } else {
+            TIMER_1_PERIOD = REST_PERIOD;
+            TIMER_1_DUTY_CYCLE = 0;
         }
     }
 
@@ -614,10 +638,18 @@ ISR(TIMER1_COMPA_vect)
         playing_notes = false;
         playing_note = false;
     }
+    PROFILE_END(TIMER_1_COUNTER);
 #endif
 }
 #endif
 
+#ifdef AUDIO_ISR_PROFILE
+uint16_t audio_get_isr_max_cycles(void)
+{
+    return isr_max_ticks * CPU_PRESCALER;
+}
+#endif
+
 void play_note(float freq, int vol) {
 
     dprintf("audio play note freq=%d vol=%d", (int)freq, vol);
@@ -644,7 +676,11 @@ void play_note(float freq, int vol) {
 
         if (freq > 0) {
             frequencies[voices] = freq;
+            periods[voices] = frequency_to_period(freq);
             volumes[voices] = vol;
+            #ifdef VIBRATO_ENABLE
+                vibrato_steps[voices] = vibrato_step(freq);
+            #endif
             voices++;
         }
 
@@ -667,52 +703,70 @@ void play_note(float freq, int vol) {
 
 }
 
-void play_notes(float (*np)[][2], uint16_t n_count, bool n_repeat)
+// Stops what is playing before a song, returns false when audio is off
+static bool stop_for_song(void)
 {
-
     if (!audio_initialized) {
         audio_init();
     }
 
-    if (audio_config.enable) {
-
-        #ifdef C6_AUDIO
-            DISABLE_AUDIO_COUNTER_3_ISR;
-        #endif
-        #ifdef B5_AUDIO
-            DISABLE_AUDIO_COUNTER_1_ISR;
-        #endif
-
-        // Cancel note if a note is playing
-        if (playing_note)
-            stop_all_notes();
-
-        playing_notes = true;
-
-        notes_pointer = np;
-        notes_count = n_count;
-        notes_repeat = n_repeat;
+    if (!audio_config.enable) {
+        return false;
+    }
 
-        place = 0;
-        current_note = 0;
+    #ifdef C6_AUDIO
+        DISABLE_AUDIO_COUNTER_3_ISR;
+    #endif
+    #ifdef B5_AUDIO
+        DISABLE_AUDIO_COUNTER_1_ISR;
+    #endif
 
-        note_frequency = (*notes_pointer)[current_note][0];
-        note_length = ((*notes_pointer)[current_note][1] / 4) * (((float)note_tempo) / 100);
-        note_position = 0;
+    // Cancel note if a note is playing
+    if (playing_note)
+        stop_all_notes();
+    return true;
+}
 
+// Starts the song in notes_pointer or compact_notes
+static void start_song(uint16_t n_count, bool n_repeat)
+{
+    notes_count = n_count;
+    notes_repeat = n_repeat;
+
+    current_note = 0;
+    note_period = 0;
+    playing_notes = start_song_note();
+    if (!playing_notes) {
+        return;
+    }
 
-        #ifdef C6_AUDIO
-            ENABLE_AUDIO_COUNTER_3_ISR;
-            ENABLE_AUDIO_COUNTER_3_OUTPUT;
-        #endif
-        #ifdef B5_AUDIO
-            #ifndef C6_AUDIO
-            ENABLE_AUDIO_COUNTER_1_ISR;
-            ENABLE_AUDIO_COUNTER_1_OUTPUT;
-            #endif
+    #ifdef C6_AUDIO
+        ENABLE_AUDIO_COUNTER_3_ISR;
+        ENABLE_AUDIO_COUNTER_3_OUTPUT;
+    #endif
+    #ifdef B5_AUDIO
+        #ifndef C6_AUDIO
+        ENABLE_AUDIO_COUNTER_1_ISR;
+        ENABLE_AUDIO_COUNTER_1_OUTPUT;
         #endif
+    #endif
+}
+
+void play_notes(float (*np)[][2], uint16_t n_count, bool n_repeat)
+{
+    if (stop_for_song()) {
+        notes_pointer = np;
+        compact_notes = NULL;
+        start_song(n_count, n_repeat);
     }
+}
 
+void play_compact_notes(const song_note_t (*np)[], uint16_t n_count, bool n_repeat)
+{
+    if (stop_for_song()) {
+        compact_notes = *np;
+        start_song(n_count, n_repeat);
+    }
 }
 
 bool is_playing_notes(void) {
@@ -747,7 +801,7 @@ void audio_off(void) {
 
 #ifdef VIBRATO_ENABLE
 
-// Vibrato rate functions
+// Vibrato rate functions, the rate of the notes already playing does not change
 
 void set_vibrato_rate(float rate) {
     vibrato_rate = rate;
@@ -765,14 +819,17 @@ void decrease_vibrato_rate(float change) {
 
 void set_vibrato_strength(float strength) {
     vibrato_strength = strength;
+    update_vibrato_periods();
 }
 
 void increase_vibrato_strength(float change) {
     vibrato_strength *= change;
+    update_vibrato_periods();
 }
 
 void decrease_vibrato_strength(float change) {
     vibrato_strength /= change;
+    update_vibrato_periods();
 }
 
 #endif  /* VIBRATO_STRENGTH_ENABLE */
@@ -811,10 +868,12 @@ void set_timbre(float timbre) {
 
 void set_tempo(uint8_t tempo) {
     note_tempo = tempo;
+    update_duration_ticks();
 }
 
 void decrease_tempo(uint8_t tempo_change) {
     note_tempo += tempo_change;
+    update_duration_ticks();
 }
 
 void increase_tempo(uint8_t tempo_change) {
@@ -823,4 +882,5 @@ void increase_tempo(uint8_t tempo_change) {
     } else {
         note_tempo -= tempo_change;
     }
+    update_duration_ticks();
 }
@@ -22,6 +22,7 @@
   #include <avr/io.h>
 #endif
 #include "wait.h"
+#include "progmem.h"
 #include "musical_notes.h"
 #include "song_list.h"
 #include "voices.h"
@@ -90,6 +91,8 @@ void play_note(float freq, int vol);
 void stop_note(float freq);
 void stop_all_notes(void);
 void play_notes(float (*np)[][2], uint16_t n_count, bool n_repeat);
+// Plays a song of song_note_t, which is read from PROGMEM on AVR
+void play_compact_notes(const song_note_t (*np)[], uint16_t n_count, bool n_repeat);
 
 #define SCALE (int8_t []){ 0 + (12*0), 2 + (12*0), 4 + (12*0), 5 + (12*0), 7 + (12*0), 9 + (12*0), 11 + (12*0), \
                            0 + (12*1), 2 + (12*1), 4 + (12*1), 5 + (12*1), 7 + (12*1), 9 + (12*1), 11 + (12*1), \
@@ -99,13 +102,25 @@ void play_notes(float (*np)[][2], uint16_t n_count, bool n_repeat);
 
 // These macros are used to allow play_notes to play an array of indeterminate
 // length. This works around the limitation of C's sizeof operation on pointers.
-// The global float array for the song must be used here.
+// The global float or song_note_t array for the song must be used here.
 #define NOTE_ARRAY_SIZE(x) ((int16_t)(sizeof(x) / (sizeof(x[0]))))
 #define PLAY_NOTE_ARRAY(note_array, note_repeat, deprecated_arg) play_notes(&note_array, NOTE_ARRAY_SIZE((note_array)), (note_repeat)); \
 	_Pragma ("message \"'PLAY_NOTE_ARRAY' macro is deprecated\"")
-#define PLAY_SONG(note_array) play_notes(&note_array, NOTE_ARRAY_SIZE((note_array)), false)
-#define PLAY_LOOP(note_array) play_notes(&note_array, NOTE_ARRAY_SIZE((note_array)), true)
+// The player is picked from the type of the notes with GCC builtins, the
+// firmware is built as gnu99 which has no _Generic. The qualifiers are
+// ignored, so const song_note_t is a compact song too.
+#define PLAY_SONG_ARRAY(note_array, note_repeat) __builtin_choose_expr( \
+        __builtin_types_compatible_p(__typeof__((note_array)[0]), song_note_t), \
+        play_compact_notes((const song_note_t (*)[])(const void*)&(note_array), NOTE_ARRAY_SIZE((note_array)), (note_repeat)), \
+        play_notes((float (*)[][2])(void*)&(note_array), NOTE_ARRAY_SIZE((note_array)), (note_repeat)))
+#define PLAY_SONG(note_array) PLAY_SONG_ARRAY(note_array, false)
+#define PLAY_LOOP(note_array) PLAY_SONG_ARRAY(note_array, true)
 
 bool is_playing_notes(void);
 
+#ifdef AUDIO_ISR_PROFILE
+// AVR only, the longest time spent in the audio interrupt in CPU cycles
+uint16_t audio_get_isr_max_cycles(void);
+#endif
+
 #endif
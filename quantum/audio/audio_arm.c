@@ -23,21 +23,38 @@
 #include "keymap.h"
 
 #include "eeconfig.h"
+#include "wavetable.h"
 
 // -----------------------------------------------------------------------------
 
+// The DAC plays AUDIO_DAC_SAMPLE_RATE samples per second, which GPT6
+// triggers. The timer clock has to be a whole fraction of the timer's input
+// clock, which 48kHz is on the STM32F0 and STM32F3.
+#ifndef AUDIO_DAC_SAMPLE_RATE
+    #define AUDIO_DAC_SAMPLE_RATE 48000U
+#endif
+
+// Samples in each half of the circular DMA buffer. The DMA plays one half
+// while the other is mixed, and the notes move on once per half.
+#ifndef AUDIO_DAC_BUFFER_SIZE
+    #define AUDIO_DAC_BUFFER_SIZE 128U
+#endif
+
+// The number of voices play_note mixes, and the voice of play_notes
+#define AUDIO_MAX_VOICES 8
+
+// Samples per unit of note duration at tempo 1, where a quarter note is 16.
+// A duration of 4 at tempo 100 lasts as long as on AVR, 0xFFFF ticks of a
+// 2MHz timer.
+#define DURATION_SAMPLES (AUDIO_DAC_SAMPLE_RATE * (65535.0f / 400 / 2000000))
+
 int voices = 0;
-int voice_place = 0;
-float frequency = 0;
-float frequency_alt = 0;
 int volume = 0;
-long position = 0;
 
 float frequencies[8] = {0, 0, 0, 0, 0, 0, 0, 0};
 int volumes[8] = {0, 0, 0, 0, 0, 0, 0, 0};
-bool sliding = false;
-
-float place = 0;
+// The frequencies the voices play, which slide towards frequencies with glissando
+static float voice_frequencies[8] = {0, 0, 0, 0, 0, 0, 0, 0};
 
 uint8_t * sample;
 uint16_t sample_length = 0;
@@ -45,17 +62,18 @@ uint16_t sample_length = 0;
 bool     playing_notes = false;
 bool     playing_note = false;
 float    note_frequency = 0;
-float    note_length = 0;
 uint8_t  note_tempo = TEMPO_DEFAULT;
 float    note_timbre = TIMBRE_DEFAULT;
-uint16_t note_position = 0;
 float (* notes_pointer)[][2];
+// Set instead of notes_pointer when a compact song is playing
+const song_note_t* compact_notes = NULL;
 uint16_t notes_count;
 bool     notes_repeat;
 bool     note_resting = false;
+// Samples left in the note or rest of the song
+static uint32_t note_samples_left = 0;
 
-uint8_t current_note = 0;
-uint8_t rest_counter = 0;
+uint16_t current_note = 0;
 
 #ifdef VIBRATO_ENABLE
 float vibrato_counter = 0;
@@ -72,189 +90,182 @@ audio_config_t audio_config;
 uint16_t envelope_index = 0;
 bool glissando = true;
 
+// The mixer voices, the voices of play_note first and then the song
+static wavetable_voice_t mixer_voices[AUDIO_MAX_VOICES + 1];
+static int16_t wavetable[WAVETABLE_LENGTH];
+static float wavetable_timbre = -1;
+
+static dacsample_t dac_buffer[AUDIO_DAC_BUFFER_SIZE * 2];
+static bool dac_running = false;
+// Halves of the buffer filled with silence since the last sound
+static uint8_t silent_halves = 0;
+
 #ifndef STARTUP_SONG
     #define STARTUP_SONG SONG(STARTUP_SOUND)
 #endif
-float startup_song[][2] = STARTUP_SONG;
-
-static void gpt_cb8(GPTDriver *gptp);
-
-#define DAC_BUFFER_SIZE 360
-
-#define START_CHANNEL_1() gptStart(&GPTD6, &gpt6cfg1); \
-    gptStartContinuous(&GPTD6, 2U)
-#define START_CHANNEL_2() gptStart(&GPTD7, &gpt7cfg1); \
-    gptStartContinuous(&GPTD7, 2U)
-#define STOP_CHANNEL_1() gptStopTimer(&GPTD6)
-#define STOP_CHANNEL_2() gptStopTimer(&GPTD7)
-#define RESTART_CHANNEL_1() STOP_CHANNEL_1(); \
-    START_CHANNEL_1()
-#define RESTART_CHANNEL_2() STOP_CHANNEL_2(); \
-    START_CHANNEL_2()
-#define UPDATE_CHANNEL_1_FREQ(freq) gpt6cfg1.frequency = freq * DAC_BUFFER_SIZE; \
-    RESTART_CHANNEL_1()
-#define UPDATE_CHANNEL_2_FREQ(freq) gpt7cfg1.frequency = freq * DAC_BUFFER_SIZE; \
-    RESTART_CHANNEL_2()
-#define GET_CHANNEL_1_FREQ gpt6cfg1.frequency
-#define GET_CHANNEL_2_FREQ gpt7cfg1.frequency
+const song_note_t startup_song[] = STARTUP_SONG;
+
+// The frequency of a note of the song, the note macros store negated MIDI
+// note numbers and raw frequencies are positive
+static float song_note_frequency(uint16_t index) {
+    float value = compact_notes ? compact_notes[index].note : (*notes_pointer)[index][0];
+    if (value < 0) {
+        return 440.0f * pow(2.0f, (-value - 69) / 12.0f);
+    }
+    return value;
+}
 
+static uint32_t song_note_samples(uint16_t index) {
+    float duration = compact_notes ? compact_notes[index].duration : (*notes_pointer)[index][1];
+    return duration * note_tempo * DURATION_SAMPLES;
+}
 
-/*
- * GPT6 configuration.
- */
-// static const GPTConfig gpt6cfg1 = {
-//   .frequency    = 1000000U,
-//   .callback     = NULL,
-//   .cr2          = TIM_CR2_MMS_1,    /* MMS = 010 = TRGO on Update Event.    */
-//   .dier         = 0U
-// };
-
-GPTConfig gpt6cfg1 = {
-  .frequency    = 440U*DAC_BUFFER_SIZE,
+static GPTConfig gpt6cfg1 = {
+  .frequency    = AUDIO_DAC_SAMPLE_RATE * 2U,
   .callback     = NULL,
   .cr2          = TIM_CR2_MMS_1,    /* MMS = 010 = TRGO on Update Event.    */
   .dier         = 0U
 };
 
-GPTConfig gpt7cfg1 = {
-  .frequency    = 440U*DAC_BUFFER_SIZE,
-  .callback     = NULL,
-  .cr2          = TIM_CR2_MMS_1,    /* MMS = 010 = TRGO on Update Event.    */
-  .dier         = 0U
-};
+#ifdef VIBRATO_ENABLE
 
-GPTConfig gpt8cfg1 = {
-  .frequency    = 10,
-  .callback     = gpt_cb8,
-  .cr2          = TIM_CR2_MMS_1,    /* MMS = 010 = TRGO on Update Event.    */
-  .dier         = 0U
-};
+float mod(float a, int b)
+{
+    float r = fmod(a, b);
+    return r < 0 ? r + b : r;
+}
 
+float vibrato(float average_freq) {
+    #ifdef VIBRATO_STRENGTH_ENABLE
+        float vibrated_freq = average_freq * pow(vibrato_lut[(int)vibrato_counter], vibrato_strength);
+    #else
+        float vibrated_freq = average_freq * vibrato_lut[(int)vibrato_counter];
+    #endif
+    vibrato_counter = mod((vibrato_counter + vibrato_rate * (1.0 + 440.0/average_freq)), VIBRATO_LUT_LENGTH);
+    return vibrated_freq;
+}
 
-/*
- * DAC test buffer (sine wave).
- */
-// static const dacsample_t dac_buffer[DAC_BUFFER_SIZE] = {
-//   2047, 2082, 2118, 2154, 2189, 2225, 2260, 2296, 2331, 2367, 2402, 2437,
-//   2472, 2507, 2542, 2576, 2611, 2645, 2679, 2713, 2747, 2780, 2813, 2846,
-//   2879, 2912, 2944, 2976, 3008, 3039, 3070, 3101, 3131, 3161, 3191, 3221,
-//   3250, 3278, 3307, 3335, 3362, 3389, 3416, 3443, 3468, 3494, 3519, 3544,
-//   3568, 3591, 3615, 3637, 3660, 3681, 3703, 3723, 3744, 3763, 3782, 3801,
-//   3819, 3837, 3854, 3870, 3886, 3902, 3917, 3931, 3944, 3958, 3970, 3982,
-//   3993, 4004, 4014, 4024, 4033, 4041, 4049, 4056, 4062, 4068, 4074, 4078,
-//   4082, 4086, 4089, 4091, 4092, 4093, 4094, 4093, 4092, 4091, 4089, 4086,
-//   4082, 4078, 4074, 4068, 4062, 4056, 4049, 4041, 4033, 4024, 4014, 4004,
-//   3993, 3982, 3970, 3958, 3944, 3931, 3917, 3902, 3886, 3870, 3854, 3837,
-//   3819, 3801, 3782, 3763, 3744, 3723, 3703, 3681, 3660, 3637, 3615, 3591,
-//   3568, 3544, 3519, 3494, 3468, 3443, 3416, 3389, 3362, 3335, 3307, 3278,
-//   3250, 3221, 3191, 3161, 3131, 3101, 3070, 3039, 3008, 2976, 2944, 2912,
-//   2879, 2846, 2813, 2780, 2747, 2713, 2679, 2645, 2611, 2576, 2542, 2507,
-//   2472, 2437, 2402, 2367, 2331, 2296, 2260, 2225, 2189, 2154, 2118, 2082,
-//   2047, 2012, 1976, 1940, 1905, 1869, 1834, 1798, 1763, 1727, 1692, 1657,
-//   1622, 1587, 1552, 1518, 1483, 1449, 1415, 1381, 1347, 1314, 1281, 1248,
-//   1215, 1182, 1150, 1118, 1086, 1055, 1024,  993,  963,  933,  903,  873,
-//    844,  816,  787,  759,  732,  705,  678,  651,  626,  600,  575,  550,
-//    526,  503,  479,  457,  434,  413,  391,  371,  350,  331,  312,  293,
-//    275,  257,  240,  224,  208,  192,  177,  163,  150,  136,  124,  112,
-//    101,   90,   80,   70,   61,   53,   45,   38,   32,   26,   20,   16,
-//     12,    8,    5,    3,    2,    1,    0,    1,    2,    3,    5,    8,
-//     12,   16,   20,   26,   32,   38,   45,   53,   61,   70,   80,   90,
-//    101,  112,  124,  136,  150,  163,  177,  192,  208,  224,  240,  257,
-//    275,  293,  312,  331,  350,  371,  391,  413,  434,  457,  479,  503,
-//    526,  550,  575,  600,  626,  651,  678,  705,  732,  759,  787,  816,
-//    844,  873,  903,  933,  963,  993, 1024, 1055, 1086, 1118, 1150, 1182,
-//   1215, 1248, 1281, 1314, 1347, 1381, 1415, 1449, 1483, 1518, 1552, 1587,
-//   1622, 1657, 1692, 1727, 1763, 1798, 1834, 1869, 1905, 1940, 1976, 2012
-// };
-
-// squarewave
-static const dacsample_t dac_buffer[DAC_BUFFER_SIZE] = {
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-
-  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-  0, 0, 0, 0, 0, 0, 0,  0,  0,  0,  0,  0,
-   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
-    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-   0,  0,  0,  0,  0,  0, 0, 0, 0, 0, 0, 0,
-  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-};
+#endif
 
-// squarewave
-static const dacsample_t dac_buffer_2[DAC_BUFFER_SIZE] = {
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-  2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047, 2047,
-
-  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-  0, 0, 0, 0, 0, 0, 0,  0,  0,  0,  0,  0,
-   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
-    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-   0,  0,  0,  0,  0,  0, 0, 0, 0, 0, 0, 0,
-  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-};
+// Moves the frequency a quarter tone towards the target when glissando is on
+static float slide(float current, float target)
+{
+    if (!glissando || current == 0) {
+        return target;
+    }
+    if (current < target * pow(2, -440/target/12/2)) {
+        return current * pow(2, 440/current/12/2);
+    }
+    if (current > target * pow(2, 440/target/12/2)) {
+        return current * pow(2, -440/current/12/2);
+    }
+    return target;
+}
+
+// The frequency a voice plays after vibrato and the envelope
+static float voice_frequency(float freq)
+{
+    #ifdef VIBRATO_ENABLE
+        if (vibrato_strength > 0) {
+            freq = vibrato(freq);
+        }
+    #endif
+    return voice_envelope(freq);
+}
+
+// Moves the song on by one half buffer, and sets its mixer voice
+static void song_step(void)
+{
+    if (note_samples_left > AUDIO_DAC_BUFFER_SIZE) {
+        note_samples_left -= AUDIO_DAC_BUFFER_SIZE;
+    } else if (!note_resting && current_note + 1 < notes_count &&
+               song_note_frequency(current_note) == song_note_frequency(current_note + 1)) {
+        // A short rest between two notes of the same frequency
+        note_resting = true;
+        note_frequency = 0;
+        note_samples_left = AUDIO_DAC_BUFFER_SIZE;
+    } else {
+        note_resting = false;
+        current_note++;
+        if (current_note >= notes_count) {
+            if (!notes_repeat) {
+                playing_notes = false;
+                mixer_voices[AUDIO_MAX_VOICES].increment = 0;
+                return;
+            }
+            current_note = 0;
+        }
+        envelope_index = 0;
+        note_frequency = song_note_frequency(current_note);
+        note_samples_left = song_note_samples(current_note);
+    }
+
+    float freq = 0;
+    if (note_frequency > 0) {
+        if (envelope_index < 65535) {
+            envelope_index++;
+        }
+        freq = voice_frequency(note_frequency);
+    }
+    mixer_voices[AUDIO_MAX_VOICES].increment = wavetable_increment(freq, AUDIO_DAC_SAMPLE_RATE);
+}
+
+// Works out the phase increments of the voices for the next half buffer
+static void update_voices(void)
+{
+    if (!audio_config.enable) {
+        playing_notes = false;
+        playing_note = false;
+    }
+
+    uint8_t v = 0;
+    if (playing_note) {
+        if (envelope_index < 65535) {
+            envelope_index++;
+        }
+        for (; v < voices; v++) {
+            voice_frequencies[v] = slide(voice_frequencies[v], frequencies[v]);
+            float freq = voice_frequency(voice_frequencies[v]);
+            mixer_voices[v].increment = wavetable_increment(freq, AUDIO_DAC_SAMPLE_RATE);
+        }
+    }
+    for (; v < AUDIO_MAX_VOICES; v++) {
+        mixer_voices[v].increment = 0;
+    }
+
+    if (playing_notes) {
+        song_step();
+    } else {
+        mixer_voices[AUDIO_MAX_VOICES].increment = 0;
+    }
+
+    // The envelopes change the timbre
+    if (note_timbre != wavetable_timbre) {
+        wavetable_timbre = note_timbre;
+        wavetable_square(wavetable, note_timbre);
+    }
+}
 
 /*
- * DAC streaming callback.
+ * DAC streaming callback, called when the DMA is done with a half of the
+ * buffer, which is then mixed again.
  */
-size_t nx = 0, ny = 0, nz = 0;
 static void end_cb1(DACDriver *dacp, dacsample_t *buffer, size_t n) {
 
   (void)dacp;
 
-  nz++;
-  if (dac_buffer == buffer) {
-    nx += n;
-  }
-  else {
-    ny += n;
-  }
-
-  if ((nz % 1000) == 0) {
-    // palTogglePad(GPIOD, GPIOD_LED3);
+  update_voices();
+  wavetable_mix(wavetable, mixer_voices, AUDIO_MAX_VOICES + 1, buffer, n);
+
+  // Stops the timer once both halves are silent, so that an idle keyboard
+  // does not mix anything and the DAC rests at the midpoint
+  if (playing_note || playing_notes) {
+    silent_halves = 0;
+  } else if (++silent_halves >= 2) {
+    osalSysLockFromISR();
+    gptStopTimerI(&GPTD6);
+    dac_running = false;
+    osalSysUnlockFromISR();
   }
 }
 
@@ -270,7 +281,7 @@ static void error_cb1(DACDriver *dacp, dacerror_t err) {
 }
 
 static const DACConfig dac1cfg1 = {
-  .init         = 2047U,
+  .init         = WAVETABLE_MIDPOINT,
   .datamode     = DAC_DHRM_12BIT_RIGHT
 };
 
@@ -282,16 +293,19 @@ static const DACConversionGroup dacgrpcfg1 = {
 };
 
 static const DACConfig dac1cfg2 = {
-  .init         = 2047U,
+  .init         = WAVETABLE_MIDPOINT,
   .datamode     = DAC_DHRM_12BIT_RIGHT
 };
 
-static const DACConversionGroup dacgrpcfg2 = {
-  .num_channels = 1U,
-  .end_cb       = end_cb1,
-  .error_cb     = error_cb1,
-  .trigger      = DAC_TRG(0)
-};
+// Starts the sample clock if it was stopped, called with the system locked
+static void start_dac_i(void)
+{
+    silent_halves = 0;
+    if (!dac_running) {
+        dac_running = true;
+        gptStartContinuousI(&GPTD6, 2U);
+    }
+}
 
 void audio_init()
 {
@@ -307,9 +321,16 @@ void audio_init()
     // audio_config.raw = eeconfig_read_audio();
     audio_config.enable = true;
 
+  for (uint16_t i = 0; i < AUDIO_DAC_BUFFER_SIZE * 2; i++) {
+    dac_buffer[i] = WAVETABLE_MIDPOINT;
+  }
+  wavetable_timbre = note_timbre;
+  wavetable_square(wavetable, note_timbre);
+
   /*
    * Starting DAC1 driver, setting up the output pin as analog as suggested
-   * by the Reference Manual.
+   * by the Reference Manual. All the voices are mixed on A4, A5 rests at the
+   * midpoint.
    */
   palSetPadMode(GPIOA, 4, PAL_MODE_INPUT_ANALOG);
   palSetPadMode(GPIOA, 5, PAL_MODE_INPUT_ANALOG);
@@ -317,19 +338,14 @@ void audio_init()
   dacStart(&DACD2, &dac1cfg2);
 
   /*
-   * Starting GPT6 driver, it is used for triggering the DAC.
+   * GPT6 triggers the DAC, it only runs while something plays.
    */
-  START_CHANNEL_1();
-  START_CHANNEL_2();
+  gptStart(&GPTD6, &gpt6cfg1);
 
   /*
-   * Starting a continuous conversion.
+   * Starting a continuous conversion, which the DMA keeps going on its own.
    */
-  dacStartConversion(&DACD1, &dacgrpcfg1,
-                     (dacsample_t *)dac_buffer, DAC_BUFFER_SIZE);
-  dacStartConversion(&DACD2, &dacgrpcfg2,
-                     (dacsample_t *)dac_buffer_2, DAC_BUFFER_SIZE);
-  // gptStartContinuous(&GPTD6, 2U);
+  dacStartConversion(&DACD1, &dacgrpcfg1, dac_buffer, AUDIO_DAC_BUFFER_SIZE * 2);
 
 
     audio_initialized = true;
@@ -347,23 +363,21 @@ void stop_all_notes()
     if (!audio_initialized) {
         audio_init();
     }
-    voices = 0;
 
-    gptStopTimer(&GPTD6);
-    gptStopTimer(&GPTD7);
-    gptStopTimer(&GPTD8);
+    chSysLock();
+    voices = 0;
 
     playing_notes = false;
     playing_note = false;
-    frequency = 0;
-    frequency_alt = 0;
     volume = 0;
 
     for (uint8_t i = 0; i < 8; i++)
     {
         frequencies[i] = 0;
+        voice_frequencies[i] = 0;
         volumes[i] = 0;
     }
+    chSysUnlock();
 }
 
 void stop_note(float freq)
@@ -374,241 +388,29 @@ void stop_note(float freq)
         if (!audio_initialized) {
             audio_init();
         }
+        chSysLock();
         for (int i = 7; i >= 0; i--) {
             if (frequencies[i] == freq) {
-                frequencies[i] = 0;
-                volumes[i] = 0;
                 for (int j = i; (j < 7); j++) {
                     frequencies[j] = frequencies[j+1];
-                    frequencies[j+1] = 0;
+                    voice_frequencies[j] = voice_frequencies[j+1];
                     volumes[j] = volumes[j+1];
-                    volumes[j+1] = 0;
+                    mixer_voices[j].phase = mixer_voices[j+1].phase;
                 }
+                frequencies[7] = 0;
+                voice_frequencies[7] = 0;
+                volumes[7] = 0;
                 break;
             }
         }
         voices--;
         if (voices < 0)
             voices = 0;
-        if (voice_place >= voices) {
-            voice_place = 0;
-        }
         if (voices == 0) {
-            STOP_CHANNEL_1();
-            STOP_CHANNEL_2();
-            gptStopTimer(&GPTD8);
-            frequency = 0;
-            frequency_alt = 0;
             volume = 0;
             playing_note = false;
         }
-    }
-}
-
-#ifdef VIBRATO_ENABLE
-
-float mod(float a, int b)
-{
-    float r = fmod(a, b);
-    return r < 0 ? r + b : r;
-}
-
-float vibrato(float average_freq) {
-    #ifdef VIBRATO_STRENGTH_ENABLE
-        float vibrated_freq = average_freq * pow(vibrato_lut[(int)vibrato_counter], vibrato_strength);
-    #else
-        float vibrated_freq = average_freq * vibrato_lut[(int)vibrato_counter];
-    #endif
-    vibrato_counter = mod((vibrato_counter + vibrato_rate * (1.0 + 440.0/average_freq)), VIBRATO_LUT_LENGTH);
-    return vibrated_freq;
-}
-
-#endif
-
-static void gpt_cb8(GPTDriver *gptp) {
-    float freq;
-
-    if (playing_note) {
-        if (voices > 0) {
-
-            float freq_alt = 0;
-                if (voices > 1) {
-                    if (polyphony_rate == 0) {
-                        if (glissando) {
-                            if (frequency_alt != 0 && frequency_alt < frequencies[voices - 2] && frequency_alt < frequencies[voices - 2] * pow(2, -440/frequencies[voices - 2]/12/2)) {
-                                frequency_alt = frequency_alt * pow(2, 440/frequency_alt/12/2);
-                            } else if (frequency_alt != 0 && frequency_alt > frequencies[voices - 2] && frequency_alt > frequencies[voices - 2] * pow(2, 440/frequencies[voices - 2]/12/2)) {
-                                frequency_alt = frequency_alt * pow(2, -440/frequency_alt/12/2);
-                            } else {
-                                frequency_alt = frequencies[voices - 2];
-                            }
-                        } else {
-                            frequency_alt = frequencies[voices - 2];
-                        }
-
-                        #ifdef VIBRATO_ENABLE
-                            if (vibrato_strength > 0) {
-                                freq_alt = vibrato(frequency_alt);
-                            } else {
-                                freq_alt = frequency_alt;
-                            }
-                        #else
-                            freq_alt = frequency_alt;
-                        #endif
-                    }
-
-                    if (envelope_index < 65535) {
-                        envelope_index++;
-                    }
-
-                    freq_alt = voice_envelope(freq_alt);
-
-                    if (freq_alt < 30.517578125) {
-                        freq_alt = 30.52;
-                    }
-
-                    if (GET_CHANNEL_2_FREQ != (uint16_t)freq_alt) {
-                        UPDATE_CHANNEL_2_FREQ(freq_alt);
-                    }
-                    //note_timbre;
-                }
-
-            if (polyphony_rate > 0) {
-                if (voices > 1) {
-                    voice_place %= voices;
-                    if (place++ > (frequencies[voice_place] / polyphony_rate)) {
-                        voice_place = (voice_place + 1) % voices;
-                        place = 0.0;
-                    }
-                }
-
-                #ifdef VIBRATO_ENABLE
-                    if (vibrato_strength > 0) {
-                        freq = vibrato(frequencies[voice_place]);
-                    } else {
-                        freq = frequencies[voice_place];
-                    }
-                #else
-                    freq = frequencies[voice_place];
-                #endif
-            } else {
-                if (glissando) {
-                    if (frequency != 0 && frequency < frequencies[voices - 1] && frequency < frequencies[voices - 1] * pow(2, -440/frequencies[voices - 1]/12/2)) {
-                        frequency = frequency * pow(2, 440/frequency/12/2);
-                    } else if (frequency != 0 && frequency > frequencies[voices - 1] && frequency > frequencies[voices - 1] * pow(2, 440/frequencies[voices - 1]/12/2)) {
-                        frequency = frequency * pow(2, -440/frequency/12/2);
-                    } else {
-                        frequency = frequencies[voices - 1];
-                    }
-                } else {
-                    frequency = frequencies[voices - 1];
-                }
-
-                #ifdef VIBRATO_ENABLE
-                    if (vibrato_strength > 0) {
-                        freq = vibrato(frequency);
-                    } else {
-                        freq = frequency;
-                    }
-                #else
-                    freq = frequency;
-                #endif
-            }
-
-            if (envelope_index < 65535) {
-                envelope_index++;
-            }
-
-            freq = voice_envelope(freq);
-
-            if (freq < 30.517578125) {
-                freq = 30.52;
-            }
-
-
-            if (GET_CHANNEL_1_FREQ != (uint16_t)freq) {
-                UPDATE_CHANNEL_1_FREQ(freq);
-            }
-            //note_timbre;
-        }
-    }
-
-    if (playing_notes) {
-        if (note_frequency > 0) {
-            #ifdef VIBRATO_ENABLE
-                if (vibrato_strength > 0) {
-                    freq = vibrato(note_frequency);
-                } else {
-                    freq = note_frequency;
-                }
-            #else
-                    freq = note_frequency;
-            #endif
-
-            if (envelope_index < 65535) {
-                envelope_index++;
-            }
-            freq = voice_envelope(freq);
-
-
-            if (GET_CHANNEL_1_FREQ != (uint16_t)freq) {
-                UPDATE_CHANNEL_1_FREQ(freq);
-                UPDATE_CHANNEL_2_FREQ(freq);
-            }
-            //note_timbre;
-        } else {
-            // gptStopTimer(&GPTD6);
-            // gptStopTimer(&GPTD7);
-        }
-
-        note_position++;
-        bool end_of_note = false;
-        if (GET_CHANNEL_1_FREQ > 0) {
-            if (!note_resting)
-                end_of_note = (note_position >= (note_length*16 - 1));
-            else
-                end_of_note = (note_position >= (note_length*16));
-        } else {
-            end_of_note = (note_position >= (note_length*16));
-        }
-
-        if (end_of_note) {
-            current_note++;
-            if (current_note >= notes_count) {
-                if (notes_repeat) {
-                    current_note = 0;
-                } else {
-                    STOP_CHANNEL_1();
-                    STOP_CHANNEL_2();
-                    // gptStopTimer(&GPTD8);
-                    playing_notes = false;
-                    return;
-                }
-            }
-            if (!note_resting) {
-                note_resting = true;
-                current_note--;
-                if ((*notes_pointer)[current_note][0] == (*notes_pointer)[current_note + 1][0]) {
-                    note_frequency = 0;
-                    note_length = 1;
-                } else {
-                    note_frequency = (*notes_pointer)[current_note][0];
-                    note_length = 1;
-                }
-            } else {
-                note_resting = false;
-                envelope_index = 0;
-                note_frequency = (*notes_pointer)[current_note][0];
-                note_length = ((*notes_pointer)[current_note][1] / 4) * (((float)note_tempo) / 100);
-            }
-
-            note_position = 0;
-        }
-    }
-
-    if (!audio_config.enable) {
-        playing_notes = false;
-        playing_note = false;
+        chSysUnlock();
     }
 }
 
@@ -620,31 +422,33 @@ void play_note(float freq, int vol) {
         audio_init();
     }
 
-    if (audio_config.enable && voices < 8) {
+    if (audio_config.enable && voices < AUDIO_MAX_VOICES) {
 
         // Cancel notes if notes are playing
         if (playing_notes)
             stop_all_notes();
 
+        chSysLock();
         playing_note = true;
 
         envelope_index = 0;
 
         if (freq > 0) {
             frequencies[voices] = freq;
+            // The new voice slides from the one below it
+            voice_frequencies[voices] = voices > 0 ? voice_frequencies[voices - 1] : 0;
             volumes[voices] = vol;
             voices++;
         }
 
-        gptStart(&GPTD8, &gpt8cfg1);
-        gptStartContinuous(&GPTD8, 2U);
-        RESTART_CHANNEL_1();
-        RESTART_CHANNEL_2();
+        start_dac_i();
+        chSysUnlock();
     }
 
 }
 
-void play_notes(float (*np)[][2], uint16_t n_count, bool n_repeat)
+// Starts a float song or a compact song
+static void start_song(float (*np)[][2], const song_note_t* compact, uint16_t n_count, bool n_repeat)
 {
 
     if (!audio_initialized) {
@@ -657,27 +461,38 @@ void play_notes(float (*np)[][2], uint16_t n_count, bool n_repeat)
         if (playing_note)
             stop_all_notes();
 
-        playing_notes = true;
+        chSysLock();
+        playing_notes = n_count > 0;
 
         notes_pointer = np;
+        compact_notes = compact;
         notes_count = n_count;
         notes_repeat = n_repeat;
 
-        place = 0;
         current_note = 0;
+        note_resting = false;
+        envelope_index = 0;
 
-        note_frequency = (*notes_pointer)[current_note][0];
-        note_length = ((*notes_pointer)[current_note][1] / 4) * (((float)note_tempo) / 100);
-        note_position = 0;
-
-        gptStart(&GPTD8, &gpt8cfg1);
-        gptStartContinuous(&GPTD8, 2U);
-        RESTART_CHANNEL_1();
-        RESTART_CHANNEL_2();
+        if (playing_notes) {
+            note_frequency = song_note_frequency(current_note);
+            note_samples_left = song_note_samples(current_note);
+            start_dac_i();
+        }
+        chSysUnlock();
     }
 
 }
 
+void play_notes(float (*np)[][2], uint16_t n_count, bool n_repeat)
+{
+    start_song(np, NULL, n_count, n_repeat);
+}
+
+void play_compact_notes(const song_note_t (*np)[], uint16_t n_count, bool n_repeat)
+{
+    start_song(NULL, *np, n_count, n_repeat);
+}
+
 bool is_playing_notes(void) {
     return playing_notes;
 }
@@ -17,15 +17,31 @@
 #ifndef MUSICAL_NOTES_H
 #define MUSICAL_NOTES_H
 
+#include <stdint.h>
+
 // Tempo Placeholder
 #define TEMPO_DEFAULT 100
 
 
 #define SONG(notes...) { notes }
 
+// A note of a compact song, 2 bytes instead of the 8 of a note in a float
+// song. The note macros below fill in the negated MIDI note number, which
+// players also accept in float songs, so the same SONG() can be stored as
+// either:
+//
+//   float my_song[][2] = SONG(MY_SOUND);
+//   const song_note_t my_song[] PROGMEM = SONG(MY_SOUND);
+//
+// A note with a raw frequency like {NOTE_C4, 16} only fits in a float song.
+typedef struct {
+    int8_t  note;     // minus the MIDI note number, 0 for a rest
+    uint8_t duration; // a quarter note is 16
+} song_note_t;
+
 
 // Note Types
-#define MUSICAL_NOTE(note, duration)   {(NOTE##note), duration}
+#define MUSICAL_NOTE(note, duration)   {-(NOTE_NUMBER##note), duration}
 #define WHOLE_NOTE(note)               MUSICAL_NOTE(note, 64)
 #define HALF_NOTE(note)                MUSICAL_NOTE(note, 32)
 #define QUARTER_NOTE(note)             MUSICAL_NOTE(note, 16)
@@ -222,5 +238,166 @@
 #define NOTE_AF8 NOTE_GS8
 #define NOTE_BF8 NOTE_AS8
 
+// MIDI note numbers of the notes, which the note macros use so that the same
+// songs can be stored as compact songs
+
+#define NOTE_NUMBER_REST    0
+
+// The notes below B1 only have numbers, the players work out the frequency
+#define NOTE_NUMBER_C0     12
+#define NOTE_NUMBER_CS0    13
+#define NOTE_NUMBER_D0     14
+#define NOTE_NUMBER_DS0    15
+#define NOTE_NUMBER_E0     16
+#define NOTE_NUMBER_F0     17
+#define NOTE_NUMBER_FS0    18
+#define NOTE_NUMBER_G0     19
+#define NOTE_NUMBER_GS0    20
+#define NOTE_NUMBER_A0     21
+#define NOTE_NUMBER_AS0    22
+#define NOTE_NUMBER_B0     23
+#define NOTE_NUMBER_C1     24
+#define NOTE_NUMBER_CS1    25
+#define NOTE_NUMBER_D1     26
+#define NOTE_NUMBER_DS1    27
+#define NOTE_NUMBER_E1     28
+#define NOTE_NUMBER_F1     29
+#define NOTE_NUMBER_FS1    30
+#define NOTE_NUMBER_G1     31
+#define NOTE_NUMBER_GS1    32
+#define NOTE_NUMBER_A1     33
+#define NOTE_NUMBER_AS1    34
+#define NOTE_NUMBER_B1     35
+#define NOTE_NUMBER_C2     36
+#define NOTE_NUMBER_CS2    37
+#define NOTE_NUMBER_D2     38
+#define NOTE_NUMBER_DS2    39
+#define NOTE_NUMBER_E2     40
+#define NOTE_NUMBER_F2     41
+#define NOTE_NUMBER_FS2    42
+#define NOTE_NUMBER_G2     43
+#define NOTE_NUMBER_GS2    44
+#define NOTE_NUMBER_A2     45
+#define NOTE_NUMBER_AS2    46
+#define NOTE_NUMBER_B2     47
+#define NOTE_NUMBER_C3     48
+#define NOTE_NUMBER_CS3    49
+#define NOTE_NUMBER_D3     50
+#define NOTE_NUMBER_DS3    51
+#define NOTE_NUMBER_E3     52
+#define NOTE_NUMBER_F3     53
+#define NOTE_NUMBER_FS3    54
+#define NOTE_NUMBER_G3     55
+#define NOTE_NUMBER_GS3    56
+#define NOTE_NUMBER_A3     57
+#define NOTE_NUMBER_AS3    58
+#define NOTE_NUMBER_B3     59
+#define NOTE_NUMBER_C4     60
+#define NOTE_NUMBER_CS4    61
+#define NOTE_NUMBER_D4     62
+#define NOTE_NUMBER_DS4    63
+#define NOTE_NUMBER_E4     64
+#define NOTE_NUMBER_F4     65
+#define NOTE_NUMBER_FS4    66
+#define NOTE_NUMBER_G4     67
+#define NOTE_NUMBER_GS4    68
+#define NOTE_NUMBER_A4     69
+#define NOTE_NUMBER_AS4    70
+#define NOTE_NUMBER_B4     71
+#define NOTE_NUMBER_C5     72
+#define NOTE_NUMBER_CS5    73
+#define NOTE_NUMBER_D5     74
+#define NOTE_NUMBER_DS5    75
+#define NOTE_NUMBER_E5     76
+#define NOTE_NUMBER_F5     77
+#define NOTE_NUMBER_FS5    78
+#define NOTE_NUMBER_G5     79
+#define NOTE_NUMBER_GS5    80
+#define NOTE_NUMBER_A5     81
+#define NOTE_NUMBER_AS5    82
+#define NOTE_NUMBER_B5     83
+#define NOTE_NUMBER_C6     84
+#define NOTE_NUMBER_CS6    85
+#define NOTE_NUMBER_D6     86
+#define NOTE_NUMBER_DS6    87
+#define NOTE_NUMBER_E6     88
+#define NOTE_NUMBER_F6     89
+#define NOTE_NUMBER_FS6    90
+#define NOTE_NUMBER_G6     91
+#define NOTE_NUMBER_GS6    92
+#define NOTE_NUMBER_A6     93
+#define NOTE_NUMBER_AS6    94
+#define NOTE_NUMBER_B6     95
+#define NOTE_NUMBER_C7     96
+#define NOTE_NUMBER_CS7    97
+#define NOTE_NUMBER_D7     98
+#define NOTE_NUMBER_DS7    99
+#define NOTE_NUMBER_E7    100
+#define NOTE_NUMBER_F7    101
+#define NOTE_NUMBER_FS7   102
+#define NOTE_NUMBER_G7    103
+#define NOTE_NUMBER_GS7   104
+#define NOTE_NUMBER_A7    105
+#define NOTE_NUMBER_AS7   106
+#define NOTE_NUMBER_B7    107
+#define NOTE_NUMBER_C8    108
+#define NOTE_NUMBER_CS8   109
+#define NOTE_NUMBER_D8    110
+#define NOTE_NUMBER_DS8   111
+#define NOTE_NUMBER_E8    112
+#define NOTE_NUMBER_F8    113
+#define NOTE_NUMBER_FS8   114
+#define NOTE_NUMBER_G8    115
+#define NOTE_NUMBER_GS8   116
+#define NOTE_NUMBER_A8    117
+#define NOTE_NUMBER_AS8   118
+#define NOTE_NUMBER_B8    119
+
+#define NOTE_NUMBER_DF0 NOTE_NUMBER_CS0
+#define NOTE_NUMBER_EF0 NOTE_NUMBER_DS0
+#define NOTE_NUMBER_GF0 NOTE_NUMBER_FS0
+#define NOTE_NUMBER_AF0 NOTE_NUMBER_GS0
+#define NOTE_NUMBER_BF0 NOTE_NUMBER_AS0
+#define NOTE_NUMBER_DF1 NOTE_NUMBER_CS1
+#define NOTE_NUMBER_EF1 NOTE_NUMBER_DS1
+#define NOTE_NUMBER_GF1 NOTE_NUMBER_FS1
+#define NOTE_NUMBER_AF1 NOTE_NUMBER_GS1
+#define NOTE_NUMBER_BF1 NOTE_NUMBER_AS1
+#define NOTE_NUMBER_DF2 NOTE_NUMBER_CS2
+#define NOTE_NUMBER_EF2 NOTE_NUMBER_DS2
+#define NOTE_NUMBER_GF2 NOTE_NUMBER_FS2
+#define NOTE_NUMBER_AF2 NOTE_NUMBER_GS2
+#define NOTE_NUMBER_BF2 NOTE_NUMBER_AS2
+#define NOTE_NUMBER_DF3 NOTE_NUMBER_CS3
+#define NOTE_NUMBER_EF3 NOTE_NUMBER_DS3
+#define NOTE_NUMBER_GF3 NOTE_NUMBER_FS3
+#define NOTE_NUMBER_AF3 NOTE_NUMBER_GS3
+#define NOTE_NUMBER_BF3 NOTE_NUMBER_AS3
+#define NOTE_NUMBER_DF4 NOTE_NUMBER_CS4
+#define NOTE_NUMBER_EF4 NOTE_NUMBER_DS4
+#define NOTE_NUMBER_GF4 NOTE_NUMBER_FS4
+#define NOTE_NUMBER_AF4 NOTE_NUMBER_GS4
+#define NOTE_NUMBER_BF4 NOTE_NUMBER_AS4
+#define NOTE_NUMBER_DF5 NOTE_NUMBER_CS5
+#define NOTE_NUMBER_EF5 NOTE_NUMBER_DS5
+#define NOTE_NUMBER_GF5 NOTE_NUMBER_FS5
+#define NOTE_NUMBER_AF5 NOTE_NUMBER_GS5
+#define NOTE_NUMBER_BF5 NOTE_NUMBER_AS5
+#define NOTE_NUMBER_DF6 NOTE_NUMBER_CS6
+#define NOTE_NUMBER_EF6 NOTE_NUMBER_DS6
+#define NOTE_NUMBER_GF6 NOTE_NUMBER_FS6
+#define NOTE_NUMBER_AF6 NOTE_NUMBER_GS6
+#define NOTE_NUMBER_BF6 NOTE_NUMBER_AS6
+#define NOTE_NUMBER_DF7 NOTE_NUMBER_CS7
+#define NOTE_NUMBER_EF7 NOTE_NUMBER_DS7
+#define NOTE_NUMBER_GF7 NOTE_NUMBER_FS7
+#define NOTE_NUMBER_AF7 NOTE_NUMBER_GS7
+#define NOTE_NUMBER_BF7 NOTE_NUMBER_AS7
+#define NOTE_NUMBER_DF8 NOTE_NUMBER_CS8
+#define NOTE_NUMBER_EF8 NOTE_NUMBER_DS8
+#define NOTE_NUMBER_GF8 NOTE_NUMBER_FS8
+#define NOTE_NUMBER_AF8 NOTE_NUMBER_GS8
+#define NOTE_NUMBER_BF8 NOTE_NUMBER_AS8
+
 
 #endif
@@ -0,0 +1,3 @@
+wavetable_SRC :=\
+	$(QUANTUM_PATH)/audio/tests/wavetable_tests.cpp \
+	$(QUANTUM_PATH)/audio/wavetable.c
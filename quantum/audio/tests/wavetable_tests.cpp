@@ -0,0 +1,149 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include <vector>
+extern "C" {
+#include "audio/wavetable.h"
+}
+
+static const uint32_t SAMPLE_RATE = 48000;
+static const uint16_t HIGH = WAVETABLE_MIDPOINT + WAVETABLE_AMPLITUDE;
+static const uint16_t LOW = WAVETABLE_MIDPOINT - WAVETABLE_AMPLITUDE;
+
+class Wavetable : public testing::Test {
+public:
+    Wavetable() {
+        wavetable_square(table, 0.5f);
+        for (int i = 0; i < 4; i++) {
+            voices[i].phase = 0;
+            voices[i].increment = 0;
+        }
+    }
+
+    std::vector<uint16_t> mix(uint16_t length, uint8_t count = 4) {
+        // One extra sample to catch writes past the end
+        std::vector<uint16_t> out(length + 1, 0xFFFF);
+        wavetable_mix(table, voices, count, out.data(), length);
+        EXPECT_EQ(out.back(), 0xFFFF);
+        out.pop_back();
+        return out;
+    }
+
+    // Times the output goes from below the midpoint to above it
+    static int rising_edges(const std::vector<uint16_t>& out) {
+        int edges = 0;
+        for (size_t i = 1; i < out.size(); i++) {
+            if (out[i - 1] < WAVETABLE_MIDPOINT && out[i] > WAVETABLE_MIDPOINT) {
+                edges++;
+            }
+        }
+        return edges;
+    }
+
+    int16_t table[WAVETABLE_LENGTH];
+    wavetable_voice_t voices[4];
+};
+
+TEST_F(Wavetable, SilenceIsTheMidpoint) {
+    std::vector<uint16_t> out = mix(64);
+    for (uint16_t sample : out) {
+        EXPECT_EQ(sample, WAVETABLE_MIDPOINT);
+    }
+}
+
+TEST_F(Wavetable, IncrementIsAFractionOfTheCycle) {
+    EXPECT_EQ(wavetable_increment(SAMPLE_RATE / 4, SAMPLE_RATE), 0x40000000u);
+    EXPECT_EQ(wavetable_increment(0, SAMPLE_RATE), 0u);
+    EXPECT_EQ(wavetable_increment(-10, SAMPLE_RATE), 0u);
+    // Frequencies the sample rate can't represent are silent
+    EXPECT_EQ(wavetable_increment(SAMPLE_RATE / 2, SAMPLE_RATE), 0u);
+}
+
+TEST_F(Wavetable, OneVoiceUsesTheWholeRange) {
+    voices[0].increment = wavetable_increment(SAMPLE_RATE / 8, SAMPLE_RATE);
+    std::vector<uint16_t> out = mix(16);
+    std::vector<uint16_t> expected = {HIGH, HIGH, HIGH, HIGH, LOW, LOW, LOW, LOW,
+                                      HIGH, HIGH, HIGH, HIGH, LOW, LOW, LOW, LOW};
+    EXPECT_EQ(out, expected);
+}
+
+TEST_F(Wavetable, FrequencyIsAccurate) {
+    voices[0].increment = wavetable_increment(440.0f, SAMPLE_RATE);
+    voices[1].increment = wavetable_increment(4186.01f, SAMPLE_RATE);
+    std::vector<uint16_t> out = mix(SAMPLE_RATE, 1);
+    EXPECT_NEAR(rising_edges(out), 440, 1);
+    voices[0].increment = 0;
+    out = mix(SAMPLE_RATE, 2);
+    EXPECT_NEAR(rising_edges(out), 4186, 1);
+}
+
+TEST_F(Wavetable, PhaseCarriesOverBetweenBlocks) {
+    voices[0].increment = wavetable_increment(440.0f, SAMPLE_RATE);
+    voices[1].increment = wavetable_increment(660.0f, SAMPLE_RATE);
+    std::vector<uint16_t> whole = mix(256);
+
+    voices[0].phase = 0;
+    voices[1].phase = 0;
+    std::vector<uint16_t> halves = mix(128);
+    std::vector<uint16_t> second = mix(128);
+    halves.insert(halves.end(), second.begin(), second.end());
+    EXPECT_EQ(halves, whole);
+}
+
+TEST_F(Wavetable, VoicesShareTheRange) {
+    for (int i = 0; i < 4; i++) {
+        voices[i].increment = wavetable_increment(220.0f * (i + 1), SAMPLE_RATE);
+    }
+    std::vector<uint16_t> out = mix(SAMPLE_RATE / 10);
+    uint16_t lowest = 0xFFFF;
+    uint16_t highest = 0;
+    for (uint16_t sample : out) {
+        lowest = std::min(lowest, sample);
+        highest = std::max(highest, sample);
+    }
+    // All four square waves line up at the start of every 220Hz cycle
+    EXPECT_GE(lowest, LOW);
+    EXPECT_LE(highest, HIGH);
+    EXPECT_NEAR(highest, HIGH, 1);
+    EXPECT_NEAR(lowest, LOW, 1);
+}
+
+TEST_F(Wavetable, SameVoicesSoundLikeOne) {
+    voices[0].increment = wavetable_increment(1000.0f, SAMPLE_RATE);
+    std::vector<uint16_t> one = mix(480);
+
+    voices[0].phase = 0;
+    voices[1].increment = voices[0].increment;
+    std::vector<uint16_t> two = mix(480);
+    for (size_t i = 0; i < one.size(); i++) {
+        EXPECT_NEAR(two[i], one[i], 1) << i;
+    }
+}
+
+TEST_F(Wavetable, SquareDuty) {
+    wavetable_square(table, 0.25f);
+    int high = 0;
+    for (int i = 0; i < WAVETABLE_LENGTH; i++) {
+        high += table[i] > 0;
+    }
+    EXPECT_EQ(high, WAVETABLE_LENGTH / 4);
+    EXPECT_EQ(table[0], WAVETABLE_AMPLITUDE);
+    EXPECT_EQ(table[WAVETABLE_LENGTH - 1], -WAVETABLE_AMPLITUDE);
+
+    wavetable_square(table, 0);
+    for (int i = 0; i < WAVETABLE_LENGTH; i++) {
+        EXPECT_EQ(table[i], -WAVETABLE_AMPLITUDE);
+    }
+}
@@ -0,0 +1,64 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wavetable.h"
+
+// Voices the mixer can play at the same time
+#define WAVETABLE_MAX_VOICES 16
+
+uint32_t wavetable_increment(float frequency, uint32_t sample_rate)
+{
+    if (frequency <= 0 || frequency >= sample_rate / 2) {
+        return 0;
+    }
+    return (uint32_t)(frequency * 4294967296.0f / sample_rate);
+}
+
+void wavetable_square(int16_t *table, float duty)
+{
+    uint16_t high = duty <= 0 ? 0 : duty >= 1 ? WAVETABLE_LENGTH : (uint16_t)(duty * WAVETABLE_LENGTH + 0.5f);
+    for (uint16_t i = 0; i < WAVETABLE_LENGTH; i++) {
+        table[i] = i < high ? WAVETABLE_AMPLITUDE : -WAVETABLE_AMPLITUDE;
+    }
+}
+
+void wavetable_mix(const int16_t *table, wavetable_voice_t *voices, uint8_t count, uint16_t *out, uint16_t length)
+{
+    wavetable_voice_t *playing[WAVETABLE_MAX_VOICES];
+    uint8_t active = 0;
+    for (uint8_t v = 0; v < count && active < WAVETABLE_MAX_VOICES; v++) {
+        if (voices[v].increment) {
+            playing[active++] = &voices[v];
+        }
+    }
+
+    if (!active) {
+        for (uint16_t i = 0; i < length; i++) {
+            out[i] = WAVETABLE_MIDPOINT;
+        }
+        return;
+    }
+
+    // 1 << 16 is a gain of 1
+    int32_t gain = (1L << 16) / active;
+    for (uint16_t i = 0; i < length; i++) {
+        int32_t sum = 0;
+        for (uint8_t v = 0; v < active; v++) {
+            wavetable_voice_t *voice = playing[v];
+            sum += table[voice->phase >> (32 - WAVETABLE_BITS)];
+            voice->phase += voice->increment;
+        }
+        out[i] = WAVETABLE_MIDPOINT + ((sum * gain) >> 16);
+    }
+}
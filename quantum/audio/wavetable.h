@@ -0,0 +1,50 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WAVETABLE_H
+#define WAVETABLE_H
+
+#include <stdint.h>
+
+/*
+ * Wavetable mixer of the DAC audio path. Every voice reads one cycle of the
+ * same waveform with its own phase accumulator, at a fixed sample rate, and
+ * the voices are summed into 12 bit DAC samples. Changing the frequency of a
+ * voice only changes its phase increment, so the waveform stays continuous.
+ */
+
+#define WAVETABLE_BITS 8
+#define WAVETABLE_LENGTH (1 << WAVETABLE_BITS)
+// Table samples are in -WAVETABLE_AMPLITUDE..WAVETABLE_AMPLITUDE, and the
+// output is centered on WAVETABLE_MIDPOINT
+#define WAVETABLE_AMPLITUDE 2047
+#define WAVETABLE_MIDPOINT 2048
+
+typedef struct {
+    uint32_t phase;     // position in the cycle, a whole cycle is 1 << 32
+    uint32_t increment; // phase added every sample, 0 for a silent voice
+} wavetable_voice_t;
+
+// The phase increment of a frequency, 0 at and above half the sample rate
+uint32_t wavetable_increment(float frequency, uint32_t sample_rate);
+
+// Fills the table with a square wave, high for the duty fraction of the cycle
+void wavetable_square(int16_t *table, float duty);
+
+// Writes length samples of the count voices to out, and moves their phases
+// along. The voices that play share the output range equally, so the output
+// never clips.
+void wavetable_mix(const int16_t *table, wavetable_voice_t *voices, uint8_t count, uint16_t *out, uint16_t length);
+
+#endif
@@ -20,12 +20,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "musical_notes.h"
 #include "stdbool.h"
 
+// Frequency and duration, the note macros of songs store note numbers instead
 __attribute__ ((weak))
-float fauxclicky_pressed_note[2] = MUSICAL_NOTE(_D4, 0.25);
+float fauxclicky_pressed_note[2] = {NOTE_D4, 0.25};
 __attribute__ ((weak))
-float fauxclicky_released_note[2] = MUSICAL_NOTE(_C4, 0.125);
+float fauxclicky_released_note[2] = {NOTE_C4, 0.125};
 __attribute__ ((weak))
-float fauxclicky_beep_note[2] = MUSICAL_NOTE(_C4, 0.25);
+float fauxclicky_beep_note[2] = {NOTE_C4, 0.25};
 
 bool fauxclicky_enabled;
 
@@ -69,3 +69,23 @@ const uint8_t LED_BREATHING_TABLE[] PROGMEM = {
   10, 9, 7, 6, 5, 5, 4, 3, 2, 2, 1, 1, 1, 0, 0, 0
 };
 #endif
+
+#ifdef USE_EXP_SIN_CURVE
+// exp(sin(pi * i / 256)) scaled by 4096, the first half of the breathing
+// curve from http://sean.voisen.org/blog/2011/10/breathing-led-with-arduino/
+const uint16_t EXP_SIN_CURVE[] PROGMEM = {
+  4096, 4147, 4198, 4250, 4302, 4355, 4409, 4463, 4518, 4573,
+  4629, 4686, 4743, 4801, 4860, 4919, 4978, 5039, 5099, 5161,
+  5223, 5285, 5348, 5412, 5476, 5540, 5605, 5671, 5737, 5803,
+  5870, 5938, 6006, 6074, 6143, 6212, 6281, 6351, 6421, 6492,
+  6563, 6634, 6705, 6777, 6849, 6921, 6994, 7066, 7139, 7212,
+  7285, 7358, 7431, 7505, 7578, 7651, 7725, 7798, 7871, 7944,
+  8017, 8090, 8163, 8235, 8307, 8379, 8451, 8522, 8593, 8664,
+  8734, 8804, 8873, 8942, 9010, 9078, 9145, 9212, 9278, 9343,
+  9407, 9471, 9534, 9596, 9658, 9718, 9778, 9836, 9894, 9951,
+  10007, 10061, 10115, 10167, 10219, 10269, 10318, 10366, 10412, 10458,
+  10502, 10545, 10586, 10626, 10665, 10702, 10738, 10772, 10805, 10837,
+  10867, 10895, 10922, 10948, 10971, 10994, 11014, 11033, 11051, 11066,
+  11081, 11093, 11104, 11113, 11121, 11127, 11131, 11133, 11134
+};
+#endif
@@ -27,4 +27,8 @@ extern const uint8_t CIE1931_CURVE[] PROGMEM;
 extern const uint8_t LED_BREATHING_TABLE[] PROGMEM;
 #endif
 
+#ifdef USE_EXP_SIN_CURVE
+extern const uint16_t EXP_SIN_CURVE[] PROGMEM;
+#endif
+
 #endif
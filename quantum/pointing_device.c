@@ -23,8 +23,57 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "debug.h"
 #include "pointing_device.h"
 
+#ifndef POINTING_DEVICE_REPORT_INTERVAL
+// Minimum time in ms between two motion-only reports, 0 sends as soon as there is motion
+#   define POINTING_DEVICE_REPORT_INTERVAL 0
+#endif
+
 static report_mouse_t mouseReport = {};
 
+// Motion that has been gathered but not yet sent to the host
+static int16_t accumulated_x = 0;
+static int16_t accumulated_y = 0;
+static int16_t accumulated_v = 0;
+static int16_t accumulated_h = 0;
+static uint8_t lastButtons = 0;
+#if POINTING_DEVICE_REPORT_INTERVAL > 0
+static uint16_t lastSendTime = 0;
+#endif
+
+static int16_t saturating_add(int16_t accumulator, int16_t delta) {
+    int32_t sum = (int32_t)accumulator + delta;
+    if (sum > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (sum < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (int16_t)sum;
+}
+
+// Removes as much as fits into a single report from the accumulator, the rest is left for the next report
+static int8_t take_report_delta(int16_t* accumulator) {
+    int16_t delta = *accumulator;
+    if (delta > 127) {
+        delta = 127;
+    } else if (delta < -127) {
+        delta = -127;
+    }
+    *accumulator -= delta;
+    return (int8_t)delta;
+}
+
+void pointing_device_accumulate(int16_t x, int16_t y, int16_t v, int16_t h){
+    accumulated_x = saturating_add(accumulated_x, x);
+    accumulated_y = saturating_add(accumulated_y, y);
+    accumulated_v = saturating_add(accumulated_v, v);
+    accumulated_h = saturating_add(accumulated_h, h);
+}
+
+bool pointing_device_has_motion(void){
+    return accumulated_x || accumulated_y || accumulated_v || accumulated_h;
+}
+
 __attribute__ ((weak))
 void pointing_device_init(void){
     //initialize device, if that needs to be done.
@@ -33,12 +82,35 @@ void pointing_device_init(void){
 __attribute__ ((weak))
 void pointing_device_send(void){
     //If you need to do other things, like debugging, this is the place to do it.
-    host_mouse_send(&mouseReport);
-	//send it and 0 it out except for buttons, so those stay until they are explicity over-ridden using update_pointing_device
-	mouseReport.x = 0;
-	mouseReport.y = 0;
-	mouseReport.v = 0;
-	mouseReport.h = 0;
+    //Movement set directly in the report is added to the accumulated motion, and 0'd out,
+    //buttons stay until they are explicity over-ridden using update_pointing_device
+    pointing_device_accumulate(mouseReport.x, mouseReport.y, mouseReport.v, mouseReport.h);
+    mouseReport.x = 0;
+    mouseReport.y = 0;
+    mouseReport.v = 0;
+    mouseReport.h = 0;
+
+    bool buttonsChanged = mouseReport.buttons != lastButtons;
+    if (!buttonsChanged && !pointing_device_has_motion()) {
+        return;
+    }
+#if POINTING_DEVICE_REPORT_INTERVAL > 0
+    //Button changes are always sent right away, motion keeps accumulating until the interval has passed
+    if (!buttonsChanged && timer_elapsed(lastSendTime) < POINTING_DEVICE_REPORT_INTERVAL) {
+        return;
+    }
+    lastSendTime = timer_read();
+#endif
+
+    report_mouse_t report = {
+        .buttons = mouseReport.buttons,
+        .x = take_report_delta(&accumulated_x),
+        .y = take_report_delta(&accumulated_y),
+        .v = take_report_delta(&accumulated_v),
+        .h = take_report_delta(&accumulated_h),
+    };
+    host_mouse_send(&report);
+    lastButtons = report.buttons;
 }
 
 __attribute__ ((weak))
@@ -49,7 +121,8 @@ void pointing_device_task(void){
     //mouseReport.v = 127 max -127 min (scroll vertical)
     //mouseReport.h = 127 max -127 min (scroll horizontal)
     //mouseReport.buttons = 0x1F (decimal 31, binary 00011111) max (bitmask for mouse buttons 1-5, 1 is rightmost, 5 is leftmost) 0x00 min
-    //send the report
+    //or, for sensors that report larger or more frequent deltas, use pointing_device_accumulate()
+    //send the report, this only happens when something has changed
     pointing_device_send();
 }
 
@@ -59,4 +132,4 @@ report_mouse_t pointing_device_get_report(void){
 
 void pointing_device_set_report(report_mouse_t newMouseReport){
 	mouseReport = newMouseReport;
-}
\ No newline at end of file
+}
@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define POINTING_DEVICE_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "host.h"
 #include "report.h"
 
@@ -27,5 +28,7 @@ void pointing_device_task(void);
 void pointing_device_send(void);
 report_mouse_t pointing_device_get_report(void);
 void pointing_device_set_report(report_mouse_t newMouseReport);
+void pointing_device_accumulate(int16_t x, int16_t y, int16_t v, int16_t h);
+bool pointing_device_has_motion(void);
 
 #endif
@@ -4,7 +4,7 @@
 #ifndef VOICE_CHANGE_SONG
     #define VOICE_CHANGE_SONG SONG(VOICE_CHANGE_SOUND)
 #endif
-float voice_change_song[][2] = VOICE_CHANGE_SONG;
+const song_note_t voice_change_song[] PROGMEM = VOICE_CHANGE_SONG;
 
 #ifndef PITCH_STANDARD_A
     #define PITCH_STANDARD_A 440.0f
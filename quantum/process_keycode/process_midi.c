@@ -35,6 +35,9 @@ void process_midi_basic_noteoff(uint8_t note)
 void process_midi_all_notes_off(void)
 {
     midi_send_cc(&midi_device, 0, 0x7B, 0);
+    // Sent right away, reset_keyboard() jumps to the bootloader without
+    // running midi_task() again
+    flush_midi_output();
 }
 
 #endif // MIDI_BASIC
@@ -227,12 +230,8 @@ bool process_midi(uint16_t keycode, keyrecord_t *record)
     return true;
 }
 
-#endif // MIDI_ADVANCED
-
-void midi_task(void)
+static void midi_modulation_task(void)
 {
-    midi_device_process(&midi_device);
-#ifdef MIDI_ADVANCED
     if (timer_elapsed(midi_modulation_timer) < midi_config.modulation_interval)
         return;
     midi_modulation_timer = timer_read();
@@ -253,7 +252,18 @@ void midi_task(void)
         if (midi_modulation > 127)
             midi_modulation = 127;
     }
+}
+
+#endif // MIDI_ADVANCED
+
+void midi_task(void)
+{
+    midi_device_process(&midi_device);
+#ifdef MIDI_ADVANCED
+    midi_modulation_task();
 #endif
+    // Whatever was sent since the last time leaves in one transfer
+    flush_midi_output();
 }
 
 
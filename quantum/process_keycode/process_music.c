@@ -66,16 +66,16 @@ static uint16_t music_sequence_interval = 100;
   #ifndef MAJOR_SONG
     #define MAJOR_SONG SONG(MAJOR_SOUND)
   #endif
-  float music_mode_songs[NUMBER_OF_MODES][5][2] = {
+  const song_note_t music_mode_songs[NUMBER_OF_MODES][5] PROGMEM = {
     CHROMATIC_SONG,
     GUITAR_SONG,
     VIOLIN_SONG,
     MAJOR_SONG
   };
-  float music_on_song[][2] = MUSIC_ON_SONG;
-  float music_off_song[][2] = MUSIC_OFF_SONG;
-  float midi_on_song[][2] = MIDI_ON_SONG;
-  float midi_off_song[][2] = MIDI_OFF_SONG;
+  const song_note_t music_on_song[] PROGMEM = MUSIC_ON_SONG;
+  const song_note_t music_off_song[] PROGMEM = MUSIC_OFF_SONG;
+  const song_note_t midi_on_song[] PROGMEM = MIDI_ON_SONG;
+  const song_note_t midi_off_song[] PROGMEM = MIDI_OFF_SONG;
 #endif
 
 #ifndef MUSIC_MASK
@@ -52,11 +52,11 @@ extern backlight_config_t backlight_config;
   #ifndef AG_SWAP_SONG
     #define AG_SWAP_SONG SONG(AG_SWAP_SOUND)
   #endif
-  float goodbye_song[][2] = GOODBYE_SONG;
-  float ag_norm_song[][2] = AG_NORM_SONG;
-  float ag_swap_song[][2] = AG_SWAP_SONG;
+  const song_note_t goodbye_song[] PROGMEM = GOODBYE_SONG;
+  const song_note_t ag_norm_song[] PROGMEM = AG_NORM_SONG;
+  const song_note_t ag_swap_song[] PROGMEM = AG_SWAP_SONG;
   #ifdef DEFAULT_LAYER_SONGS
-    float default_layer_songs[][16][2] = DEFAULT_LAYER_SONGS;
+    const song_note_t default_layer_songs[][16] PROGMEM = DEFAULT_LAYER_SONGS;
   #endif
 #endif
 
@@ -225,6 +225,10 @@ bool process_record_quantum(keyrecord_t *record) {
   #if defined(KEY_LOCK_ENABLE)
     // Must run first to be able to mask key_up events.
     process_key_lock(&keycode, record) &&
+  #endif
+  #ifdef RGB_MATRIX_ENABLE
+    // Only lights the key up, so it sees the keys the keymap handles too
+    process_rgb_matrix(keycode, record) &&
   #endif
     process_record_kb(keycode, record) &&
   #if defined(MIDI_ENABLE) && defined(MIDI_ADVANCED)
@@ -830,6 +834,9 @@ void matrix_init_quantum() {
   #ifdef AUDIO_ENABLE
     audio_init();
   #endif
+  #ifdef RGB_MATRIX_ENABLE
+    rgb_matrix_init();
+  #endif
   matrix_init_kb();
 }
 
@@ -850,6 +857,14 @@ void matrix_scan_quantum() {
     backlight_task();
   #endif
 
+  #ifdef RGB_MATRIX_ENABLE
+    rgb_matrix_task();
+  #endif
+
+  #if defined(RGBLIGHT_ENABLE) && defined(WS2812_CHUNKED) && !defined(RGBLIGHT_CUSTOM_DRIVER)
+    rgblight_resend_skipped();
+  #endif
+
   matrix_scan_kb();
 }
 
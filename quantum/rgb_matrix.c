@@ -0,0 +1,286 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+#include "progmem.h"
+#include "timer.h"
+#include "rgb_matrix.h"
+
+#ifndef RGB_MATRIX_STARTUP_MODE
+#define RGB_MATRIX_STARTUP_MODE RGB_MATRIX_REACTIVE
+#endif
+
+#if MATRIX_ROWS > MATRIX_COLS
+#  define RIPPLE_MAX_RADIUS MATRIX_ROWS
+#else
+#  define RIPPLE_MAX_RADIUS MATRIX_COLS
+#endif
+// Energy lost by a ripple for every key it travels
+#define RIPPLE_FADE (255 / (RIPPLE_MAX_RADIUS + 1))
+#define RIPPLE_UNUSED 0xFF
+
+typedef struct {
+  int8_t row;
+  int8_t col;
+  uint8_t radius;
+  uint8_t frames;
+} ripple_t;
+
+extern rgblight_config_t rgblight_config;
+
+static uint8_t mode = RGB_MATRIX_NONE;
+
+// The energy of every LED, and the LEDs that still have some in no particular order
+static uint8_t energy[RGBLED_NUM];
+static uint8_t active[RGBLED_NUM];
+static uint8_t active_count = 0;
+
+// LEDs whose color has to be recomputed
+static uint8_t dirty[(RGBLED_NUM + 7) / 8];
+static uint8_t dirty_count = 0;
+static uint8_t render_cursor = 0;
+
+static ripple_t ripples[RGB_MATRIX_RIPPLES];
+static uint8_t next_ripple = 0;
+
+static uint16_t frame_timer = 0;
+static uint8_t decay_frames = 0;
+// The rgblight state the frame was drawn over, a change means rgblight
+// has redrawn the whole strip
+static uint32_t base_config = 0;
+static bool base_valid = false;
+
+static void mark_dirty(uint8_t index) {
+  uint8_t mask = 1 << (index & 7);
+  if (!(dirty[index >> 3] & mask)) {
+    dirty[index >> 3] |= mask;
+    dirty_count++;
+  }
+}
+
+static void mark_all_dirty(void) {
+  for (uint8_t i = 0; i < RGBLED_NUM; i++) {
+    mark_dirty(i);
+  }
+}
+
+static uint8_t key_led(int8_t row, int8_t col) {
+  if (row < 0 || row >= MATRIX_ROWS || col < 0 || col >= MATRIX_COLS) {
+    return NO_LED;
+  }
+  return pgm_read_byte(&rgb_matrix_leds[row][col]);
+}
+
+// Raises the energy of an LED to at least value
+static void raise_energy(uint8_t index, uint8_t value) {
+  if (index >= RGBLED_NUM || energy[index] >= value) {
+    return;
+  }
+  if (!energy[index]) {
+    active[active_count++] = index;
+  }
+  energy[index] = value;
+  mark_dirty(index);
+}
+
+static void decay(uint8_t amount) {
+  uint8_t i = 0;
+  while (i < active_count) {
+    uint8_t index = active[i];
+    mark_dirty(index);
+    if (energy[index] > amount) {
+      energy[index] -= amount;
+      i++;
+    } else {
+      energy[index] = 0;
+      active[i] = active[--active_count];
+    }
+  }
+}
+
+// Lights the keys at the ripple's distance from its origin, which form the
+// sides of a square around it
+static void ripple_draw(const ripple_t *ripple) {
+  int8_t r = ripple->radius;
+  uint8_t value = 255 - r * RIPPLE_FADE;
+
+  for (int8_t col = ripple->col - r; col <= ripple->col + r; col++) {
+    raise_energy(key_led(ripple->row - r, col), value);
+    if (r) {
+      raise_energy(key_led(ripple->row + r, col), value);
+    }
+  }
+  for (int8_t row = ripple->row - r + 1; row < ripple->row + r; row++) {
+    raise_energy(key_led(row, ripple->col - r), value);
+    raise_energy(key_led(row, ripple->col + r), value);
+  }
+}
+
+static void ripples_advance(void) {
+  for (uint8_t i = 0; i < RGB_MATRIX_RIPPLES; i++) {
+    ripple_t *ripple = &ripples[i];
+    if (ripple->radius == RIPPLE_UNUSED || ++ripple->frames < RGB_MATRIX_RIPPLE_FRAMES) {
+      continue;
+    }
+    ripple->frames = 0;
+    if (++ripple->radius > RIPPLE_MAX_RADIUS) {
+      ripple->radius = RIPPLE_UNUSED;
+    } else {
+      ripple_draw(ripple);
+    }
+  }
+}
+
+static void render_led(uint8_t index) {
+  uint16_t hue = rgblight_config.hue;
+  uint8_t sat = rgblight_config.sat;
+  uint8_t val = rgblight_config.val;
+  uint8_t e = energy[index];
+
+  if (e) {
+    if (mode == RGB_MATRIX_HEATMAP) {
+      // from blue for cold keys to red for hot ones
+      hue = 240 - (((uint16_t)e * 240) >> 8);
+      sat = 255;
+    } else {
+      hue += ((uint16_t)e * RGB_MATRIX_HUE_SPREAD) >> 8;
+      if (hue >= 360) {
+        hue -= 360;
+      }
+    }
+    if (val < e) {
+      val = e;
+    }
+  }
+  sethsv(hue, sat, val, &led[index]);
+}
+
+// Recomputes up to RGB_MATRIX_FRAME_BUDGET dirty LEDs, going round the strip
+// so that no LED waits for more than a few frames
+static void render(void) {
+  if (!dirty_count) {
+    return;
+  }
+  uint8_t budget = RGB_MATRIX_FRAME_BUDGET;
+  uint8_t index = render_cursor;
+  while (dirty_count && budget) {
+    uint8_t mask = 1 << (index & 7);
+    if (dirty[index >> 3] & mask) {
+      dirty[index >> 3] &= ~mask;
+      dirty_count--;
+      budget--;
+      render_led(index);
+    }
+    if (++index >= RGBLED_NUM) {
+      index = 0;
+    }
+  }
+  render_cursor = index;
+  rgblight_set();
+}
+
+void rgb_matrix_clear(void) {
+  for (uint8_t i = 0; i < active_count; i++) {
+    energy[active[i]] = 0;
+    mark_dirty(active[i]);
+  }
+  active_count = 0;
+  for (uint8_t i = 0; i < RGB_MATRIX_RIPPLES; i++) {
+    ripples[i].radius = RIPPLE_UNUSED;
+  }
+}
+
+void rgb_matrix_init(void) {
+  memset(energy, 0, sizeof(energy));
+  memset(dirty, 0, sizeof(dirty));
+  active_count = 0;
+  dirty_count = 0;
+  base_valid = false;
+  mode = RGB_MATRIX_STARTUP_MODE;
+  rgb_matrix_clear();
+  frame_timer = timer_read();
+}
+
+void rgb_matrix_mode(uint8_t new_mode) {
+  mode = new_mode < RGB_MATRIX_MODES ? new_mode : RGB_MATRIX_NONE;
+  rgb_matrix_clear();
+}
+
+uint8_t rgb_matrix_get_mode(void) {
+  return mode;
+}
+
+void rgb_matrix_step(void) {
+  rgb_matrix_mode(mode + 1);
+}
+
+bool process_rgb_matrix(uint16_t keycode, keyrecord_t *record) {
+  if (mode == RGB_MATRIX_NONE || !record->event.pressed) {
+    return true;
+  }
+  int8_t row = record->event.key.row;
+  int8_t col = record->event.key.col;
+  uint8_t index = key_led(row, col);
+
+  switch (mode) {
+    case RGB_MATRIX_REACTIVE:
+      raise_energy(index, 255);
+      break;
+    case RGB_MATRIX_RIPPLE: {
+      ripple_t *ripple = &ripples[next_ripple];
+      ripple->row = row;
+      ripple->col = col;
+      ripple->radius = 0;
+      ripple->frames = 0;
+      ripple_draw(ripple);
+      next_ripple = (next_ripple + 1) % RGB_MATRIX_RIPPLES;
+      break;
+    }
+    case RGB_MATRIX_HEATMAP:
+      if (index < RGBLED_NUM) {
+        uint8_t heat = energy[index];
+        raise_energy(index, heat > 255 - RGB_MATRIX_HEATMAP_INCREASE ? 255 : heat + RGB_MATRIX_HEATMAP_INCREASE);
+      }
+      break;
+  }
+  return true;
+}
+
+void rgb_matrix_task(void) {
+  if (timer_elapsed(frame_timer) < RGB_MATRIX_FRAME_INTERVAL) {
+    return;
+  }
+  frame_timer = timer_read();
+
+  // Only drawn over the static color
+  if (!rgblight_config.enable || rgblight_config.mode != 1) {
+    base_valid = false;
+    return;
+  }
+  if (!base_valid || rgblight_config.raw != base_config) {
+    base_config = rgblight_config.raw;
+    base_valid = true;
+    mark_all_dirty();
+  }
+
+  ripples_advance();
+  if (mode == RGB_MATRIX_HEATMAP) {
+    if (++decay_frames >= RGB_MATRIX_HEATMAP_DECAY_FRAMES) {
+      decay_frames = 0;
+      decay(1);
+    }
+  } else {
+    decay(RGB_MATRIX_DECAY);
+  }
+  render();
+}
@@ -0,0 +1,96 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef RGB_MATRIX_H
+#define RGB_MATRIX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "quantum.h"
+#include "rgblight.h"
+
+/*
+ * Per-key RGB effects on top of rgblight
+ *
+ * The keyboard maps every key to its LED with rgb_matrix_leds. Key presses
+ * add energy to the LEDs they touch, and the energy decays a little every
+ * frame. Only LEDs with energy left are visited by the decay, and only LEDs
+ * whose color changed are recomputed, so an idle keyboard costs nothing.
+ * The effects are drawn over the static rgblight color (mode 1), and pause
+ * while an rgblight animation is running.
+ */
+
+// Maximum number of frames per second
+#ifndef RGB_MATRIX_MAX_FPS
+#define RGB_MATRIX_MAX_FPS 60
+#endif
+#define RGB_MATRIX_FRAME_INTERVAL (1000 / RGB_MATRIX_MAX_FPS)
+
+// Maximum number of LEDs whose color is recomputed in a frame, the rest
+// waits for the next frame. A color takes roughly 15us on a 16MHz AVR.
+#ifndef RGB_MATRIX_FRAME_BUDGET
+#define RGB_MATRIX_FRAME_BUDGET 16
+#endif
+
+// Energy lost per frame, the heatmap loses 1 every RGB_MATRIX_HEATMAP_DECAY_FRAMES
+#ifndef RGB_MATRIX_DECAY
+#define RGB_MATRIX_DECAY 8
+#endif
+#ifndef RGB_MATRIX_HEATMAP_DECAY_FRAMES
+#define RGB_MATRIX_HEATMAP_DECAY_FRAMES 6
+#endif
+
+// Energy added to a key by a press in heatmap mode
+#ifndef RGB_MATRIX_HEATMAP_INCREASE
+#define RGB_MATRIX_HEATMAP_INCREASE 32
+#endif
+
+// Ripples in flight at the same time, further presses replace the oldest
+#ifndef RGB_MATRIX_RIPPLES
+#define RGB_MATRIX_RIPPLES 4
+#endif
+// Frames for a ripple to move one key further
+#ifndef RGB_MATRIX_RIPPLE_FRAMES
+#define RGB_MATRIX_RIPPLE_FRAMES 3
+#endif
+
+// How far the hue moves away from the rgblight hue at full energy
+#ifndef RGB_MATRIX_HUE_SPREAD
+#define RGB_MATRIX_HUE_SPREAD 120
+#endif
+
+// Keys without an LED in rgb_matrix_leds
+#define NO_LED 0xFF
+
+enum rgb_matrix_modes {
+  RGB_MATRIX_NONE = 0,
+  RGB_MATRIX_REACTIVE,
+  RGB_MATRIX_RIPPLE,
+  RGB_MATRIX_HEATMAP,
+  RGB_MATRIX_MODES
+};
+
+// The LED of each key, defined by the keyboard
+extern const uint8_t rgb_matrix_leds[MATRIX_ROWS][MATRIX_COLS] PROGMEM;
+
+void rgb_matrix_init(void);
+void rgb_matrix_task(void);
+bool process_rgb_matrix(uint16_t keycode, keyrecord_t *record);
+
+void rgb_matrix_mode(uint8_t mode);
+uint8_t rgb_matrix_get_mode(void);
+void rgb_matrix_step(void);
+// Clears the energy of all keys
+void rgb_matrix_clear(void);
+
+#endif
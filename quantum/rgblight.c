@@ -13,11 +13,10 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
-#include <math.h>
-#include <avr/eeprom.h>
-#include <avr/interrupt.h>
-#include <util/delay.h>
+#include <string.h>
 #include "progmem.h"
+#include "eeprom.h"
+#include "wait.h"
 #include "timer.h"
 #include "rgblight.h"
 #include "debug.h"
@@ -47,8 +46,28 @@ LED_TYPE led[RGBLED_NUM];
 uint8_t rgblight_inited = 0;
 bool rgblight_timer_enabled = false;
 
+#ifdef RGBLIGHT_ANIMATIONS
+static uint16_t effect_timer;
+static uint32_t effect_phase;
+
+// The breathing curve is (exp(sin(x)) - CENTER / e) * MAX / (e - 1 / e), with
+// exp(sin(x)) looked up in EXP_SIN_CURVE. The constants are folded at compile
+// time, so no floating point is left at runtime.
+#define BREATHE_E 2.718281828459045
+#define BREATHE_OFFSET ((int32_t)(RGBLIGHT_EFFECT_BREATHE_CENTER / BREATHE_E * 4096))
+#define BREATHE_SCALE ((int32_t)(RGBLIGHT_EFFECT_BREATHE_MAX / (BREATHE_E - 1 / BREATHE_E) * 256))
+#endif
+
+// Position within each 60 degree hue sector, scaled to 256
+static const uint8_t HUE_SECTOR_FRACTION[60] PROGMEM = {
+    0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60,
+    64, 68, 73, 77, 81, 85, 90, 94, 98, 102, 107, 111, 115, 119, 124,
+    128, 132, 137, 141, 145, 149, 154, 158, 162, 166, 171, 175, 179, 183, 188,
+    192, 196, 201, 205, 209, 213, 218, 222, 226, 230, 235, 239, 243, 247, 252
+};
+
 void sethsv(uint16_t hue, uint8_t sat, uint8_t val, LED_TYPE *led1) {
-  uint8_t r = 0, g = 0, b = 0, base, color;
+  uint8_t r = 0, g = 0, b = 0, base, color, sector = 0;
 
   if (val > RGBLIGHT_LIMIT_VAL) {
       val=RGBLIGHT_LIMIT_VAL; // limit the val
@@ -59,10 +78,16 @@ void sethsv(uint16_t hue, uint8_t sat, uint8_t val, LED_TYPE *led1) {
     g = val;
     b = val;
   } else {
+    // No divider on the AVR, the sector is found by subtraction and the
+    // position within it looked up
+    while (hue >= 60) {
+      hue -= 60;
+      sector++;
+    }
     base = ((255 - sat) * val) >> 8;
-    color = (val - base) * (hue % 60) / 60;
+    color = ((val - base) * pgm_read_byte(&HUE_SECTOR_FRACTION[hue])) >> 8;
 
-    switch (hue / 60) {
+    switch (sector) {
       case 0:
         r = val;
         g = base + color;
@@ -173,6 +198,10 @@ void rgblight_update_dword(uint32_t dword) {
   }
 }
 
+uint32_t rgblight_read_dword(void) {
+  return rgblight_config.raw;
+}
+
 void rgblight_increase(void) {
   uint8_t mode = 0;
   if (rgblight_config.mode < RGBLIGHT_MODES) {
@@ -276,7 +305,7 @@ void rgblight_disable(void) {
   #ifdef RGBLIGHT_ANIMATIONS
     rgblight_timer_disable();
   #endif
-  _delay_ms(50);
+  wait_ms(50);
   rgblight_set();
 }
 
@@ -419,25 +448,47 @@ void rgblight_sethsv_at(uint16_t hue, uint8_t sat, uint8_t val, uint8_t index) {
 }
 
 #ifndef RGBLIGHT_CUSTOM_DRIVER
+// What the strip currently shows, frames are only sent when they differ
+static LED_TYPE led_shown[RGBLED_NUM];
+static bool led_shown_valid = false;
+#ifdef WS2812_CHUNKED
+// The driver gave up the last frame, it's sent again by rgblight_resend_skipped
+static bool led_shown_skipped = false;
+#endif
+
+static void rgblight_send_shown(void) {
+  #ifdef RGBW
+    ws2812_setleds_rgbw(led_shown, RGBLED_NUM);
+  #else
+    ws2812_setleds(led_shown, RGBLED_NUM);
+  #endif
+  #ifdef WS2812_CHUNKED
+    led_shown_skipped = ws2812_frame_skipped();
+  #endif
+}
+
+#ifdef WS2812_CHUNKED
+void rgblight_resend_skipped(void) {
+  if (led_shown_skipped) {
+    rgblight_send_shown();
+  }
+}
+#endif
+
 void rgblight_set(void) {
-  if (rgblight_config.enable) {
-    #ifdef RGBW
-      ws2812_setleds_rgbw(led, RGBLED_NUM);
-    #else
-      ws2812_setleds(led, RGBLED_NUM);
-    #endif
-  } else {
+  if (!rgblight_config.enable) {
     for (uint8_t i = 0; i < RGBLED_NUM; i++) {
       led[i].r = 0;
       led[i].g = 0;
       led[i].b = 0;
     }
-    #ifdef RGBW
-      ws2812_setleds_rgbw(led, RGBLED_NUM);
-    #else
-      ws2812_setleds(led, RGBLED_NUM);
-    #endif
   }
+  if (led_shown_valid && memcmp(led_shown, led, sizeof(led_shown)) == 0) {
+    return;
+  }
+  memcpy(led_shown, led, sizeof(led_shown));
+  led_shown_valid = true;
+  rgblight_send_shown();
 }
 #endif
 
@@ -464,6 +515,8 @@ void rgblight_timer_init(void) {
 }
 void rgblight_timer_enable(void) {
   rgblight_timer_enabled = true;
+  effect_timer = timer_read();
+  effect_phase = 0;
   dprintf("TIMER3 enabled.\n");
 }
 void rgblight_timer_disable(void) {
@@ -481,97 +534,82 @@ void rgblight_show_solid_color(uint8_t r, uint8_t g, uint8_t b) {
   rgblight_setrgb(r, g, b);
 }
 
-void rgblight_task(void) {
-  if (rgblight_timer_enabled) {
-    // mode = 1, static light, do nothing here
-    if (rgblight_config.mode >= 2 && rgblight_config.mode <= 5) {
-      // mode = 2 to 5, breathing mode
-      rgblight_effect_breathing(rgblight_config.mode - 2);
-    } else if (rgblight_config.mode >= 6 && rgblight_config.mode <= 8) {
-      // mode = 6 to 8, rainbow mood mod
-      rgblight_effect_rainbow_mood(rgblight_config.mode - 6);
-    } else if (rgblight_config.mode >= 9 && rgblight_config.mode <= 14) {
-      // mode = 9 to 14, rainbow swirl mode
-      rgblight_effect_rainbow_swirl(rgblight_config.mode - 9);
-    } else if (rgblight_config.mode >= 15 && rgblight_config.mode <= 20) {
-      // mode = 15 to 20, snake mode
-      rgblight_effect_snake(rgblight_config.mode - 15);
-    } else if (rgblight_config.mode >= 21 && rgblight_config.mode <= 23) {
-      // mode = 21 to 23, knight mode
-      rgblight_effect_knight(rgblight_config.mode - 21);
-    } else if (rgblight_config.mode == 24) {
-      // mode = 24, christmas mode
-      rgblight_effect_christmas();
-    }
-  }
-}
-
-// Effects
-void rgblight_effect_breathing(uint8_t interval) {
+// Effects, each one is advanced by the number of steps (intervals) that
+// have passed since its last frame
+static void rgblight_effect_breathing(uint8_t variant, uint8_t steps) {
   static uint8_t pos = 0;
-  static uint16_t last_timer = 0;
-  float val;
+  int32_t val;
 
-  if (timer_elapsed(last_timer) < pgm_read_byte(&RGBLED_BREATHING_INTERVALS[interval])) {
-    return;
+  // The first half of the curve is mirrored for the second one
+  pos += steps;
+  uint8_t index = pos <= 128 ? pos : 256 - pos;
+  val = (((int32_t)pgm_read_word(&EXP_SIN_CURVE[index]) - BREATHE_OFFSET) * BREATHE_SCALE) >> 20;
+  if (val < 0) {
+    val = 0;
+  } else if (val > 255) {
+    val = 255;
   }
-  last_timer = timer_read();
-
-
-  // http://sean.voisen.org/blog/2011/10/breathing-led-with-arduino/
-  val = (exp(sin((pos/255.0)*M_PI)) - RGBLIGHT_EFFECT_BREATHE_CENTER/M_E)*(RGBLIGHT_EFFECT_BREATHE_MAX/(M_E-1/M_E));
   rgblight_sethsv_noeeprom(rgblight_config.hue, rgblight_config.sat, val);
-  pos = (pos + 1) % 256;
 }
-void rgblight_effect_rainbow_mood(uint8_t interval) {
+
+static void rgblight_effect_rainbow_mood(uint8_t variant, uint8_t steps) {
   static uint16_t current_hue = 0;
-  static uint16_t last_timer = 0;
 
-  if (timer_elapsed(last_timer) < pgm_read_byte(&RGBLED_RAINBOW_MOOD_INTERVALS[interval])) {
-    return;
+  current_hue += steps;
+  while (current_hue >= 360) {
+    current_hue -= 360;
   }
-  last_timer = timer_read();
   rgblight_sethsv_noeeprom(current_hue, rgblight_config.sat, rgblight_config.val);
-  current_hue = (current_hue + 1) % 360;
 }
-void rgblight_effect_rainbow_swirl(uint8_t interval) {
+
+static void rgblight_effect_rainbow_swirl(uint8_t variant, uint8_t steps) {
   static uint16_t current_hue = 0;
-  static uint16_t last_timer = 0;
+  // The hues of neighbouring LEDs are this far apart, in 1/64 degrees
+  const uint16_t spacing = (360U << 6) / RGBLED_NUM;
   uint16_t hue;
-  uint8_t i;
-  if (timer_elapsed(last_timer) < pgm_read_byte(&RGBLED_RAINBOW_SWIRL_INTERVALS[interval / 2])) {
-    return;
-  }
-  last_timer = timer_read();
-  for (i = 0; i < RGBLED_NUM; i++) {
-    hue = (360 / RGBLED_NUM * i + current_hue) % 360;
-    sethsv(hue, rgblight_config.sat, rgblight_config.val, (LED_TYPE *)&led[i]);
-  }
-  rgblight_set();
 
-  if (interval % 2) {
-    current_hue = (current_hue + 1) % 360;
+  if (variant % 2) {
+    current_hue += steps;
+    while (current_hue >= 360) {
+      current_hue -= 360;
+    }
   } else {
-    if (current_hue - 1 < 0) {
-      current_hue = 359;
-    } else {
-      current_hue = current_hue - 1;
+    while (current_hue < steps) {
+      current_hue += 360;
+    }
+    current_hue -= steps;
+  }
+
+  hue = current_hue << 6;
+  for (uint8_t i = 0; i < RGBLED_NUM; i++) {
+    sethsv(hue >> 6, rgblight_config.sat, rgblight_config.val, (LED_TYPE *)&led[i]);
+    hue += spacing;
+    if (hue >= (360U << 6)) {
+      hue -= 360U << 6;
     }
   }
+  rgblight_set();
 }
-void rgblight_effect_snake(uint8_t interval) {
+
+static void rgblight_effect_snake(uint8_t variant, uint8_t steps) {
   static uint8_t pos = 0;
-  static uint16_t last_timer = 0;
   uint8_t i, j;
   int8_t k;
   int8_t increment = 1;
-  if (interval % 2) {
+  if (variant % 2) {
     increment = -1;
   }
-  if (timer_elapsed(last_timer) < pgm_read_byte(&RGBLED_SNAKE_INTERVALS[interval / 2])) {
-    return;
+
+  if (increment == 1) {
+    for (i = 0; i < steps; i++) {
+      pos = pos ? pos - 1 : RGBLED_NUM - 1;
+    }
+  } else {
+    for (i = 0; i < steps; i++) {
+      pos = pos < RGBLED_NUM - 1 ? pos + 1 : 0;
+    }
   }
-  last_timer = timer_read();
+
   for (i = 0; i < RGBLED_NUM; i++) {
     led[i].r = 0;
     led[i].g = 0;
@@ -587,28 +625,25 @@ void rgblight_effect_snake(uint8_t interval) {
     }
   }
   rgblight_set();
-  if (increment == 1) {
-    if (pos - 1 < 0) {
-      pos = RGBLED_NUM - 1;
-    } else {
-      pos -= 1;
-    }
-  } else {
-    pos = (pos + 1) % RGBLED_NUM;
-  }
 }
-void rgblight_effect_knight(uint8_t interval) {
-  static uint16_t last_timer = 0;
-  if (timer_elapsed(last_timer) < pgm_read_byte(&RGBLED_KNIGHT_INTERVALS[interval])) {
-    return;
-  }
-  last_timer = timer_read();
 
+static void rgblight_effect_knight(uint8_t variant, uint8_t steps) {
   static int8_t low_bound = 0;
   static int8_t high_bound = RGBLIGHT_EFFECT_KNIGHT_LENGTH - 1;
   static int8_t increment = 1;
   uint8_t i, cur;
 
+  // Move from low_bound to high_bound changing the direction we increment each
+  // time a boundary is hit.
+  for (i = 0; i < steps; i++) {
+    low_bound += increment;
+    high_bound += increment;
+
+    if (high_bound <= 0 || low_bound >= RGBLIGHT_EFFECT_KNIGHT_LED_NUM - 1) {
+      increment = -increment;
+    }
+  }
+
   // Set all the LEDs to 0
   for (i = 0; i < RGBLED_NUM; i++) {
     led[i].r = 0;
@@ -628,28 +663,14 @@ void rgblight_effect_knight(uint8_t interval) {
     }
   }
   rgblight_set();
-
-  // Move from low_bound to high_bound changing the direction we increment each
-  // time a boundary is hit.
-  low_bound += increment;
-  high_bound += increment;
-
-  if (high_bound <= 0 || low_bound >= RGBLIGHT_EFFECT_KNIGHT_LED_NUM - 1) {
-    increment = -increment;
-  }
 }
 
-
-void rgblight_effect_christmas(void) {
-  static uint16_t current_offset = 0;
-  static uint16_t last_timer = 0;
+static void rgblight_effect_christmas(uint8_t variant, uint8_t steps) {
+  static uint8_t current_offset = 0;
   uint16_t hue;
   uint8_t i;
-  if (timer_elapsed(last_timer) < RGBLIGHT_EFFECT_CHRISTMAS_INTERVAL) {
-    return;
-  }
-  last_timer = timer_read();
-  current_offset = (current_offset + 1) % 2;
+
+  current_offset = (current_offset + steps) % 2;
   for (i = 0; i < RGBLED_NUM; i++) {
     hue = 0 + ((i/RGBLIGHT_EFFECT_CHRISTMAS_STEP + current_offset) % 2) * 120;
     sethsv(hue, rgblight_config.sat, rgblight_config.val, (LED_TYPE *)&led[i]);
@@ -657,4 +678,64 @@ void rgblight_effect_christmas(void) {
   rgblight_set();
 }
 
+typedef struct {
+  uint8_t last_mode;
+  void (*effect)(uint8_t variant, uint8_t steps);
+  const uint8_t *intervals;   // in PROGMEM, NULL for a fixed interval
+  uint8_t variants_per_speed; // e.g. 2 when the variants alternate directions
+} rgblight_effect_t;
+
+// Animated modes, from mode 2 onwards, each entry covers the modes up to last_mode
+static const rgblight_effect_t effects[] PROGMEM = {
+  {  5, rgblight_effect_breathing,     RGBLED_BREATHING_INTERVALS,     1 },
+  {  8, rgblight_effect_rainbow_mood,  RGBLED_RAINBOW_MOOD_INTERVALS,  1 },
+  { 14, rgblight_effect_rainbow_swirl, RGBLED_RAINBOW_SWIRL_INTERVALS, 2 },
+  { 20, rgblight_effect_snake,         RGBLED_SNAKE_INTERVALS,         2 },
+  { 23, rgblight_effect_knight,        RGBLED_KNIGHT_INTERVALS,        1 },
+  { 24, rgblight_effect_christmas,     NULL,                           1 },
+};
+
+void rgblight_task(void) {
+  if (!rgblight_timer_enabled) {
+    return;
+  }
+  // mode = 1 and the static gradients, nothing to animate
+  if (rgblight_config.mode < 2 || rgblight_config.mode > 24) {
+    return;
+  }
+
+  uint16_t elapsed = timer_elapsed(effect_timer);
+  if (elapsed < RGBLIGHT_FRAME_INTERVAL) {
+    return;
+  }
+
+  rgblight_effect_t effect;
+  uint8_t first_mode = 2;
+  for (uint8_t i = 0; ; i++) {
+    memcpy_P(&effect, &effects[i], sizeof(effect));
+    if (rgblight_config.mode <= effect.last_mode) {
+      break;
+    }
+    first_mode = effect.last_mode + 1;
+  }
+  uint8_t variant = rgblight_config.mode - first_mode;
+  uint16_t interval = effect.intervals ?
+    pgm_read_byte(&effect.intervals[variant / effect.variants_per_speed]) :
+    RGBLIGHT_EFFECT_CHRISTMAS_INTERVAL;
+  if (!interval) {
+    interval = 1;
+  }
+
+  // The phase advances by 256 per interval, so the speed of an animation
+  // doesn't depend on how often its frames are drawn
+  effect_timer += elapsed;
+  effect_phase += ((uint32_t)elapsed << 8) / interval;
+  if (effect_phase < 0x100) {
+    return;
+  }
+  uint8_t steps = effect_phase > 0xFFFF ? 0xFF : effect_phase >> 8;
+  effect_phase &= 0xFF;
+  effect.effect(variant, steps);
+}
+
 #endif
@@ -54,6 +54,13 @@
 #define RGBLIGHT_EFFECT_CHRISTMAS_STEP 2
 #endif
 
+// Animations draw at most this many frames per second, and a frame only
+// goes out to the strip when it differs from the previous one
+#ifndef RGBLIGHT_MAX_FPS
+#define RGBLIGHT_MAX_FPS 60
+#endif
+#define RGBLIGHT_FRAME_INTERVAL (1000 / RGBLIGHT_MAX_FPS)
+
 #ifndef RGBLIGHT_HUE_STEP
 #define RGBLIGHT_HUE_STEP 10
 #endif
@@ -107,6 +114,7 @@ uint32_t rgblight_get_mode(void);
 void rgblight_mode(uint8_t mode);
 void rgblight_set(void);
 void rgblight_update_dword(uint32_t dword);
+uint32_t rgblight_read_dword(void);
 void rgblight_increase_hue(void);
 void rgblight_decrease_hue(void);
 void rgblight_increase_sat(void);
@@ -134,16 +142,14 @@ void rgblight_sethsv_noeeprom(uint16_t hue, uint8_t sat, uint8_t val);
 void rgblight_show_solid_color(uint8_t r, uint8_t g, uint8_t b);
 
 void rgblight_task(void);
+#if defined(WS2812_CHUNKED) && !defined(RGBLIGHT_CUSTOM_DRIVER)
+// Sends the last frame again if the driver had to give it up
+void rgblight_resend_skipped(void);
+#endif
 
 void rgblight_timer_init(void);
 void rgblight_timer_enable(void);
 void rgblight_timer_disable(void);
 void rgblight_timer_toggle(void);
-void rgblight_effect_breathing(uint8_t interval);
-void rgblight_effect_rainbow_mood(uint8_t interval);
-void rgblight_effect_rainbow_swirl(uint8_t interval);
-void rgblight_effect_snake(uint8_t interval);
-void rgblight_effect_knight(uint8_t interval);
-void rgblight_effect_christmas(void);
 
 #endif
@@ -0,0 +1,246 @@
+/*
+The MIT License (MIT)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "serial_link/loopback/loopback.h"
+#include "serial_link/protocol/byte_stuffer.h"
+#include "serial_link/protocol/crc32.h"
+#include "serial_link/protocol/frame_router.h"
+#include "serial_link/protocol/physical.h"
+#include "serial_link/protocol/reliable_link.h"
+#include "serial_link/protocol/transport.h"
+#include <pthread.h>
+#include <string.h>
+
+// The bytes received on one link of a node
+typedef struct {
+    uint8_t data[LOOPBACK_WIRE_SIZE];
+    // In nanoseconds
+    uint64_t arrival[LOOPBACK_WIRE_SIZE];
+    uint16_t first;
+    uint16_t count;
+    // The time the sender can start with the next byte
+    uint64_t line_free;
+} wire_t;
+
+typedef struct {
+    pthread_t thread;
+    loopback_function_t fn;
+    void* param;
+    // The function is waiting to run or running
+    bool busy;
+    bool quit;
+    wire_t wires[NUM_LINKS];
+    loopback_stats_t stats[NUM_LINKS];
+} node_t;
+
+static node_t nodes[LOOPBACK_MAX_NODES];
+static uint8_t num_nodes;
+static loopback_config_t config;
+static uint32_t random_state;
+// In nanoseconds
+static uint64_t now;
+static loopback_function_t task;
+static void* task_param;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static __thread uint8_t current_node;
+
+static void* node_main(void* arg) {
+    current_node = (uint8_t)(uintptr_t)arg;
+    node_t* node = &nodes[current_node];
+    pthread_mutex_lock(&lock);
+    while (true) {
+        while (!node->busy) {
+            pthread_cond_wait(&cond, &lock);
+        }
+        if (node->quit) {
+            break;
+        }
+        pthread_mutex_unlock(&lock);
+        node->fn(current_node, node->param);
+        pthread_mutex_lock(&lock);
+        node->busy = false;
+        pthread_cond_broadcast(&cond);
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+static void init_node(uint8_t node, void* param) {
+    (void)param;
+    init_byte_stuffer();
+    router_set_master(node == 0);
+#ifdef SERIAL_LINK_RELIABLE
+    init_reliable_link();
+#endif
+}
+
+void loopback_init(uint8_t count, const loopback_config_t* c) {
+    memset(nodes, 0, sizeof(nodes));
+    num_nodes = count;
+    config = *c;
+    random_state = config.seed ? config.seed : 1;
+    now = 0;
+    task = NULL;
+    // The tables are shared by all the nodes
+    init_crc32();
+    for (uint8_t i = 0; i < num_nodes; i++) {
+        pthread_create(&nodes[i].thread, NULL, node_main, (void*)(uintptr_t)i);
+        loopback_run_on(i, init_node, NULL);
+    }
+}
+
+void loopback_deinit(void) {
+    for (uint8_t i = 0; i < num_nodes; i++) {
+        pthread_mutex_lock(&lock);
+        nodes[i].quit = true;
+        nodes[i].busy = true;
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&lock);
+        pthread_join(nodes[i].thread, NULL);
+    }
+    num_nodes = 0;
+}
+
+void loopback_run_on(uint8_t node, loopback_function_t fn, void* param) {
+    node_t* n = &nodes[node];
+    pthread_mutex_lock(&lock);
+    n->fn = fn;
+    n->param = param;
+    n->busy = true;
+    pthread_cond_broadcast(&cond);
+    while (n->busy) {
+        pthread_cond_wait(&cond, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void loopback_set_task(loopback_function_t fn, void* param) {
+    task = fn;
+    task_param = param;
+}
+
+// xorshift32
+static uint32_t next_random(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+void send_data(uint8_t link, const uint8_t* data, uint16_t size) {
+    uint8_t from = current_node;
+    loopback_stats_t* stats = &nodes[from].stats[link];
+    stats->frames++;
+    stats->bytes += size;
+    // The down link of a node goes to the up link of the next one
+    int to = link == DOWN_LINK ? from + 1 : from - 1;
+    if (to < 0 || to >= num_nodes) {
+        return;
+    }
+    wire_t* wire = &nodes[to].wires[link == DOWN_LINK ? UP_LINK : DOWN_LINK];
+    uint64_t byte_time = config.bytes_per_second ? 1000000000ull / config.bytes_per_second : 0;
+    for (uint16_t i = 0; i < size; i++) {
+        if (wire->count == LOOPBACK_WIRE_SIZE) {
+            stats->overruns += size - i;
+            return;
+        }
+        uint8_t byte = data[i];
+        if (config.bit_errors) {
+            for (uint8_t bit = 0; bit < 8; bit++) {
+                if (next_random() % 1000000 < config.bit_errors) {
+                    byte ^= 1 << bit;
+                    stats->bit_errors++;
+                }
+            }
+        }
+        uint64_t start = wire->line_free > now ? wire->line_free : now;
+        wire->line_free = start + byte_time;
+        uint16_t index = (wire->first + wire->count) % LOOPBACK_WIRE_SIZE;
+        wire->data[index] = byte;
+        wire->arrival[index] = wire->line_free + config.latency * 1000ull;
+        wire->count++;
+    }
+}
+
+static void receive(uint8_t node, uint8_t link) {
+    // Like the serial link thread, everything that has arrived is read at once
+    static __thread uint8_t buffer[LOOPBACK_WIRE_SIZE];
+    wire_t* wire = &nodes[node].wires[link];
+    uint16_t size = 0;
+    while (wire->count > 0 && wire->arrival[wire->first] <= now) {
+        buffer[size++] = wire->data[wire->first];
+        wire->first = (wire->first + 1) % LOOPBACK_WIRE_SIZE;
+        wire->count--;
+    }
+    if (size > 0) {
+        // The up link of a node comes from the down link of the previous one
+        uint8_t from = link == UP_LINK ? node - 1 : node + 1;
+        nodes[from].stats[link == UP_LINK ? DOWN_LINK : UP_LINK].delivered += size;
+        byte_stuffer_recv_bytes(link, buffer, size);
+    }
+}
+
+static void step_node(uint8_t node, void* param) {
+    (void)param;
+    if (task) {
+        task(node, task_param);
+    }
+    receive(node, UP_LINK);
+    receive(node, DOWN_LINK);
+    update_transport();
+#ifdef SERIAL_LINK_RELIABLE
+    reliable_link_task();
+#endif
+}
+
+void loopback_run_for(uint32_t microseconds) {
+    uint64_t target = now + microseconds * 1000ull;
+    while (now < target) {
+        uint64_t step = target - now < LOOPBACK_STEP * 1000ull ? target - now : LOOPBACK_STEP * 1000ull;
+        now += step;
+        for (uint8_t i = 0; i < num_nodes; i++) {
+            loopback_run_on(i, step_node, NULL);
+        }
+    }
+}
+
+uint64_t loopback_time(void) {
+    return now / 1000;
+}
+
+uint8_t loopback_node(void) {
+    return current_node;
+}
+
+void loopback_get_stats(uint8_t node, uint8_t link, loopback_stats_t* stats) {
+    *stats = nodes[node].stats[link];
+}
+
+uint16_t timer_read(void) {
+    return (uint16_t)(now / 1000000);
+}
+
+void signal_data_written(void) {
+    // The transport is updated in every step anyway
+}
@@ -0,0 +1,90 @@
+/*
+The MIT License (MIT)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef SERIAL_LINK_LOOPBACK_H
+#define SERIAL_LINK_LOOPBACK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// An in memory physical layer for running the whole serial link stack on
+// the host. Every node, a simulated half of the keyboard, has its own
+// thread, which is where its protocol state lives, and the nodes are
+// connected in a chain, the down link of every node to the up link of the
+// next one. Node 0 is the master. Time is simulated, the nodes run one at a
+// time, so a run gives the same results every time.
+//
+// The protocol layers and the objects defined with the transport macros
+// have to be compiled with SERIAL_LINK_LOOPBACK.
+
+#define LOOPBACK_MAX_NODES 9
+// The nodes run every this many microseconds, which is also the resolution
+// of the latency
+#ifndef LOOPBACK_STEP
+#define LOOPBACK_STEP 100
+#endif
+// The bytes that can be on the way on a link, more are dropped as overruns
+#ifndef LOOPBACK_WIRE_SIZE
+#define LOOPBACK_WIRE_SIZE 4096
+#endif
+
+typedef struct {
+    // The speed of every link in bytes per second, 0 for no limit
+    uint32_t bytes_per_second;
+    // The microseconds from a byte being sent to it being received
+    uint32_t latency;
+    // The number of bits in a million that are flipped on the way
+    uint32_t bit_errors;
+    // The seed of the random bit errors
+    uint32_t seed;
+} loopback_config_t;
+
+// What a node sent on one of its links
+typedef struct {
+    // One send_data call is one frame
+    uint32_t frames;
+    uint32_t bytes;
+    uint32_t bit_errors;
+    // Bytes dropped because the link was too far behind
+    uint32_t overruns;
+    // Bytes that have arrived at the other end, the rest are still on the way
+    uint32_t delivered;
+} loopback_stats_t;
+
+typedef void (*loopback_function_t)(uint8_t node, void* param);
+
+// Starts the threads of the nodes and initializes their protocol layers
+void loopback_init(uint8_t num_nodes, const loopback_config_t* config);
+void loopback_deinit(void);
+// Runs the function on the thread of the node, and waits for it
+void loopback_run_on(uint8_t node, loopback_function_t fn, void* param);
+// The task is run on every node in every step, before the received data is
+// handled and the objects are sent, like the main loop of a keyboard
+void loopback_set_task(loopback_function_t task, void* param);
+void loopback_run_for(uint32_t microseconds);
+// The simulated time in microseconds
+uint64_t loopback_time(void);
+// The node of the calling thread
+uint8_t loopback_node(void);
+void loopback_get_stats(uint8_t node, uint8_t link, loopback_stats_t* stats);
+
+#endif
@@ -25,7 +25,9 @@ SOFTWARE.
 #include "serial_link/protocol/byte_stuffer.h"
 #include "serial_link/protocol/frame_validator.h"
 #include "serial_link/protocol/physical.h"
+#include "serial_link/system/serial_link.h"
 #include <stdbool.h>
+#include <string.h>
 
 // This implements the "Consistent overhead byte stuffing protocol"
 // https://en.wikipedia.org/wiki/Consistent_Overhead_Byte_Stuffing
@@ -38,7 +40,7 @@ typedef struct byte_stuffer_state {
     uint8_t data[MAX_FRAME_SIZE];
 }byte_stuffer_state_t;
 
-static byte_stuffer_state_t states[NUM_LINKS];
+static SERIAL_LINK_NODE_LOCAL byte_stuffer_state_t states[NUM_LINKS];
 
 void init_byte_stuffer_state(byte_stuffer_state_t* state) {
     state->next_zero = 0;
@@ -102,19 +104,114 @@ void byte_stuffer_recv_byte(uint8_t link, uint8_t data) {
     }
 }
 
+// Checks that the bytes before a delimiter are a frame that
+// byte_stuffer_recv_byte would accept, and returns its decoded size, or -1
+static int16_t decoded_frame_size(const uint8_t* data, uint16_t size) {
+    uint16_t in = 0;
+    uint16_t out = 0;
+    bool add_zero = false;
+    while (in < size) {
+        if (in > 0) {
+            // The next block starts when the frame is already full
+            if (out == MAX_FRAME_SIZE) {
+                return -1;
+            }
+            out += add_zero;
+        }
+        uint8_t code = data[in];
+        if (in + code > size || out + code - 1 > MAX_FRAME_SIZE) {
+            return -1;
+        }
+        out += code - 1;
+        in += code;
+        add_zero = code != 0xFF;
+    }
+    return out;
+}
+
+// The decoded frame is never longer than the encoded one, so the blocks can
+// be moved down to their place in the same buffer
+static void decode_frame_in_place(uint8_t* data, uint16_t size) {
+    uint16_t in = 0;
+    uint16_t out = 0;
+    bool add_zero = false;
+    while (in < size) {
+        if (in > 0 && add_zero) {
+            data[out++] = 0;
+        }
+        uint8_t code = data[in];
+        memmove(data + out, data + in + 1, code - 1);
+        out += code - 1;
+        in += code;
+        add_zero = code != 0xFF;
+    }
+}
+
+void byte_stuffer_recv_bytes(uint8_t link, uint8_t* data, uint16_t size) {
+    byte_stuffer_state_t* state = &states[link];
+    uint8_t* end = data + size;
+    while (data < end) {
+        if (state->next_zero == 0) {
+            // A whole frame in the buffer is decoded where it is
+            uint8_t* delimiter = memchr(data, 0, end - data);
+            if (delimiter) {
+                int16_t frame_size = decoded_frame_size(data, delimiter - data);
+                if (frame_size >= 0) {
+                    if (frame_size > 0) {
+                        decode_frame_in_place(data, delimiter - data);
+                        validator_recv_frame(link, data, frame_size);
+                    }
+                    data = delimiter + 1;
+                    continue;
+                }
+            }
+        }
+        else if (state->next_zero > 1 && state->data_pos < MAX_FRAME_SIZE && *data != 0) {
+            // The rest of the current block is copied up to the first zero,
+            // which is handled one byte at a time
+            uint16_t count = state->next_zero - 1;
+            if (count > end - data) {
+                count = end - data;
+            }
+            if (count > MAX_FRAME_SIZE - state->data_pos) {
+                count = MAX_FRAME_SIZE - state->data_pos;
+            }
+            uint8_t* zero = memchr(data, 0, count);
+            if (zero) {
+                count = zero - data;
+            }
+            memcpy(state->data + state->data_pos, data, count);
+            state->data_pos += count;
+            state->next_zero -= count;
+            data += count;
+            continue;
+        }
+        byte_stuffer_recv_byte(link, *(data++));
+    }
+}
+
+// Frames are encoded into one buffer, so that they are given to the physical
+// layer in one piece. It's only used by the thread that sends the frames.
+static SERIAL_LINK_NODE_LOCAL uint8_t send_buffer[MAX_ENCODED_FRAME_SIZE];
+static SERIAL_LINK_NODE_LOCAL uint16_t send_pos;
+
 static void send_block(uint8_t link, uint8_t* start, uint8_t* end, uint8_t num_non_zero) {
-    send_data(link, &num_non_zero, 1);
-    if (end > start) {
-        send_data(link, start, end-start);
+    // Only frames longer than MAX_FRAME_SIZE are sent in more than one piece
+    if (send_pos + (end - start) + 2 > MAX_ENCODED_FRAME_SIZE) {
+        send_data(link, send_buffer, send_pos);
+        send_pos = 0;
     }
+    send_buffer[send_pos++] = num_non_zero;
+    memcpy(send_buffer + send_pos, start, end - start);
+    send_pos += end - start;
 }
 
 void byte_stuffer_send_frame(uint8_t link, uint8_t* data, uint16_t size) {
-    const uint8_t zero = 0;
     if (size > 0) {
         uint16_t num_non_zero = 1;
         uint8_t* end = data + size;
         uint8_t* start = data;
+        send_pos = 0;
         while (data < end) {
             if (num_non_zero == 0xFF) {
                 // There's more data after big non-zero block
@@ -137,6 +234,7 @@ void byte_stuffer_send_frame(uint8_t link, uint8_t* data, uint16_t size) {
             }
         }
         send_block(link, start, data, num_non_zero);
-        send_data(link, &zero, 1);
+        send_buffer[send_pos++] = 0;
+        send_data(link, send_buffer, send_pos);
     }
 }
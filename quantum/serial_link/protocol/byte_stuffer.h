@@ -29,9 +29,15 @@ SOFTWARE.
 
 #define MAX_FRAME_SIZE 1024
 #define NUM_LINKS 2
+// A frame of MAX_FRAME_SIZE with its CRC, after byte stuffing
+#define MAX_ENCODED_FRAME_SIZE (MAX_FRAME_SIZE + 4 + (MAX_FRAME_SIZE + 4) / 254 + 2)
 
 void init_byte_stuffer(void);
 void byte_stuffer_recv_byte(uint8_t link, uint8_t data);
+// Receives a span of bytes. Frames that are completely inside of it are
+// decoded in place, so the data is modified.
+void byte_stuffer_recv_bytes(uint8_t link, uint8_t* data, uint16_t size);
+// The frame is sent with a single send_data call
 void byte_stuffer_send_frame(uint8_t link, uint8_t* data, uint16_t size);
 
 #endif
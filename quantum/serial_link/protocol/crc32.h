@@ -0,0 +1,48 @@
+/*
+The MIT License (MIT)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef SERIAL_LINK_CRC32_H
+#define SERIAL_LINK_CRC32_H
+
+#include <stdint.h>
+
+// The standard reflected CRC-32 (polynomial 0x04C11DB7, as used by zlib and
+// Ethernet) of the frames. The implementation is chosen at build time:
+//  SERIAL_LINK_CRC_HARDWARE  the CRC module of Kinetis K20 or the CRC unit of
+//                            STM32 chips with input and output reversal
+//  SERIAL_LINK_CRC_SLICING   1, 4 or 8 bytes per table lookup round, the
+//                            default is 1 on AVR and 4 everywhere else
+// All of them give the same result.
+uint32_t crc32_calculate(const uint8_t* data, uint32_t size);
+
+// Builds the lookup tables of the slicing implementations. Frames are sent and
+// received from different threads, so this has to be called before any of
+// them start.
+void init_crc32(void);
+
+// The software implementations, for testing. crc32_slicing4 is only built when
+// SERIAL_LINK_CRC_SLICING is 4 or 8, and crc32_slicing8 when it is 8.
+uint32_t crc32_bytewise(const uint8_t* data, uint32_t size);
+uint32_t crc32_slicing4(const uint8_t* data, uint32_t size);
+uint32_t crc32_slicing8(const uint8_t* data, uint32_t size);
+
+#endif
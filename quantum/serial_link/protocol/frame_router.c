@@ -25,8 +25,35 @@ SOFTWARE.
 #include "serial_link/protocol/frame_router.h"
 #include "serial_link/protocol/transport.h"
 #include "serial_link/protocol/frame_validator.h"
+#ifdef SERIAL_LINK_RELIABLE
+#include "serial_link/protocol/reliable_link.h"
+#endif
 
-static bool is_master;
+static void send_frame(uint8_t link, uint8_t* data, uint16_t size) {
+#ifdef SERIAL_LINK_RELIABLE
+    reliable_send_frame(link, data, size);
+#else
+    validator_send_frame(link, data, size);
+#endif
+}
+
+static SERIAL_LINK_NODE_LOCAL bool is_master;
+
+bool router_can_send(uint8_t destination, uint16_t size) {
+#ifdef SERIAL_LINK_RELIABLE
+    if (destination == 0) {
+        if (!is_master) {
+            return reliable_link_can_send(UP_LINK, size + 1);
+        }
+    }
+    else {
+        if (is_master) {
+            return reliable_link_can_send(DOWN_LINK, size + 1);
+        }
+    }
+#endif
+    return true;
+}
 
 void router_set_master(bool master) {
    is_master = master;
@@ -44,11 +71,11 @@ void route_incoming_frame(uint8_t link, uint8_t* data, uint16_t size){
                 transport_recv_frame(0, data, size - 1);
             }
             data[size-1] >>= 1;
-            validator_send_frame(DOWN_LINK, data, size);
+            send_frame(DOWN_LINK, data, size);
         }
         else {
             data[size-1]++;
-            validator_send_frame(UP_LINK, data, size);
+            send_frame(UP_LINK, data, size);
         }
     }
 }
@@ -57,13 +84,13 @@ void router_send_frame(uint8_t destination, uint8_t* data, uint16_t size) {
     if (destination == 0) {
         if (!is_master) {
             data[size] = 1;
-            validator_send_frame(UP_LINK, data, size + 1);
+            send_frame(UP_LINK, data, size + 1);
         }
     }
     else {
         if (is_master) {
             data[size] = destination;
-            validator_send_frame(DOWN_LINK, data, size + 1);
+            send_frame(DOWN_LINK, data, size + 1);
         }
     }
 }
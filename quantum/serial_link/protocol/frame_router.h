@@ -33,6 +33,9 @@ SOFTWARE.
 
 void router_set_master(bool master);
 void route_incoming_frame(uint8_t link, uint8_t* data, uint16_t size);
+// Whether a frame of the size can be sent to the destination now, with
+// SERIAL_LINK_RELIABLE it has to wait while the link is busy
+bool router_can_send(uint8_t destination, uint16_t size);
 void router_send_frame(uint8_t destination, uint8_t* data, uint16_t size);
 
 #endif
@@ -0,0 +1,283 @@
+/*
+The MIT License (MIT)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "serial_link/protocol/reliable_link.h"
+#include "serial_link/protocol/frame_router.h"
+#include "serial_link/protocol/frame_validator.h"
+#include "serial_link/protocol/byte_stuffer.h"
+#include "serial_link/system/serial_link.h"
+#include "timer.h"
+#include <string.h>
+
+// The frame has a sequence number
+#define FLAG_SEQUENCED 1
+// The acknowledgement is valid
+#define FLAG_ACK 2
+// The first frame since the sender started, or the oldest unacknowledged
+// one when the receiver doesn't seem to follow anymore. The receiver starts
+// expecting the frames that follow it.
+#define FLAG_FIRST 4
+
+// The oldest frame is sent with FLAG_FIRST after this many timeouts in a
+// row, in case the receiver has restarted
+#define RESYNC_TIMEOUTS 3
+
+typedef struct {
+    uint16_t size;
+    uint16_t sent_time;
+    bool retransmitted;
+    // With room for the trailer and the CRC
+    uint8_t data[SERIAL_LINK_RELIABLE_MAX_FRAME + RELIABLE_LINK_OVERHEAD + 4];
+} retransmit_entry_t;
+
+typedef struct {
+    // The sender side, the queue holds the frames from the sequence
+    // numbers first_unacked to next_seq - 1
+    retransmit_entry_t queue[SERIAL_LINK_RETRANSMIT_QUEUE];
+    uint8_t queue_start;
+    uint8_t first_unacked;
+    uint8_t next_seq;
+    bool started;
+    // When the oldest frame was last sent, and how many times in a row it
+    // timed out
+    uint16_t timer_start;
+    uint8_t timeouts;
+    // The receiver side
+    uint8_t expected_seq;
+    bool receiving;
+    bool ack_pending;
+    // The round trip time and its mean deviation, in 1/8 milliseconds
+    uint16_t srtt;
+    uint16_t rttvar;
+    reliable_link_stats_t stats;
+} link_state_t;
+
+static SERIAL_LINK_NODE_LOCAL link_state_t links[NUM_LINKS];
+
+void init_reliable_link(void) {
+    memset(links, 0, sizeof(links));
+}
+
+static uint8_t queue_length(link_state_t* state) {
+    return (uint8_t)(state->next_seq - state->first_unacked);
+}
+
+static retransmit_entry_t* queue_entry(link_state_t* state, uint8_t index) {
+    return &state->queue[(state->queue_start + index) % SERIAL_LINK_RETRANSMIT_QUEUE];
+}
+
+static uint16_t retransmit_timeout(link_state_t* state) {
+    uint16_t timeout = SERIAL_LINK_INITIAL_RETRANSMIT_TIMEOUT;
+    if (state->srtt != 0) {
+        timeout = (state->srtt + 4 * state->rttvar + 7) / 8;
+    }
+    if (timeout < SERIAL_LINK_MIN_RETRANSMIT_TIMEOUT) {
+        timeout = SERIAL_LINK_MIN_RETRANSMIT_TIMEOUT;
+    }
+    // Backs off while the frames don't get through
+    timeout <<= state->timeouts < 3 ? state->timeouts : 3;
+    if (timeout > SERIAL_LINK_MAX_RETRANSMIT_TIMEOUT) {
+        timeout = SERIAL_LINK_MAX_RETRANSMIT_TIMEOUT;
+    }
+    return timeout;
+}
+
+static void measure_rtt(link_state_t* state, uint16_t rtt) {
+    uint16_t sample = rtt * 8;
+    if (state->srtt == 0) {
+        state->srtt = sample;
+        state->rttvar = sample / 2;
+    }
+    else {
+        uint16_t deviation = sample > state->srtt ? sample - state->srtt : state->srtt - sample;
+        state->rttvar = state->rttvar - state->rttvar / 4 + deviation / 4;
+        state->srtt = state->srtt - state->srtt / 8 + sample / 8;
+    }
+    state->stats.rtt = state->srtt;
+}
+
+// Adds the trailer and sends the frame, the data has room for the trailer
+static void send_with_trailer(uint8_t link, uint8_t* data, uint16_t size, uint8_t seq, uint8_t flags) {
+    link_state_t* state = &links[link];
+    if (state->receiving) {
+        flags |= FLAG_ACK;
+    }
+    data[size] = seq;
+    data[size + 1] = state->expected_seq;
+    data[size + 2] = flags;
+    state->ack_pending = false;
+    state->stats.frames_sent++;
+    validator_send_frame(link, data, size + RELIABLE_LINK_OVERHEAD);
+}
+
+static void send_queued(uint8_t link, uint8_t index, uint16_t now) {
+    link_state_t* state = &links[link];
+    retransmit_entry_t* entry = queue_entry(state, index);
+    uint8_t seq = state->first_unacked + index;
+    uint8_t flags = FLAG_SEQUENCED;
+    if ((!state->started && seq == 0) || (index == 0 && state->timeouts >= RESYNC_TIMEOUTS)) {
+        flags |= FLAG_FIRST;
+    }
+    entry->sent_time = now;
+    if (index == 0) {
+        state->timer_start = now;
+    }
+    send_with_trailer(link, entry->data, entry->size, seq, flags);
+}
+
+bool reliable_link_can_send(uint8_t link, uint16_t size) {
+    link_state_t* state = &links[link];
+    if (size > SERIAL_LINK_RELIABLE_MAX_FRAME) {
+        // Otherwise it could arrive before the older frames, which would then
+        // overwrite it when they are retransmitted
+        return queue_length(state) == 0;
+    }
+    return queue_length(state) < SERIAL_LINK_RETRANSMIT_QUEUE;
+}
+
+void reliable_send_frame(uint8_t link, uint8_t* data, uint16_t size) {
+    link_state_t* state = &links[link];
+    if (!reliable_link_can_send(link, size)) {
+        state->stats.dropped++;
+        return;
+    }
+    if (size > SERIAL_LINK_RELIABLE_MAX_FRAME) {
+        state->stats.unreliable++;
+        send_with_trailer(link, data, size, 0, 0);
+        return;
+    }
+    uint8_t index = queue_length(state);
+    retransmit_entry_t* entry = queue_entry(state, index);
+    memcpy(entry->data, data, size);
+    entry->size = size;
+    entry->retransmitted = false;
+    state->next_seq++;
+    send_queued(link, index, timer_read());
+}
+
+static void receive_ack(link_state_t* state, uint8_t ack) {
+    uint8_t acked = ack - state->first_unacked;
+    // Acknowledgements of frames that haven't been sent are ignored
+    if (acked == 0 || acked > queue_length(state)) {
+        return;
+    }
+    uint16_t now = timer_read();
+    // Karn's algorithm, only frames that were sent once are measured
+    retransmit_entry_t* last = queue_entry(state, acked - 1);
+    if (!last->retransmitted) {
+        measure_rtt(state, now - last->sent_time);
+    }
+    state->queue_start = (state->queue_start + acked) % SERIAL_LINK_RETRANSMIT_QUEUE;
+    state->first_unacked = ack;
+    state->started = true;
+    state->timeouts = 0;
+    // The timer restarts for the rest of the queue
+    state->timer_start = now;
+}
+
+void reliable_recv_frame(uint8_t link, uint8_t* data, uint16_t size) {
+    if (size < RELIABLE_LINK_OVERHEAD) {
+        return;
+    }
+    link_state_t* state = &links[link];
+    size -= RELIABLE_LINK_OVERHEAD;
+    uint8_t seq = data[size];
+    uint8_t ack = data[size + 1];
+    uint8_t flags = data[size + 2];
+    if (flags & FLAG_ACK) {
+        receive_ack(state, ack);
+    }
+    if (size == 0) {
+        return;
+    }
+    if (flags & FLAG_SEQUENCED) {
+        if (flags & FLAG_FIRST) {
+            state->expected_seq = seq;
+        }
+        // Everything received with a sequence number is acknowledged, so
+        // that the sender finds out about lost acknowledgements too
+        state->ack_pending = true;
+        if (seq != state->expected_seq) {
+            if ((uint8_t)(state->expected_seq - seq) <= SERIAL_LINK_RETRANSMIT_QUEUE) {
+                state->stats.duplicates++;
+            }
+            else {
+                state->stats.out_of_order++;
+            }
+            return;
+        }
+        state->expected_seq++;
+        state->receiving = true;
+    }
+    state->stats.frames_received++;
+    route_incoming_frame(link, data, size);
+}
+
+void reliable_link_task(void) {
+    uint16_t now = timer_read();
+    uint8_t link;
+    for (link=0;link<NUM_LINKS;link++) {
+        link_state_t* state = &links[link];
+        uint8_t length = queue_length(state);
+        if (length > 0 && (uint16_t)(now - state->timer_start) >= retransmit_timeout(state)) {
+            // Go back to the oldest frame
+            if (state->timeouts < 0xFF) {
+                state->timeouts++;
+            }
+            uint8_t i;
+            for (i=0;i<length;i++) {
+                queue_entry(state, i)->retransmitted = true;
+                state->stats.retransmits++;
+                send_queued(link, i, now);
+            }
+        }
+        if (state->ack_pending && state->receiving) {
+            uint8_t ack_frame[RELIABLE_LINK_OVERHEAD + 4];
+            send_with_trailer(link, ack_frame, 0, 0, 0);
+        }
+    }
+}
+
+uint16_t reliable_link_time_to_next_task(void) {
+    uint16_t now = timer_read();
+    uint16_t next = 0xFFFF;
+    uint8_t link;
+    for (link=0;link<NUM_LINKS;link++) {
+        link_state_t* state = &links[link];
+        if (state->ack_pending && state->receiving) {
+            return 0;
+        }
+        if (queue_length(state) > 0) {
+            uint16_t elapsed = now - state->timer_start;
+            uint16_t timeout = retransmit_timeout(state);
+            uint16_t wait = elapsed < timeout ? timeout - elapsed : 0;
+            if (wait < next) {
+                next = wait;
+            }
+        }
+    }
+    return next;
+}
+
+void reliable_link_get_stats(uint8_t link, reliable_link_stats_t* stats) {
+    *stats = links[link].stats;
+}
@@ -0,0 +1,97 @@
+/*
+The MIT License (MIT)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef SERIAL_LINK_RELIABLE_LINK_H
+#define SERIAL_LINK_RELIABLE_LINK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// With SERIAL_LINK_RELIABLE the frames between the router and the frame
+// validator go through this layer, which retransmits the ones that are lost
+// on a link. Every frame ends with a sequence number, the cumulative
+// acknowledgement of the frames received on the same link, and flags.
+// Frames that are received out of order are dropped, and the sender goes
+// back to the oldest unacknowledged frame when it times out.
+
+// The number of frames per link that can wait for an acknowledgement
+#ifndef SERIAL_LINK_RETRANSMIT_QUEUE
+#define SERIAL_LINK_RETRANSMIT_QUEUE 4
+#endif
+
+// Larger frames aren't retransmitted, and are only sent when there are no
+// frames waiting for an acknowledgement
+#ifndef SERIAL_LINK_RELIABLE_MAX_FRAME
+#define SERIAL_LINK_RELIABLE_MAX_FRAME 64
+#endif
+
+// The limits of the retransmit timeout in milliseconds, which is worked
+// out from the measured round trip time, and the timeout before the first
+// measurement
+#ifndef SERIAL_LINK_INITIAL_RETRANSMIT_TIMEOUT
+#define SERIAL_LINK_INITIAL_RETRANSMIT_TIMEOUT 20
+#endif
+#ifndef SERIAL_LINK_MIN_RETRANSMIT_TIMEOUT
+#define SERIAL_LINK_MIN_RETRANSMIT_TIMEOUT 4
+#endif
+#ifndef SERIAL_LINK_MAX_RETRANSMIT_TIMEOUT
+#define SERIAL_LINK_MAX_RETRANSMIT_TIMEOUT 100
+#endif
+
+// The sequence number, the acknowledgement and the flags
+#define RELIABLE_LINK_OVERHEAD 3
+
+typedef struct {
+    uint32_t frames_sent;
+    uint32_t frames_received;
+    // Frames sent again because they weren't acknowledged in time, compared
+    // to the frames sent it's an estimate of the loss on the link
+    uint32_t retransmits;
+    // Frames received after a lost one, which are dropped
+    uint32_t out_of_order;
+    uint32_t duplicates;
+    // Frames sent without retransmission, because they were too large
+    uint32_t unreliable;
+    // Frames that were sent while reliable_link_can_send returned false,
+    // they are dropped instead of overtaking the frames in the queue
+    uint32_t dropped;
+    // The smoothed round trip time in 1/8 milliseconds
+    uint16_t rtt;
+} reliable_link_stats_t;
+
+void init_reliable_link(void);
+// Whether a frame of the size can be sent on the link now, frames that can't
+// have to wait until the queued ones are acknowledged
+bool reliable_link_can_send(uint8_t link, uint16_t size);
+// The buffer pointed to by the data needs RELIABLE_LINK_OVERHEAD + 4
+// additional bytes
+void reliable_send_frame(uint8_t link, uint8_t* data, uint16_t size);
+void reliable_recv_frame(uint8_t link, uint8_t* data, uint16_t size);
+// Retransmits the frames that timed out, and acknowledges the received ones
+// that there was no other frame to acknowledge with
+void reliable_link_task(void);
+// The time in milliseconds until reliable_link_task has something to do, or
+// 0xFFFF if there's nothing waiting for an acknowledgement
+uint16_t reliable_link_time_to_next_task(void);
+void reliable_link_get_stats(uint8_t link, reliable_link_stats_t* stats);
+
+#endif
@@ -25,20 +25,92 @@ SOFTWARE.
 #include "serial_link/protocol/transport.h"
 #include "serial_link/protocol/frame_router.h"
 #include "serial_link/protocol/triple_buffered_object.h"
+#ifdef SERIAL_LINK_RELIABLE
+#include "serial_link/protocol/reliable_link.h"
+#endif
+#include "timer.h"
 #include <string.h>
 
 #define MAX_REMOTE_OBJECTS 16
-static remote_object_t* remote_objects[MAX_REMOTE_OBJECTS];
-static uint32_t num_remote_objects = 0;
+static SERIAL_LINK_NODE_LOCAL remote_object_t* remote_objects[MAX_REMOTE_OBJECTS];
+static SERIAL_LINK_NODE_LOCAL uint32_t num_remote_objects = 0;
+// The ids of the objects, highest priority first
+static SERIAL_LINK_NODE_LOCAL uint8_t send_order[MAX_REMOTE_OBJECTS];
+// A bit for every object that has been written since it was last sent
+static SERIAL_LINK_NODE_LOCAL uint16_t dirty_objects;
+// The dirty objects that update_transport couldn't send because the link was
+// busy, they are sent when it has received something or after a timeout
+static SERIAL_LINK_NODE_LOCAL uint16_t blocked_objects;
+
+#ifdef SERIAL_LINK_DELTA_UPDATES
+// Delta frames end with the id with this bit set
+#define DELTA_FRAME 0x80
+// The receivers only get back in sync after a lost frame with a full
+// version, so one is sent after this many deltas
+#ifndef SERIAL_LINK_DELTA_FULL_INTERVAL
+#define SERIAL_LINK_DELTA_FULL_INTERVAL 8
+#endif
+// Larger deltas are sent as full versions
+#ifndef SERIAL_LINK_DELTA_MAX_SIZE
+#define SERIAL_LINK_DELTA_MAX_SIZE 64
+#endif
+// The delta, followed by the two versions and the id, and then the bytes the
+// layers below add, like after the local objects
+static SERIAL_LINK_NODE_LOCAL uint8_t delta_frame[SERIAL_LINK_DELTA_MAX_SIZE + LOCAL_OBJECT_EXTRA];
+
+typedef struct {
+    // 0 when there's no previous version
+    uint8_t version;
+    uint8_t deltas;
+    uint8_t data[];
+} delta_base_t;
+
+static delta_base_t* get_delta_base(uint8_t* start, uint16_t block_size, uint16_t object_size) {
+    return (delta_base_t*)(start + block_size - DELTA_BASE_SIZE(object_size));
+}
+
+// The full version is sent with the version and the id, and the deltas are
+// never larger
+#define OBJECT_FRAME_EXTRA 2
+#else
+// The object is sent with its id
+#define OBJECT_FRAME_EXTRA 1
+#endif
+
+// The frame router appends the routing byte, the reliable link its trailer,
+// and the frame validator the CRC
+#ifdef SERIAL_LINK_RELIABLE
+#define FRAME_LAYERS_EXTRA (1 + RELIABLE_LINK_OVERHEAD + 4)
+#else
+#define FRAME_LAYERS_EXTRA (1 + 4)
+#endif
+
+_Static_assert(OBJECT_FRAME_EXTRA + FRAME_LAYERS_EXTRA <= LOCAL_OBJECT_EXTRA,
+    "LOCAL_OBJECT_EXTRA has no room for the frame layers");
 
 void reinitialize_serial_link_transport(void) {
     num_remote_objects = 0;
+    dirty_objects = 0;
+    blocked_objects = 0;
+}
+
+static void sort_remote_objects(void) {
+    uint8_t i;
+    for (i=0;i<num_remote_objects;i++) {
+        uint8_t j = i;
+        while (j > 0 && remote_objects[send_order[j - 1]]->priority < remote_objects[i]->priority) {
+            send_order[j] = send_order[j - 1];
+            j--;
+        }
+        send_order[j] = i;
+    }
 }
 
 void add_remote_objects(remote_object_t** _remote_objects, uint32_t _num_remote_objects) {
     unsigned int i;
     for(i=0;i<_num_remote_objects;i++) {
         remote_object_t* obj = _remote_objects[i];
+        obj->id = num_remote_objects;
         remote_objects[num_remote_objects++] = obj;
         if (obj->object_type == MASTER_TO_ALL_SLAVES) {
             triple_buffer_object_t* tb = (triple_buffer_object_t*)obj->buffer;
@@ -70,7 +142,178 @@ void add_remote_objects(remote_object_t** _remote_objects, uint32_t _num_remote_
                 start += REMOTE_OBJECT_SIZE(obj->object_size);
             }
         }
+#ifdef SERIAL_LINK_DELTA_UPDATES
+        // All the local and remote objects start without a previous version
+        uint8_t* start = obj->buffer;
+        uint8_t num_local = obj->object_type == MASTER_TO_SINGLE_SLAVE ? NUM_SLAVES : 1;
+        uint8_t num_remote = obj->object_type == SLAVE_TO_MASTER ? NUM_SLAVES : 1;
+        unsigned int j;
+        for (j=0;j<num_local;j++) {
+            get_delta_base(start, LOCAL_OBJECT_SIZE(obj->object_size), obj->object_size)->version = 0;
+            start += LOCAL_OBJECT_SIZE(obj->object_size);
+        }
+        for (j=0;j<num_remote;j++) {
+            get_delta_base(start, REMOTE_OBJECT_SIZE(obj->object_size), obj->object_size)->version = 0;
+            start += REMOTE_OBJECT_SIZE(obj->object_size);
+        }
+#endif
+    }
+    sort_remote_objects();
+}
+
+void set_remote_object_priority(remote_object_t* object, uint8_t priority) {
+    object->priority = priority;
+    sort_remote_objects();
+}
+
+void set_remote_object_min_interval(remote_object_t* object, uint16_t min_interval) {
+    object->min_interval = min_interval;
+    // So that the next write is sent right away
+    object->last_sent = timer_read() - min_interval;
+}
+
+void transport_object_written(remote_object_t* object) {
+    serial_link_lock();
+    dirty_objects |= 1 << object->id;
+    serial_link_unlock();
+}
+
+#ifdef SERIAL_LINK_DELTA_UPDATES
+
+// The delta is a list of runs, each one is the number of unchanged bytes,
+// the number of changed bytes, and the changed bytes XORed with the
+// previous version. Returns the size, or 0xFFFF if it's larger than max_size.
+static uint16_t encode_delta(const uint8_t* data, const uint8_t* base, uint16_t size, uint8_t* out, uint16_t max_size) {
+    uint16_t in = 0;
+    uint16_t pos = 0;
+    while (in < size) {
+        uint8_t same = 0;
+        while (in < size && same < 0xFF && data[in] == base[in]) {
+            same++;
+            in++;
+        }
+        if (in == size) {
+            break;
+        }
+        uint8_t changed = 0;
+        uint16_t start = in;
+        while (in < size && changed < 0xFF && data[in] != base[in]) {
+            changed++;
+            in++;
+        }
+        if (pos + 2 + changed > max_size) {
+            return 0xFFFF;
+        }
+        out[pos++] = same;
+        out[pos++] = changed;
+        uint8_t i;
+        for (i=0;i<changed;i++) {
+            out[pos++] = data[start + i] ^ base[start + i];
+        }
     }
+    return pos;
+}
+
+static bool apply_delta(uint8_t* base, uint16_t size, const uint8_t* delta, uint16_t delta_size) {
+    uint16_t pos = 0;
+    uint16_t in = 0;
+    while (in < delta_size) {
+        if (in + 2 > delta_size) {
+            return false;
+        }
+        pos += delta[in];
+        uint8_t changed = delta[in + 1];
+        in += 2;
+        if (pos + changed > size || in + changed > delta_size) {
+            return false;
+        }
+        uint8_t i;
+        for (i=0;i<changed;i++) {
+            base[pos++] ^= delta[in++];
+        }
+    }
+    return true;
+}
+
+// Sends the object as a delta when the receiver should have the previous
+// version, and it's smaller, otherwise as the full version
+static void send_object(uint8_t dest, uint8_t id, uint8_t* ptr, uint16_t size, delta_base_t* base) {
+    uint8_t version = base->version + 1;
+    if (version == 0) {
+        version = 1;
+    }
+    uint16_t delta_size = 0xFFFF;
+    if (base->version != 0 && base->deltas < SERIAL_LINK_DELTA_FULL_INTERVAL) {
+        uint16_t max_size = size - 1 < SERIAL_LINK_DELTA_MAX_SIZE ? size - 1 : SERIAL_LINK_DELTA_MAX_SIZE;
+        delta_size = encode_delta(ptr, base->data, size, delta_frame, max_size);
+    }
+    if (delta_size != 0xFFFF) {
+        delta_frame[delta_size] = base->version;
+        delta_frame[delta_size + 1] = version;
+        delta_frame[delta_size + 2] = id | DELTA_FRAME;
+        router_send_frame(dest, delta_frame, delta_size + 3);
+        base->deltas++;
+    }
+    else {
+        ptr[size] = version;
+        ptr[size + 1] = id;
+        router_send_frame(dest, ptr, size + 2);
+        base->deltas = 0;
+    }
+    memcpy(base->data, ptr, size);
+    base->version = version;
+}
+
+void transport_recv_frame(uint8_t from, uint8_t* data, uint16_t size) {
+    if (size < 3) {
+        return;
+    }
+    uint8_t id = data[size-1] & ~DELTA_FRAME;
+    bool delta = data[size-1] & DELTA_FRAME;
+    if (id < num_remote_objects) {
+        remote_object_t* obj = remote_objects[id];
+        if (!delta && obj->object_size != size - 2) {
+            return;
+        }
+        uint8_t* start;
+        if (obj->object_type == MASTER_TO_ALL_SLAVES) {
+            start = obj->buffer + LOCAL_OBJECT_SIZE(obj->object_size);
+        }
+        else if(obj->object_type == SLAVE_TO_MASTER) {
+            start = obj->buffer + LOCAL_OBJECT_SIZE(obj->object_size);
+            start += (from - 1) * REMOTE_OBJECT_SIZE(obj->object_size);
+        }
+        else {
+            start = obj->buffer + NUM_SLAVES * LOCAL_OBJECT_SIZE(obj->object_size);
+        }
+        delta_base_t* base = get_delta_base(start, REMOTE_OBJECT_SIZE(obj->object_size), obj->object_size);
+        if (delta) {
+            // Deltas against a version that was lost are ignored until the
+            // next full version
+            if (base->version == 0 || base->version != data[size-3]) {
+                return;
+            }
+            if (!apply_delta(base->data, obj->object_size, data, size - 3)) {
+                base->version = 0;
+                return;
+            }
+        }
+        else {
+            memcpy(base->data, data, obj->object_size);
+        }
+        base->version = data[size-2];
+        triple_buffer_object_t* tb = (triple_buffer_object_t*)start;
+        void* ptr = triple_buffer_begin_write_internal(obj->object_size, tb);
+        memcpy(ptr, base->data, obj->object_size);
+        triple_buffer_end_write_internal(tb);
+    }
+}
+
+#else
+
+static void send_object(uint8_t dest, uint8_t id, uint8_t* ptr, uint16_t size) {
+    ptr[size] = id;
+    router_send_frame(dest, ptr, size + 1);
 }
 
 void transport_recv_frame(uint8_t from, uint8_t* data, uint16_t size) {
@@ -97,32 +340,108 @@ void transport_recv_frame(uint8_t from, uint8_t* data, uint16_t size) {
     }
 }
 
-void update_transport(void) {
-    unsigned int i;
-    for(i=0;i<num_remote_objects;i++) {
-        remote_object_t* obj = remote_objects[i];
-        if (obj->object_type == MASTER_TO_ALL_SLAVES || obj->object_type == SLAVE_TO_MASTER) {
-            triple_buffer_object_t* tb = (triple_buffer_object_t*)obj->buffer;
+#endif
+
+// Returns false when the link was too busy to send everything, the versions
+// that weren't sent stay in the triple buffers
+static bool send_remote_object(remote_object_t* obj) {
+    uint8_t i = obj->id;
+    uint16_t frame_size = obj->object_size + OBJECT_FRAME_EXTRA;
+    if (obj->object_type == MASTER_TO_ALL_SLAVES || obj->object_type == SLAVE_TO_MASTER) {
+        uint8_t dest = obj->object_type == MASTER_TO_ALL_SLAVES ? 0xFF : 0;
+        if (!router_can_send(dest, frame_size)) {
+            return false;
+        }
+        triple_buffer_object_t* tb = (triple_buffer_object_t*)obj->buffer;
+        uint8_t* ptr = (uint8_t*)triple_buffer_read_internal(obj->object_size + LOCAL_OBJECT_EXTRA, tb);
+        if (ptr) {
+#ifdef SERIAL_LINK_DELTA_UPDATES
+            send_object(dest, i, ptr, obj->object_size,
+                get_delta_base(obj->buffer, LOCAL_OBJECT_SIZE(obj->object_size), obj->object_size));
+#else
+            send_object(dest, i, ptr, obj->object_size);
+#endif
+        }
+    }
+    else {
+        uint8_t* start = obj->buffer;
+        unsigned int j;
+        for (j=0;j<NUM_SLAVES;j++) {
+            uint8_t dest = j + 1;
+            if (!router_can_send(dest, frame_size)) {
+                return false;
+            }
+            triple_buffer_object_t* tb = (triple_buffer_object_t*)start;
             uint8_t* ptr = (uint8_t*)triple_buffer_read_internal(obj->object_size + LOCAL_OBJECT_EXTRA, tb);
             if (ptr) {
-                ptr[obj->object_size] = i;
-                uint8_t dest = obj->object_type == MASTER_TO_ALL_SLAVES ? 0xFF : 0;
-                router_send_frame(dest, ptr, obj->object_size + 1);
+#ifdef SERIAL_LINK_DELTA_UPDATES
+                send_object(dest, i, ptr, obj->object_size,
+                    get_delta_base(start, LOCAL_OBJECT_SIZE(obj->object_size), obj->object_size));
+#else
+                send_object(dest, i, ptr, obj->object_size);
+#endif
             }
+            start += LOCAL_OBJECT_SIZE(obj->object_size);
         }
-        else {
-            uint8_t* start = obj->buffer;
-            unsigned int j;
-            for (j=0;j<NUM_SLAVES;j++) {
-                triple_buffer_object_t* tb = (triple_buffer_object_t*)start;
-                uint8_t* ptr = (uint8_t*)triple_buffer_read_internal(obj->object_size + LOCAL_OBJECT_EXTRA, tb);
-                if (ptr) {
-                    ptr[obj->object_size] = i;
-                    uint8_t dest = j + 1;
-                    router_send_frame(dest, ptr, obj->object_size + 1);
-                }
-                start += LOCAL_OBJECT_SIZE(obj->object_size);
+    }
+    return true;
+}
+
+void update_transport(void) {
+    serial_link_lock();
+    uint16_t dirty = dirty_objects;
+    dirty_objects = 0;
+    serial_link_unlock();
+    if (!dirty) {
+        return;
+    }
+
+    uint16_t now = timer_read();
+    uint16_t held_back = 0;
+    blocked_objects = 0;
+    unsigned int i;
+    for(i=0;i<num_remote_objects;i++) {
+        remote_object_t* obj = remote_objects[send_order[i]];
+        if (!(dirty & (1 << obj->id))) {
+            continue;
+        }
+        if (obj->min_interval && (uint16_t)(now - obj->last_sent) < obj->min_interval) {
+            // The latest version stays in the triple buffer until it's time
+            held_back |= 1 << obj->id;
+            continue;
+        }
+        if (!send_remote_object(obj)) {
+            // Sending it now could reorder it with the frames that are
+            // waiting to be acknowledged
+            blocked_objects |= 1 << obj->id;
+            continue;
+        }
+        obj->last_sent = now;
+    }
+
+    if (held_back || blocked_objects) {
+        serial_link_lock();
+        dirty_objects |= held_back | blocked_objects;
+        serial_link_unlock();
+    }
+}
+
+uint16_t transport_time_to_next_update(void) {
+    serial_link_lock();
+    uint16_t dirty = dirty_objects;
+    serial_link_unlock();
+    uint16_t now = timer_read();
+    uint16_t next = 0xFFFF;
+    unsigned int i;
+    for(i=0;i<num_remote_objects;i++) {
+        remote_object_t* obj = remote_objects[i];
+        if ((dirty & ~blocked_objects) & (1 << obj->id)) {
+            uint16_t elapsed = now - obj->last_sent;
+            uint16_t wait = elapsed < obj->min_interval ? obj->min_interval - elapsed : 0;
+            if (wait < next) {
+                next = wait;
             }
         }
     }
+    return next;
 }
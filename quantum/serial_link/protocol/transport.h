@@ -29,6 +29,8 @@ SOFTWARE.
 #include "serial_link/system/serial_link.h"
 
 #define NUM_SLAVES 8
+// The room after the local objects for the bytes that the transport and the
+// layers below it add to the frames before they are sent
 #define LOCAL_OBJECT_EXTRA 16
 
 // master -> slave = 1 local(target all), 1 remote object
@@ -43,13 +45,33 @@ typedef enum {
 typedef struct {
     remote_object_type object_type;
     uint16_t object_size;
-    uint8_t buffer[] __attribute__((aligned(4)));
+    // Objects with a higher priority are sent first
+    uint8_t priority;
+    // The minimum time between two sends of the object in milliseconds, if
+    // it's written more often only the latest value is sent
+    uint16_t min_interval;
+    // Managed by the transport
+    uint8_t id;
+    uint16_t last_sent;
+    // Zero sized instead of flexible, so that the object can be embedded in
+    // the structs of the macros below
+    uint8_t buffer[0] __attribute__((aligned(4)));
 } remote_object_t;
 
+// With SERIAL_LINK_DELTA_UPDATES the objects are usually sent as the XOR
+// difference to the previous version, run length encoded. Every local and
+// remote object then keeps a copy of the last version sent or received,
+// with its version number and the number of deltas since the full version.
+#ifdef SERIAL_LINK_DELTA_UPDATES
+#define DELTA_BASE_SIZE(objectsize) (objectsize + 2)
+#else
+#define DELTA_BASE_SIZE(objectsize) 0
+#endif
+
 #define REMOTE_OBJECT_SIZE(objectsize) \
-    (sizeof(triple_buffer_object_t) + objectsize * 3)
+    (sizeof(triple_buffer_object_t) + objectsize * 3 + DELTA_BASE_SIZE(objectsize))
 #define LOCAL_OBJECT_SIZE(objectsize) \
-    (sizeof(triple_buffer_object_t) + (objectsize + LOCAL_OBJECT_EXTRA) * 3)
+    (sizeof(triple_buffer_object_t) + (objectsize + LOCAL_OBJECT_EXTRA) * 3 + DELTA_BASE_SIZE(objectsize))
 
 #define REMOTE_OBJECT_HELPER(name, type, num_local, num_remote) \
 typedef struct { \
@@ -61,7 +83,7 @@ typedef struct { \
 
 #define MASTER_TO_ALL_SLAVES_OBJECT(name, type) \
     REMOTE_OBJECT_HELPER(name, type, 1, 1) \
-    remote_object_##name##_t remote_object_##name = { \
+    SERIAL_LINK_NODE_LOCAL remote_object_##name##_t remote_object_##name = { \
         .object = { \
             .object_type = MASTER_TO_ALL_SLAVES, \
             .object_size = sizeof(type), \
@@ -76,6 +98,7 @@ typedef struct { \
         remote_object_t* obj = (remote_object_t*)&remote_object_##name; \
         triple_buffer_object_t* tb = (triple_buffer_object_t*)obj->buffer; \
         triple_buffer_end_write_internal(tb); \
+        transport_object_written(obj); \
         signal_data_written(); \
     }\
     type* read_##name(void) { \
@@ -87,7 +110,7 @@ typedef struct { \
 
 #define MASTER_TO_SINGLE_SLAVE_OBJECT(name, type) \
     REMOTE_OBJECT_HELPER(name, type, NUM_SLAVES, 1) \
-    remote_object_##name##_t remote_object_##name = { \
+    SERIAL_LINK_NODE_LOCAL remote_object_##name##_t remote_object_##name = { \
         .object = { \
             .object_type = MASTER_TO_SINGLE_SLAVE, \
             .object_size = sizeof(type), \
@@ -106,6 +129,7 @@ typedef struct { \
         start += slave * LOCAL_OBJECT_SIZE(obj->object_size); \
         triple_buffer_object_t* tb = (triple_buffer_object_t*)start; \
         triple_buffer_end_write_internal(tb); \
+        transport_object_written(obj); \
         signal_data_written(); \
     }\
     type* read_##name() { \
@@ -117,7 +141,7 @@ typedef struct { \
 
 #define SLAVE_TO_MASTER_OBJECT(name, type) \
     REMOTE_OBJECT_HELPER(name, type, 1, NUM_SLAVES) \
-    remote_object_##name##_t remote_object_##name = { \
+    SERIAL_LINK_NODE_LOCAL remote_object_##name##_t remote_object_##name = { \
         .object = { \
             .object_type = SLAVE_TO_MASTER, \
             .object_size = sizeof(type), \
@@ -132,6 +156,7 @@ typedef struct { \
         remote_object_t* obj = (remote_object_t*)&remote_object_##name; \
         triple_buffer_object_t* tb = (triple_buffer_object_t*)obj->buffer; \
         triple_buffer_end_write_internal(tb); \
+        transport_object_written(obj); \
         signal_data_written(); \
     }\
     type* read_##name(uint8_t slave) { \
@@ -146,7 +171,16 @@ typedef struct { \
 
 void add_remote_objects(remote_object_t** remote_objects, uint32_t num_remote_objects);
 void reinitialize_serial_link_transport(void);
+// The priority and the rate limit can be changed at any time, the default
+// is 0 for both, which means no limit
+void set_remote_object_priority(remote_object_t* object, uint8_t priority);
+void set_remote_object_min_interval(remote_object_t* object, uint16_t min_interval);
+// Adds the object to the ones that update_transport sends
+void transport_object_written(remote_object_t* object);
 void transport_recv_frame(uint8_t from, uint8_t* data, uint16_t size);
 void update_transport(void);
+// The time in milliseconds until update_transport can send an object that
+// is held back by its rate limit, or 0xFFFF if there's none
+uint16_t transport_time_to_next_update(void);
 
 #endif
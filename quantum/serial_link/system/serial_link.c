@@ -26,8 +26,12 @@ SOFTWARE.
 #include "serial_link/system/serial_link.h"
 #include "hal.h"
 #include "serial_link/protocol/byte_stuffer.h"
+#include "serial_link/protocol/crc32.h"
 #include "serial_link/protocol/transport.h"
 #include "serial_link/protocol/frame_router.h"
+#ifdef SERIAL_LINK_RELIABLE
+#include "serial_link/protocol/reliable_link.h"
+#endif
 #include "matrix.h"
 #include <stdbool.h>
 #include "print.h"
@@ -66,16 +70,13 @@ static SerialConfig config = {
 
 //#define DEBUG_LINK_ERRORS
 
+// Everything in the input queue is read at once, and the frames are decoded
+// from this buffer
+static uint8_t read_buffer[SERIAL_BUFFERS_SIZE];
+
 static uint32_t read_from_serial(SerialDriver* driver, uint8_t link) {
-    const uint32_t buffer_size = 16;
-    uint8_t buffer[buffer_size];
-    uint32_t bytes_read = sdAsynchronousRead(driver, buffer, buffer_size);
-    uint8_t* current = buffer;
-    uint8_t* end = current + bytes_read;
-    while(current < end) {
-        byte_stuffer_recv_byte(link, *current);
-        current++;
-    }
+    uint32_t bytes_read = sdAsynchronousRead(driver, read_buffer, sizeof(read_buffer));
+    byte_stuffer_recv_bytes(link, read_buffer, bytes_read);
     return bytes_read;
 }
 
@@ -137,7 +138,19 @@ static THD_FUNCTION(serialThread, arg) {
         eventflags_t flags1 = 0;
         eventflags_t flags2 = 0;
         if (need_wait) {
-            eventmask_t mask = chEvtWaitAnyTimeout(ALL_EVENTS, MS2ST(1000));
+            // Wakes up for the objects that are held back by their rate limit
+            uint16_t timeout = transport_time_to_next_update();
+#ifdef SERIAL_LINK_RELIABLE
+            // and for the retransmits
+            uint16_t retransmit = reliable_link_time_to_next_task();
+            if (retransmit < timeout) {
+                timeout = retransmit;
+            }
+#endif
+            if (timeout > 1000) {
+                timeout = 1000;
+            }
+            eventmask_t mask = chEvtWaitAnyTimeout(ALL_EVENTS, MS2ST(timeout));
             if (mask & EVENT_MASK(1)) {
                 flags1 = chEvtGetAndClearFlags(&sd1_listener);
                 print_error("DOWNLINK", flags1, &SD1);
@@ -156,6 +169,9 @@ static THD_FUNCTION(serialThread, arg) {
         need_wait &= read_from_serial(&SD2, UP_LINK) == 0;
         need_wait &= read_from_serial(&SD1, DOWN_LINK) == 0;
         update_transport();
+#ifdef SERIAL_LINK_RELIABLE
+        reliable_link_task();
+#endif
     }
 }
 
@@ -188,7 +204,13 @@ void init_serial_link(void) {
     serial_link_connected = false;
     init_serial_link_hal();
     add_remote_objects(remote_objects, sizeof(remote_objects)/sizeof(remote_object_t*));
+    // The matrix is sent before anything else that's written at the same time
+    set_remote_object_priority(REMOTE_OBJECT(keyboard_matrix), 1);
+    init_crc32();
     init_byte_stuffer();
+#ifdef SERIAL_LINK_RELIABLE
+    init_reliable_link();
+#endif
     sdStart(&SD1, &config);
     sdStart(&SD2, &config);
     chEvtObjectInit(&new_data_event);
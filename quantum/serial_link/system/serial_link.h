@@ -35,6 +35,15 @@ bool is_serial_link_master(void);
 host_driver_t* get_serial_link_driver(void);
 void serial_link_update(void);
 
+// The state of the protocol layers is static. The loopback physical layer
+// of the tests runs every simulated half of the keyboard on its own thread,
+// so there it's thread local, to give each of them a copy.
+#ifdef SERIAL_LINK_LOOPBACK
+#define SERIAL_LINK_NODE_LOCAL __thread
+#else
+#define SERIAL_LINK_NODE_LOCAL
+#endif
+
 #if defined(PROTOCOL_CHIBIOS)
 #include "ch.h"
 
@@ -26,6 +26,7 @@ SOFTWARE.
 #include "gmock/gmock.h"
 #include <vector>
 #include <algorithm>
+#include <random>
 extern "C" {
 #include "serial_link/protocol/byte_stuffer.h"
 #include "serial_link/protocol/frame_validator.h"
@@ -35,6 +36,7 @@ extern "C" {
 using testing::_;
 using testing::ElementsAreArray;
 using testing::Args;
+using testing::Invoke;
 
 class ByteStuffer : public ::testing::Test{
 public:
@@ -51,8 +53,20 @@ public:
 
     void send_data(uint8_t link, const uint8_t* data, uint16_t size) {
         std::copy(data, data + size, std::back_inserter(sent_data));
+        send_calls++;
     }
     std::vector<uint8_t> sent_data;
+    int send_calls = 0;
+
+    typedef std::vector<std::vector<uint8_t>> frames_t;
+
+    // Records the received frames instead of checking them
+    void record_frames(frames_t& frames) {
+        EXPECT_CALL(*this, validator_recv_frame(_, _, _))
+            .WillRepeatedly(Invoke([&frames](uint8_t link, uint8_t* data, uint16_t size) {
+                frames.push_back(std::vector<uint8_t>(data, data + size));
+            }));
+    }
 
     static ByteStuffer* Instance;
 };
@@ -481,3 +495,86 @@ TEST_F(ByteStuffer, sends_and_receives_full_roundtrip_254_bytes_and_then_zero) {
        byte_stuffer_recv_byte(1, d);
     }
 }
+
+TEST_F(ByteStuffer, sends_a_frame_with_one_call) {
+    uint8_t original_data[600];
+    for (int i = 0; i < 600; i++) {
+        original_data[i] = i % 100;
+    }
+    byte_stuffer_send_frame(0, original_data, sizeof(original_data));
+    EXPECT_EQ(send_calls, 1);
+}
+
+TEST_F(ByteStuffer, receives_several_frames_from_one_span) {
+    frames_t frames;
+    record_frames(frames);
+    uint8_t first[] = {1, 0, 3};
+    uint8_t second[300];
+    for (int i = 0; i < 300; i++) {
+        second[i] = i;
+    }
+    byte_stuffer_send_frame(0, first, sizeof(first));
+    byte_stuffer_send_frame(0, second, sizeof(second));
+    byte_stuffer_send_frame(0, first, sizeof(first));
+    byte_stuffer_recv_bytes(1, sent_data.data(), sent_data.size());
+    ASSERT_EQ(frames.size(), 3u);
+    EXPECT_THAT(frames[0], ElementsAreArray(first));
+    EXPECT_THAT(frames[1], ElementsAreArray(second));
+    EXPECT_THAT(frames[2], ElementsAreArray(first));
+}
+
+TEST_F(ByteStuffer, receives_frames_split_anywhere_between_spans) {
+    uint8_t original_data[520];
+    for (int i = 0; i < 520; i++) {
+        original_data[i] = i % 7 ? i : 0;
+    }
+    byte_stuffer_send_frame(0, original_data, sizeof(original_data));
+    byte_stuffer_send_frame(0, original_data, 20);
+    for (size_t split = 0; split <= sent_data.size(); split++) {
+        frames_t frames;
+        record_frames(frames);
+        std::vector<uint8_t> span(sent_data);
+        byte_stuffer_recv_bytes(1, span.data(), split);
+        byte_stuffer_recv_bytes(1, span.data() + split, span.size() - split);
+        ASSERT_EQ(frames.size(), 2u) << split;
+        EXPECT_THAT(frames[0], ElementsAreArray(original_data)) << split;
+        EXPECT_THAT(frames[1], ElementsAreArray(original_data, 20)) << split;
+    }
+}
+
+TEST_F(ByteStuffer, receiving_spans_is_the_same_as_receiving_bytes) {
+    std::minstd_rand random(45);
+    for (int round = 0; round < 200; round++) {
+        // Valid frames of all sizes, with random corruption and noise
+        sent_data.clear();
+        for (int frame = 0; frame < 8; frame++) {
+            std::vector<uint8_t> data(random() % (MAX_FRAME_SIZE + 300));
+            for (auto& d : data) {
+                d = random() % 4 ? random() : 0;
+            }
+            byte_stuffer_send_frame(0, data.data(), data.size());
+        }
+        for (int error = random() % 4; error > 0; error--) {
+            sent_data[random() % sent_data.size()] = random() % 3 ? random() : 0;
+        }
+
+        frames_t expected;
+        record_frames(expected);
+        init_byte_stuffer();
+        for (auto d : sent_data) {
+            byte_stuffer_recv_byte(1, d);
+        }
+
+        frames_t frames;
+        record_frames(frames);
+        init_byte_stuffer();
+        std::vector<uint8_t> span(sent_data);
+        size_t pos = 0;
+        while (pos < span.size()) {
+            size_t size = std::min<size_t>(random() % 200, span.size() - pos);
+            byte_stuffer_recv_bytes(1, span.data() + pos, size);
+            pos += size;
+        }
+        ASSERT_EQ(frames, expected) << round;
+    }
+}
@@ -0,0 +1,135 @@
+/*
+The MIT License (MIT)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "gtest/gtest.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+extern "C" {
+#include "serial_link/protocol/crc32.h"
+}
+
+typedef uint32_t (*crc_function)(const uint8_t*, uint32_t);
+
+// The CRC one bit at a time, straight from the definition
+static uint32_t crc32_bitwise(const uint8_t* data, uint32_t size) {
+    uint32_t crc = 0xffffffff;
+    while (size-- != 0) {
+        crc ^= *(data++);
+        for (int i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return crc ^ 0xffffffff;
+}
+
+class Crc32 : public testing::Test {
+public:
+    Crc32() {
+        init_crc32();
+        std::minstd_rand random(44);
+        buffer.resize(4096 + 8);
+        for (auto& byte : buffer) {
+            byte = random();
+        }
+    }
+
+    static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    // The fastest of a few runs, so that the other processes on the host
+    // affect it as little as possible
+    double bytes_per_tick(crc_function crc, uint32_t size) {
+        const int rounds = 64;
+        uint64_t best = UINT64_MAX;
+        volatile uint32_t sink = 0;
+        for (int run = 0; run < 8; run++) {
+            uint64_t start = now();
+            for (int round = 0; round < rounds; round++) {
+                sink = sink + crc(buffer.data(), size);
+            }
+            best = std::min(best, now() - start);
+        }
+        return (double)size * rounds / best;
+    }
+
+    std::vector<uint8_t> buffer;
+};
+
+static const char* tick_name =
+#if defined(__x86_64__) || defined(__i386__)
+    "cycle";
+#else
+    "ns";
+#endif
+
+TEST_F(Crc32, calculates_the_standard_check_value) {
+    const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    EXPECT_EQ(crc32_bitwise(check, sizeof(check)), 0xCBF43926);
+    EXPECT_EQ(crc32_bytewise(check, sizeof(check)), 0xCBF43926);
+    EXPECT_EQ(crc32_slicing4(check, sizeof(check)), 0xCBF43926);
+    EXPECT_EQ(crc32_slicing8(check, sizeof(check)), 0xCBF43926);
+    EXPECT_EQ(crc32_calculate(check, sizeof(check)), 0xCBF43926);
+}
+
+TEST_F(Crc32, empty_data_has_a_zero_crc) {
+    EXPECT_EQ(crc32_bytewise(buffer.data(), 0), 0u);
+    EXPECT_EQ(crc32_slicing4(buffer.data(), 0), 0u);
+    EXPECT_EQ(crc32_slicing8(buffer.data(), 0), 0u);
+}
+
+TEST_F(Crc32, all_implementations_agree_on_every_size_and_alignment) {
+    for (uint32_t offset = 0; offset < 8; offset++) {
+        for (uint32_t size = 0; size <= 300; size++) {
+            const uint8_t* data = buffer.data() + offset;
+            uint32_t expected = crc32_bitwise(data, size);
+            ASSERT_EQ(crc32_bytewise(data, size), expected) << offset << ", " << size;
+            ASSERT_EQ(crc32_slicing4(data, size), expected) << offset << ", " << size;
+            ASSERT_EQ(crc32_slicing8(data, size), expected) << offset << ", " << size;
+            ASSERT_EQ(crc32_calculate(data, size), expected) << offset << ", " << size;
+        }
+    }
+}
+
+TEST_F(Crc32, benchmark) {
+    // The frames between the halves are small, the large size shows the
+    // throughput of the inner loops
+    const uint32_t sizes[] = {12, 64, 4096};
+    for (uint32_t size : sizes) {
+        double bytewise = bytes_per_tick(crc32_bytewise, size);
+        double slicing4 = bytes_per_tick(crc32_slicing4, size);
+        double slicing8 = bytes_per_tick(crc32_slicing8, size);
+        std::cout << size << " bytes, bytes per " << tick_name << ": bytewise " << bytewise
+            << ", slicing by 4 " << slicing4 << ", slicing by 8 " << slicing8 << std::endl;
+        EXPECT_GT(bytewise, 0);
+    }
+}
@@ -29,6 +29,7 @@ extern "C" {
     #include "serial_link/protocol/transport.h"
     #include "serial_link/protocol/byte_stuffer.h"
     #include "serial_link/protocol/frame_router.h"
+    #include "serial_link/protocol/crc32.h"
 }
 
 using testing::_;
@@ -41,6 +42,7 @@ public:
         current_router_buffer(nullptr)
     {
         Instance = this;
+        init_crc32();
         init_byte_stuffer();
     }
 
@@ -26,6 +26,7 @@ SOFTWARE.
 #include "gmock/gmock.h"
 extern "C" {
 #include "serial_link/protocol/frame_validator.h"
+#include "serial_link/protocol/crc32.h"
 }
 
 using testing::_;
@@ -36,6 +37,7 @@ class FrameValidator : public testing::Test {
 public:
     FrameValidator() {
         Instance = this;
+        init_crc32();
     }
 
     ~FrameValidator() {
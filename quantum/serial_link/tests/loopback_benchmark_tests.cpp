@@ -0,0 +1,207 @@
+/*
+The MIT License (MIT)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "gtest/gtest.h"
+#include <chrono>
+#include <iostream>
+extern "C" {
+#include "serial_link/loopback/loopback.h"
+#include "serial_link/protocol/transport.h"
+#include "serial_link/protocol/frame_router.h"
+#include "serial_link/protocol/byte_stuffer.h"
+}
+
+// Runs a keyboard like load on the loopback physical layer, with the links
+// at the usual SERIAL_LINK_BAUD of 562500. Every slave sends its matrix
+// every 2 milliseconds and a larger status object that changes a bit every
+// 8 milliseconds, and the master sends the LEDs to all slaves every 10
+// milliseconds. The latency is the time from the matrix being written on a
+// slave to it being read on the master.
+
+#define BYTES_PER_SECOND (562500 / 10)
+#define SECONDS 1
+
+typedef struct {
+    uint32_t sequence;
+    uint32_t written_at;
+    uint8_t rows[8];
+} matrix_t;
+
+typedef struct {
+    uint8_t data[48];
+} status_t;
+
+SLAVE_TO_MASTER_OBJECT(matrix, matrix_t);
+SLAVE_TO_MASTER_OBJECT(status, status_t);
+MASTER_TO_ALL_SLAVES_OBJECT(leds, uint32_t);
+
+static void add_objects(uint8_t node, void* param) {
+    (void)node;
+    (void)param;
+    remote_object_t* objects[] = {
+        REMOTE_OBJECT(matrix),
+        REMOTE_OBJECT(status),
+        REMOTE_OBJECT(leds),
+    };
+    add_remote_objects(objects, sizeof(objects) / sizeof(remote_object_t*));
+    set_remote_object_priority(REMOTE_OBJECT(matrix), 1);
+}
+
+struct load_t {
+    uint32_t written;
+    uint32_t received;
+    uint64_t total_latency;
+    uint64_t worst_latency;
+    uint32_t last_sequence[LOOPBACK_MAX_NODES];
+    // Matrices older than one the master had already read
+    uint32_t went_back;
+};
+
+static void run_load(uint8_t node, void* param) {
+    load_t* load = (load_t*)param;
+    uint64_t now = loopback_time();
+    if (node == 0) {
+        for (uint8_t slave = 0; slave < LOOPBACK_MAX_NODES - 1; slave++) {
+            matrix_t* matrix = read_matrix(slave);
+            if (matrix && matrix->sequence != load->last_sequence[slave]) {
+                if (matrix->sequence < load->last_sequence[slave]) {
+                    load->went_back++;
+                }
+                load->last_sequence[slave] = matrix->sequence;
+                uint64_t latency = now - matrix->written_at;
+                load->received++;
+                load->total_latency += latency;
+                load->worst_latency = std::max(load->worst_latency, latency);
+            }
+            read_status(slave);
+        }
+        if (now % 10000 == 0) {
+            *begin_write_leds() = now / 10000;
+            end_write_leds();
+        }
+        return;
+    }
+    read_leds();
+    if (now % 2000 == 0) {
+        matrix_t* matrix = begin_write_matrix();
+        matrix->sequence = now / 2000;
+        matrix->written_at = now;
+        matrix->rows[node % 8] ^= 1;
+        end_write_matrix();
+        load->written++;
+    }
+    if (now % 8000 == 0) {
+        status_t* status = begin_write_status();
+        status->data[(now / 8000) % sizeof(status->data)] = now / 8000;
+        end_write_status();
+    }
+}
+
+class LoopbackBenchmark : public testing::Test {
+public:
+    ~LoopbackBenchmark() {
+        loopback_deinit();
+    }
+
+    void run(const char* name, uint8_t nodes, uint32_t bit_errors) {
+        loopback_config_t config = {};
+        config.bytes_per_second = BYTES_PER_SECOND;
+        config.latency = 20;
+        config.bit_errors = bit_errors;
+        config.seed = 3;
+        loopback_init(nodes, &config);
+        for (uint8_t i = 0; i < nodes; i++) {
+            loopback_run_on(i, add_objects, nullptr);
+        }
+        load = load_t();
+        loopback_set_task(run_load, &load);
+        auto start = std::chrono::steady_clock::now();
+        loopback_run_for(SECONDS * 1000000);
+        std::chrono::duration<double> host_time = std::chrono::steady_clock::now() - start;
+
+        uint64_t frames = 0;
+        uint64_t bytes = 0;
+        uint64_t overruns = 0;
+        busiest = 0;
+        for (uint8_t node = 0; node < nodes; node++) {
+            for (uint8_t link = 0; link < NUM_LINKS; link++) {
+                loopback_stats_t stats;
+                loopback_get_stats(node, link, &stats);
+                frames += stats.frames;
+                bytes += stats.delivered;
+                overruns += stats.overruns;
+                // Bytes still on the way at the end don't count, a link
+                // with a backlog can't show more than the speed
+                busiest = std::max(busiest, 100.0 * stats.delivered / (BYTES_PER_SECOND * SECONDS));
+            }
+        }
+        mean_latency = load.received ? (double)load.total_latency / load.received / 1000 : 0;
+        std::cout << name << ": " << frames / SECONDS << " frames/s, " << bytes / SECONDS << " bytes/s, "
+            << busiest << "% of the busiest link, " << overruns << " bytes overrun, matrix latency "
+            << mean_latency << " ms mean, " << load.worst_latency / 1000.0 << " ms worst, "
+            << load.received << " of " << load.written << " updates, "
+            << frames / host_time.count() << " frames per host second" << std::endl;
+        // The master never reads an older matrix after a newer one
+        EXPECT_EQ(load.went_back, 0u);
+    }
+
+    load_t load;
+    double mean_latency;
+    // The percentage of the speed used
+    double busiest;
+};
+
+TEST_F(LoopbackBenchmark, TwoHalves) {
+    run("Two halves", 2, 0);
+    // Apart from the one written at the very end
+    EXPECT_GE(load.received, load.written - 1);
+    EXPECT_LT(mean_latency, 1);
+}
+
+TEST_F(LoopbackBenchmark, TwoSlaves) {
+    run("Two slaves", 3, 0);
+    EXPECT_GE(load.received, load.written - 2);
+    EXPECT_LT(mean_latency, 2);
+}
+
+TEST_F(LoopbackBenchmark, TwoHalvesWithBitErrors) {
+    // One bit in ten thousand, so about every twentieth frame is corrupted
+    run("Two halves, 1e-4 bit errors", 2, 100);
+    EXPECT_GT(load.received, load.written * 95 / 100);
+    EXPECT_LT(mean_latency, 2);
+}
+
+TEST_F(LoopbackBenchmark, TwoSlavesWithBitErrors) {
+    run("Two slaves, 1e-4 bit errors", 3, 100);
+    // A matrix that is retransmitted is often overtaken by the next one,
+    // and the master only sees the latest
+    EXPECT_GT(load.received, load.written * 3 / 4);
+    EXPECT_LT(mean_latency, 4);
+}
+
+TEST_F(LoopbackBenchmark, FourSlavesSaturateTheFirstLink) {
+    // All the matrices go through the link between the master and the first
+    // slave, which can't keep up
+    run("Four slaves", 5, 0);
+    EXPECT_GT(busiest, 95);
+    EXPECT_GT(load.received, 0);
+}
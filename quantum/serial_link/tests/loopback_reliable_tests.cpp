@@ -0,0 +1,112 @@
+/*
+The MIT License (MIT)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "gtest/gtest.h"
+#include <string.h>
+extern "C" {
+#include "serial_link/loopback/loopback.h"
+#include "serial_link/protocol/transport.h"
+#include "serial_link/protocol/frame_router.h"
+}
+
+// The whole stack with SERIAL_LINK_RELIABLE and SERIAL_LINK_DELTA_UPDATES,
+// where every layer adds its bytes to the frames of the transport
+
+typedef struct {
+    uint8_t data[128];
+} large_t;
+
+SLAVE_TO_MASTER_OBJECT(large, large_t);
+
+static void add_objects(uint8_t node, void* param) {
+    (void)node;
+    (void)param;
+    remote_object_t* objects[] = {
+        REMOTE_OBJECT(large),
+    };
+    add_remote_objects(objects, sizeof(objects) / sizeof(remote_object_t*));
+}
+
+class LoopbackReliable : public testing::Test {
+public:
+    ~LoopbackReliable() {
+        loopback_deinit();
+    }
+
+    void start(uint8_t nodes) {
+        loopback_config_t config = {};
+        loopback_init(nodes, &config);
+        for (uint8_t i = 0; i < nodes; i++) {
+            loopback_run_on(i, add_objects, nullptr);
+        }
+    }
+
+    template<typename F>
+    void on(uint8_t node, F f) {
+        loopback_run_on(node, [](uint8_t, void* param) { (*(F*)param)(); }, &f);
+    }
+
+    // Writes the object and returns the size of the frame it was sent as
+    uint32_t write(uint8_t node, const large_t& value) {
+        loopback_stats_t before;
+        loopback_get_stats(node, UP_LINK, &before);
+        on(node, [&value]() {
+            *begin_write_large() = value;
+            end_write_large();
+        });
+        loopback_run_for(5000);
+        loopback_stats_t after;
+        loopback_get_stats(node, UP_LINK, &after);
+        EXPECT_EQ(after.frames, before.frames + 1);
+        return after.bytes - before.bytes;
+    }
+
+    void expect_on_master(uint8_t slave, const large_t& value) {
+        on(0, [slave, &value]() {
+            large_t* large = read_large(slave);
+            ASSERT_NE(large, nullptr);
+            EXPECT_EQ(memcmp(large->data, value.data, sizeof(value.data)), 0);
+        });
+    }
+};
+
+TEST_F(LoopbackReliable, AMaximumSizeDeltaArrivesIntact) {
+    // The second slave's frames are forwarded by the first one
+    start(3);
+    for (uint8_t node = 1; node < 3; node++) {
+        large_t value = {};
+        for (size_t i = 0; i < sizeof(value.data); i++) {
+            value.data[i] = i;
+        }
+        uint32_t full = write(node, value);
+        expect_on_master(node - 1, value);
+        // One run of changed bytes, which with its two byte header is
+        // exactly SERIAL_LINK_DELTA_MAX_SIZE
+        for (size_t i = 10; i < 10 + 62; i++) {
+            value.data[i] ^= 0xFF;
+        }
+        uint32_t delta = write(node, value);
+        EXPECT_LT(delta, full);
+        expect_on_master(node - 1, value);
+    }
+}
@@ -0,0 +1,214 @@
+/*
+The MIT License (MIT)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "gtest/gtest.h"
+#include <vector>
+extern "C" {
+#include "serial_link/loopback/loopback.h"
+#include "serial_link/protocol/transport.h"
+#include "serial_link/protocol/frame_router.h"
+}
+
+// The whole stack runs on the loopback physical layer, with node 0 as the
+// master and the rest as its slaves in a chain. The objects are defined for
+// every node, each of which has its own copy.
+
+typedef struct {
+    uint32_t sequence;
+    uint32_t written_at;
+} keys_t;
+
+SLAVE_TO_MASTER_OBJECT(keys, keys_t);
+MASTER_TO_ALL_SLAVES_OBJECT(leds, uint32_t);
+MASTER_TO_SINGLE_SLAVE_OBJECT(backlight, uint8_t);
+
+static void add_objects(uint8_t node, void* param) {
+    (void)node;
+    (void)param;
+    remote_object_t* objects[] = {
+        REMOTE_OBJECT(keys),
+        REMOTE_OBJECT(leds),
+        REMOTE_OBJECT(backlight),
+    };
+    add_remote_objects(objects, sizeof(objects) / sizeof(remote_object_t*));
+}
+
+class Loopback : public testing::Test {
+public:
+    ~Loopback() {
+        loopback_deinit();
+    }
+
+    void start(uint8_t nodes, loopback_config_t config = loopback_config_t()) {
+        loopback_init(nodes, &config);
+        for (uint8_t i = 0; i < nodes; i++) {
+            loopback_run_on(i, add_objects, nullptr);
+        }
+    }
+
+    // Runs the function on the thread of the node, where its objects are
+    template<typename F>
+    void on(uint8_t node, F f) {
+        loopback_run_on(node, [](uint8_t, void* param) { (*(F*)param)(); }, &f);
+    }
+
+    void write_keys(uint8_t node, uint32_t sequence) {
+        on(node, [sequence]() {
+            keys_t* keys = begin_write_keys();
+            keys->sequence = sequence;
+            keys->written_at = loopback_time();
+            end_write_keys();
+        });
+    }
+
+    // The sequence of the keys of the slave that the master has received, or 0
+    uint32_t read_keys_on_master(uint8_t slave) {
+        uint32_t sequence = 0;
+        on(0, [slave, &sequence]() {
+            keys_t* keys = read_keys(slave);
+            sequence = keys ? keys->sequence : 0;
+        });
+        return sequence;
+    }
+};
+
+TEST_F(Loopback, SlavesReachTheMaster) {
+    start(3);
+    write_keys(1, 10);
+    write_keys(2, 20);
+    loopback_run_for(2000);
+    EXPECT_EQ(read_keys_on_master(0), 10);
+    EXPECT_EQ(read_keys_on_master(1), 20);
+}
+
+TEST_F(Loopback, TheMasterReachesAllSlaves) {
+    start(3);
+    on(0, []() {
+        *begin_write_leds() = 0x1234;
+        end_write_leds();
+    });
+    loopback_run_for(2000);
+    for (uint8_t node = 1; node < 3; node++) {
+        on(node, []() {
+            uint32_t* leds = read_leds();
+            ASSERT_NE(leds, nullptr);
+            EXPECT_EQ(*leds, 0x1234);
+        });
+    }
+}
+
+TEST_F(Loopback, TheMasterReachesASingleSlave) {
+    start(3);
+    on(0, []() {
+        *begin_write_backlight(1) = 7;
+        end_write_backlight(1);
+    });
+    loopback_run_for(2000);
+    on(1, []() {
+        EXPECT_EQ(read_backlight(), nullptr);
+    });
+    on(2, []() {
+        uint8_t* backlight = read_backlight();
+        ASSERT_NE(backlight, nullptr);
+        EXPECT_EQ(*backlight, 7);
+    });
+}
+
+TEST_F(Loopback, TheEndOfALongChainReachesTheMaster) {
+    start(LOOPBACK_MAX_NODES);
+    for (uint8_t node = 1; node < LOOPBACK_MAX_NODES; node++) {
+        write_keys(node, node * 100);
+    }
+    loopback_run_for(5000);
+    for (uint8_t slave = 0; slave < LOOPBACK_MAX_NODES - 1; slave++) {
+        EXPECT_EQ(read_keys_on_master(slave), (slave + 1) * 100);
+    }
+}
+
+TEST_F(Loopback, SpeedAndLatencyDelayTheUpdate) {
+    loopback_config_t config = {};
+    config.bytes_per_second = 1000;
+    config.latency = 5000;
+    start(2, config);
+    write_keys(1, 1);
+    uint64_t received = 0;
+    auto poll = [&received](uint8_t node) {
+        if (node == 0 && !received && read_keys(0)) {
+            received = loopback_time();
+        }
+    };
+    loopback_set_task([](uint8_t node, void* param) { (*(decltype(poll)*)param)(node); }, &poll);
+    loopback_run_for(100000);
+    loopback_stats_t stats;
+    loopback_get_stats(1, UP_LINK, &stats);
+    EXPECT_EQ(stats.frames, 1);
+    // The frame is sent in the first step, and every byte takes a
+    // millisecond. The task of the master runs before the data is received,
+    // so it sees the frame one step after the last byte has arrived.
+    uint64_t arrival = LOOPBACK_STEP + stats.bytes * 1000 + 5000;
+    EXPECT_GE(received, arrival + LOOPBACK_STEP);
+    EXPECT_LE(received, arrival + 2 * LOOPBACK_STEP);
+}
+
+TEST_F(Loopback, BitErrorsDropFrames) {
+    loopback_config_t config = {};
+    config.bit_errors = 2000;
+    config.seed = 17;
+    start(2, config);
+    std::vector<uint32_t> received;
+    auto task = [&received](uint8_t node) {
+        if (node == 1 && loopback_time() % 1000 == 0) {
+            keys_t* keys = begin_write_keys();
+            keys->sequence = loopback_time() / 1000;
+            end_write_keys();
+        } else {
+            keys_t* keys = read_keys(0);
+            if (keys) {
+                received.push_back(keys->sequence);
+            }
+        }
+    };
+    loopback_set_task([](uint8_t node, void* param) { (*(decltype(task)*)param)(node); }, &task);
+    loopback_run_for(1000000);
+    loopback_stats_t stats;
+    loopback_get_stats(1, UP_LINK, &stats);
+    EXPECT_GT(stats.bit_errors, 0);
+    // With about 120 bits per frame, a fifth of them are corrupted
+    EXPECT_LT(received.size(), stats.frames * 9 / 10);
+    EXPECT_GT(received.size(), stats.frames / 2);
+    for (size_t i = 1; i < received.size(); i++) {
+        EXPECT_GT(received[i], received[i - 1]);
+    }
+}
+
+TEST_F(Loopback, SlowLinksOverrun) {
+    loopback_config_t config = {};
+    config.bytes_per_second = 100;
+    start(2, config);
+    for (uint32_t i = 1; i <= 1000; i++) {
+        write_keys(1, i);
+        loopback_run_for(1000);
+    }
+    loopback_stats_t stats;
+    loopback_get_stats(1, UP_LINK, &stats);
+    EXPECT_GT(stats.overruns, 0);
+}
@@ -0,0 +1,332 @@
+/*
+The MIT License (MIT)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "gtest/gtest.h"
+#include <deque>
+#include <iostream>
+#include <random>
+#include <vector>
+extern "C" {
+#include "serial_link/protocol/reliable_link.h"
+#include "serial_link/protocol/byte_stuffer.h"
+#include "serial_link/protocol/frame_router.h"
+#include "serial_link/protocol/physical.h"
+#include "serial_link/protocol/crc32.h"
+}
+
+// The two links of the protocol are connected to each other by a lossy
+// loopback, so link 0 and link 1 act as the two ends of a cable. Time moves
+// in steps of one millisecond.
+
+static uint16_t current_time;
+
+struct sent_bytes {
+    uint16_t arrival;
+    std::vector<uint8_t> bytes;
+};
+
+class ReliableLink : public testing::Test {
+public:
+    ReliableLink() : random(48) {
+        Instance = this;
+        current_time = 0;
+        init_crc32();
+        init_byte_stuffer();
+        init_reliable_link();
+    }
+
+    ~ReliableLink() {
+        Instance = nullptr;
+    }
+
+    void send_data(uint8_t link, const uint8_t* data, uint16_t size) {
+        std::vector<uint8_t> bytes(data, data + size);
+        wire_bytes += size;
+        if (size == RELIABLE_LINK_OVERHEAD + 4 + 2) {
+            pure_acks++;
+        }
+        if (uniform() < frame_loss) {
+            return;
+        }
+        for (auto& byte : bytes) {
+            if (uniform() < byte_error) {
+                byte ^= 1 << (random() % 8);
+            }
+        }
+        wire[link].push_back({(uint16_t)(current_time + latency), bytes});
+    }
+
+    void route_incoming_frame(uint8_t link, uint8_t* data, uint16_t size) {
+        received[link].push_back(std::vector<uint8_t>(data, data + size));
+        received_time[link].push_back(current_time);
+    }
+
+    double uniform() {
+        return std::uniform_real_distribution<double>(0, 1)(random);
+    }
+
+    // Sends a numbered frame of the given size, or queues it until the link
+    // can send it, like the transport does
+    void send(uint8_t link, uint16_t number, uint16_t size = 8) {
+        std::vector<uint8_t> frame(size + RELIABLE_LINK_OVERHEAD + 4);
+        for (uint16_t i = 0; i < size; i++) {
+            frame[i] = number + i;
+        }
+        frame[0] = number;
+        frame[1] = number >> 8;
+        frame.resize(size);
+        sent_time[link].push_back(current_time);
+        waiting[link].push_back(frame);
+        send_waiting(link);
+    }
+
+    void send_waiting(uint8_t link) {
+        while (!waiting[link].empty() && reliable_link_can_send(link, waiting[link].front().size())) {
+            std::vector<uint8_t> frame = waiting[link].front();
+            waiting[link].pop_front();
+            uint16_t size = frame.size();
+            frame.resize(size + RELIABLE_LINK_OVERHEAD + 4);
+            reliable_send_frame(link, frame.data(), size);
+        }
+    }
+
+    static uint16_t number(const std::vector<uint8_t>& frame) {
+        return frame[0] | (frame[1] << 8);
+    }
+
+    // Each millisecond the frames that arrive are received, then the frames
+    // of the step are sent, and then the acknowledgements that couldn't be
+    // sent with them, like the serial link thread does
+    template <typename Step>
+    void run_for(int ms, Step step) {
+        for (int i = 0; i < ms; i++) {
+            current_time++;
+            for (int link = 0; link < 2; link++) {
+                while (!wire[link].empty() && wire[link].front().arrival == current_time) {
+                    sent_bytes sent = wire[link].front();
+                    wire[link].pop_front();
+                    byte_stuffer_recv_bytes(1 - link, sent.bytes.data(), sent.bytes.size());
+                }
+            }
+            send_waiting(0);
+            send_waiting(1);
+            step(i);
+            reliable_link_task();
+        }
+    }
+
+    void run_for(int ms) {
+        run_for(ms, [](int) {});
+    }
+
+    // Every frame sent on the link arrives on the other one, in order
+    void check_delivery(uint8_t link, uint16_t count) {
+        const auto& frames = received[1 - link];
+        ASSERT_GE(frames.size(), count);
+        uint16_t next = 0;
+        for (const auto& frame : frames) {
+            ASSERT_EQ(frame.size(), 8u);
+            // Frames can only be repeated when the receiver was resynced
+            ASSERT_LE(number(frame), next);
+            if (number(frame) == next) {
+                next++;
+            }
+        }
+        EXPECT_EQ(next, count);
+    }
+
+    // The time from sending a frame until it arrives the first time
+    void print_latency(uint8_t link, const char* name) {
+        std::vector<uint16_t> latencies;
+        uint16_t next = 0;
+        for (size_t i = 0; i < received[1 - link].size(); i++) {
+            if (number(received[1 - link][i]) == next) {
+                latencies.push_back(received_time[1 - link][i] - sent_time[link][next]);
+                next++;
+            }
+        }
+        double sum = 0;
+        uint16_t worst = 0;
+        for (auto latency : latencies) {
+            sum += latency;
+            worst = std::max(worst, latency);
+        }
+        reliable_link_stats_t stats;
+        reliable_link_get_stats(link, &stats);
+        std::cout << name << ": mean latency " << sum / latencies.size() << " ms, worst " << worst
+            << " ms, " << stats.retransmits << " retransmits of " << stats.frames_sent
+            << " frames, rtt " << stats.rtt / 8.0 << " ms" << std::endl;
+        max_latency = worst;
+    }
+
+    static ReliableLink* Instance;
+    std::minstd_rand random;
+    double frame_loss = 0;
+    double byte_error = 0;
+    uint16_t latency = 1;
+    std::deque<sent_bytes> wire[2];
+    std::deque<std::vector<uint8_t>> waiting[2];
+    std::vector<std::vector<uint8_t>> received[2];
+    std::vector<uint16_t> received_time[2];
+    std::vector<uint16_t> sent_time[2];
+    uint32_t wire_bytes = 0;
+    uint32_t pure_acks = 0;
+    uint16_t max_latency = 0;
+};
+
+ReliableLink* ReliableLink::Instance = nullptr;
+
+extern "C" {
+void send_data(uint8_t link, const uint8_t* data, uint16_t size) {
+    ReliableLink::Instance->send_data(link, data, size);
+}
+
+void route_incoming_frame(uint8_t link, uint8_t* data, uint16_t size) {
+    ReliableLink::Instance->route_incoming_frame(link, data, size);
+}
+
+uint16_t timer_read(void) {
+    return current_time;
+}
+}
+
+TEST_F(ReliableLink, delivers_frames_without_retransmits_on_a_good_link) {
+    for (int i = 0; i < 100; i++) {
+        send(0, i);
+        run_for(3);
+    }
+    run_for(20);
+    check_delivery(0, 100);
+    reliable_link_stats_t stats;
+    reliable_link_get_stats(0, &stats);
+    EXPECT_EQ(stats.retransmits, 0u);
+    EXPECT_EQ(stats.unreliable, 0u);
+    // A millisecond each way
+    EXPECT_EQ(stats.rtt, 2 * 8);
+    EXPECT_EQ(reliable_link_time_to_next_task(), 0xFFFF);
+}
+
+TEST_F(ReliableLink, acknowledgements_ride_on_the_reverse_traffic) {
+    run_for(100, [this](int i) {
+        send(0, i);
+        send(1, i);
+    });
+    run_for(20);
+    check_delivery(0, 100);
+    check_delivery(1, 100);
+    // Only the last frames in each direction need acknowledgements of their own
+    EXPECT_LE(pure_acks, 4u);
+}
+
+TEST_F(ReliableLink, retransmits_lost_frames) {
+    frame_loss = 0.1;
+    for (int i = 0; i < 1000; i++) {
+        send(0, i);
+        run_for(5);
+    }
+    run_for(1000);
+    check_delivery(0, 1000);
+    reliable_link_stats_t stats;
+    reliable_link_get_stats(0, &stats);
+    EXPECT_GT(stats.retransmits, 0u);
+    EXPECT_EQ(stats.unreliable, 0u);
+    reliable_link_get_stats(1, &stats);
+    EXPECT_GT(stats.out_of_order + stats.duplicates, 0u);
+    print_latency(0, "10% frame loss");
+    EXPECT_LT(max_latency, 100);
+}
+
+TEST_F(ReliableLink, retransmits_corrupted_frames) {
+    byte_error = 0.005;
+    latency = 2;
+    for (int i = 0; i < 1000; i++) {
+        send(0, i);
+        send(1, i);
+        run_for(5);
+    }
+    run_for(1000);
+    check_delivery(0, 1000);
+    check_delivery(1, 1000);
+    print_latency(0, "0.5% byte errors");
+    EXPECT_LT(max_latency, 100);
+}
+
+TEST_F(ReliableLink, large_frames_are_sent_without_retransmits) {
+    send(0, 1, SERIAL_LINK_RELIABLE_MAX_FRAME + 1);
+    run_for(10);
+    ASSERT_EQ(received[1].size(), 1u);
+    EXPECT_EQ(received[1][0].size(), SERIAL_LINK_RELIABLE_MAX_FRAME + 1);
+    reliable_link_stats_t stats;
+    reliable_link_get_stats(0, &stats);
+    EXPECT_EQ(stats.unreliable, 1u);
+}
+
+TEST_F(ReliableLink, large_frames_wait_for_the_queued_frames) {
+    frame_loss = 1;
+    send(0, 0);
+    run_for(1);
+    EXPECT_FALSE(reliable_link_can_send(0, SERIAL_LINK_RELIABLE_MAX_FRAME + 1));
+    send(0, 1, SERIAL_LINK_RELIABLE_MAX_FRAME + 1);
+    run_for(10);
+    frame_loss = 0;
+    run_for(200);
+    // The retransmitted frame doesn't arrive after the newer one
+    ASSERT_EQ(received[1].size(), 2u);
+    EXPECT_EQ(number(received[1][0]), 0);
+    EXPECT_EQ(number(received[1][1]), 1);
+    EXPECT_EQ(received[1][1].size(), SERIAL_LINK_RELIABLE_MAX_FRAME + 1);
+}
+
+TEST_F(ReliableLink, frames_that_would_overtake_the_queue_are_dropped) {
+    frame_loss = 1;
+    for (int i = 0; i < SERIAL_LINK_RETRANSMIT_QUEUE; i++) {
+        send(0, i);
+    }
+    EXPECT_FALSE(reliable_link_can_send(0, 8));
+    uint8_t frame[8 + RELIABLE_LINK_OVERHEAD + 4] = {SERIAL_LINK_RETRANSMIT_QUEUE};
+    reliable_send_frame(0, frame, 8);
+    run_for(10);
+    frame_loss = 0;
+    run_for(500);
+    check_delivery(0, SERIAL_LINK_RETRANSMIT_QUEUE);
+    reliable_link_stats_t stats;
+    reliable_link_get_stats(0, &stats);
+    EXPECT_EQ(stats.dropped, 1u);
+    EXPECT_EQ(stats.unreliable, 0u);
+}
+
+TEST_F(ReliableLink, recovers_from_a_dead_link) {
+    send(0, 0);
+    run_for(10);
+    frame_loss = 1;
+    for (int i = 1; i < 4; i++) {
+        send(0, i);
+        run_for(1);
+    }
+    run_for(500);
+    frame_loss = 0;
+    uint16_t restored = current_time;
+    run_for(1000);
+    check_delivery(0, 4);
+    // Backed off, but not by more than the maximum timeout
+    EXPECT_LE(received_time[1].back() - restored, 8 * SERIAL_LINK_MAX_RETRANSMIT_TIMEOUT);
+}
@@ -4,12 +4,21 @@ serial_link_byte_stuffer_SRC :=\
 
 serial_link_frame_validator_SRC := \
 	$(SERIAL_PATH)/tests/frame_validator_tests.cpp \
-	$(SERIAL_PATH)/protocol/frame_validator.c 
+	$(SERIAL_PATH)/protocol/frame_validator.c \
+	$(SERIAL_PATH)/protocol/crc32.c
+
+serial_link_crc32_SRC := \
+	$(SERIAL_PATH)/tests/crc32_tests.cpp \
+	$(SERIAL_PATH)/protocol/crc32.c
+
+# All the tables, so that every implementation can be tested
+serial_link_crc32_DEFS := -DSERIAL_LINK_CRC_SLICING=8
 
 serial_link_frame_router_SRC := \
 	$(SERIAL_PATH)/tests/frame_router_tests.cpp \
 	$(SERIAL_PATH)/protocol/byte_stuffer.c \
 	$(SERIAL_PATH)/protocol/frame_validator.c \
+	$(SERIAL_PATH)/protocol/crc32.c \
 	$(SERIAL_PATH)/protocol/frame_router.c
 
 serial_link_triple_buffered_object_SRC := \
@@ -20,3 +29,56 @@ serial_link_transport_SRC := \
 	$(SERIAL_PATH)/tests/transport_tests.cpp \
 	$(SERIAL_PATH)/protocol/transport.c \
 	$(SERIAL_PATH)/protocol/triple_buffered_object.c 
+
+serial_link_transport_delta_SRC := \
+	$(SERIAL_PATH)/tests/transport_delta_tests.cpp \
+	$(SERIAL_PATH)/protocol/transport.c \
+	$(SERIAL_PATH)/protocol/triple_buffered_object.c
+serial_link_transport_delta_DEFS := -DSERIAL_LINK_DELTA_UPDATES
+
+serial_link_reliable_link_SRC := \
+	$(SERIAL_PATH)/tests/reliable_link_tests.cpp \
+	$(SERIAL_PATH)/protocol/reliable_link.c \
+	$(SERIAL_PATH)/protocol/byte_stuffer.c \
+	$(SERIAL_PATH)/protocol/frame_validator.c \
+	$(SERIAL_PATH)/protocol/crc32.c
+serial_link_reliable_link_DEFS := -DSERIAL_LINK_RELIABLE -DSERIAL_LINK_RETRANSMIT_QUEUE=16
+
+# The same tests with the default queue, which fills up more often
+serial_link_reliable_link_default_queue_SRC := $(serial_link_reliable_link_SRC)
+serial_link_reliable_link_default_queue_DEFS := -DSERIAL_LINK_RELIABLE
+
+serial_link_loopback_SRC := \
+	$(SERIAL_PATH)/tests/loopback_tests.cpp \
+	$(SERIAL_PATH)/loopback/loopback.c \
+	$(SERIAL_PATH)/protocol/byte_stuffer.c \
+	$(SERIAL_PATH)/protocol/frame_validator.c \
+	$(SERIAL_PATH)/protocol/crc32.c \
+	$(SERIAL_PATH)/protocol/frame_router.c \
+	$(SERIAL_PATH)/protocol/transport.c \
+	$(SERIAL_PATH)/protocol/triple_buffered_object.c
+serial_link_loopback_DEFS := -DSERIAL_LINK_LOOPBACK
+
+serial_link_loopback_benchmark_SRC := \
+	$(SERIAL_PATH)/tests/loopback_benchmark_tests.cpp \
+	$(SERIAL_PATH)/loopback/loopback.c \
+	$(SERIAL_PATH)/protocol/byte_stuffer.c \
+	$(SERIAL_PATH)/protocol/frame_validator.c \
+	$(SERIAL_PATH)/protocol/crc32.c \
+	$(SERIAL_PATH)/protocol/frame_router.c \
+	$(SERIAL_PATH)/protocol/reliable_link.c \
+	$(SERIAL_PATH)/protocol/transport.c \
+	$(SERIAL_PATH)/protocol/triple_buffered_object.c
+serial_link_loopback_benchmark_DEFS := -DSERIAL_LINK_LOOPBACK -DSERIAL_LINK_RELIABLE -DSERIAL_LINK_DELTA_UPDATES
+
+serial_link_loopback_reliable_SRC := \
+	$(SERIAL_PATH)/tests/loopback_reliable_tests.cpp \
+	$(SERIAL_PATH)/loopback/loopback.c \
+	$(SERIAL_PATH)/protocol/byte_stuffer.c \
+	$(SERIAL_PATH)/protocol/frame_validator.c \
+	$(SERIAL_PATH)/protocol/crc32.c \
+	$(SERIAL_PATH)/protocol/frame_router.c \
+	$(SERIAL_PATH)/protocol/reliable_link.c \
+	$(SERIAL_PATH)/protocol/transport.c \
+	$(SERIAL_PATH)/protocol/triple_buffered_object.c
+serial_link_loopback_reliable_DEFS := -DSERIAL_LINK_LOOPBACK -DSERIAL_LINK_RELIABLE -DSERIAL_LINK_DELTA_UPDATES
@@ -1,6 +1,13 @@
 TEST_LIST +=\
 	serial_link_byte_stuffer\
 	serial_link_frame_validator\
+	serial_link_crc32\
 	serial_link_frame_router\
+	serial_link_reliable_link\
+	serial_link_reliable_link_default_queue\
 	serial_link_triple_buffered_object\
-	serial_link_transport
\ No newline at end of file
+	serial_link_transport\
+	serial_link_transport_delta\
+	serial_link_loopback\
+	serial_link_loopback_reliable\
+	serial_link_loopback_benchmark
\ No newline at end of file
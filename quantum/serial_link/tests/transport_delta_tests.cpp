@@ -0,0 +1,244 @@
+/*
+The MIT License (MIT)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include <random>
+
+using testing::_;
+using testing::AnyNumber;
+
+extern "C" {
+#include "serial_link/protocol/transport.h"
+}
+
+struct large_object {
+    uint8_t data[40];
+};
+
+MASTER_TO_ALL_SLAVES_OBJECT(master_to_slave, large_object);
+SLAVE_TO_MASTER_OBJECT(slave_to_master, large_object);
+
+static remote_object_t* test_remote_objects[] = {
+    REMOTE_OBJECT(master_to_slave),
+    REMOTE_OBJECT(slave_to_master),
+};
+
+class TransportDelta : public testing::Test {
+public:
+    TransportDelta() {
+        Instance = this;
+        add_remote_objects(test_remote_objects, sizeof(test_remote_objects) / sizeof(remote_object_t*));
+        EXPECT_CALL(*this, signal_data_written()).Times(AnyNumber());
+    }
+
+    ~TransportDelta() {
+        Instance = nullptr;
+        reinitialize_serial_link_transport();
+    }
+
+    MOCK_METHOD0(signal_data_written, void ());
+
+    void router_send_frame(uint8_t destination, uint8_t* data, uint16_t size) {
+        frames.push_back(std::vector<uint8_t>(data, data + size));
+    }
+
+    // Writes the object and returns the frame it's sent as
+    std::vector<uint8_t> send(const large_object& value) {
+        *begin_write_master_to_slave() = value;
+        end_write_master_to_slave();
+        frames.clear();
+        update_transport();
+        EXPECT_EQ(frames.size(), 1u);
+        return frames.empty() ? std::vector<uint8_t>() : frames[0];
+    }
+
+    bool receive(std::vector<uint8_t> frame, large_object& value) {
+        transport_recv_frame(0, frame.data(), frame.size());
+        large_object* obj = read_master_to_slave();
+        if (obj) {
+            value = *obj;
+        }
+        return obj != nullptr;
+    }
+
+    static TransportDelta* Instance;
+    std::vector<std::vector<uint8_t>> frames;
+};
+
+TransportDelta* TransportDelta::Instance = nullptr;
+
+extern "C" {
+void signal_data_written(void) {
+    TransportDelta::Instance->signal_data_written();
+}
+
+void router_send_frame(uint8_t destination, uint8_t* data, uint16_t size) {
+    TransportDelta::Instance->router_send_frame(destination, data, size);
+}
+
+bool router_can_send(uint8_t destination, uint16_t size) {
+    return true;
+}
+
+uint16_t timer_read(void) {
+    return 0;
+}
+}
+
+static bool operator==(const large_object& a, const large_object& b) {
+    return memcmp(a.data, b.data, sizeof(a.data)) == 0;
+}
+
+TEST_F(TransportDelta, first_version_is_sent_in_full) {
+    large_object value = {};
+    value.data[3] = 7;
+    std::vector<uint8_t> frame = send(value);
+    EXPECT_EQ(frame.size(), sizeof(large_object) + 2);
+    large_object received = {};
+    EXPECT_TRUE(receive(frame, received));
+    EXPECT_TRUE(received == value);
+}
+
+TEST_F(TransportDelta, small_change_is_sent_as_a_delta) {
+    large_object value = {};
+    large_object received = {};
+    receive(send(value), received);
+    value.data[10] = 1;
+    value.data[11] = 2;
+    value.data[39] = 3;
+    std::vector<uint8_t> frame = send(value);
+    // Two runs, and the versions and the id
+    EXPECT_EQ(frame.size(), 2u + 2 + 2 + 1 + 3);
+    EXPECT_TRUE(receive(frame, received));
+    EXPECT_TRUE(received == value);
+
+    // An unchanged object is an empty delta
+    frame = send(value);
+    EXPECT_EQ(frame.size(), 3u);
+    EXPECT_TRUE(receive(frame, received));
+    EXPECT_TRUE(received == value);
+}
+
+TEST_F(TransportDelta, large_change_is_sent_in_full) {
+    large_object value = {};
+    large_object received = {};
+    receive(send(value), received);
+    for (int i = 0; i < 40; i += 2) {
+        value.data[i] = i + 1;
+    }
+    std::vector<uint8_t> frame = send(value);
+    EXPECT_EQ(frame.size(), sizeof(large_object) + 2);
+    EXPECT_TRUE(receive(frame, received));
+    EXPECT_TRUE(received == value);
+}
+
+TEST_F(TransportDelta, deltas_after_a_lost_frame_are_ignored_until_a_full_version) {
+    large_object value = {};
+    large_object received = {};
+    receive(send(value), received);
+    value.data[0] = 1;
+    // Lost
+    send(value);
+    int ignored = 0;
+    for (int i = 2; i < 20; i++) {
+        value.data[0] = i;
+        std::vector<uint8_t> frame = send(value);
+        if (receive(frame, received)) {
+            EXPECT_EQ(frame.size(), sizeof(large_object) + 2);
+            EXPECT_TRUE(received == value);
+            break;
+        }
+        ignored++;
+    }
+    EXPECT_GT(ignored, 0);
+    EXPECT_LT(ignored, 10);
+    value.data[1] = 1;
+    EXPECT_TRUE(receive(send(value), received));
+    EXPECT_TRUE(received == value);
+}
+
+TEST_F(TransportDelta, corrupted_delta_is_not_applied) {
+    large_object value = {};
+    large_object received = {};
+    receive(send(value), received);
+    value.data[5] = 1;
+    std::vector<uint8_t> frame = send(value);
+    // The run goes past the end of the object
+    frame[0] = 40;
+    EXPECT_FALSE(receive(frame, received));
+    value.data[5] = 2;
+    EXPECT_FALSE(receive(send(value), received));
+}
+
+TEST_F(TransportDelta, every_slave_has_its_own_previous_version) {
+    // The frames of two slaves, each from a new sender
+    large_object values[2][3] = {};
+    std::vector<std::vector<uint8_t>> sent[2];
+    for (int slave = 0; slave < 2; slave++) {
+        reinitialize_serial_link_transport();
+        add_remote_objects(test_remote_objects, 2);
+        for (int i = 0; i < 3; i++) {
+            values[slave][i].data[slave] = 1;
+            values[slave][i].data[10 + slave] = i;
+            *begin_write_slave_to_master() = values[slave][i];
+            end_write_slave_to_master();
+            frames.clear();
+            update_transport();
+            ASSERT_EQ(frames.size(), 1u);
+            sent[slave].push_back(frames[0]);
+        }
+    }
+    EXPECT_LT(sent[0][2].size(), sizeof(large_object));
+
+    reinitialize_serial_link_transport();
+    add_remote_objects(test_remote_objects, 2);
+    for (int i = 0; i < 3; i++) {
+        for (int slave = 0; slave < 2; slave++) {
+            transport_recv_frame(slave + 1, sent[slave][i].data(), sent[slave][i].size());
+            large_object* obj = read_slave_to_master(slave);
+            ASSERT_NE(obj, nullptr);
+            EXPECT_TRUE(*obj == values[slave][i]) << slave << ", " << i;
+        }
+    }
+}
+
+TEST_F(TransportDelta, random_changes_with_lost_frames_arrive_intact) {
+    std::minstd_rand random(46);
+    large_object value = {};
+    large_object received = {};
+    int delivered = 0;
+    for (int i = 0; i < 2000; i++) {
+        for (int changes = random() % 6; changes > 0; changes--) {
+            value.data[random() % sizeof(value.data)] = random();
+        }
+        std::vector<uint8_t> frame = send(value);
+        if (random() % 8 == 0) {
+            continue;
+        }
+        if (receive(frame, received)) {
+            ASSERT_TRUE(received == value) << i;
+            delivered++;
+        }
+    }
+    EXPECT_GT(delivered, 1000);
+}
@@ -28,6 +28,7 @@ SOFTWARE.
 using testing::_;
 using testing::ElementsAreArray;
 using testing::Args;
+using testing::InSequence;
 
 extern "C" {
 #include "serial_link/protocol/transport.h"
@@ -61,6 +62,10 @@ public:
 
     ~Transport() {
         Instance = nullptr;
+        for (auto obj : test_remote_objects) {
+            set_remote_object_priority(obj, 0);
+            set_remote_object_min_interval(obj, 0);
+        }
         reinitialize_serial_link_transport();
     }
 
@@ -73,10 +78,14 @@ public:
     }
 
     static Transport* Instance;
+    static uint16_t time;
 
     std::vector<uint8_t> sent_data;
+    bool link_busy = false;
 };
 
+uint16_t Transport::time = 0;
+
 Transport* Transport::Instance = nullptr;
 
 extern "C" {
@@ -87,6 +96,14 @@ void signal_data_written(void) {
 void router_send_frame(uint8_t destination, uint8_t* data, uint16_t size) {
     Transport::Instance->router_send_frame(destination, data, size);
 }
+
+bool router_can_send(uint8_t destination, uint16_t size) {
+    return !Transport::Instance->link_busy;
+}
+
+uint16_t timer_read(void) {
+    return Transport::time;
+}
 }
 
 TEST_F(Transport, write_to_local_signals_an_event) {
@@ -186,3 +203,90 @@ TEST_F(Transport, ignores_object_with_size_too_big) {
     test_object1* obj2 = read_master_to_slave();
     EXPECT_EQ(obj2, nullptr);
 }
+
+TEST_F(Transport, sends_only_the_written_objects) {
+    update_transport();
+    begin_write_slave_to_master()->test = 3;
+    EXPECT_CALL(*this, signal_data_written());
+    end_write_slave_to_master();
+    EXPECT_CALL(*this, router_send_frame(0));
+    update_transport();
+    EXPECT_CALL(*this, router_send_frame(_)).Times(0);
+    update_transport();
+}
+
+TEST_F(Transport, sends_higher_priority_objects_first) {
+    update_transport();
+    set_remote_object_priority(REMOTE_OBJECT(slave_to_master), 2);
+    set_remote_object_priority(REMOTE_OBJECT(master_to_single_slave), 1);
+    EXPECT_CALL(*this, signal_data_written()).Times(3);
+    begin_write_master_to_slave()->test = 1;
+    end_write_master_to_slave();
+    begin_write_master_to_single_slave(2)->test = 2;
+    end_write_master_to_single_slave(2);
+    begin_write_slave_to_master()->test = 3;
+    end_write_slave_to_master();
+    {
+        InSequence sequence;
+        EXPECT_CALL(*this, router_send_frame(0));
+        EXPECT_CALL(*this, router_send_frame(3));
+        EXPECT_CALL(*this, router_send_frame(0xFF));
+    }
+    update_transport();
+}
+
+TEST_F(Transport, rate_limit_sends_only_the_latest_value) {
+    update_transport();
+    time = 1000;
+    set_remote_object_min_interval(REMOTE_OBJECT(master_to_slave), 10);
+    EXPECT_CALL(*this, signal_data_written()).Times(3);
+    begin_write_master_to_slave()->test = 1;
+    end_write_master_to_slave();
+    EXPECT_CALL(*this, router_send_frame(0xFF));
+    update_transport();
+    EXPECT_EQ(transport_time_to_next_update(), 0xFFFF);
+
+    time += 4;
+    begin_write_master_to_slave()->test = 2;
+    end_write_master_to_slave();
+    begin_write_master_to_slave()->test = 3;
+    end_write_master_to_slave();
+    EXPECT_CALL(*this, router_send_frame(_)).Times(0);
+    update_transport();
+    EXPECT_EQ(transport_time_to_next_update(), 6);
+
+    time += 6;
+    sent_data.clear();
+    EXPECT_CALL(*this, router_send_frame(0xFF));
+    update_transport();
+    transport_recv_frame(0, sent_data.data(), sent_data.size());
+    test_object1* obj = read_master_to_slave();
+    ASSERT_NE(obj, nullptr);
+    EXPECT_EQ(obj->test, 3);
+}
+
+TEST_F(Transport, objects_are_kept_until_the_link_is_not_busy) {
+    update_transport();
+    EXPECT_CALL(*this, signal_data_written()).Times(2);
+    begin_write_slave_to_master()->test = 1;
+    end_write_slave_to_master();
+    link_busy = true;
+    EXPECT_CALL(*this, router_send_frame(_)).Times(0);
+    update_transport();
+    // It waits for the link instead of a timer
+    EXPECT_EQ(transport_time_to_next_update(), 0xFFFF);
+
+    begin_write_slave_to_master()->test = 2;
+    end_write_slave_to_master();
+    update_transport();
+
+    link_busy = false;
+    EXPECT_CALL(*this, router_send_frame(0));
+    update_transport();
+    transport_recv_frame(1, sent_data.data(), sent_data.size());
+    test_object1* obj = read_slave_to_master(0);
+    ASSERT_NE(obj, nullptr);
+    EXPECT_EQ(obj->test, 2);
+    EXPECT_CALL(*this, router_send_frame(_)).Times(0);
+    update_transport();
+}
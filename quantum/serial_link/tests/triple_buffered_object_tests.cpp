@@ -23,6 +23,8 @@ SOFTWARE.
 */
 
 #include "gtest/gtest.h"
+#include <atomic>
+#include <thread>
 extern "C" {
 #include "serial_link/protocol/triple_buffered_object.h"
 }
@@ -82,3 +84,54 @@ TEST_F(TripleBufferedObject, performs_two_writes_in_the_middle_of_read) {
     EXPECT_EQ(*triple_buffer_read(&test_object), 3);
     EXPECT_EQ(triple_buffer_read(&test_object), nullptr);
 }
+
+struct stress_object {
+    uint8_t state;
+    struct {
+        uint32_t values[16];
+    } buffer[3];
+};
+
+TEST_F(TripleBufferedObject, reader_and_writer_on_different_threads) {
+    static stress_object object;
+    triple_buffer_init((triple_buffer_object_t*)&object);
+    const uint32_t writes = 200000;
+    std::atomic<bool> done(false);
+    std::thread writer([&]() {
+        for (uint32_t i = 1; i <= writes; i++) {
+            auto* data = triple_buffer_begin_write(&object);
+            for (auto& value : data->values) {
+                value = i;
+            }
+            triple_buffer_end_write(&object);
+            if (i % 64 == 0) {
+                std::this_thread::yield();
+            }
+        }
+        done = true;
+    });
+
+    uint32_t last = 0;
+    uint32_t reads = 0;
+    bool finished = false;
+    while (!finished) {
+        finished = done;
+        auto* data = triple_buffer_read(&object);
+        if (data) {
+            // Never a partly written object, and never an old one
+            uint32_t first = data->values[0];
+            for (auto value : data->values) {
+                ASSERT_EQ(value, first);
+            }
+            ASSERT_GT(first, last);
+            last = first;
+            reads++;
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+    writer.join();
+    EXPECT_EQ(last, writes);
+    EXPECT_GT(reads, 1u);
+}
@@ -0,0 +1,312 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * WARNING: be careful changing this code, it is very timing dependent
+ */
+
+#ifndef F_CPU
+#define F_CPU 16000000
+#endif
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+#include <string.h>
+#include <stdbool.h>
+#include "serial.h"
+
+#ifndef USE_I2C
+
+// Cycles per bit, minus the cycles spent around the delay in the bit loops
+#define SERIAL_BIT_CYCLES (F_CPU / SERIAL_BAUD)
+#define SERIAL_LOOP_CYCLES 8
+_Static_assert(SERIAL_BIT_CYCLES > 4 * SERIAL_LOOP_CYCLES, "SERIAL_BAUD is too high for F_CPU");
+
+// A poll of the pin while waiting for an edge takes about 8 cycles
+#define SERIAL_POLLS(us) ((uint16_t)((F_CPU / 1000000UL) * (us) / 8))
+#define SERIAL_POLLS_PER_BIT (SERIAL_BIT_CYCLES / 8)
+
+volatile uint8_t serial_master_buffer[SERIAL_MASTER_BUFFER_LENGTH] = {0};
+volatile uint8_t serial_slave_buffer[SERIAL_SLAVE_BUFFER_LENGTH] = {0};
+
+#define SLAVE_DATA_CORRUPT (1<<0)
+#define SLAVE_DATA_RECEIVED (1<<1)
+static volatile uint8_t status = 0;
+static volatile uint8_t received_length = 0;
+
+inline static
+void serial_delay(void) {
+  __builtin_avr_delay_cycles(SERIAL_BIT_CYCLES - SERIAL_LOOP_CYCLES);
+}
+
+inline static
+void serial_delay_half(void) {
+  __builtin_avr_delay_cycles(SERIAL_BIT_CYCLES / 2 - SERIAL_LOOP_CYCLES);
+}
+
+inline static
+void serial_output(void) {
+  SERIAL_PIN_DDR |= SERIAL_PIN_MASK;
+}
+
+// make the serial pin an input with pull-up resistor
+inline static
+void serial_input(void) {
+  SERIAL_PIN_DDR  &= ~SERIAL_PIN_MASK;
+  SERIAL_PIN_PORT |= SERIAL_PIN_MASK;
+}
+
+inline static
+uint8_t serial_read_pin(void) {
+  return !!(SERIAL_PIN_INPUT & SERIAL_PIN_MASK);
+}
+
+inline static
+void serial_low(void) {
+  SERIAL_PIN_PORT &= ~SERIAL_PIN_MASK;
+}
+
+inline static
+void serial_high(void) {
+  SERIAL_PIN_PORT |= SERIAL_PIN_MASK;
+}
+
+void serial_master_init(void) {
+  serial_output();
+  serial_high();
+}
+
+void serial_slave_init(void) {
+  serial_input();
+
+  // Trigger on falling edge, and don't act on an edge from before the init
+  EICRA = (EICRA & ~(_BV(SERIAL_PIN_ISC0) | _BV(SERIAL_PIN_ISC1))) | _BV(SERIAL_PIN_ISC1);
+  EIFR = _BV(SERIAL_PIN_INTF);
+  EIMSK |= _BV(SERIAL_PIN_INT);
+}
+
+// Waits for the line to reach level, returns false on timeout
+static
+bool serial_wait(uint8_t level, uint16_t polls) {
+  while (serial_read_pin() != level) {
+    if (!polls--) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Reads a byte, LSB first, returns false if no start bit arrives in time
+// or the stop bit is missing. Returns in the middle of the stop bit.
+static
+bool serial_read_byte(uint8_t *data, uint16_t polls) {
+  if (!serial_wait(0, polls)) {
+    return false;
+  }
+  serial_delay_half();
+  if (serial_read_pin()) {
+    // just a glitch
+    return false;
+  }
+
+  uint8_t byte = 0;
+  for (uint8_t i = 0; i < 8; ++i) {
+    serial_delay();
+    byte >>= 1;
+    if (serial_read_pin()) {
+      byte |= 0x80;
+    }
+  }
+  serial_delay();
+  if (!serial_read_pin()) {
+    return false;
+  }
+  *data = byte;
+  return true;
+}
+
+// Sends a byte, LSB first, the pin has to be an output
+static
+void serial_write_byte(uint8_t data) {
+  serial_low();
+  serial_delay();
+  for (uint8_t i = 0; i < 8; ++i) {
+    if (data & 1) {
+      serial_high();
+    } else {
+      serial_low();
+    }
+    data >>= 1;
+    serial_delay();
+  }
+  serial_high();
+  serial_delay();
+}
+
+// The checksum of a frame, which covers the length and the data
+static
+uint8_t serial_frame_crc(const uint8_t *data, uint8_t length) {
+  uint8_t crc = split_crc8(0, &length, 1);
+  return split_crc8(crc, data, length);
+}
+
+// Sends a frame, the line is driven high for a bit before the first start bit.
+// The checksum is computed by the caller before the transaction starts, there
+// is no time for it once the other side waits for the first byte.
+static
+void serial_write_frame(const uint8_t *data, uint8_t length, uint8_t crc) {
+  serial_output();
+  serial_high();
+  serial_delay();
+  serial_write_byte(length);
+  for (uint8_t i = 0; i < length; ++i) {
+    serial_write_byte(data[i]);
+  }
+  serial_write_byte(crc);
+}
+
+// Receives a frame, the bytes are only checked once all of them are in
+static
+int serial_read_frame(uint8_t *data, uint8_t max_length, uint8_t *length, uint16_t polls) {
+  uint8_t received;
+  uint8_t crc;
+  if (!serial_read_byte(&received, polls)) {
+    return SERIAL_NO_RESPONSE;
+  }
+  if (received > max_length) {
+    return SERIAL_DATA_CORRUPT;
+  }
+  for (uint8_t i = 0; i < received; ++i) {
+    if (!serial_read_byte(&data[i], 2 * SERIAL_POLLS_PER_BIT)) {
+      return SERIAL_DATA_CORRUPT;
+    }
+  }
+  if (!serial_read_byte(&crc, 2 * SERIAL_POLLS_PER_BIT)) {
+    return SERIAL_DATA_CORRUPT;
+  }
+
+  if (serial_frame_crc(data, received) != crc) {
+    return SERIAL_DATA_CORRUPT;
+  }
+  *length = received;
+  return SERIAL_OK;
+}
+
+// interrupt handle to be used by the slave device
+ISR(SERIAL_PIN_INTERRUPT) {
+  uint8_t request[SERIAL_MASTER_BUFFER_LENGTH];
+  uint8_t response[SERIAL_SLAVE_BUFFER_LENGTH];
+  uint8_t length = 0;
+  uint8_t response_length = 0;
+
+  // acknowledge the transaction, the master starts sending a bit after the release
+  serial_output();
+  serial_low();
+  serial_delay();
+  serial_delay();
+  serial_input();
+
+  int result = serial_read_frame(request, sizeof(request), &length, 4 * SERIAL_POLLS_PER_BIT);
+  if (result == SERIAL_OK) {
+    response_length = serial_slave_respond(request, length, response);
+    memcpy((uint8_t*)serial_master_buffer, request, length);
+    received_length = length;
+    status = (status & ~SLAVE_DATA_CORRUPT) | SLAVE_DATA_RECEIVED;
+  } else {
+    status |= SLAVE_DATA_CORRUPT;
+  }
+
+  if (result != SERIAL_NO_RESPONSE) {
+    // an empty response tells the master its request was rejected, the
+    // master allows SERIAL_RESPONSE_TIMEOUT for the checksum
+    serial_write_frame(response, response_length, serial_frame_crc(response, response_length));
+  }
+
+  serial_input(); // end transaction
+
+  // the edges of the transaction itself must not trigger another one
+  EIFR = _BV(SERIAL_PIN_INTF);
+}
+
+uint8_t serial_slave_receive(uint8_t *request) {
+  uint8_t length = 0;
+  uint8_t sreg = SREG;
+  cli();
+  if (status & SLAVE_DATA_RECEIVED) {
+    length = received_length;
+    memcpy(request, (uint8_t*)serial_master_buffer, length);
+    status &= ~SLAVE_DATA_RECEIVED;
+  }
+  SREG = sreg;
+  return length;
+}
+
+bool serial_slave_data_corrupt(void) {
+  return status & SLAVE_DATA_CORRUPT;
+}
+
+// Sends the request in serial_master_buffer to the slave, and receives
+// its response in serial_slave_buffer.
+//
+// Returns:
+// SERIAL_OK => no error
+// SERIAL_NO_RESPONSE => slave did not respond
+// SERIAL_DATA_CORRUPT => the request or the response was corrupted
+int serial_update_buffers(uint8_t master_length, uint8_t *slave_length) {
+  // the slave only waits a few bits for the first byte after its acknowledge
+  uint8_t crc = serial_frame_crc((const uint8_t*)serial_master_buffer, master_length);
+
+  // this code is very time dependent, so we need to disable interrupts
+  uint8_t sreg = SREG;
+  cli();
+
+  // signal to the slave that we want to start a transaction
+  serial_output();
+  serial_low();
+  _delay_us(1);
+
+  // wait for the slave to acknowledge, and for the end of its pulse
+  serial_input();
+  if (!serial_wait(0, SERIAL_POLLS(SERIAL_ACK_TIMEOUT)) ||
+      !serial_wait(1, 4 * SERIAL_POLLS_PER_BIT)) {
+    // slave failed to pull the line low, assume not present
+    serial_output();
+    serial_high();
+    SREG = sreg;
+    return SERIAL_NO_RESPONSE;
+  }
+
+  serial_write_frame((const uint8_t*)serial_master_buffer, master_length, crc);
+
+  serial_input();
+  uint8_t length = 0;
+  int result = serial_read_frame((uint8_t*)serial_slave_buffer, SERIAL_SLAVE_BUFFER_LENGTH,
+                                 &length, SERIAL_POLLS(SERIAL_RESPONSE_TIMEOUT));
+
+  // always, release the line when not in use
+  serial_output();
+  serial_high();
+
+  SREG = sreg;
+
+  if (result == SERIAL_OK && length == 0) {
+    // the slave rejected the request
+    return SERIAL_DATA_CORRUPT;
+  }
+  *slave_length = length;
+  return result;
+}
+
+#endif
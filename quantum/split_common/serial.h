@@ -0,0 +1,103 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPLIT_SERIAL_H
+#define SPLIT_SERIAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "split_transport.h"
+
+/*
+ * Single wire soft serial link between the halves of a split keyboard.
+ *
+ * Bytes are sent like on a UART: a start bit, 8 data bits LSB first and a
+ * stop bit, at SERIAL_BAUD. The receiver synchronises on every start bit,
+ * so the timing only has to be accurate over a single byte. Messages are
+ * framed as a length byte, the payload and a CRC-8 of both.
+ *
+ * A transaction is started by the master with a short low pulse, which
+ * the slave acknowledges from its pin change interrupt. The master then
+ * sends its request and the slave responds. An empty response means the
+ * slave rejected a corrupt request.
+ */
+
+#ifndef SERIAL_BAUD
+#define SERIAL_BAUD 125000
+#endif
+
+// How long the master waits for the slave to acknowledge a transaction, in microseconds
+#ifndef SERIAL_ACK_TIMEOUT
+#define SERIAL_ACK_TIMEOUT 50
+#endif
+
+// How long the master waits for the response after its request, in microseconds
+#ifndef SERIAL_RESPONSE_TIMEOUT
+#define SERIAL_RESPONSE_TIMEOUT 200
+#endif
+
+#ifdef USE_SERIAL_PD2
+#  define SERIAL_PIN_MASK _BV(PD2)
+#  define SERIAL_PIN_INTERRUPT INT2_vect
+#  define SERIAL_PIN_INT INT2
+#  define SERIAL_PIN_INTF INTF2
+#  define SERIAL_PIN_ISC0 ISC20
+#  define SERIAL_PIN_ISC1 ISC21
+#else
+#  define SERIAL_PIN_MASK _BV(PD0)
+#  define SERIAL_PIN_INTERRUPT INT0_vect
+#  define SERIAL_PIN_INT INT0
+#  define SERIAL_PIN_INTF INTF0
+#  define SERIAL_PIN_ISC0 ISC00
+#  define SERIAL_PIN_ISC1 ISC01
+#endif
+#define SERIAL_PIN_DDR DDRD
+#define SERIAL_PIN_PORT PORTD
+#define SERIAL_PIN_INPUT PIND
+
+#ifndef SERIAL_MASTER_BUFFER_LENGTH
+#define SERIAL_MASTER_BUFFER_LENGTH SPLIT_REQUEST_SIZE
+#endif
+#ifndef SERIAL_SLAVE_BUFFER_LENGTH
+#define SERIAL_SLAVE_BUFFER_LENGTH SPLIT_TRANSPORT_SIZE
+#endif
+
+// Return values of serial_update_buffers
+#define SERIAL_OK 0
+#define SERIAL_NO_RESPONSE 1
+#define SERIAL_DATA_CORRUPT 2
+
+// The master's request, and the last valid one received on the slave
+extern volatile uint8_t serial_master_buffer[SERIAL_MASTER_BUFFER_LENGTH];
+// The slave's response as received on the master, free for the slave's own use on the slave
+extern volatile uint8_t serial_slave_buffer[SERIAL_SLAVE_BUFFER_LENGTH];
+
+void serial_master_init(void);
+void serial_slave_init(void);
+
+// Master side, sends the first master_length bytes of serial_master_buffer
+// and receives the response in serial_slave_buffer
+int serial_update_buffers(uint8_t master_length, uint8_t* slave_length);
+
+// Slave side, called from the interrupt to build the response to a valid
+// request, returns its length. Has to be quick, the master is waiting.
+uint8_t serial_slave_respond(const uint8_t* request, uint8_t length, uint8_t* response);
+// Slave side, copies the last valid request from serial_master_buffer if one
+// was received since the previous call and returns its length, 0 otherwise
+uint8_t serial_slave_receive(uint8_t* request);
+// Slave side, whether the last request was corrupt
+bool serial_slave_data_corrupt(void);
+
+#endif
@@ -0,0 +1,260 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "split_transport.h"
+#include "timer.h"
+#include "action_layer.h"
+#include "host.h"
+#include "led.h"
+#ifdef BACKLIGHT_ENABLE
+#  include "backlight.h"
+#endif
+#ifdef RGBLIGHT_ENABLE
+#  include "rgblight.h"
+#endif
+
+_Static_assert(SPLIT_ROWS_PER_HAND <= 8, "The changed rows mask only supports 8 rows per hand");
+
+static uint8_t master_seq;
+static bool master_synced = false;
+static uint16_t master_refresh_time;
+
+static split_master_state_t state_sent;
+static split_master_state_t state_pending;
+static bool state_synced = false;
+static bool state_in_flight = false;
+static uint16_t state_refresh_time;
+
+static split_master_state_t slave_state;
+static bool slave_state_valid = false;
+
+uint8_t split_crc8(uint8_t crc, const uint8_t* data, uint8_t length) {
+    // CRC-8, polynomial x^8 + x^2 + x + 1
+    while (length--) {
+        crc ^= *data++;
+        for (uint8_t i = 0; i < 8; i++) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static uint8_t checksum(uint8_t seq, const matrix_row_t* rows) {
+    uint8_t crc = split_crc8(0, &seq, 1);
+    return split_crc8(crc, (const uint8_t*)rows, SPLIT_TRANSPORT_ROWS_SIZE);
+}
+
+void split_transport_slave_init(volatile uint8_t* buffer) {
+    split_transport_header_t header = {};
+    matrix_row_t rows[SPLIT_ROWS_PER_HAND] = {};
+    header.checksum = checksum(header.seq, rows);
+    memcpy((uint8_t*)buffer, &header, sizeof(header));
+    memcpy((uint8_t*)buffer + sizeof(header), rows, sizeof(rows));
+}
+
+void split_transport_slave_update(volatile uint8_t* buffer, const matrix_row_t* rows) {
+    split_transport_header_t header;
+    matrix_row_t published[SPLIT_ROWS_PER_HAND];
+    memcpy(&header, (uint8_t*)buffer, sizeof(header));
+    memcpy(published, (uint8_t*)buffer + sizeof(header), sizeof(published));
+
+    uint8_t changed = 0;
+    for (uint8_t i = 0; i < SPLIT_ROWS_PER_HAND; i++) {
+        if (published[i] != rows[i]) {
+            changed |= 1 << i;
+        }
+    }
+    if (!changed) {
+        return;
+    }
+
+    // The rows and checksum are written before the sequence number, a master reading
+    // in between sees a checksum mismatch and reads everything again
+    header.seq++;
+    header.changed = changed;
+    header.checksum = checksum(header.seq, rows);
+    memcpy((uint8_t*)buffer + sizeof(header), rows, SPLIT_TRANSPORT_ROWS_SIZE);
+    buffer[offsetof(split_transport_header_t, changed)] = header.changed;
+    buffer[offsetof(split_transport_header_t, checksum)] = header.checksum;
+    buffer[offsetof(split_transport_header_t, seq)] = header.seq;
+}
+
+static bool full_read_due(void) {
+    return !master_synced || timer_elapsed(master_refresh_time) >= SPLIT_TRANSPORT_REFRESH;
+}
+
+// Rows a master that has applied the update seq needs to catch up with header
+static uint8_t rows_since(const split_transport_header_t* header, uint8_t seq) {
+    if (header->seq == seq) {
+        return 0;
+    }
+    if (header->seq == (uint8_t)(seq + 1)) {
+        // Only the rows up to the last changed one
+        uint8_t count = SPLIT_ROWS_PER_HAND;
+        while (count && !(header->changed & (1 << (count - 1)))) {
+            count--;
+        }
+        return count;
+    }
+    // We have missed an update
+    return SPLIT_ROWS_PER_HAND;
+}
+
+uint8_t split_transport_rows_to_read(const split_transport_header_t* header) {
+    if (full_read_due()) {
+        return SPLIT_ROWS_PER_HAND;
+    }
+    return rows_since(header, master_seq);
+}
+
+bool split_transport_apply(const split_transport_header_t* header, const matrix_row_t* rows, uint8_t count, matrix_row_t* mirror) {
+    if (count == 0 && header->seq == master_seq) {
+        // Nothing has changed, the checksum isn't even read in this case
+        return true;
+    }
+
+    matrix_row_t updated[SPLIT_ROWS_PER_HAND];
+    memcpy(updated, mirror, sizeof(updated));
+    memcpy(updated, rows, count * sizeof(matrix_row_t));
+    if (checksum(header->seq, updated) != header->checksum) {
+        master_synced = false;
+        return false;
+    }
+
+    memcpy(mirror, updated, sizeof(updated));
+    master_seq = header->seq;
+    if (count == SPLIT_ROWS_PER_HAND) {
+        master_synced = true;
+        master_refresh_time = timer_read();
+    }
+    return true;
+}
+
+void split_transport_reset(void) {
+    master_synced = false;
+    state_synced = false;
+}
+
+static void read_master_state(split_master_state_t* state) {
+    memset(state, 0, sizeof(*state));
+#ifndef NO_ACTION_LAYER
+    state->layer_state = layer_state;
+#endif
+    state->leds = host_keyboard_leds();
+#ifdef BACKLIGHT_ENABLE
+    state->backlight = get_backlight_level();
+#endif
+#ifdef RGBLIGHT_ENABLE
+    state->rgblight = rgblight_read_dword();
+#endif
+}
+
+uint8_t split_transport_master_request(uint8_t* request) {
+    split_request_header_t header = { .flags = 0, .ack_seq = master_seq };
+    uint8_t length = sizeof(header);
+    if (full_read_due()) {
+        header.flags |= SPLIT_REQUEST_FULL;
+    }
+
+    read_master_state(&state_pending);
+    state_in_flight = !state_synced ||
+        memcmp(&state_pending, &state_sent, sizeof(state_sent)) != 0 ||
+        timer_elapsed(state_refresh_time) >= SPLIT_TRANSPORT_REFRESH;
+    if (state_in_flight) {
+        header.flags |= SPLIT_REQUEST_STATE;
+        memcpy(request + sizeof(header), &state_pending, sizeof(state_pending));
+        length += sizeof(state_pending);
+    }
+    memcpy(request, &header, sizeof(header));
+    return length;
+}
+
+bool split_transport_master_response(const uint8_t* response, uint8_t length, matrix_row_t* mirror) {
+    if (length < sizeof(split_transport_header_t)) {
+        return false;
+    }
+    uint8_t size = length - sizeof(split_transport_header_t);
+    if (size > SPLIT_TRANSPORT_ROWS_SIZE || size % sizeof(matrix_row_t)) {
+        return false;
+    }
+
+    // The slave only responds to requests that passed its checks, so the state has arrived
+    if (state_in_flight) {
+        state_sent = state_pending;
+        state_synced = true;
+        state_in_flight = false;
+        state_refresh_time = timer_read();
+    }
+
+    split_transport_header_t header;
+    matrix_row_t rows[SPLIT_ROWS_PER_HAND];
+    memcpy(&header, response, sizeof(header));
+    memcpy(rows, response + sizeof(header), size);
+    return split_transport_apply(&header, rows, size / sizeof(matrix_row_t), mirror);
+}
+
+uint8_t split_transport_slave_response(const volatile uint8_t* buffer, const uint8_t* request, uint8_t length, uint8_t* response) {
+    split_transport_header_t header;
+    memcpy(&header, (const uint8_t*)buffer, sizeof(header));
+
+    uint8_t count = SPLIT_ROWS_PER_HAND;
+    if (length >= sizeof(split_request_header_t)) {
+        split_request_header_t request_header;
+        memcpy(&request_header, request, sizeof(request_header));
+        if (!(request_header.flags & SPLIT_REQUEST_FULL)) {
+            count = rows_since(&header, request_header.ack_seq);
+        }
+    }
+
+    uint8_t size = sizeof(header) + count * sizeof(matrix_row_t);
+    memcpy(response, (const uint8_t*)buffer, size);
+    return size;
+}
+
+void split_transport_slave_apply(const uint8_t* request, uint8_t length) {
+    split_request_header_t header;
+    split_master_state_t state;
+    if (length < sizeof(header) + sizeof(state)) {
+        return;
+    }
+    memcpy(&header, request, sizeof(header));
+    if (!(header.flags & SPLIT_REQUEST_STATE)) {
+        return;
+    }
+    memcpy(&state, request + sizeof(header), sizeof(state));
+
+    // Only pass on what has changed, the RGB light configuration ends up in the EEPROM
+#ifndef NO_ACTION_LAYER
+    if (!slave_state_valid || state.layer_state != slave_state.layer_state) {
+        layer_state_set(state.layer_state);
+    }
+#endif
+    if (!slave_state_valid || state.leds != slave_state.leds) {
+        led_set(state.leds);
+    }
+#ifdef BACKLIGHT_ENABLE
+    if (!slave_state_valid || state.backlight != slave_state.backlight) {
+        backlight_set(state.backlight);
+    }
+#endif
+#ifdef RGBLIGHT_ENABLE
+    if (!slave_state_valid || state.rgblight != slave_state.rgblight) {
+        rgblight_update_dword(state.rgblight);
+    }
+#endif
+    slave_state = state;
+    slave_state_valid = true;
+}
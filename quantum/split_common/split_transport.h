@@ -0,0 +1,107 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPLIT_TRANSPORT_H
+#define SPLIT_TRANSPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "matrix.h"
+
+/*
+ * Matrix exchange between the two halves of a split keyboard.
+ *
+ * The slave publishes its half of the matrix in a buffer that the master
+ * reads over the link, laid out as a split_transport_header_t followed by
+ * the rows. The sequence number is incremented every time the slave's half
+ * changes, so the master only needs the header when nothing has changed,
+ * and only the rows up to the last changed one when it has seen the
+ * previous sequence number. The checksum covers the sequence number and
+ * all rows, so the master can verify that its mirror is consistent after
+ * applying a partial update. A full read is forced every
+ * SPLIT_TRANSPORT_REFRESH ms.
+ */
+
+#ifndef SPLIT_ROWS_PER_HAND
+#define SPLIT_ROWS_PER_HAND (MATRIX_ROWS / 2)
+#endif
+
+#ifndef SPLIT_TRANSPORT_REFRESH
+#define SPLIT_TRANSPORT_REFRESH 500
+#endif
+
+typedef struct {
+    uint8_t seq;      // incremented whenever the slave's half changes
+    uint8_t changed;  // bitmask of the rows changed by the last increment
+    uint8_t checksum; // CRC-8 of seq and all rows
+} __attribute__((packed)) split_transport_header_t;
+
+#define SPLIT_TRANSPORT_ROWS_SIZE (SPLIT_ROWS_PER_HAND * sizeof(matrix_row_t))
+#define SPLIT_TRANSPORT_SIZE (sizeof(split_transport_header_t) + SPLIT_TRANSPORT_ROWS_SIZE)
+
+uint8_t split_crc8(uint8_t crc, const uint8_t* data, uint8_t length);
+
+// Slave side, buffer is SPLIT_TRANSPORT_SIZE bytes read by the master
+void split_transport_slave_init(volatile uint8_t* buffer);
+void split_transport_slave_update(volatile uint8_t* buffer, const matrix_row_t* rows);
+
+// Master side
+// Returns how many rows, starting from the first one, have to be read after the header
+uint8_t split_transport_rows_to_read(const split_transport_header_t* header);
+// Applies the rows that were read to the mirror of the slave's half.
+// The mirror is left untouched and false returned if the result doesn't match the checksum.
+bool split_transport_apply(const split_transport_header_t* header, const matrix_row_t* rows, uint8_t count, matrix_row_t* mirror);
+// Forces the next read to be a full one, for example after the link was lost
+void split_transport_reset(void);
+
+/*
+ * Request/response links such as the soft serial one.
+ *
+ * The master sends a request telling the slave which sequence number it has
+ * applied, and the slave responds with the header and only the rows the
+ * master is missing. The request also carries the master's state (layers,
+ * host LEDs, backlight and RGB light) whenever it changes, and every
+ * SPLIT_TRANSPORT_REFRESH ms.
+ */
+
+#define SPLIT_REQUEST_FULL  (1 << 0) // the slave has to respond with all of its rows
+#define SPLIT_REQUEST_STATE (1 << 1) // a split_master_state_t follows the header
+
+typedef struct {
+    uint8_t flags;
+    uint8_t ack_seq; // sequence number of the last update the master has applied
+} __attribute__((packed)) split_request_header_t;
+
+typedef struct {
+    uint32_t layer_state;
+    uint8_t leds;
+    uint8_t backlight;
+    uint32_t rgblight;
+} __attribute__((packed)) split_master_state_t;
+
+#define SPLIT_REQUEST_SIZE (sizeof(split_request_header_t) + sizeof(split_master_state_t))
+
+// Master side, returns the length of the request written
+uint8_t split_transport_master_request(uint8_t* request);
+// Master side, applies a response to the request to the mirror of the slave's half.
+// Returns false if the response is malformed or inconsistent.
+bool split_transport_master_response(const uint8_t* response, uint8_t length, matrix_row_t* mirror);
+
+// Slave side, builds the response to a request from the buffer maintained with
+// split_transport_slave_update, returns its length
+uint8_t split_transport_slave_response(const volatile uint8_t* buffer, const uint8_t* request, uint8_t length, uint8_t* response);
+// Slave side, applies the master's state included in a request
+void split_transport_slave_apply(const uint8_t* request, uint8_t length);
+
+#endif
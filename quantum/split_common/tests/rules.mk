@@ -0,0 +1,5 @@
+split_transport_SRC :=\
+	$(SPLIT_PATH)/tests/split_transport_tests.cpp \
+	$(SPLIT_PATH)/split_transport.c
+
+split_transport_DEFS := -DMATRIX_ROWS=8 -DMATRIX_COLS=6
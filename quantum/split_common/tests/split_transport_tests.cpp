@@ -0,0 +1,291 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include <string.h>
+extern "C" {
+#include "split_common/split_transport.h"
+}
+
+static uint16_t current_time = 0;
+static uint8_t host_leds = 0;
+static int layer_state_set_calls = 0;
+static int led_set_calls = 0;
+
+extern "C" {
+uint32_t layer_state = 0;
+
+uint16_t timer_read(void) {
+    return current_time;
+}
+
+uint16_t timer_elapsed(uint16_t last) {
+    return current_time - last;
+}
+
+uint8_t host_keyboard_leds(void) {
+    return host_leds;
+}
+
+void layer_state_set(uint32_t state) {
+    layer_state = state;
+    layer_state_set_calls++;
+}
+
+void led_set(uint8_t leds) {
+    host_leds = leds;
+    led_set_calls++;
+}
+}
+
+class SplitTransport : public testing::Test {
+public:
+    SplitTransport() {
+        current_time = 0;
+        split_transport_reset();
+        split_transport_slave_init(buffer);
+        memset(mirror, 0, sizeof(mirror));
+        layer_state = 0;
+        host_leds = 0;
+    }
+
+    split_transport_header_t header() {
+        split_transport_header_t h;
+        memcpy(&h, buffer, sizeof(h));
+        return h;
+    }
+
+    const matrix_row_t* published_rows() {
+        return reinterpret_cast<const matrix_row_t*>(buffer + sizeof(split_transport_header_t));
+    }
+
+    // Reads the slave buffer like a master would, returns the number of rows read
+    int master_read() {
+        split_transport_header_t h = header();
+        uint8_t count = split_transport_rows_to_read(&h);
+        matrix_row_t rows[SPLIT_ROWS_PER_HAND];
+        memcpy(rows, published_rows(), count * sizeof(matrix_row_t));
+        if (!split_transport_apply(&h, rows, count, mirror)) {
+            return -1;
+        }
+        return count;
+    }
+
+    // Goes through a request and response like the serial link does, returns the number of rows sent
+    int transact() {
+        request_length = split_transport_master_request(request);
+        uint8_t response[SPLIT_TRANSPORT_SIZE];
+        uint8_t length = split_transport_slave_response(buffer, request, request_length, response);
+        if (!split_transport_master_response(response, length, mirror)) {
+            return -1;
+        }
+        return (length - sizeof(split_transport_header_t)) / sizeof(matrix_row_t);
+    }
+
+    uint8_t request_flags() {
+        split_request_header_t h;
+        memcpy(&h, request, sizeof(h));
+        return h.flags;
+    }
+
+    uint8_t request[SPLIT_REQUEST_SIZE];
+    uint8_t request_length = 0;
+    uint8_t buffer[SPLIT_TRANSPORT_SIZE];
+    matrix_row_t slave_rows[SPLIT_ROWS_PER_HAND] = {};
+    matrix_row_t mirror[SPLIT_ROWS_PER_HAND];
+};
+
+TEST_F(SplitTransport, first_read_is_a_full_read) {
+    EXPECT_EQ(master_read(), SPLIT_ROWS_PER_HAND);
+}
+
+TEST_F(SplitTransport, nothing_is_read_when_the_slave_does_not_change) {
+    master_read();
+    split_transport_slave_update(buffer, slave_rows);
+    EXPECT_EQ(header().seq, 0);
+    EXPECT_EQ(master_read(), 0);
+    EXPECT_EQ(master_read(), 0);
+}
+
+TEST_F(SplitTransport, changes_increment_the_sequence_number) {
+    slave_rows[1] = 0x3;
+    split_transport_slave_update(buffer, slave_rows);
+    EXPECT_EQ(header().seq, 1);
+    EXPECT_EQ(header().changed, 1 << 1);
+    slave_rows[0] = 0x1;
+    slave_rows[3] = 0x4;
+    split_transport_slave_update(buffer, slave_rows);
+    EXPECT_EQ(header().seq, 2);
+    EXPECT_EQ(header().changed, (1 << 0) | (1 << 3));
+}
+
+TEST_F(SplitTransport, only_rows_up_to_the_last_changed_are_read) {
+    master_read();
+    slave_rows[1] = 0x21;
+    split_transport_slave_update(buffer, slave_rows);
+    EXPECT_EQ(master_read(), 2);
+    EXPECT_EQ(mirror[1], 0x21);
+    EXPECT_EQ(master_read(), 0);
+}
+
+TEST_F(SplitTransport, a_missed_update_causes_a_full_read) {
+    master_read();
+    slave_rows[3] = 0x1;
+    split_transport_slave_update(buffer, slave_rows);
+    slave_rows[0] = 0x2;
+    split_transport_slave_update(buffer, slave_rows);
+    EXPECT_EQ(master_read(), SPLIT_ROWS_PER_HAND);
+    EXPECT_EQ(memcmp(mirror, slave_rows, sizeof(mirror)), 0);
+}
+
+TEST_F(SplitTransport, a_corrupt_update_is_rejected_and_the_next_read_is_full) {
+    master_read();
+    slave_rows[0] = 0x5;
+    split_transport_slave_update(buffer, slave_rows);
+    buffer[sizeof(split_transport_header_t)] ^= 0x10;
+    EXPECT_EQ(master_read(), -1);
+    EXPECT_EQ(mirror[0], 0);
+    buffer[sizeof(split_transport_header_t)] ^= 0x10;
+    EXPECT_EQ(master_read(), SPLIT_ROWS_PER_HAND);
+    EXPECT_EQ(mirror[0], 0x5);
+}
+
+TEST_F(SplitTransport, an_inconsistent_mirror_is_detected) {
+    master_read();
+    mirror[3] = 0x7;
+    slave_rows[0] = 0x1;
+    split_transport_slave_update(buffer, slave_rows);
+    EXPECT_EQ(master_read(), -1);
+    EXPECT_EQ(master_read(), SPLIT_ROWS_PER_HAND);
+    EXPECT_EQ(memcmp(mirror, slave_rows, sizeof(mirror)), 0);
+}
+
+TEST_F(SplitTransport, the_state_is_refreshed_periodically) {
+    master_read();
+    current_time = SPLIT_TRANSPORT_REFRESH - 1;
+    EXPECT_EQ(master_read(), 0);
+    current_time = SPLIT_TRANSPORT_REFRESH;
+    EXPECT_EQ(master_read(), SPLIT_ROWS_PER_HAND);
+    EXPECT_EQ(master_read(), 0);
+}
+
+TEST_F(SplitTransport, the_sequence_number_wraps_around) {
+    master_read();
+    for (int i = 0; i < 300; i++) {
+        slave_rows[i % SPLIT_ROWS_PER_HAND] ^= 1;
+        split_transport_slave_update(buffer, slave_rows);
+        EXPECT_GE(master_read(), 1);
+    }
+    EXPECT_EQ(memcmp(mirror, slave_rows, sizeof(mirror)), 0);
+}
+
+TEST_F(SplitTransport, reset_forces_a_full_read) {
+    master_read();
+    split_transport_reset();
+    EXPECT_EQ(master_read(), SPLIT_ROWS_PER_HAND);
+}
+
+TEST_F(SplitTransport, the_first_request_asks_for_everything_and_carries_the_state) {
+    EXPECT_EQ(transact(), SPLIT_ROWS_PER_HAND);
+    EXPECT_EQ(request_length, SPLIT_REQUEST_SIZE);
+    EXPECT_EQ(request_flags(), SPLIT_REQUEST_FULL | SPLIT_REQUEST_STATE);
+}
+
+TEST_F(SplitTransport, an_idle_request_only_gets_the_header_back) {
+    transact();
+    EXPECT_EQ(transact(), 0);
+    EXPECT_EQ(request_length, sizeof(split_request_header_t));
+    EXPECT_EQ(request_flags(), 0);
+}
+
+TEST_F(SplitTransport, the_response_contains_the_rows_up_to_the_last_changed) {
+    transact();
+    slave_rows[2] = 0x11;
+    split_transport_slave_update(buffer, slave_rows);
+    EXPECT_EQ(transact(), 3);
+    EXPECT_EQ(memcmp(mirror, slave_rows, sizeof(mirror)), 0);
+    EXPECT_EQ(transact(), 0);
+}
+
+TEST_F(SplitTransport, a_missed_response_is_caught_up_with) {
+    transact();
+    slave_rows[0] = 0x1;
+    split_transport_slave_update(buffer, slave_rows);
+    // The response gets lost on the way
+    split_transport_master_request(request);
+    slave_rows[3] = 0x2;
+    split_transport_slave_update(buffer, slave_rows);
+    EXPECT_EQ(transact(), SPLIT_ROWS_PER_HAND);
+    EXPECT_EQ(memcmp(mirror, slave_rows, sizeof(mirror)), 0);
+}
+
+TEST_F(SplitTransport, the_state_is_sent_when_it_changes) {
+    transact();
+    transact();
+    layer_state = 0x4;
+    transact();
+    EXPECT_EQ(request_flags(), SPLIT_REQUEST_STATE);
+    split_master_state_t state;
+    memcpy(&state, request + sizeof(split_request_header_t), sizeof(state));
+    EXPECT_EQ(state.layer_state, 0x4u);
+    transact();
+    EXPECT_EQ(request_flags(), 0);
+}
+
+TEST_F(SplitTransport, the_state_is_sent_again_until_a_response_arrives) {
+    transact();
+    host_leds = 0x2;
+    split_transport_master_request(request);
+    EXPECT_EQ(request_flags(), SPLIT_REQUEST_STATE);
+    split_transport_master_request(request);
+    EXPECT_EQ(request_flags(), SPLIT_REQUEST_STATE);
+    transact();
+    transact();
+    EXPECT_EQ(request_flags(), 0);
+}
+
+TEST_F(SplitTransport, the_state_is_sent_periodically) {
+    transact();
+    current_time = SPLIT_TRANSPORT_REFRESH;
+    transact();
+    EXPECT_TRUE(request_flags() & SPLIT_REQUEST_STATE);
+}
+
+TEST_F(SplitTransport, a_malformed_response_is_rejected) {
+    transact();
+    uint8_t response[SPLIT_TRANSPORT_SIZE] = {};
+    EXPECT_FALSE(split_transport_master_response(response, sizeof(split_transport_header_t) - 1, mirror));
+    EXPECT_FALSE(split_transport_master_response(response, SPLIT_TRANSPORT_SIZE + 1, mirror));
+}
+
+TEST_F(SplitTransport, the_slave_only_applies_what_has_changed) {
+    layer_state = 0x12;
+    host_leds = 0x3;
+    uint8_t length = split_transport_master_request(request);
+    layer_state_set_calls = 0;
+    led_set_calls = 0;
+    split_transport_slave_apply(request, length);
+    EXPECT_EQ(layer_state_set_calls, 1);
+    EXPECT_EQ(led_set_calls, 1);
+    split_transport_slave_apply(request, length);
+    EXPECT_EQ(layer_state_set_calls, 1);
+    EXPECT_EQ(led_set_calls, 1);
+
+    host_leds = 0x1;
+    length = split_transport_master_request(request);
+    split_transport_slave_apply(request, length);
+    EXPECT_EQ(layer_state_set_calls, 1);
+    EXPECT_EQ(led_set_calls, 2);
+    EXPECT_EQ(host_leds, 0x1);
+}
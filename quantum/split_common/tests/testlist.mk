@@ -0,0 +1,2 @@
+TEST_LIST +=\
+	split_transport
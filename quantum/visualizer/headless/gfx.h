@@ -0,0 +1,136 @@
+/*
+The MIT License (MIT)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HEADLESS_GFX_H
+#define HEADLESS_GFX_H
+
+/*
+ * Headless replacement for the part of uGFX used by the visualizer, so that
+ * the animations can run on the host.
+ *
+ * The displays are 8 bit grayscale framebuffers in memory, rotated like the
+ * ST7565 driver does. Time only moves
+ * when headless_run_for is called, which lets the visualizer thread run
+ * until it sleeps past the end of the given time. Everything else runs while
+ * the visualizer thread is asleep, so no locking is needed by the callers.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef bool bool_t;
+#define TRUE true
+#define FALSE false
+
+typedef int16_t coord_t;
+typedef uint8_t color_t;
+typedef uint32_t systemticks_t;
+typedef const void* font_t;
+
+// One tick is one millisecond
+#define TIME_INFINITE ((systemticks_t)-1)
+#define gfxMillisecondsToTicks(ms) ((systemticks_t)(ms))
+
+#define LUMA2COLOR(l) ((color_t)(l))
+#define Black ((color_t)0)
+#define White ((color_t)255)
+
+typedef enum { powerOff, powerSleep, powerDeepSleep, powerOn } powermode_t;
+typedef enum {
+    GDISP_ROTATE_0 = 0,
+    GDISP_ROTATE_90 = 90,
+    GDISP_ROTATE_180 = 180,
+    GDISP_ROTATE_270 = 270
+} orientation_t;
+
+typedef struct GDisplay {
+    coord_t width;
+    coord_t height;
+    orientation_t orientation;
+    powermode_t powermode;
+    uint8_t backlight;
+    // The pixels as drawn, and as they were at the last flush
+    uint8_t* pixels;
+    uint8_t* shown;
+    // Pixels drawn, flushes, and flushes that changed something
+    uint32_t pixel_writes;
+    uint32_t flushes;
+    uint32_t frames;
+} GDisplay;
+
+// Threads
+#define NORMAL_PRIORITY 0
+#define DECLARE_THREAD_STACK(name, size) uint8_t name[size]
+#define DECLARE_THREAD_FUNCTION(name, arg) void* name(void* arg)
+typedef void* (*gfxThreadFunction)(void*);
+
+void gfxInit(void);
+systemticks_t gfxSystemTicks(void);
+void gfxThreadCreate(void* stack, uint32_t stack_size, int priority, gfxThreadFunction fn, void* param);
+
+// Displays
+GDisplay* gdispGetDisplay(unsigned display);
+void gdispGClear(GDisplay* g, color_t color);
+void gdispGDrawPixel(GDisplay* g, coord_t x, coord_t y, color_t color);
+color_t gdispGGetPixelColor(GDisplay* g, coord_t x, coord_t y);
+void gdispGDrawLine(GDisplay* g, coord_t x0, coord_t y0, coord_t x1, coord_t y1, color_t color);
+void gdispGFlush(GDisplay* g);
+void gdispGSetBacklight(GDisplay* g, unsigned percent);
+void gdispGSetPowerMode(GDisplay* g, powermode_t mode);
+void gdispGSetOrientation(GDisplay* g, orientation_t orientation);
+
+// Events, there is a single listener which is the visualizer thread
+typedef struct { int dummy; } GListener;
+typedef struct { int dummy; } GSourceListener;
+typedef struct { int dummy; } GEvent;
+typedef void* GSourceHandle;
+void geventListenerInit(GListener* listener);
+bool_t geventAttachSource(GListener* listener, GSourceHandle source, unsigned flags);
+GEvent* geventEventWait(GListener* listener, systemticks_t timeout);
+GSourceListener* geventGetSourceListener(GSourceHandle source, GSourceListener* last);
+void geventSendEvent(GSourceListener* listener);
+
+// Host side control
+typedef struct {
+    uint32_t wakeups;
+    // CPU time used by the visualizer thread
+    uint64_t busy_ns;
+} headless_stats_t;
+
+// Lets the visualizer thread run until ticks have passed
+void headless_run_for(systemticks_t ticks);
+void headless_get_stats(headless_stats_t* stats);
+// Writes the pixels as a binary PGM image, returns false on failure
+bool headless_dump_pgm(GDisplay* g, const char* path);
+// When a directory is set, every flush that changes something is dumped to
+// directory/display<number>_<frame>.pgm, NULL stops dumping
+void headless_dump_frames(const char* directory);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,305 @@
+/*
+The MIT License (MIT)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "gfx.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_DISPLAYS 2
+// Wakeups without time passing before the visualizer is considered stuck
+#define MAX_WAKEUPS_AT_SAME_TIME 1000
+
+static GDisplay displays[MAX_DISPLAYS];
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static systemticks_t now = 0;
+// The visualizer thread is waiting until wake_time or an event
+static bool waiting = false;
+static systemticks_t wake_time = TIME_INFINITE;
+static bool event_pending = false;
+static GEvent event;
+static GSourceListener source_listener;
+static bool source_attached = false;
+
+static headless_stats_t stats;
+static struct timespec busy_start;
+static const char* dump_directory = NULL;
+
+static void init_display(unsigned number, coord_t width, coord_t height) {
+    GDisplay* g = &displays[number];
+    g->width = width;
+    g->height = height;
+    g->orientation = GDISP_ROTATE_0;
+    g->powermode = powerOff;
+    g->backlight = 100;
+    g->pixels = calloc(width * height, 1);
+    g->shown = calloc(width * height, 1);
+}
+
+void gfxInit(void) {
+#ifdef LED_DISPLAY_NUMBER
+    init_display(LED_DISPLAY_NUMBER, LED_WIDTH, LED_HEIGHT);
+#endif
+#ifdef LCD_DISPLAY_NUMBER
+    init_display(LCD_DISPLAY_NUMBER, LCD_WIDTH, LCD_HEIGHT);
+#endif
+}
+
+systemticks_t gfxSystemTicks(void) {
+    return now;
+}
+
+typedef struct {
+    gfxThreadFunction fn;
+    void* param;
+} thread_start_t;
+
+static void* thread_main(void* arg) {
+    thread_start_t start = *(thread_start_t*)arg;
+    free(arg);
+    pthread_mutex_lock(&lock);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &busy_start);
+    stats.wakeups++;
+    pthread_mutex_unlock(&lock);
+    return start.fn(start.param);
+}
+
+void gfxThreadCreate(void* stack, uint32_t stack_size, int priority, gfxThreadFunction fn, void* param) {
+    (void)stack;
+    (void)stack_size;
+    (void)priority;
+    thread_start_t* start = malloc(sizeof(thread_start_t));
+    start->fn = fn;
+    start->param = param;
+    pthread_t thread;
+    pthread_create(&thread, NULL, thread_main, start);
+    pthread_detach(thread);
+    // Like on the keyboard, the thread runs until it has to wait for something
+    pthread_mutex_lock(&lock);
+    while (!waiting) {
+        pthread_cond_wait(&cond, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+GDisplay* gdispGetDisplay(unsigned display) {
+    return display < MAX_DISPLAYS && displays[display].pixels ? &displays[display] : NULL;
+}
+
+// Converts to the unrotated position, returns false when outside the display
+static bool physical(GDisplay* g, coord_t* x, coord_t* y) {
+    coord_t px = *x;
+    coord_t py = *y;
+    switch (g->orientation) {
+    default:
+    case GDISP_ROTATE_0:
+        break;
+    case GDISP_ROTATE_90:
+        px = *y;
+        py = g->height - 1 - *x;
+        break;
+    case GDISP_ROTATE_180:
+        px = g->width - 1 - *x;
+        py = g->height - 1 - *y;
+        break;
+    case GDISP_ROTATE_270:
+        px = g->width - 1 - *y;
+        py = *x;
+        break;
+    }
+    if (px < 0 || px >= g->width || py < 0 || py >= g->height) {
+        return false;
+    }
+    *x = px;
+    *y = py;
+    return true;
+}
+
+void gdispGDrawPixel(GDisplay* g, coord_t x, coord_t y, color_t color) {
+    if (physical(g, &x, &y)) {
+        g->pixels[y * g->width + x] = color;
+        g->pixel_writes++;
+    }
+}
+
+color_t gdispGGetPixelColor(GDisplay* g, coord_t x, coord_t y) {
+    return physical(g, &x, &y) ? g->pixels[y * g->width + x] : Black;
+}
+
+void gdispGClear(GDisplay* g, color_t color) {
+    memset(g->pixels, color, g->width * g->height);
+    g->pixel_writes += g->width * g->height;
+}
+
+void gdispGDrawLine(GDisplay* g, coord_t x0, coord_t y0, coord_t x1, coord_t y1, color_t color) {
+    int dx = abs(x1 - x0);
+    int dy = -abs(y1 - y0);
+    int sx = x0 < x1 ? 1 : -1;
+    int sy = y0 < y1 ? 1 : -1;
+    int error = dx + dy;
+    while (true) {
+        gdispGDrawPixel(g, x0, y0, color);
+        if (x0 == x1 && y0 == y1) {
+            break;
+        }
+        int e2 = 2 * error;
+        if (e2 >= dy) {
+            error += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx) {
+            error += dx;
+            y0 += sy;
+        }
+    }
+}
+
+void gdispGFlush(GDisplay* g) {
+    g->flushes++;
+    size_t size = g->width * g->height;
+    if (memcmp(g->pixels, g->shown, size) == 0) {
+        return;
+    }
+    memcpy(g->shown, g->pixels, size);
+    if (dump_directory) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/display%u_%05u.pgm", dump_directory,
+                (unsigned)(g - displays), (unsigned)g->frames);
+        headless_dump_pgm(g, path);
+    }
+    g->frames++;
+}
+
+void gdispGSetBacklight(GDisplay* g, unsigned percent) {
+    g->backlight = percent > 100 ? 100 : percent;
+}
+
+void gdispGSetPowerMode(GDisplay* g, powermode_t mode) {
+    g->powermode = mode;
+}
+
+void gdispGSetOrientation(GDisplay* g, orientation_t orientation) {
+    g->orientation = orientation;
+}
+
+void geventListenerInit(GListener* listener) {
+    (void)listener;
+}
+
+bool_t geventAttachSource(GListener* listener, GSourceHandle source, unsigned flags) {
+    (void)listener;
+    (void)source;
+    (void)flags;
+    source_attached = true;
+    return TRUE;
+}
+
+GSourceListener* geventGetSourceListener(GSourceHandle source, GSourceListener* last) {
+    (void)source;
+    return source_attached && last == NULL ? &source_listener : NULL;
+}
+
+void geventSendEvent(GSourceListener* listener) {
+    (void)listener;
+    pthread_mutex_lock(&lock);
+    event_pending = true;
+    pthread_mutex_unlock(&lock);
+}
+
+GEvent* geventEventWait(GListener* listener, systemticks_t timeout) {
+    (void)listener;
+    pthread_mutex_lock(&lock);
+    struct timespec busy_end;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &busy_end);
+    stats.busy_ns += (uint64_t)(busy_end.tv_sec - busy_start.tv_sec) * 1000000000 +
+        busy_end.tv_nsec - busy_start.tv_nsec;
+
+    wake_time = timeout == TIME_INFINITE ? TIME_INFINITE : now + timeout;
+    waiting = true;
+    pthread_cond_broadcast(&cond);
+    while (waiting) {
+        pthread_cond_wait(&cond, &lock);
+    }
+    bool had_event = event_pending;
+    event_pending = false;
+    stats.wakeups++;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &busy_start);
+    pthread_mutex_unlock(&lock);
+    return had_event ? &event : NULL;
+}
+
+// Has to be called with the lock held and the thread waiting
+static void resume_thread(void) {
+    waiting = false;
+    pthread_cond_broadcast(&cond);
+    while (!waiting) {
+        pthread_cond_wait(&cond, &lock);
+    }
+}
+
+void headless_run_for(systemticks_t ticks) {
+    pthread_mutex_lock(&lock);
+    systemticks_t target = now + ticks;
+    unsigned same_time_wakeups = 0;
+    while (true) {
+        if (event_pending) {
+            same_time_wakeups++;
+        } else if (wake_time != TIME_INFINITE && wake_time <= target) {
+            same_time_wakeups = wake_time == now ? same_time_wakeups + 1 : 0;
+            now = wake_time;
+        } else {
+            break;
+        }
+        if (same_time_wakeups > MAX_WAKEUPS_AT_SAME_TIME) {
+            fprintf(stderr, "The visualizer keeps waking up without time passing\n");
+            abort();
+        }
+        resume_thread();
+    }
+    now = target;
+    pthread_mutex_unlock(&lock);
+}
+
+void headless_get_stats(headless_stats_t* s) {
+    pthread_mutex_lock(&lock);
+    *s = stats;
+    pthread_mutex_unlock(&lock);
+}
+
+bool headless_dump_pgm(GDisplay* g, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    fprintf(file, "P5\n%d %d\n255\n", g->width, g->height);
+    size_t size = g->width * g->height;
+    bool ok = fwrite(g->pixels, 1, size, file) == size;
+    return fclose(file) == 0 && ok;
+}
+
+void headless_dump_frames(const char* directory) {
+    dump_directory = directory;
+}
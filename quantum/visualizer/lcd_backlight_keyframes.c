@@ -46,6 +46,10 @@ bool lcd_backlight_keyframe_animate_color(keyframe_animation_t* animation, visua
             LCD_SAT(state->current_lcd_color),
             LCD_INT(state->current_lcd_color));
 
+    // Nothing changes until one of the components goes to its next value
+    keyframe_update_in(animation, keyframe_time_to_next_step(animation, d_h));
+    keyframe_update_in(animation, keyframe_time_to_next_step(animation, d_s));
+    keyframe_update_in(animation, keyframe_time_to_next_step(animation, d_i));
     return true;
 }
 
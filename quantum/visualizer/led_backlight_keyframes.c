@@ -38,6 +38,7 @@ static void keyframe_fade_all_leds_from_to(keyframe_animation_t* animation, uint
     uint8_t luma = fade_led_color(animation, from, to);
     color_t color = LUMA2COLOR(luma);
     gdispGClear(LED_DISPLAY, color);
+    keyframe_update_in(animation, keyframe_time_to_next_step(animation, to - from));
 }
 
 // TODO: Should be customizable per keyboard
@@ -109,6 +110,8 @@ bool led_backlight_keyframe_crossfade(keyframe_animation_t* animation, visualize
         for (int j=0;j<NUM_COLS;j++) {
             color_t color  = LUMA2COLOR(fade_led_color(animation, crossfade_start_frame[i][j], crossfade_end_frame[i][j]));
             gdispGDrawPixel(LED_DISPLAY, j, i, color);
+            keyframe_update_in(animation,
+                keyframe_time_to_next_step(animation, crossfade_end_frame[i][j] - crossfade_start_frame[i][j]));
         }
     }
     return true;
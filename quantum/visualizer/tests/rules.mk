@@ -0,0 +1,17 @@
+visualizer_SRC :=\
+	$(QUANTUM_PATH)/visualizer/tests/visualizer_tests.cpp \
+	$(QUANTUM_PATH)/visualizer/headless/gfx_headless.c \
+	$(QUANTUM_PATH)/visualizer/visualizer.c \
+	$(QUANTUM_PATH)/visualizer/visualizer_keyframes.c \
+	$(QUANTUM_PATH)/visualizer/default_animations.c \
+	$(QUANTUM_PATH)/visualizer/led_backlight_keyframes.c \
+	$(QUANTUM_PATH)/visualizer/lcd_backlight.c \
+	$(QUANTUM_PATH)/visualizer/lcd_backlight_keyframes.c
+
+visualizer_INC :=\
+	$(QUANTUM_PATH)/visualizer/tests \
+	$(QUANTUM_PATH)/visualizer \
+	$(QUANTUM_PATH)/visualizer/headless
+
+visualizer_DEFS := -DVISUALIZER_ENABLE -DBACKLIGHT_ENABLE -DLCD_BACKLIGHT_ENABLE \
+	-DLED_DISPLAY_NUMBER=0 -DLED_WIDTH=7 -DLED_HEIGHT=7
@@ -0,0 +1,279 @@
+/*
+The MIT License (MIT)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "gtest/gtest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+extern "C" {
+#include "visualizer.h"
+#include "default_animations.h"
+}
+
+// The visualizer runs as a single thread for the whole test program, so the
+// tests run one after another on the same visualizer, which is idle with the
+// LEDs fully on between them. Layer 1 runs the LED test animation.
+
+#define TEST_LAYER 1
+
+static int user_updates = 0;
+static int user_suspends = 0;
+static int user_resumes = 0;
+static uint16_t lcd_color[3];
+
+extern "C" {
+uint8_t get_mods(void) { return 0; }
+uint8_t get_oneshot_mods(void) { return 0; }
+bool has_oneshot_mods_timed_out(void) { return true; }
+
+void lcd_backlight_hal_init(void) {}
+void lcd_backlight_hal_color(uint16_t r, uint16_t g, uint16_t b) {
+    lcd_color[0] = r;
+    lcd_color[1] = g;
+    lcd_color[2] = b;
+}
+
+void initialize_user_visualizer(visualizer_state_t* state) {
+    // Fades the intensity only, so that the LCD and the LEDs change together
+    state->current_lcd_color = LCD_COLOR(0, 0, 0);
+    state->target_lcd_color = LCD_COLOR(0, 0, 0xFF);
+    start_keyframe_animation(&default_startup_animation);
+}
+
+void update_user_visualizer_state(visualizer_state_t* state, visualizer_keyboard_status_t* prev_status) {
+    (void)prev_status;
+    user_updates++;
+    if (state->status.layer & (1 << TEST_LAYER)) {
+        start_keyframe_animation(&led_test_animation);
+    } else {
+        stop_keyframe_animation(&led_test_animation);
+        gdispGSetOrientation(LED_DISPLAY, GDISP_ROTATE_0);
+        gdispGClear(LED_DISPLAY, LUMA2COLOR(255));
+    }
+}
+
+void user_visualizer_suspend(visualizer_state_t* state) {
+    (void)state;
+    user_suspends++;
+    start_keyframe_animation(&default_suspend_animation);
+}
+
+void user_visualizer_resume(visualizer_state_t* state) {
+    state->current_lcd_color = LCD_COLOR(0, 0, 0);
+    state->target_lcd_color = LCD_COLOR(0, 0, 0xFF);
+    user_resumes++;
+    start_keyframe_animation(&default_startup_animation);
+}
+}
+
+class Visualizer : public testing::Test {
+public:
+    static void SetUpTestCase() {
+        visualizer_init();
+        lcd_backlight_brightness(255);
+        visualizer_update(1, 1, 0, 0);
+        led = get_led_display();
+    }
+
+    Visualizer() {
+        // Lets whatever the previous test left running finish
+        headless_run_for(10000);
+        visualizer_get_stats(&stats_before);
+        headless_get_stats(&headless_before);
+        frames_before = led->frames;
+    }
+
+    uint8_t pixel(int x, int y) {
+        return led->shown[y * led->width + x];
+    }
+
+    uint32_t wakeups() {
+        headless_stats_t stats;
+        headless_get_stats(&stats);
+        return stats.wakeups - headless_before.wakeups;
+    }
+
+    uint32_t events() {
+        visualizer_stats_t stats;
+        visualizer_get_stats(&stats);
+        return stats.events - stats_before.events;
+    }
+
+    uint32_t frames() {
+        return led->frames - frames_before;
+    }
+
+    // The CPU time the visualizer thread used per wakeup since the test started
+    double ns_per_wakeup() {
+        headless_stats_t stats;
+        headless_get_stats(&stats);
+        return (double)(stats.busy_ns - headless_before.busy_ns) / (stats.wakeups - headless_before.wakeups);
+    }
+
+    static GDisplay* led;
+    visualizer_stats_t stats_before;
+    headless_stats_t headless_before;
+    uint32_t frames_before;
+};
+
+GDisplay* Visualizer::led;
+
+TEST_F(Visualizer, StartupHasFadedTheLedsIn) {
+    // The first test starts after the 5 second startup animation
+    EXPECT_EQ(led->powermode, powerOn);
+    EXPECT_EQ(pixel(0, 0), 255);
+    EXPECT_EQ(pixel(6, 6), 255);
+    EXPECT_GE(user_updates, 1);
+    EXPECT_GT(lcd_color[0], 0);
+}
+
+TEST_F(Visualizer, AnUnchangedStatusDoesNotWakeTheThread) {
+    for (int i = 0; i < 1000; i++) {
+        visualizer_update(1, 1, 0, 0);
+        headless_run_for(1);
+    }
+    EXPECT_EQ(events(), 0);
+    EXPECT_EQ(wakeups(), 0);
+}
+
+TEST_F(Visualizer, AChangedStatusWakesTheThreadOnce) {
+    int updates = user_updates;
+    visualizer_update(1, 1, 0, 0x1);
+    headless_run_for(1000);
+    EXPECT_EQ(events(), 1);
+    EXPECT_EQ(wakeups(), 1);
+    EXPECT_EQ(user_updates, updates + 1);
+    visualizer_update(1, 1, 0, 0);
+}
+
+TEST_F(Visualizer, SuspendFadesOutAndPowersOff) {
+    visualizer_suspend();
+    headless_run_for(500);
+    EXPECT_EQ(user_suspends, 1);
+    EXPECT_NEAR(pixel(3, 3), 128, 3);
+    headless_run_for(501);
+    EXPECT_EQ(pixel(3, 3), 0);
+    EXPECT_EQ(led->powermode, powerOff);
+    EXPECT_EQ(lcd_color[0], 0);
+
+    // Suspending twice does nothing
+    visualizer_suspend();
+    headless_run_for(1000);
+    EXPECT_EQ(user_suspends, 1);
+
+    visualizer_resume();
+    headless_run_for(2500);
+    EXPECT_EQ(user_resumes, 1);
+    EXPECT_EQ(led->powermode, powerOn);
+    EXPECT_NEAR(pixel(3, 3), 127, 1);
+    headless_run_for(2501);
+    EXPECT_EQ(pixel(3, 3), 255);
+}
+
+TEST_F(Visualizer, FadesWakeUpOncePerStep) {
+    visualizer_suspend();
+    headless_run_for(2000);
+    visualizer_resume();
+    headless_run_for(5001);
+    // The 1 second fade out is limited by VISUALIZER_UPDATE_INTERVAL, the 5
+    // second fade in wakes up once for each of its 255 steps
+    EXPECT_LE(frames(), 1000 / VISUALIZER_UPDATE_INTERVAL + 256);
+    EXPECT_LE(wakeups(), 1000 / VISUALIZER_UPDATE_INTERVAL + 256 + 8);
+    std::cout << "Suspend and resume: " << wakeups() << " wakeups, " << frames() << " frames, "
+        << ns_per_wakeup() << " ns per wakeup" << std::endl;
+}
+
+TEST_F(Visualizer, BacklightLevelSetsTheLedBrightness) {
+    backlight_set(2);
+    headless_run_for(1);
+    EXPECT_EQ(led->powermode, powerOn);
+    EXPECT_EQ(led->backlight, 66);
+    backlight_set(0);
+    headless_run_for(1);
+    EXPECT_EQ(led->powermode, powerOff);
+    backlight_set(3);
+    headless_run_for(1);
+    EXPECT_EQ(led->powermode, powerOn);
+    EXPECT_EQ(led->backlight, 100);
+}
+
+TEST_F(Visualizer, MirroredGradientIsTheGradientFlipped) {
+    visualizer_update(1, 1 << TEST_LAYER, 0, 0);
+    // 1 second into the left to right gradient
+    headless_run_for(5000);
+    uint8_t normal[LED_HEIGHT][LED_WIDTH];
+    memcpy(normal, led->shown, sizeof(normal));
+    EXPECT_NE(normal[0][0], normal[0][3]);
+    // 1 second into the mirrored left to right gradient
+    headless_run_for(8000);
+    for (int y = 0; y < LED_HEIGHT; y++) {
+        for (int x = 0; x < LED_WIDTH; x++) {
+            EXPECT_EQ(pixel(x, y), normal[LED_HEIGHT - 1 - y][LED_WIDTH - 1 - x]) << x << ", " << y;
+        }
+    }
+    visualizer_update(1, 1, 0, 0);
+}
+
+TEST_F(Visualizer, LedTestAnimationCost) {
+    visualizer_update(1, 1 << TEST_LAYER, 0, 0);
+    // One loop of the animation
+    headless_run_for(20000);
+    visualizer_update(1, 1, 0, 0);
+    // Never more than one wakeup every VISUALIZER_UPDATE_INTERVAL, and the
+    // fades only when they change
+    EXPECT_LE(wakeups(), 20000 / VISUALIZER_UPDATE_INTERVAL - 100 + 16);
+    std::cout << "LED test animation: " << wakeups() << " wakeups, " << frames() << " frames, "
+        << ns_per_wakeup() << " ns per wakeup" << std::endl;
+}
+
+TEST_F(Visualizer, DumpsChangedFramesAsPgm) {
+    char directory[] = "/tmp/visualizer_testXXXXXX";
+    ASSERT_NE(mkdtemp(directory), nullptr);
+    headless_dump_frames(directory);
+    visualizer_update(1, 1 << TEST_LAYER, 0, 0);
+    headless_run_for(100);
+    headless_dump_frames(NULL);
+    visualizer_update(1, 1, 0, 0);
+
+    char path[64];
+    snprintf(path, sizeof(path), "%s/display0_%05u.pgm", directory, frames_before);
+    FILE* file = fopen(path, "rb");
+    ASSERT_NE(file, nullptr) << path;
+    int width = 0;
+    int height = 0;
+    int max = 0;
+    EXPECT_EQ(fscanf(file, "P5 %d %d %d", &width, &height, &max), 3);
+    EXPECT_EQ(width, LED_WIDTH);
+    EXPECT_EQ(height, LED_HEIGHT);
+    EXPECT_EQ(max, 255);
+    fgetc(file);
+    uint8_t pixels[LED_WIDTH * LED_HEIGHT];
+    EXPECT_EQ(fread(pixels, 1, sizeof(pixels), file), sizeof(pixels));
+    fclose(file);
+    // The fade in restarted from black
+    EXPECT_LT(pixels[0], 255);
+
+    char command[64];
+    snprintf(command, sizeof(command), "rm -r %s", directory);
+    EXPECT_EQ(system(command), 0);
+}
@@ -86,6 +86,7 @@ static bool same_status(visualizer_keyboard_status_t* status1, visualizer_keyboa
 }
 
 static bool visualizer_enabled = false;
+static visualizer_stats_t stats;
 
 #ifdef VISUALIZER_USER_DATA_SIZE
 static uint8_t user_data[VISUALIZER_USER_DATA_SIZE];
@@ -123,6 +124,7 @@ GDisplay* get_led_display(void) {
 void start_keyframe_animation(keyframe_animation_t* animation) {
     animation->current_frame = -1;
     animation->time_left_in_frame = 0;
+    animation->time_to_update = 0;
     animation->need_update = true;
     int free_index = -1;
     for (int i=0;i<MAX_SIMULTANEOUS_ANIMATIONS;i++) {
@@ -188,6 +190,7 @@ static bool update_keyframe_animation(keyframe_animation_t* animation, visualize
        animation->first_update_of_frame = true;
     } else {
         animation->time_left_in_frame -= delta;
+        animation->time_to_update -= delta;
         while (animation->time_left_in_frame <= 0) {
             int left = animation->time_left_in_frame;
             if (animation->need_update) {
@@ -195,6 +198,7 @@ static bool update_keyframe_animation(keyframe_animation_t* animation, visualize
                 animation->last_update_of_frame = true;
                 (*animation->frame_functions[animation->current_frame])(animation, state);
                 animation->last_update_of_frame = false;
+                stats.frames++;
             }
             animation->current_frame++;
             animation->need_update = true;
@@ -213,12 +217,21 @@ static bool update_keyframe_animation(keyframe_animation_t* animation, visualize
             animation->time_left_in_frame -= delta;
         }
     }
-    if (animation->need_update) {
+    // A new frame is always drawn, after that only when the frame asked for it
+    if (animation->need_update && (animation->first_update_of_frame || animation->time_to_update <= 0)) {
+        animation->next_update = 0;
         animation->need_update = (*animation->frame_functions[animation->current_frame])(animation, state);
         animation->first_update_of_frame = false;
+        // VISUALIZER_UPDATE_INTERVAL is also the shortest time between updates
+        animation->time_to_update = animation->next_update > (int)gfxMillisecondsToTicks(VISUALIZER_UPDATE_INTERVAL) ?
+            animation->next_update : (int)gfxMillisecondsToTicks(VISUALIZER_UPDATE_INTERVAL);
+        stats.frames++;
     }
 
-    systemticks_t wanted_sleep = animation->need_update ? gfxMillisecondsToTicks(10) : (unsigned)animation->time_left_in_frame;
+    systemticks_t wanted_sleep = animation->time_left_in_frame;
+    if (animation->need_update && animation->time_to_update < animation->time_left_in_frame) {
+        wanted_sleep = animation->time_to_update;
+    }
     if (wanted_sleep < *sleep_time) {
         *sleep_time = wanted_sleep;
     }
@@ -241,6 +254,31 @@ void run_next_keyframe(keyframe_animation_t* animation, visualizer_state_t* stat
     (*temp_animation.frame_functions[next_frame])(&temp_animation, &temp_state);
 }
 
+void keyframe_update_in(keyframe_animation_t* animation, int ticks) {
+    if (ticks > 0 && (animation->next_update == 0 || ticks < animation->next_update)) {
+        animation->next_update = ticks;
+    }
+}
+
+int keyframe_time_to_next_step(keyframe_animation_t* animation, int steps) {
+    int frame_length = animation->frame_lengths[animation->current_frame];
+    int current_pos = frame_length - animation->time_left_in_frame;
+    if (steps < 0) {
+        steps = -steps;
+    }
+    if (steps == 0 || frame_length <= 0) {
+        return animation->time_left_in_frame;
+    }
+    // The value is at step current_pos * steps / frame_length, rounded down
+    int step = current_pos * steps / frame_length;
+    int next_pos = ((step + 1) * frame_length + steps - 1) / steps;
+    return next_pos - current_pos;
+}
+
+void visualizer_get_stats(visualizer_stats_t* s) {
+    *s = stats;
+}
+
 // TODO: Optimize the stack size, this is probably way too big
 static DECLARE_THREAD_STACK(visualizerThreadStack, 1024);
 static DECLARE_THREAD_FUNCTION(visualizerThread, arg) {
@@ -287,6 +325,7 @@ static DECLARE_THREAD_FUNCTION(visualizerThread, arg) {
     bool force_update = true;
 
     while(true) {
+        stats.wakeups++;
         systemticks_t new_time = gfxSystemTicks();
         systemticks_t delta = new_time - current_time;
         current_time = new_time;
@@ -414,6 +453,7 @@ void update_status(bool changed) {
     if (changed) {
         GSourceListener* listener = geventGetSourceListener((GSourceHandle)&current_status, NULL);
         if (listener) {
+            stats.events++;
             geventSendEvent(listener);
         }
     }
@@ -490,18 +530,21 @@ void visualizer_update(uint32_t default_state, uint32_t state, uint8_t mods, uin
 }
 
 void visualizer_suspend(void) {
+    bool changed = !current_status.suspended;
     current_status.suspended = true;
-    update_status(true);
+    update_status(changed);
 }
 
 void visualizer_resume(void) {
+    bool changed = current_status.suspended;
     current_status.suspended = false;
-    update_status(true);
+    update_status(changed);
 }
 
 #ifdef BACKLIGHT_ENABLE
 void backlight_set(uint8_t level) {
+    bool changed = current_status.backlight_level != level;
     current_status.backlight_level = level;
-    update_status(true);
+    update_status(changed);
 }
 #endif
@@ -47,6 +47,15 @@ void visualizer_init(void);
 // This should be called at every matrix scan
 void visualizer_update(uint32_t default_state, uint32_t state, uint8_t mods, uint32_t leds);
 
+// Counters of how hard the visualizer thread is working
+typedef struct {
+    uint32_t wakeups;   // times the thread woke up
+    uint32_t events;    // status changes posted to the thread
+    uint32_t frames;    // calls to keyframe functions
+} visualizer_stats_t;
+
+void visualizer_get_stats(visualizer_stats_t* stats);
+
 // This should be called when the keyboard goes to suspend state
 void visualizer_suspend(void);
 // This should be called when the keyboard wakes up from suspend state
@@ -65,6 +74,13 @@ void draw_emulator(void);
 // If you need support for more than 16 keyframes per animation, you can change this
 #define MAX_VISUALIZER_KEY_FRAMES 16
 
+// How often a keyframe function that asks for continuous updates is called,
+// unless it tells when it needs the next one, and the shortest time between
+// updates, in milliseconds
+#ifndef VISUALIZER_UPDATE_INTERVAL
+#define VISUALIZER_UPDATE_INTERVAL 10
+#endif
+
 struct keyframe_animation_t;
 
 typedef struct {
@@ -103,7 +119,8 @@ typedef struct visualizer_state_t {
 
 // Any custom keyframe function should have this signature
 // return true to get continuous updates, otherwise you will only get one
-// update per frame
+// update per frame. When returning true, keyframe_update_in can tell when
+// the function has something new to draw, the thread sleeps until then.
 typedef bool (*frame_func)(struct keyframe_animation_t*, visualizer_state_t*);
 
 // Represents a keyframe animation, so fields are internal to the system
@@ -122,6 +139,9 @@ typedef struct keyframe_animation_t {
     bool first_update_of_frame;
     bool last_update_of_frame;
     bool need_update;
+    // Set with keyframe_update_in, 0 means VISUALIZER_UPDATE_INTERVAL
+    int next_update;
+    int time_to_update;
 
 } keyframe_animation_t;
 
@@ -133,6 +153,12 @@ void stop_keyframe_animation(keyframe_animation_t* animation);
 // This runs the next keyframe, but does not update the animation state
 // Useful for crossfades for example
 void run_next_keyframe(keyframe_animation_t* animation, visualizer_state_t* state);
+// Asks for the next update of the current keyframe in ticks, when a keyframe
+// function is made of several others the earliest request wins
+void keyframe_update_in(keyframe_animation_t* animation, int ticks);
+// For keyframes that go linearly through a number of steps over the frame,
+// the ticks until the next step
+int keyframe_time_to_next_step(keyframe_animation_t* animation, int steps);
 
 // The master can set userdata which will be transferred to the slave
 #ifdef VISUALIZER_USER_DATA_SIZE
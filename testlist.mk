@@ -2,6 +2,13 @@ TEST_LIST = $(notdir $(patsubst %/rules.mk,%,$(wildcard $(ROOT_DIR)/tests/*/rule
 FULL_TESTS := $(TEST_LIST)
 
 include $(ROOT_DIR)/quantum/serial_link/tests/testlist.mk
+include $(ROOT_DIR)/quantum/split_common/tests/testlist.mk
+include $(ROOT_DIR)/drivers/arm/tests/testlist.mk
+include $(ROOT_DIR)/quantum/visualizer/tests/testlist.mk
+include $(ROOT_DIR)/quantum/audio/tests/testlist.mk
+include $(ROOT_DIR)/tmk_core/protocol/midi/tests/testlist.mk
+include $(ROOT_DIR)/quantum/api/tests/testlist.mk
+include $(ROOT_DIR)/tmk_core/common/chibios/tests/testlist.mk
 
 define VALIDATE_TEST_LIST
     ifneq ($1,)
@@ -0,0 +1,117 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+
+extern "C" {
+#include "pointing_device.h"
+}
+
+using testing::_;
+using testing::InSequence;
+using testing::AllOf;
+using testing::Field;
+
+class PointingDevice : public TestFixture {};
+
+static auto MouseReport(uint8_t buttons, int8_t x, int8_t y, int8_t v, int8_t h) -> decltype(AllOf(
+        Field(&report_mouse_t::buttons, buttons),
+        Field(&report_mouse_t::x, x),
+        Field(&report_mouse_t::y, y),
+        Field(&report_mouse_t::v, v),
+        Field(&report_mouse_t::h, h))) {
+    return AllOf(
+        Field(&report_mouse_t::buttons, buttons),
+        Field(&report_mouse_t::x, x),
+        Field(&report_mouse_t::y, y),
+        Field(&report_mouse_t::v, v),
+        Field(&report_mouse_t::h, h));
+}
+
+TEST_F(PointingDevice, NothingIsSentWithoutMotion) {
+    TestDriver driver;
+    EXPECT_CALL(driver, send_mouse_mock(_)).Times(0);
+    run_one_scan_loop();
+    run_one_scan_loop();
+}
+
+TEST_F(PointingDevice, AccumulatedMotionIsSentInOneReport) {
+    TestDriver driver;
+    pointing_device_accumulate(3, -4, 0, 0);
+    pointing_device_accumulate(5, -6, 1, -1);
+    EXPECT_CALL(driver, send_mouse_mock(MouseReport(0, 8, -10, 1, -1)));
+    run_one_scan_loop();
+    EXPECT_FALSE(pointing_device_has_motion());
+    run_one_scan_loop();
+}
+
+TEST_F(PointingDevice, OverflowIsSplitOverSeveralReports) {
+    TestDriver driver;
+    InSequence s;
+    pointing_device_accumulate(300, -130, 0, 0);
+    EXPECT_CALL(driver, send_mouse_mock(MouseReport(0, 127, -127, 0, 0)));
+    EXPECT_CALL(driver, send_mouse_mock(MouseReport(0, 127, -3, 0, 0)));
+    EXPECT_CALL(driver, send_mouse_mock(MouseReport(0, 46, 0, 0, 0)));
+    idle_for(4);
+    EXPECT_FALSE(pointing_device_has_motion());
+}
+
+TEST_F(PointingDevice, OppositeMotionCancelsOut) {
+    TestDriver driver;
+    EXPECT_CALL(driver, send_mouse_mock(_)).Times(0);
+    pointing_device_accumulate(20, 0, 0, 0);
+    pointing_device_accumulate(-20, 0, 0, 0);
+    run_one_scan_loop();
+}
+
+TEST_F(PointingDevice, AccumulatorSaturatesInsteadOfWrappingAround) {
+    TestDriver driver;
+    pointing_device_accumulate(INT16_MAX, 0, 0, 0);
+    pointing_device_accumulate(INT16_MAX, 0, 0, 0);
+    EXPECT_CALL(driver, send_mouse_mock(MouseReport(0, 127, 0, 0, 0))).Times(258);
+    EXPECT_CALL(driver, send_mouse_mock(MouseReport(0, 1, 0, 0, 0)));
+    idle_for(260);
+    EXPECT_FALSE(pointing_device_has_motion());
+}
+
+TEST_F(PointingDevice, ButtonChangeIsSentOnceWithoutMotion) {
+    TestDriver driver;
+    report_mouse_t report = pointing_device_get_report();
+    report.buttons = MOUSE_BTN1;
+    pointing_device_set_report(report);
+    EXPECT_CALL(driver, send_mouse_mock(MouseReport(MOUSE_BTN1, 0, 0, 0, 0)));
+    run_one_scan_loop();
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    report.buttons = 0;
+    pointing_device_set_report(report);
+    EXPECT_CALL(driver, send_mouse_mock(MouseReport(0, 0, 0, 0, 0)));
+    run_one_scan_loop();
+}
+
+TEST_F(PointingDevice, MotionSetInTheReportIsAddedToTheAccumulatedMotion) {
+    TestDriver driver;
+    report_mouse_t report = pointing_device_get_report();
+    report.x = 100;
+    report.v = -2;
+    pointing_device_set_report(report);
+    pointing_device_accumulate(100, 0, 0, 0);
+    InSequence s;
+    EXPECT_CALL(driver, send_mouse_mock(MouseReport(0, 127, 0, -2, 0)));
+    EXPECT_CALL(driver, send_mouse_mock(MouseReport(0, 73, 0, 0, 0)));
+    run_one_scan_loop();
+    EXPECT_EQ(pointing_device_get_report().x, 0);
+    run_one_scan_loop();
+}
@@ -0,0 +1,47 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "quantum.h"
+
+const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
+    [0] = {
+        {KC_A,  KC_B,  KC_C,  KC_D,  KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO},
+        {KC_E,  KC_F,  KC_G,  KC_H,  KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO},
+        {KC_I,  KC_J,  KC_K,  KC_L,  KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO},
+        {KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO, KC_NO},
+    },
+};
+
+// The first three rows of four keys have an LED each, in rows
+const uint8_t rgb_matrix_leds[MATRIX_ROWS][MATRIX_COLS] PROGMEM = {
+    {0,      1,      2,      3,      NO_LED, NO_LED, NO_LED, NO_LED, NO_LED, NO_LED},
+    {4,      5,      6,      7,      NO_LED, NO_LED, NO_LED, NO_LED, NO_LED, NO_LED},
+    {8,      9,      10,     11,     NO_LED, NO_LED, NO_LED, NO_LED, NO_LED, NO_LED},
+    {NO_LED, NO_LED, NO_LED, NO_LED, NO_LED, NO_LED, NO_LED, NO_LED, NO_LED, NO_LED},
+};
+
+// What the strip shows, and how many frames were sent to it
+LED_TYPE strip[RGBLED_NUM];
+uint32_t frames_sent = 0;
+
+void rgblight_set(void) {
+    memcpy(strip, led, sizeof(strip));
+    frames_sent++;
+}
+
+// The keymap handles KC_L itself
+bool process_record_user(uint16_t keycode, keyrecord_t *record) {
+    return keycode != KC_L;
+}
@@ -0,0 +1,139 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+
+extern "C" {
+#include "rgb_matrix.h"
+extern LED_TYPE strip[RGBLED_NUM];
+extern uint32_t frames_sent;
+}
+
+using testing::_;
+using testing::AnyNumber;
+
+static bool operator==(const LED_TYPE& a, const LED_TYPE& b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+static bool operator!=(const LED_TYPE& a, const LED_TYPE& b) {
+    return !(a == b);
+}
+
+class RgbMatrix : public TestFixture {
+public:
+    RgbMatrix() {
+        EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+        rgblight_enable();
+        rgblight_mode(1);
+        rgblight_sethsv(0, 255, 100);
+        rgb_matrix_init();
+        // The first frame draws every key over the new static color
+        idle_for(2 * RGB_MATRIX_FRAME_INTERVAL);
+        base = strip[0];
+        frames_sent = 0;
+    }
+
+    void tap(uint8_t col, uint8_t row) {
+        press_key(col, row);
+        run_one_scan_loop();
+        release_key(col, row);
+        run_one_scan_loop();
+    }
+
+    void next_frame() {
+        idle_for(RGB_MATRIX_FRAME_INTERVAL);
+    }
+
+    TestDriver driver;
+    // The static color of the keys that aren't lit
+    LED_TYPE base;
+};
+
+TEST_F(RgbMatrix, PressedKeyLightsUpAndFadesBack) {
+    tap(0, 0);
+    next_frame();
+    EXPECT_NE(strip[0], base);
+    for (uint8_t i = 1; i < RGBLED_NUM; i++) {
+        EXPECT_EQ(strip[i], base);
+    }
+    idle_for(255 / RGB_MATRIX_DECAY * RGB_MATRIX_FRAME_INTERVAL + 2 * RGB_MATRIX_FRAME_INTERVAL);
+    EXPECT_EQ(strip[0], base);
+}
+
+TEST_F(RgbMatrix, KeysHandledByTheKeymapLightUpToo) {
+    tap(3, 2);
+    next_frame();
+    EXPECT_NE(strip[11], base);
+}
+
+TEST_F(RgbMatrix, IdleKeyboardSendsNoFrames) {
+    idle_for(500);
+    EXPECT_EQ(frames_sent, 0u);
+    tap(1, 0);
+    idle_for(1000);
+    EXPECT_GT(frames_sent, 0u);
+    frames_sent = 0;
+    idle_for(500);
+    EXPECT_EQ(frames_sent, 0u);
+}
+
+TEST_F(RgbMatrix, RippleSpreadsFromThePressedKey) {
+    rgb_matrix_mode(RGB_MATRIX_RIPPLE);
+    tap(1, 1);
+    next_frame();
+    EXPECT_NE(strip[5], base);
+    // Every LED lights up as the ripple passes, the farthest two keys away
+    bool lit[RGBLED_NUM] = {};
+    for (int frame = 0; frame < 4 * RGB_MATRIX_RIPPLE_FRAMES; frame++) {
+        next_frame();
+        for (uint8_t i = 0; i < RGBLED_NUM; i++) {
+            lit[i] |= strip[i] != base;
+        }
+    }
+    for (uint8_t i = 0; i < RGBLED_NUM; i++) {
+        EXPECT_TRUE(lit[i]) << "LED " << (int)i;
+    }
+}
+
+TEST_F(RgbMatrix, HeatmapShowsHowOftenKeysArePressed) {
+    rgb_matrix_mode(RGB_MATRIX_HEATMAP);
+    for (int i = 0; i < 5; i++) {
+        tap(0, 0);
+    }
+    tap(1, 0);
+    next_frame();
+    EXPECT_NE(strip[0], base);
+    EXPECT_NE(strip[1], base);
+    EXPECT_NE(strip[0], strip[1]);
+    EXPECT_EQ(strip[2], base);
+    // The more used key is redder
+    EXPECT_GT(strip[0].r, strip[1].r);
+}
+
+TEST_F(RgbMatrix, StepGoesThroughTheModesAndWrapsAround) {
+    rgb_matrix_mode(RGB_MATRIX_HEATMAP);
+    rgb_matrix_step();
+    EXPECT_EQ(rgb_matrix_get_mode(), RGB_MATRIX_NONE);
+    rgb_matrix_step();
+    EXPECT_EQ(rgb_matrix_get_mode(), RGB_MATRIX_REACTIVE);
+}
+
+TEST_F(RgbMatrix, NoneModeLeavesTheStaticColor) {
+    rgb_matrix_mode(RGB_MATRIX_NONE);
+    tap(0, 0);
+    idle_for(100);
+    EXPECT_EQ(strip[0], base);
+    EXPECT_EQ(frames_sent, 0u);
+}
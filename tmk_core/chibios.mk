@@ -127,6 +127,8 @@ EXTRAINCDIRS += $(CHIBIOS)/os/license \
          $(HALINC) $(PLATFORMINC) $(BOARDINC) $(TESTINC) \
          $(STREAMSINC) $(CHIBIOS)/os/various
 
+COMMON_VPATH += $(DRIVER_PATH)/arm
+
 #
 # Project, sources and paths
 ##############################################################################
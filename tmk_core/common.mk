@@ -30,6 +30,10 @@ endif
 ifeq ($(PLATFORM),CHIBIOS)
 	TMK_COMMON_SRC += $(PLATFORM_COMMON_DIR)/printf.c
 	TMK_COMMON_SRC += $(PLATFORM_COMMON_DIR)/eeprom.c
+  ifeq ($(strip $(EEPROM_LOG_ENABLE)), yes)
+    TMK_COMMON_SRC += $(PLATFORM_COMMON_DIR)/eeprom_log.c
+    TMK_COMMON_DEFS += -DEEPROM_LOG_ENABLE
+  endif
   ifeq ($(strip $(AUTO_SHIFT_ENABLE)), yes)
     TMK_COMMON_SRC += $(CHIBIOS)/os/various/syscalls.c
   endif
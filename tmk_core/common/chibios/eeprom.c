@@ -545,6 +545,108 @@ void eeprom_write_block(const void *buf, void *addr, uint32_t len)
 	}
 }
 
+#else
+
+#if defined(EEPROM_LOG_ENABLE)
+// Emulated in the last pages of the flash, see eeprom_log.h
+
+#if !defined(STM32F0XX) && !defined(STM32F1XX) && !defined(STM32F3XX)
+#error "EEPROM_LOG_ENABLE is only supported on STM32F0xx, STM32F1xx and STM32F3xx"
+#endif
+
+#include "eeprom_log.h"
+
+// The flash is erased in pages of this size, which is 2KB on the STM32F3,
+// the STM32F07x, STM32F09x and STM32F030xC, and the high density, XL density
+// and connectivity line STM32F1, and 1KB on the other STM32F0 and STM32F1
+#ifndef EEPROM_LOG_ERASE_SIZE
+#if defined(STM32F3XX) || \
+    defined(STM32F070xB) || defined(STM32F071xB) || defined(STM32F072xB) || defined(STM32F078xx) || \
+    defined(STM32F091xC) || defined(STM32F098xx) || defined(STM32F030xC) || \
+    defined(STM32F100xE) || defined(STM32F101xE) || defined(STM32F101xG) || \
+    defined(STM32F103xE) || defined(STM32F103xG) || defined(STM32F105xC) || defined(STM32F107xC) || \
+    defined(STM32F10X_HD) || defined(STM32F10X_HD_VL) || defined(STM32F10X_XL) || defined(STM32F10X_CL)
+#define EEPROM_LOG_ERASE_SIZE 2048
+#else
+#define EEPROM_LOG_ERASE_SIZE 1024
+#endif
+#endif
+
+#if EEPROM_LOG_PAGE_SIZE % EEPROM_LOG_ERASE_SIZE != 0
+#error "EEPROM_LOG_PAGE_SIZE has to be a multiple of the flash page size"
+#endif
+
+#ifndef EEPROM_LOG_FLASH_BASE
+#if defined(STM32F1XX)
+#define FLASH_SIZE_REGISTER ((const uint16_t *)0x1FFFF7E0)
+#else
+#define FLASH_SIZE_REGISTER ((const uint16_t *)0x1FFFF7CC)
+#endif
+// The flash size register is in KB
+#define EEPROM_LOG_FLASH_BASE (0x08000000 + *FLASH_SIZE_REGISTER * 1024 - EEPROM_LOG_PAGES * EEPROM_LOG_PAGE_SIZE)
+#endif
+
+#define PAGE_ADDRESS(page, offset) (EEPROM_LOG_FLASH_BASE + (page) * EEPROM_LOG_PAGE_SIZE + (offset))
+
+static void flash_unlock(void)
+{
+	if (FLASH->CR & FLASH_CR_LOCK) {
+		FLASH->KEYR = 0x45670123;
+		FLASH->KEYR = 0xCDEF89AB;
+	}
+}
+
+// The CPU stalls while it reads from the flash during an operation, so
+// there's nothing else to do than to wait
+static bool flash_wait(void)
+{
+	while (FLASH->SR & FLASH_SR_BSY) {
+	}
+	uint32_t status = FLASH->SR;
+	FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR;
+	return !(status & (FLASH_SR_PGERR | FLASH_SR_WRPRTERR));
+}
+
+uint16_t eeprom_log_flash_read(uint8_t page, uint16_t offset)
+{
+	return *(volatile const uint16_t *)PAGE_ADDRESS(page, offset);
+}
+
+bool eeprom_log_flash_program(uint8_t page, uint16_t offset, uint16_t value)
+{
+	volatile uint16_t *address = (volatile uint16_t *)PAGE_ADDRESS(page, offset);
+	flash_unlock();
+	FLASH->CR |= FLASH_CR_PG;
+	*address = value;
+	bool ok = flash_wait();
+	FLASH->CR &= ~FLASH_CR_PG;
+	FLASH->CR |= FLASH_CR_LOCK;
+	return ok && *address == value;
+}
+
+bool eeprom_log_flash_erase(uint8_t page)
+{
+	bool ok = true;
+	flash_unlock();
+	for (uint32_t offset = 0; offset < EEPROM_LOG_PAGE_SIZE; offset += EEPROM_LOG_ERASE_SIZE) {
+		FLASH->CR |= FLASH_CR_PER;
+		FLASH->AR = PAGE_ADDRESS(page, offset);
+		FLASH->CR |= FLASH_CR_STRT;
+		ok &= flash_wait();
+		FLASH->CR &= ~FLASH_CR_PER;
+	}
+	FLASH->CR |= FLASH_CR_LOCK;
+	return ok;
+}
+
+uint8_t eeprom_read_byte(const uint8_t *addr) {
+	return eeprom_log_read((uint32_t)addr);
+}
+
+void eeprom_write_byte(uint8_t *addr, uint8_t value) {
+	eeprom_log_write((uint32_t)addr, value);
+}
+
 #else
 // No EEPROM supported, so emulate it
 
@@ -561,6 +663,8 @@ void eeprom_write_byte(uint8_t *addr, uint8_t value) {
 	buffer[offset] = value;
 }
 
+#endif
+
 uint16_t eeprom_read_word(const uint16_t *addr) {
 	const uint8_t *p = (const uint8_t *)addr;
 	return eeprom_read_byte(p) | (eeprom_read_byte(p+1) << 8);
@@ -603,7 +707,8 @@ void eeprom_write_block(const void *buf, void *addr, uint32_t len) {
 }
 
 #endif /* chip selection */
-// The update functions just calls write for now, but could probably be optimized
+// The update functions just calls write for now, but could probably be optimized.
+// With EEPROM_LOG_ENABLE writing an unchanged value doesn't touch the flash.
 
 void eeprom_update_byte(uint8_t *addr, uint8_t value) {
 	eeprom_write_byte(addr, value);
@@ -0,0 +1,294 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "eeprom_log.h"
+#include "timer.h"
+#include <string.h>
+
+// The half words of the page header
+#define HEADER_MAGIC 0
+#define HEADER_SEQUENCE 2
+#define HEADER_TYPE 4
+#define HEADER_COMMIT 6
+#define HEADER_SIZE 8
+
+#define MAGIC 0xEE10
+#define TYPE_SNAPSHOT 0x5A5A
+#define TYPE_CONTINUATION 0xC3C3
+#define COMMITTED 0x0000
+
+// A record is the value and a check byte, followed by the address, which
+// is programmed last. A slot where both are erased is the end of the log.
+#define RECORD_SIZE 4
+#define RECORDS_PER_PAGE ((EEPROM_LOG_PAGE_SIZE - HEADER_SIZE) / RECORD_SIZE)
+
+#if EEPROM_LOG_PAGES < 2
+#error "EEPROM_LOG_PAGES has to be at least 2"
+#endif
+#if EEPROM_LOG_SIZE + EEPROM_LOG_COMPACT_MARGIN > RECORDS_PER_PAGE
+#error "A snapshot of EEPROM_LOG_SIZE bytes doesn't fit in EEPROM_LOG_PAGE_SIZE"
+#endif
+
+typedef enum {
+    // Has to be erased before it's used, it isn't known to be blank
+    PAGE_DIRTY,
+    PAGE_ERASED,
+    // Part of the current log
+    PAGE_LOG,
+} page_state_t;
+
+static uint8_t cache[EEPROM_LOG_SIZE];
+static page_state_t page_states[EEPROM_LOG_PAGES];
+static uint16_t sequences[EEPROM_LOG_PAGES];
+static bool initialized = false;
+// The page that is written to, or -1 before the first snapshot
+static int8_t current_page;
+static uint16_t write_offset;
+static uint16_t last_write;
+static eeprom_log_stats_t stats;
+
+// CRC-8 with the polynomial 0x07
+static uint8_t record_check(uint16_t address, uint8_t value) {
+    uint8_t data[3] = {address & 0xFF, address >> 8, value};
+    uint8_t crc = 0;
+    for (uint8_t i = 0; i < sizeof(data); i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// Sequence numbers wrap around
+static bool is_newer(uint16_t sequence, uint16_t than) {
+    return (int16_t)(sequence - than) > 0;
+}
+
+static bool is_blank(uint8_t page, uint16_t offset) {
+    for (; offset < EEPROM_LOG_PAGE_SIZE; offset += 2) {
+        if (eeprom_log_flash_read(page, offset) != 0xFFFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns the type of a page with a valid header, or 0
+static uint16_t page_type(uint8_t page) {
+    if (eeprom_log_flash_read(page, HEADER_MAGIC) != MAGIC ||
+        eeprom_log_flash_read(page, HEADER_COMMIT) != COMMITTED) {
+        return 0;
+    }
+    uint16_t type = eeprom_log_flash_read(page, HEADER_TYPE);
+    return type == TYPE_SNAPSHOT || type == TYPE_CONTINUATION ? type : 0;
+}
+
+// Applies the records of the page to the cache, and returns the offset of
+// the end of the log in it
+static uint16_t replay_page(uint8_t page) {
+    uint16_t offset = HEADER_SIZE;
+    for (; offset + RECORD_SIZE <= EEPROM_LOG_PAGE_SIZE; offset += RECORD_SIZE) {
+        uint16_t data = eeprom_log_flash_read(page, offset);
+        uint16_t address = eeprom_log_flash_read(page, offset + 2);
+        if (data == 0xFFFF && address == 0xFFFF) {
+            break;
+        }
+        // Records that weren't completely programmed are skipped
+        uint8_t value = data & 0xFF;
+        if (address < EEPROM_LOG_SIZE && record_check(address, value) == data >> 8) {
+            cache[address] = value;
+        }
+    }
+    return offset;
+}
+
+void eeprom_log_init(void) {
+    memset(cache, 0xFF, sizeof(cache));
+    current_page = -1;
+    write_offset = 0;
+    int8_t snapshot = -1;
+    for (uint8_t i = 0; i < EEPROM_LOG_PAGES; i++) {
+        page_states[i] = PAGE_DIRTY;
+        sequences[i] = eeprom_log_flash_read(i, HEADER_SEQUENCE);
+        uint16_t type = page_type(i);
+        if (type == TYPE_SNAPSHOT && (snapshot < 0 || is_newer(sequences[i], sequences[snapshot]))) {
+            snapshot = i;
+        } else if (!type && is_blank(i, 0)) {
+            page_states[i] = PAGE_ERASED;
+        }
+    }
+    // The log is the newest snapshot and the pages that continue it. Every
+    // other page is left dirty, to be erased later.
+    int8_t page = snapshot;
+    while (page >= 0) {
+        page_states[page] = PAGE_LOG;
+        current_page = page;
+        write_offset = replay_page(page);
+        uint16_t next = sequences[page] + 1;
+        page = -1;
+        for (uint8_t i = 0; i < EEPROM_LOG_PAGES; i++) {
+            if (page_states[i] == PAGE_DIRTY && sequences[i] == next && page_type(i) == TYPE_CONTINUATION) {
+                page = i;
+            }
+        }
+    }
+    last_write = timer_read();
+    initialized = true;
+}
+
+uint8_t eeprom_log_read(uint16_t address) {
+    if (!initialized) {
+        eeprom_log_init();
+    }
+    return address < EEPROM_LOG_SIZE ? cache[address] : 0xFF;
+}
+
+static bool prepare_page(uint8_t page) {
+    if (page_states[page] == PAGE_DIRTY) {
+        stats.erases++;
+        if (eeprom_log_flash_erase(page) && is_blank(page, 0)) {
+            page_states[page] = PAGE_ERASED;
+        }
+    }
+    return page_states[page] == PAGE_ERASED;
+}
+
+static uint8_t free_pages(void) {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < EEPROM_LOG_PAGES; i++) {
+        count += page_states[i] != PAGE_LOG;
+    }
+    return count;
+}
+
+// Starts a page after the current one, and returns it, or -1. The header
+// isn't committed.
+static int8_t start_page(uint16_t type) {
+    // The erased pages first, so that nothing has to be erased now, and
+    // in turns from the current page, so that they wear evenly
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        for (uint8_t n = 1; n <= EEPROM_LOG_PAGES; n++) {
+            uint8_t i = (current_page + n) % EEPROM_LOG_PAGES;
+            if (page_states[i] == PAGE_LOG || (pass == 0 && page_states[i] != PAGE_ERASED)) {
+                continue;
+            }
+            if (!prepare_page(i)) {
+                continue;
+            }
+            uint16_t sequence = current_page >= 0 ? sequences[current_page] + 1 : 0;
+            // Whatever happens, the page is no longer blank
+            page_states[i] = PAGE_DIRTY;
+            if (eeprom_log_flash_program(i, HEADER_MAGIC, MAGIC) &&
+                eeprom_log_flash_program(i, HEADER_SEQUENCE, sequence) &&
+                eeprom_log_flash_program(i, HEADER_TYPE, type)) {
+                sequences[i] = sequence;
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+// Programs a record at the end of the log of the page, skipping the slots
+// that fail
+static bool append_to(uint8_t page, uint16_t* offset, uint16_t address, uint8_t value) {
+    while (*offset + RECORD_SIZE <= EEPROM_LOG_PAGE_SIZE) {
+        uint16_t slot = *offset;
+        *offset += RECORD_SIZE;
+        stats.records++;
+        if (eeprom_log_flash_program(page, slot, value | record_check(address, value) << 8) &&
+            eeprom_log_flash_program(page, slot + 2, address)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Writes the cache to a new snapshot page, which replaces the whole log
+static void compact(void) {
+    int8_t page = start_page(TYPE_SNAPSHOT);
+    if (page < 0) {
+        return;
+    }
+    uint16_t offset = HEADER_SIZE;
+    for (uint16_t address = 0; address < EEPROM_LOG_SIZE; address++) {
+        if (cache[address] != 0xFF && !append_to(page, &offset, address, cache[address])) {
+            return;
+        }
+    }
+    if (!eeprom_log_flash_program(page, HEADER_COMMIT, COMMITTED)) {
+        return;
+    }
+    for (uint8_t i = 0; i < EEPROM_LOG_PAGES; i++) {
+        if (page_states[i] == PAGE_LOG) {
+            page_states[i] = PAGE_DIRTY;
+        }
+    }
+    page_states[page] = PAGE_LOG;
+    current_page = page;
+    write_offset = offset;
+    stats.compactions++;
+}
+
+void eeprom_log_write(uint16_t address, uint8_t value) {
+    if (!initialized) {
+        eeprom_log_init();
+    }
+    if (address >= EEPROM_LOG_SIZE || cache[address] == value) {
+        return;
+    }
+    cache[address] = value;
+    last_write = timer_read();
+    if (current_page >= 0 && append_to(current_page, &write_offset, address, value)) {
+        return;
+    }
+    // The log continues on a new page as long as there's another one left
+    // for the next snapshot
+    if (current_page >= 0 && free_pages() >= 2) {
+        int8_t page = start_page(TYPE_CONTINUATION);
+        if (page >= 0 && eeprom_log_flash_program(page, HEADER_COMMIT, COMMITTED)) {
+            page_states[page] = PAGE_LOG;
+            current_page = page;
+            write_offset = HEADER_SIZE;
+            if (append_to(current_page, &write_offset, address, value)) {
+                return;
+            }
+        }
+    }
+    // The snapshot has the new value
+    stats.write_compactions++;
+    compact();
+}
+
+void eeprom_log_task(void) {
+    if (!initialized || (uint16_t)(timer_read() - last_write) < EEPROM_LOG_IDLE_TIME) {
+        return;
+    }
+    // At most one erase or compaction per call
+    for (uint8_t i = 0; i < EEPROM_LOG_PAGES; i++) {
+        if (page_states[i] == PAGE_DIRTY) {
+            prepare_page(i);
+            return;
+        }
+    }
+    uint16_t records_left = (EEPROM_LOG_PAGE_SIZE - write_offset) / RECORD_SIZE;
+    if (current_page >= 0 && free_pages() < 2 && records_left < EEPROM_LOG_COMPACT_MARGIN) {
+        compact();
+    }
+}
+
+void eeprom_log_get_stats(eeprom_log_stats_t* s) {
+    *s = stats;
+}
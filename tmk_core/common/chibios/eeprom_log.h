@@ -0,0 +1,83 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EEPROM_LOG_H
+#define EEPROM_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * EEPROM emulation in flash pages, for the chips that have no EEPROM. The
+ * writes are appended to a log of 4 byte records, and the reads come from a
+ * copy of the whole EEPROM in RAM, which is loaded from the log at start up.
+ *
+ * A page starts with a header, which is only valid once its last half word
+ * has been programmed. A snapshot page starts with every byte that isn't
+ * 0xFF, and the pages with the following sequence numbers continue its log.
+ * When the log is full, a snapshot is written to a free page, and the older
+ * pages are erased afterwards. Until the new snapshot is complete the old
+ * log stays valid, so losing power at any point loses at most the byte that
+ * was being written.
+ *
+ * The erases and the compaction are done by eeprom_log_task once nothing
+ * has been written for EEPROM_LOG_IDLE_TIME, so that a write only stalls on
+ * them when the log runs out of space between two idle periods.
+ */
+
+// The size of the emulated EEPROM in bytes
+#ifndef EEPROM_LOG_SIZE
+#define EEPROM_LOG_SIZE 128
+#endif
+// At least two, more spread the wear and make compaction less frequent
+#ifndef EEPROM_LOG_PAGES
+#define EEPROM_LOG_PAGES 2
+#endif
+#ifndef EEPROM_LOG_PAGE_SIZE
+#define EEPROM_LOG_PAGE_SIZE 2048
+#endif
+// Milliseconds without writes before eeprom_log_task does anything
+#ifndef EEPROM_LOG_IDLE_TIME
+#define EEPROM_LOG_IDLE_TIME 1000
+#endif
+// eeprom_log_task compacts the log when it's about to need compaction, and
+// fewer than this many records fit in the current page
+#ifndef EEPROM_LOG_COMPACT_MARGIN
+#define EEPROM_LOG_COMPACT_MARGIN 64
+#endif
+
+typedef struct {
+    uint32_t records;
+    uint32_t compactions;
+    // Compactions that were done by a write instead of eeprom_log_task
+    uint32_t write_compactions;
+    uint32_t erases;
+} eeprom_log_stats_t;
+
+// Loads the contents from the flash, the other functions do it on first use
+void eeprom_log_init(void);
+uint8_t eeprom_log_read(uint16_t address);
+// Writing the value that's already there doesn't touch the flash
+void eeprom_log_write(uint16_t address, uint8_t value);
+// Call often, for example from the main loop
+void eeprom_log_task(void);
+void eeprom_log_get_stats(eeprom_log_stats_t* stats);
+
+// Implemented by the platform. The offsets are in bytes from the start of
+// the page, and the half words can only be programmed once after an erase.
+uint16_t eeprom_log_flash_read(uint8_t page, uint16_t offset);
+bool eeprom_log_flash_program(uint8_t page, uint16_t offset, uint16_t value);
+bool eeprom_log_flash_erase(uint8_t page);
+
+#endif
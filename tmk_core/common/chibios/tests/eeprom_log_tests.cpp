@@ -0,0 +1,305 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <array>
+#include <random>
+extern "C" {
+#include "eeprom_log.h"
+}
+
+// The flash is simulated like the STM32 flash, a half word can only be
+// programmed once after an erase. It can lose power at any operation, which
+// is then only partly done, and every operation after it is ignored.
+
+#define WORDS_PER_PAGE (EEPROM_LOG_PAGE_SIZE / 2)
+
+typedef std::array<uint8_t, EEPROM_LOG_SIZE> contents_t;
+
+static uint16_t flash[EEPROM_LOG_PAGES][WORDS_PER_PAGE];
+static uint16_t now;
+static uint32_t operations;
+static int64_t power_fail_at;
+static bool powered;
+static uint32_t overwrites;
+static uint32_t erases[EEPROM_LOG_PAGES];
+static std::mt19937 random_bits;
+
+static bool power_fails(void) {
+    if (!powered) {
+        return true;
+    }
+    if (operations++ == power_fail_at) {
+        powered = false;
+        return true;
+    }
+    return false;
+}
+
+extern "C" {
+uint16_t timer_read(void) {
+    return now;
+}
+
+uint16_t eeprom_log_flash_read(uint8_t page, uint16_t offset) {
+    return flash[page][offset / 2];
+}
+
+bool eeprom_log_flash_program(uint8_t page, uint16_t offset, uint16_t value) {
+    uint16_t& word = flash[page][offset / 2];
+    if (!powered) {
+        return false;
+    }
+    if (word != 0xFFFF) {
+        overwrites++;
+        return false;
+    }
+    if (power_fails()) {
+        if (operations == power_fail_at + 1) {
+            // Only some of the bits have been programmed
+            word &= value | random_bits();
+        }
+        return false;
+    }
+    word = value;
+    return true;
+}
+
+bool eeprom_log_flash_erase(uint8_t page) {
+    if (power_fails()) {
+        if (!powered && operations == power_fail_at + 1) {
+            for (auto& word : flash[page]) {
+                if (random_bits() & 1) {
+                    word = 0xFFFF;
+                }
+            }
+        }
+        return false;
+    }
+    erases[page]++;
+    std::fill(std::begin(flash[page]), std::end(flash[page]), 0xFFFF);
+    return true;
+}
+}
+
+class EepromLog : public testing::Test {
+public:
+    EepromLog() {
+        for (auto& page : flash) {
+            std::fill(std::begin(page), std::end(page), 0xFFFF);
+        }
+        std::fill(std::begin(erases), std::end(erases), 0);
+        now = 0;
+        operations = 0;
+        power_fail_at = -1;
+        powered = true;
+        overwrites = 0;
+        random_bits.seed(5);
+        stats_before = stats();
+        eeprom_log_init();
+    }
+
+    ~EepromLog() {
+        EXPECT_EQ(overwrites, 0);
+    }
+
+    static eeprom_log_stats_t stats() {
+        eeprom_log_stats_t s;
+        eeprom_log_get_stats(&s);
+        return s;
+    }
+
+    uint32_t compactions() {
+        return stats().compactions - stats_before.compactions;
+    }
+
+    uint32_t write_compactions() {
+        return stats().write_compactions - stats_before.write_compactions;
+    }
+
+    static contents_t read_all() {
+        contents_t contents;
+        for (uint16_t i = 0; i < EEPROM_LOG_SIZE; i++) {
+            contents[i] = eeprom_log_read(i);
+        }
+        return contents;
+    }
+
+    static void reboot() {
+        powered = true;
+        eeprom_log_init();
+    }
+
+    // Lets the time pass with the task running every millisecond
+    static void idle(uint16_t milliseconds) {
+        for (uint16_t i = 0; i < milliseconds; i++) {
+            now++;
+            eeprom_log_task();
+        }
+    }
+
+    eeprom_log_stats_t stats_before;
+};
+
+TEST_F(EepromLog, BlankFlashReadsAsErased) {
+    for (uint16_t i = 0; i < EEPROM_LOG_SIZE; i++) {
+        EXPECT_EQ(eeprom_log_read(i), 0xFF);
+    }
+    EXPECT_EQ(eeprom_log_read(EEPROM_LOG_SIZE), 0xFF);
+    EXPECT_EQ(operations, 0);
+}
+
+TEST_F(EepromLog, WritesSurviveAReboot) {
+    eeprom_log_write(0, 1);
+    eeprom_log_write(5, 2);
+    eeprom_log_write(EEPROM_LOG_SIZE - 1, 3);
+    eeprom_log_write(5, 4);
+    eeprom_log_write(EEPROM_LOG_SIZE, 5);
+    contents_t expected = read_all();
+    EXPECT_EQ(expected[5], 4);
+    reboot();
+    EXPECT_EQ(read_all(), expected);
+}
+
+TEST_F(EepromLog, UnchangedValuesArentWritten) {
+    eeprom_log_write(3, 7);
+    uint32_t before = operations;
+    eeprom_log_write(3, 7);
+    eeprom_log_write(4, 0xFF);
+    EXPECT_EQ(operations, before);
+}
+
+TEST_F(EepromLog, GarbageInTheFlashIsErasedBeforeUse) {
+    for (auto& page : flash) {
+        std::fill(std::begin(page), std::end(page), 0x1234);
+    }
+    reboot();
+    EXPECT_EQ(eeprom_log_read(0), 0xFF);
+    eeprom_log_write(0, 9);
+    reboot();
+    EXPECT_EQ(eeprom_log_read(0), 9);
+}
+
+TEST_F(EepromLog, TheLogIsCompactedWhenItsFull) {
+    std::mt19937 random(1);
+    contents_t expected = read_all();
+    for (int i = 0; i < 10000; i++) {
+        uint8_t address = random() % EEPROM_LOG_SIZE;
+        uint8_t value = random();
+        eeprom_log_write(address, value);
+        expected[address] = value;
+    }
+    EXPECT_EQ(read_all(), expected);
+    reboot();
+    EXPECT_EQ(read_all(), expected);
+    EXPECT_GT(compactions(), 0);
+    // The pages are used in turns, so they wear evenly
+    uint32_t most = *std::max_element(std::begin(erases), std::end(erases));
+    uint32_t least = *std::min_element(std::begin(erases), std::end(erases));
+    EXPECT_LE(most - least, 1);
+}
+
+TEST_F(EepromLog, TheTaskWaitsForIdleTime) {
+    eeprom_log_write(0, 1);
+    // A dirty page from an old log
+    flash[1][0] = 0;
+    reboot();
+    eeprom_log_write(0, 2);
+    uint32_t before = operations;
+    idle(EEPROM_LOG_IDLE_TIME - 1);
+    EXPECT_EQ(operations, before);
+    idle(1);
+    EXPECT_EQ(erases[1], 1);
+}
+
+TEST_F(EepromLog, IdleTimeCompactsAheadOfTheWrites) {
+    // Bursts of writes with idle time between them never wait for a
+    // compaction or an erase
+    std::mt19937 random(2);
+    contents_t expected = read_all();
+    eeprom_log_write(0, 0);
+    idle(EEPROM_LOG_IDLE_TIME + 10);
+    for (int burst = 0; burst < 200; burst++) {
+        uint32_t erases_before = stats().erases;
+        for (int i = 0; i < 10; i++) {
+            uint8_t address = random() % EEPROM_LOG_SIZE;
+            uint8_t value = random();
+            eeprom_log_write(address, value);
+            expected[address] = value;
+        }
+        EXPECT_EQ(stats().erases, erases_before);
+        idle(EEPROM_LOG_IDLE_TIME + 10);
+    }
+    EXPECT_GT(compactions(), 10);
+    EXPECT_EQ(write_compactions(), 1);
+    reboot();
+    EXPECT_EQ(read_all(), expected);
+}
+
+// Runs the same writes with the power failing at every flash operation in
+// turn, and checks after a reboot that only the byte being written when the
+// power failed can have either its old or its new value
+TEST_F(EepromLog, PowerFailuresLoseAtMostTheLastWrite) {
+    const int WRITES = 200;
+    int64_t fail_at = 0;
+    while (true) {
+        for (auto& page : flash) {
+            std::fill(std::begin(page), std::end(page), 0xFFFF);
+        }
+        reboot();
+        operations = 0;
+        power_fail_at = fail_at;
+        std::mt19937 random(3);
+        contents_t expected = read_all();
+        contents_t before = expected;
+        bool in_write = false;
+        for (int i = 0; i < WRITES && powered; i++) {
+            uint8_t address = random() % EEPROM_LOG_SIZE;
+            uint8_t value = random() % 4;
+            before = expected;
+            expected[address] = value;
+            eeprom_log_write(address, value);
+            in_write = !powered;
+            if (powered && i % 20 == 19) {
+                idle(EEPROM_LOG_IDLE_TIME + 5);
+            }
+        }
+        if (powered) {
+            // Every operation has been interrupted once
+            break;
+        }
+        reboot();
+        contents_t after = read_all();
+        for (uint16_t i = 0; i < EEPROM_LOG_SIZE; i++) {
+            if (in_write && after[i] != expected[i]) {
+                EXPECT_EQ(after[i], before[i]) << "failure at " << fail_at << ", address " << i;
+            } else {
+                EXPECT_EQ(after[i], expected[i]) << "failure at " << fail_at << ", address " << i;
+            }
+        }
+        // And the log keeps working
+        power_fail_at = -1;
+        for (uint16_t i = 0; i < EEPROM_LOG_SIZE; i++) {
+            eeprom_log_write(i, i);
+        }
+        idle(EEPROM_LOG_IDLE_TIME + 5);
+        reboot();
+        for (uint16_t i = 0; i < EEPROM_LOG_SIZE; i++) {
+            ASSERT_EQ(eeprom_log_read(i), i) << "failure at " << fail_at;
+        }
+        fail_at++;
+    }
+    EXPECT_GT(fail_at, WRITES);
+}
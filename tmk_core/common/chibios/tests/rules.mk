@@ -0,0 +1,9 @@
+eeprom_log_SRC :=\
+	$(TMK_PATH)/common/chibios/tests/eeprom_log_tests.cpp \
+	$(TMK_PATH)/common/chibios/eeprom_log.c
+
+eeprom_log_INC :=\
+	$(TMK_PATH)/common/chibios
+
+eeprom_log_DEFS := -DEEPROM_LOG_SIZE=16 -DEEPROM_LOG_PAGES=3 -DEEPROM_LOG_PAGE_SIZE=256 \
+	-DEEPROM_LOG_COMPACT_MARGIN=16
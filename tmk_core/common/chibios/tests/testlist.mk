@@ -0,0 +1,2 @@
+TEST_LIST +=\
+	eeprom_log
\ No newline at end of file
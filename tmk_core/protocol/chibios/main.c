@@ -46,6 +46,9 @@
 #endif
 #include "suspend.h"
 #include "wait.h"
+#ifdef EEPROM_LOG_ENABLE
+#include "eeprom_log.h"
+#endif
 
 /* -------------------------
  *   TMK host driver defs
@@ -208,6 +211,9 @@ int main(void) {
 #endif
 #ifdef RAW_HID_ENABLE
     raw_hid_task();
+#endif
+#ifdef EEPROM_LOG_ENABLE
+    eeprom_log_task();
 #endif
   }
 }
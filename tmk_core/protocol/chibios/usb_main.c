@@ -860,6 +860,10 @@ void send_midi_packet(MIDI_EventPacket_t* event) {
   chnWrite(&drivers.midi_driver.driver, (uint8_t*)event, sizeof(MIDI_EventPacket_t));
 }
 
+void send_midi_packets(MIDI_EventPacket_t* events, uint8_t count) {
+  chnWrite(&drivers.midi_driver.driver, (uint8_t*)events, count * sizeof(MIDI_EventPacket_t));
+}
+
 bool recv_midi_packet(MIDI_EventPacket_t* const event) {
   size_t size = chnReadTimeout(&drivers.midi_driver.driver, (uint8_t*)event, sizeof(MIDI_EventPacket_t), TIME_IMMEDIATE);
   return size == sizeof(MIDI_EventPacket_t);
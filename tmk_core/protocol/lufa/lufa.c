@@ -897,6 +897,16 @@ void send_midi_packet(MIDI_EventPacket_t* event) {
   MIDI_Device_SendEventPacket(&USB_MIDI_Interface, event);
 }
 
+void send_midi_packets(MIDI_EventPacket_t* events, uint8_t count) {
+  if (USB_DeviceState != DEVICE_STATE_Configured)
+    return;
+
+  Endpoint_SelectEndpoint(USB_MIDI_Interface.Config.DataINEndpoint.Address);
+  if (Endpoint_Write_Stream_LE(events, count * sizeof(MIDI_EventPacket_t), NULL) != ENDPOINT_RWSTREAM_NoError)
+    return;
+  Endpoint_ClearIN();
+}
+
 bool recv_midi_packet(MIDI_EventPacket_t* const event) {
   return MIDI_Device_ReceiveEventPacket(&USB_MIDI_Interface, event);
 }
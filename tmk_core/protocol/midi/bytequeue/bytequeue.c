@@ -1,4 +1,4 @@
-//this is a single reader [maybe multiple writer?] byte queue
+//this is a single reader, single writer byte queue
 //Copyright 2008 Alex Norman
 //writen by Alex Norman 
 //
@@ -18,7 +18,19 @@
 //along with avr-bytequeue.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "bytequeue.h"
-#include "interrupt_setting.h"
+
+//keeps the data accesses on the right side of an index update, the
+//microcontrollers have a single core so only the compiler can reorder them
+#if defined(__AVR__) || defined(__arm__)
+#define bytequeue_barrier() __asm__ __volatile__("" ::: "memory")
+#else
+#define bytequeue_barrier() __sync_synchronize()
+#endif
+
+static inline byteQueueIndex_t bytequeue_next(byteQueue_t * queue, byteQueueIndex_t index){
+   index++;
+   return index == queue->length ? 0 : index;
+}
 
 void bytequeue_init(byteQueue_t * queue, uint8_t * dataArray, byteQueueIndex_t arrayLen){
    queue->length = arrayLen;
@@ -27,39 +39,62 @@ void bytequeue_init(byteQueue_t * queue, uint8_t * dataArray, byteQueueIndex_t a
 }
 
 bool bytequeue_enqueue(byteQueue_t * queue, uint8_t item){
-   interrupt_setting_t setting = store_and_clear_interrupt();
-   //full
-   if(((queue->end + 1) % queue->length) == queue->start){
-      restore_interrupt_setting(setting);
-      return false;
-   } else {
-      queue->data[queue->end] = item;
-      queue->end = (queue->end + 1) % queue->length;
-      restore_interrupt_setting(setting);
-      return true;
+   return bytequeue_enqueue_bytes(queue, &item, 1) == 1;
+}
+
+byteQueueIndex_t bytequeue_enqueue_bytes(byteQueue_t * queue, const uint8_t * items, byteQueueIndex_t count){
+   byteQueueIndex_t start = queue->start;
+   byteQueueIndex_t end = queue->end;
+   byteQueueIndex_t i;
+   for (i = 0; i < count; i++) {
+      byteQueueIndex_t next = bytequeue_next(queue, end);
+      //full
+      if (next == start)
+         break;
+      queue->data[end] = items[i];
+      end = next;
    }
+   //the reader only sees the new items once they are all written
+   bytequeue_barrier();
+   queue->end = end;
+   return i;
 }
 
 byteQueueIndex_t bytequeue_length(byteQueue_t * queue){
-   byteQueueIndex_t len;
-   interrupt_setting_t setting = store_and_clear_interrupt();
-   if(queue->end >= queue->start)
-      len = queue->end - queue->start;
+   byteQueueIndex_t start = queue->start;
+   byteQueueIndex_t end = queue->end;
+   if(end >= start)
+      return end - start;
    else
-      len = (queue->length - queue->start) + queue->end;
-   restore_interrupt_setting(setting);
-   return len;
+      return (queue->length - start) + end;
 }
 
 //we don't need to avoid interrupts if there is only one reader
 uint8_t bytequeue_get(byteQueue_t * queue, byteQueueIndex_t index){
-   return queue->data[(queue->start + index) % queue->length];
+   uint16_t position = (uint16_t)queue->start + index;
+   if (position >= queue->length)
+      position -= queue->length;
+   bytequeue_barrier();
+   return queue->data[position];
+}
+
+byteQueueIndex_t bytequeue_span(byteQueue_t * queue, uint8_t ** span){
+   byteQueueIndex_t start = queue->start;
+   byteQueueIndex_t end = queue->end;
+   *span = queue->data + start;
+   bytequeue_barrier();
+   if(end >= start)
+      return end - start;
+   else
+      return queue->length - start;
 }
 
 //we just update the start index to remove elements
 void bytequeue_remove(byteQueue_t * queue, byteQueueIndex_t numToRemove){
-   interrupt_setting_t setting = store_and_clear_interrupt();
-   queue->start = (queue->start + numToRemove) % queue->length;
-   restore_interrupt_setting(setting);
+   uint16_t start = (uint16_t)queue->start + numToRemove;
+   if (start >= queue->length)
+      start -= queue->length;
+   //the writer can reuse the space once the reader is done with it
+   bytequeue_barrier();
+   queue->start = start;
 }
-
@@ -1,4 +1,4 @@
-//this is a single reader [maybe multiple writer?] byte queue
+//this is a single reader, single writer byte queue
 //Copyright 2008 Alex Norman
 //writen by Alex Norman 
 //
@@ -29,9 +29,11 @@ extern "C" {
 
 typedef uint8_t byteQueueIndex_t;
 
+//the writer only moves end and the reader only moves start, so one of them
+//can run in an interrupt without either having to disable interrupts
 typedef struct {
-	byteQueueIndex_t start;
-	byteQueueIndex_t end;
+	volatile byteQueueIndex_t start;
+	volatile byteQueueIndex_t end;
 	byteQueueIndex_t length;
 	uint8_t * data;
 } byteQueue_t;
@@ -42,12 +44,19 @@ void bytequeue_init(byteQueue_t * queue, uint8_t * dataArray, byteQueueIndex_t a
 //add an item to the queue, returns false if the queue is full
 bool bytequeue_enqueue(byteQueue_t * queue, uint8_t item);
 
+//add up to count items to the queue, returns how many were added
+byteQueueIndex_t bytequeue_enqueue_bytes(byteQueue_t * queue, const uint8_t * items, byteQueueIndex_t count);
+
 //get the length of the queue
 byteQueueIndex_t bytequeue_length(byteQueue_t * queue);
 
 //this grabs data at the index given [starting at queue->start]
 uint8_t bytequeue_get(byteQueue_t * queue, byteQueueIndex_t index);
 
+//points span at the data starting at queue->start, and returns how many bytes
+//can be read from there without wrapping around the end of the array
+byteQueueIndex_t bytequeue_span(byteQueue_t * queue, uint8_t ** span);
+
 //update the index in the queue to reflect data that has been dealt with 
 void bytequeue_remove(byteQueue_t * queue, byteQueueIndex_t numToRemove);
 
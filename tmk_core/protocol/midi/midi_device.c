@@ -26,6 +26,7 @@
 //forward declarations, internally used to call the callbacks
 void midi_input_callbacks(MidiDevice * device, uint16_t cnt, uint8_t byte0, uint8_t byte1, uint8_t byte2);
 void midi_process_byte(MidiDevice * device, uint8_t input);
+void midi_process_bytes(MidiDevice * device, const uint8_t * input, uint16_t cnt);
 
 void midi_device_init(MidiDevice * device){
   device->input_state = IDLE;
@@ -59,9 +60,7 @@ void midi_device_init(MidiDevice * device){
 }
 
 void midi_device_input(MidiDevice * device, uint8_t cnt, uint8_t * input) {
-  uint8_t i;
-  for (i = 0; i < cnt; i++)
-    bytequeue_enqueue(&device->input_queue, input[i]);
+  bytequeue_enqueue_bytes(&device->input_queue, input, cnt);
 }
 
 void midi_device_set_send_func(MidiDevice * device, midi_var_byte_func_t send_func){
@@ -77,14 +76,62 @@ void midi_device_process(MidiDevice * device) {
   if(device->pre_input_process_callback)
     device->pre_input_process_callback(device);
 
-  //pull stuff off the queue and process
+  //pull stuff off the queue and process, a contiguous span at a time
+  //only what was there when we started, so an interrupt that keeps adding
+  //can't keep us here
   byteQueueIndex_t len = bytequeue_length(&device->input_queue);
-  uint16_t i;
-  //TODO limit number of bytes processed?
-  for(i = 0; i < len; i++) {
-    uint8_t val = bytequeue_get(&device->input_queue, 0);
-    midi_process_byte(device, val);
-    bytequeue_remove(&device->input_queue, 1);
+  while (len > 0) {
+    uint8_t * span;
+    byteQueueIndex_t cnt = bytequeue_span(&device->input_queue, &span);
+    if (cnt > len)
+      cnt = len;
+    midi_process_bytes(device, span, cnt);
+    bytequeue_remove(&device->input_queue, cnt);
+    len -= cnt;
+  }
+}
+
+void midi_process_bytes(MidiDevice * device, const uint8_t * input, uint16_t cnt) {
+  uint16_t i = 0;
+  while (i < cnt) {
+    uint8_t byte0 = input[i];
+    uint8_t status = 0;
+    uint16_t skip = 0;
+
+    //a channel message with its status byte, or one that continues the
+    //running status, that is whole in the span goes straight to the
+    //callbacks, anything else goes through the state machine
+    if (byte0 >= MIDI_NOTEOFF && byte0 < SYSEX_BEGIN && device->input_state != SYSEX_MESSAGE) {
+      status = byte0;
+      skip = 1;
+    } else if (!midi_is_statusbyte(byte0) && device->input_count == 1 &&
+        (device->input_state == TWO_BYTE_MESSAGE || device->input_state == THREE_BYTE_MESSAGE) &&
+        device->input_buffer[0] >= MIDI_NOTEOFF && device->input_buffer[0] < SYSEX_BEGIN) {
+      status = device->input_buffer[0];
+    }
+
+    if (status) {
+      uint8_t length = midi_packet_length(status) == THREE ? 3 : 2;
+      uint16_t end = i + skip + length - 1;
+      if (end <= cnt &&
+          !midi_is_statusbyte(input[i + skip]) &&
+          (length == 2 || !midi_is_statusbyte(input[i + skip + 1]))) {
+        //leaves the buffer as the state machine would have
+        device->input_buffer[0] = status;
+        device->input_buffer[1] = input[i + skip];
+        if (length == 3)
+          device->input_buffer[2] = input[i + skip + 1];
+        device->input_count = 1;
+        device->input_state = length == 3 ? THREE_BYTE_MESSAGE : TWO_BYTE_MESSAGE;
+        midi_input_callbacks(device, length, status, device->input_buffer[1],
+            length == 3 ? device->input_buffer[2] : 0);
+        i = end;
+        continue;
+      }
+    }
+
+    midi_process_byte(device, byte0);
+    i++;
   }
 }
 
@@ -116,7 +116,9 @@ struct _midi_device {
  * @brief Process input bytes.  This function parses bytes and calls the
  * appropriate callbacks associated with the given device.  You use this
  * function if you are creating a custom device and you want to have midi
- * input.
+ * input.  The bytes are queued until the next midi_device_process call, which
+ * can run in a different context, for instance when this is called from a
+ * receive interrupt, as long as there is only one of each.
  *
  * @param device the midi device to associate the input with
  * @param cnt the number of bytes you are processing
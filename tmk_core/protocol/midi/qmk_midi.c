@@ -23,6 +23,20 @@ MidiDevice midi_device;
 #define SYS_COMMON_2 0x20
 #define SYS_COMMON_3 0x30
 
+// Event packets are collected and sent together, as many as fit in one
+// transfer of the endpoint
+#define MIDI_OUTPUT_PACKETS (MIDI_STREAM_EPSIZE / sizeof(MIDI_EventPacket_t))
+
+static MIDI_EventPacket_t output_packets[MIDI_OUTPUT_PACKETS];
+static uint8_t output_count = 0;
+
+void flush_midi_output(void) {
+  if (output_count) {
+    send_midi_packets(output_packets, output_count);
+    output_count = 0;
+  }
+}
+
 static void usb_send_func(MidiDevice * device, uint16_t cnt, uint8_t byte0, uint8_t byte1, uint8_t byte2) {
   MIDI_EventPacket_t event;
   event.Data1 = byte0;
@@ -72,7 +86,9 @@ static void usb_send_func(MidiDevice * device, uint16_t cnt, uint8_t byte0, uint
     }
   }
 
-  send_midi_packet(&event);
+  output_packets[output_count++] = event;
+  if (output_count == MIDI_OUTPUT_PACKETS)
+    flush_midi_output();
 }
 
 static void usb_get_midi(MidiDevice * device) {
@@ -131,37 +147,25 @@ static void cc_callback(MidiDevice * device,
 }
 
 #ifdef API_SYSEX_ENABLE
-uint8_t midi_buffer[MIDI_SYSEX_BUFFER] = {0};
+// The message_type and data_type, and up to API_SYSEX_MAX_SIZE bytes
+static uint8_t sysex_decoded[API_SYSEX_MAX_SIZE + 2];
+static sysex_decoder_t sysex_decoder;
 
 static void sysex_callback(MidiDevice * device, uint16_t start, uint8_t length, uint8_t * data) {
-  // SEND_STRING("\n");
-  // send_word(start);
-  // SEND_STRING(": ");
-  // Don't store the header
-  int16_t pos = start - 4;
+  // The message is decoded as it comes in, after the 4 byte header
+  if (start == 0) {
+    sysex_decoder_init(&sysex_decoder, sysex_decoded, sizeof(sysex_decoded));
+  }
   for (uint8_t place = 0; place < length; place++) {
-      // send_byte(*data);
-      if (pos >= 0) {
-          if (*data == 0xF7) {
-              // SEND_STRING("\nRD: ");
-              // for (uint8_t i = 0; i < start + place + 1; i++){
-              //     send_byte(midi_buffer[i]);
-              // SEND_STRING(" ");
-              // }
-              const unsigned decoded_length = sysex_decoded_length(pos);
-              uint8_t decoded[API_SYSEX_MAX_SIZE];
-              sysex_decode(decoded, midi_buffer, pos);
-              process_api(decoded_length, decoded);
-              return;
-          }
-          else if (pos >= MIDI_SYSEX_BUFFER) {
+      if (start + place >= 4) {
+          if (data[place] == 0xF7) {
+              if (!sysex_decoder.overflow) {
+                  process_api(sysex_decoder.length, sysex_decoded);
+              }
               return;
           }
-          midi_buffer[pos] = *data;
+          sysex_decoder_push(&sysex_decoder, data[place]);
       }
-      // SEND_STRING(" ");
-      data++;
-      pos++;
   }
 }
 #endif
@@ -5,5 +5,9 @@
   extern MidiDevice midi_device;
   void setup_midi(void);
   void send_midi_packet(MIDI_EventPacket_t* event);
+  // Sends count packets in one transfer
+  void send_midi_packets(MIDI_EventPacket_t* events, uint8_t count);
+  // Sends the packets the midi_send_* functions have collected
+  void flush_midi_output(void);
   bool recv_midi_packet(MIDI_EventPacket_t* const event);
 #endif
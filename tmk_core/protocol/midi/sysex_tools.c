@@ -97,3 +97,47 @@ uint16_t sysex_decode(uint8_t *decoded, const uint8_t *source, const uint16_t le
    }
 }
 
+void sysex_encoder_init(sysex_encoder_t *encoder){
+   encoder->count = 0;
+}
+
+uint8_t sysex_encoder_push(sysex_encoder_t *encoder, uint8_t byte){
+   if (encoder->count == 0)
+      encoder->group[0] = 0;
+   encoder->group[0] |= (0x80 & byte) >> (1 + encoder->count);
+   encoder->group[1 + encoder->count] = 0x7F & byte;
+   encoder->count++;
+   if (encoder->count == 7) {
+      encoder->count = 0;
+      return 8;
+   }
+   return 0;
+}
+
+uint8_t sysex_encoder_flush(sysex_encoder_t *encoder){
+   uint8_t length = encoder->count ? encoder->count + 1 : 0;
+   encoder->count = 0;
+   return length;
+}
+
+void sysex_decoder_init(sysex_decoder_t *decoder, uint8_t *decoded, uint16_t capacity){
+   decoder->decoded = decoded;
+   decoder->capacity = capacity;
+   decoder->length = 0;
+   decoder->position = 0;
+   decoder->overflow = false;
+}
+
+void sysex_decoder_push(sysex_decoder_t *decoder, uint8_t byte){
+   //the first byte of each group of 8 holds the top bits of the other 7
+   if (decoder->position == 0) {
+      decoder->msbs = byte;
+      decoder->position = 1;
+      return;
+   }
+   if (decoder->length < decoder->capacity)
+      decoder->decoded[decoder->length++] = (0x7F & byte) | (0x80 & (decoder->msbs << decoder->position));
+   else
+      decoder->overflow = true;
+   decoder->position = decoder->position == 7 ? 0 : decoder->position + 1;
+}
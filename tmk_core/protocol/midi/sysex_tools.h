@@ -24,6 +24,7 @@ extern "C" {
 #endif 
 
 #include <inttypes.h>
+#include <stdbool.h>
 
 /**
  * @file
@@ -86,6 +87,75 @@ uint16_t sysex_encode(uint8_t *encoded, const uint8_t *source, uint16_t length);
  */
 uint16_t sysex_decode(uint8_t *decoded, const uint8_t *source, uint16_t length);
 
+/**
+ * @brief State of an encoding done a byte at a time.
+ *
+ * Holds one group of 7 bytes, so a message of any length can be encoded and
+ * sent without a buffer for the whole message.
+ */
+typedef struct {
+   uint8_t group[8];
+   uint8_t count;
+} sysex_encoder_t;
+
+/**
+ * @brief Start a new encoding.
+ *
+ * @param encoder The encoder to reset.
+ */
+void sysex_encoder_init(sysex_encoder_t *encoder);
+
+/**
+ * @brief Add a byte to an encoding.
+ *
+ * @param encoder The encoder to add the byte to.
+ * @param byte The byte to encode.
+ *
+ * @return 8 when the byte completes a group, which is then in encoder->group, 0 otherwise.
+ */
+uint8_t sysex_encoder_push(sysex_encoder_t *encoder, uint8_t byte);
+
+/**
+ * @brief Finish an encoding.
+ *
+ * @param encoder The encoder to finish.
+ *
+ * @return The number of encoded bytes of the last, incomplete, group in encoder->group.
+ */
+uint8_t sysex_encoder_flush(sysex_encoder_t *encoder);
+
+/**
+ * @brief State of a decoding done a byte at a time.
+ */
+typedef struct {
+   uint8_t *decoded;
+   uint16_t capacity;
+   uint16_t length;
+   uint8_t msbs;
+   uint8_t position;
+   bool overflow;
+} sysex_decoder_t;
+
+/**
+ * @brief Start a new decoding.
+ *
+ * @param decoder The decoder to reset.
+ * @param decoded The output data buffer.
+ * @param capacity The size of the output data buffer, bytes past it are dropped and set decoder->overflow.
+ */
+void sysex_decoder_init(sysex_decoder_t *decoder, uint8_t *decoded, uint16_t capacity);
+
+/**
+ * @brief Add an encoded byte to a decoding.
+ *
+ * Decoded bytes are written to the output as soon as they are known, and
+ * decoder->length is the number of bytes decoded so far.
+ *
+ * @param decoder The decoder to add the byte to.
+ * @param byte The encoded byte.
+ */
+void sysex_decoder_push(sysex_decoder_t *decoder, uint8_t byte);
+
 /**@}*/
 
 #ifdef __cplusplus
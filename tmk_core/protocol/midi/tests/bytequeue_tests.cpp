@@ -0,0 +1,125 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+extern "C" {
+#include "bytequeue/bytequeue.h"
+}
+
+class ByteQueue : public testing::Test {
+public:
+    ByteQueue() {
+        bytequeue_init(&queue, data, sizeof(data));
+    }
+
+    byteQueue_t queue;
+    uint8_t data[8];
+};
+
+TEST_F(ByteQueue, HoldsOneLessThanTheArray) {
+    for (uint8_t i = 0; i < 7; i++) {
+        EXPECT_TRUE(bytequeue_enqueue(&queue, i));
+    }
+    EXPECT_FALSE(bytequeue_enqueue(&queue, 7));
+    EXPECT_EQ(bytequeue_length(&queue), 7);
+    for (uint8_t i = 0; i < 7; i++) {
+        EXPECT_EQ(bytequeue_get(&queue, i), i);
+    }
+}
+
+TEST_F(ByteQueue, EnqueueBytesAddsWhatFits) {
+    uint8_t items[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    EXPECT_EQ(bytequeue_enqueue_bytes(&queue, items, 3), 3);
+    EXPECT_EQ(bytequeue_enqueue_bytes(&queue, items + 3, 7), 4);
+    EXPECT_EQ(bytequeue_length(&queue), 7);
+    bytequeue_remove(&queue, 2);
+    EXPECT_EQ(bytequeue_enqueue_bytes(&queue, items + 7, 3), 2);
+    EXPECT_EQ(bytequeue_length(&queue), 7);
+    for (uint8_t i = 0; i < 7; i++) {
+        EXPECT_EQ(bytequeue_get(&queue, i), i + 2);
+    }
+}
+
+TEST_F(ByteQueue, SpanStopsAtTheEndOfTheArray) {
+    uint8_t* span;
+    EXPECT_EQ(bytequeue_span(&queue, &span), 0);
+
+    uint8_t items[7] = {0, 1, 2, 3, 4, 5, 6};
+    bytequeue_enqueue_bytes(&queue, items, 6);
+    bytequeue_remove(&queue, 5);
+    bytequeue_enqueue_bytes(&queue, items, 4);
+    EXPECT_EQ(bytequeue_length(&queue), 5);
+
+    // Bytes 6 and 7 of the array, then the three that wrapped around
+    EXPECT_EQ(bytequeue_span(&queue, &span), 3);
+    EXPECT_EQ(span, data + 5);
+    EXPECT_EQ(span[0], 5);
+    EXPECT_EQ(span[1], 0);
+    EXPECT_EQ(span[2], 1);
+    bytequeue_remove(&queue, 3);
+    EXPECT_EQ(bytequeue_span(&queue, &span), 2);
+    EXPECT_EQ(span, data);
+    EXPECT_EQ(span[0], 2);
+    EXPECT_EQ(span[1], 3);
+    bytequeue_remove(&queue, 2);
+    EXPECT_EQ(bytequeue_length(&queue), 0);
+    EXPECT_EQ(bytequeue_span(&queue, &span), 0);
+}
+
+TEST(ByteQueueThreads, ReaderSeesEveryByteInOrder) {
+    static const uint32_t count = 1000000;
+    uint8_t data[192];
+    byteQueue_t queue;
+    bytequeue_init(&queue, data, sizeof(data));
+
+    // The writer adds the low bytes of a counter in uneven chunks, the reader
+    // takes whole spans and checks that nothing is lost or reordered
+    std::thread writer([&queue]() {
+        uint32_t sent = 0;
+        uint8_t chunk[5];
+        while (sent < count) {
+            uint8_t length = std::min<uint32_t>(1 + sent % 5, count - sent);
+            for (uint8_t i = 0; i < length; i++) {
+                chunk[i] = sent + i;
+            }
+            byteQueueIndex_t added = bytequeue_enqueue_bytes(&queue, chunk, length);
+            if (!added) {
+                std::this_thread::yield();
+            }
+            sent += added;
+        }
+    });
+
+    uint32_t received = 0;
+    uint32_t errors = 0;
+    while (received < count) {
+        uint8_t* span;
+        byteQueueIndex_t length = bytequeue_span(&queue, &span);
+        for (byteQueueIndex_t i = 0; i < length; i++) {
+            errors += span[i] != (uint8_t)(received + i);
+        }
+        bytequeue_remove(&queue, length);
+        received += length;
+        if (!length) {
+            std::this_thread::yield();
+        }
+    }
+    writer.join();
+    EXPECT_EQ(received, count);
+    EXPECT_EQ(errors, 0u);
+    EXPECT_EQ(bytequeue_length(&queue), 0);
+}
@@ -0,0 +1,174 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+extern "C" {
+#include "midi.h"
+void midi_process_byte(MidiDevice* device, uint8_t input);
+}
+
+struct Message {
+    uint16_t count;
+    uint8_t bytes[3];
+
+    bool operator==(const Message& other) const {
+        return count == other.count && bytes[0] == other.bytes[0] &&
+            bytes[1] == other.bytes[1] && bytes[2] == other.bytes[2];
+    }
+};
+
+std::ostream& operator<<(std::ostream& stream, const Message& message) {
+    return stream << message.count << ": " << (int)message.bytes[0] << " " <<
+        (int)message.bytes[1] << " " << (int)message.bytes[2];
+}
+
+static std::vector<Message> received;
+static std::vector<uint8_t> cc_values;
+
+extern "C" {
+static void catchall(MidiDevice* device, uint16_t count, uint8_t byte0, uint8_t byte1, uint8_t byte2) {
+    (void)device;
+    received.push_back({count, {byte0, byte1, byte2}});
+}
+
+static void cc(MidiDevice* device, uint8_t channel, uint8_t number, uint8_t value) {
+    (void)device;
+    (void)channel;
+    (void)number;
+    cc_values.push_back(value);
+}
+}
+
+class MidiDeviceInput : public testing::Test {
+public:
+    MidiDeviceInput() {
+        received.clear();
+        cc_values.clear();
+        midi_device_init(&device);
+        midi_register_catchall_callback(&device, catchall);
+        midi_register_cc_callback(&device, cc);
+    }
+
+    void input(std::vector<uint8_t> bytes) {
+        midi_device_input(&device, bytes.size(), bytes.data());
+    }
+
+    // What the byte by byte parser makes of the same bytes
+    std::vector<Message> parse_bytes(const std::vector<uint8_t>& bytes) {
+        std::vector<Message> saved = received;
+        received.clear();
+        MidiDevice reference;
+        midi_device_init(&reference);
+        midi_register_catchall_callback(&reference, catchall);
+        for (uint8_t byte : bytes) {
+            midi_process_byte(&reference, byte);
+        }
+        std::vector<Message> result = received;
+        received = saved;
+        return result;
+    }
+
+    MidiDevice device;
+};
+
+TEST_F(MidiDeviceInput, ChannelMessages) {
+    input({0x90, 60, 100, 0xC2, 5, 0xB1, 7, 127});
+    midi_device_process(&device);
+    std::vector<Message> expected = {{3, {0x90, 60, 100}}, {2, {0xC2, 5, 0}}, {3, {0xB1, 7, 127}}};
+    EXPECT_EQ(received, expected);
+    EXPECT_EQ(cc_values, std::vector<uint8_t>({127}));
+}
+
+TEST_F(MidiDeviceInput, RunningStatus) {
+    input({0xB0, 1, 10, 1, 11, 1, 12});
+    midi_device_process(&device);
+    EXPECT_EQ(cc_values, std::vector<uint8_t>({10, 11, 12}));
+    // The status carries over to the next time too
+    input({1, 13});
+    midi_device_process(&device);
+    EXPECT_EQ(cc_values, std::vector<uint8_t>({10, 11, 12, 13}));
+}
+
+TEST_F(MidiDeviceInput, MessageSplitBetweenCalls) {
+    input({0xB0, 1});
+    midi_device_process(&device);
+    EXPECT_TRUE(received.empty());
+    input({20});
+    midi_device_process(&device);
+    EXPECT_EQ(cc_values, std::vector<uint8_t>({20}));
+}
+
+TEST_F(MidiDeviceInput, ClockInsideAMessage) {
+    input({0xB0, 1, MIDI_CLOCK, 30, 1, 31});
+    midi_device_process(&device);
+    std::vector<Message> expected = {{1, {MIDI_CLOCK, 0, 0}}, {3, {0xB0, 1, 30}}, {3, {0xB0, 1, 31}}};
+    EXPECT_EQ(received, expected);
+}
+
+TEST_F(MidiDeviceInput, MessagesAcrossTheEndOfTheQueue) {
+    // Moves the queue along so that the messages wrap around its end
+    std::vector<uint8_t> clock(MIDI_INPUT_QUEUE_LENGTH - 4, MIDI_CLOCK);
+    input(clock);
+    midi_device_process(&device);
+    received.clear();
+
+    input({0xB0, 1, 40, 1, 41, 1, 42});
+    midi_device_process(&device);
+    EXPECT_EQ(cc_values, std::vector<uint8_t>({40, 41, 42}));
+}
+
+TEST_F(MidiDeviceInput, SysexIsPassedThrough) {
+    input({SYSEX_BEGIN, 1, 2, 3, 4, SYSEX_END, 0x80, 60, 0});
+    midi_device_process(&device);
+    std::vector<Message> expected = {{3, {SYSEX_BEGIN, 1, 2}}, {6, {3, 4, SYSEX_END}}, {3, {0x80, 60, 0}}};
+    EXPECT_EQ(received, expected);
+}
+
+TEST_F(MidiDeviceInput, SameAsParsingByteByByte) {
+    // Mostly data bytes and channel messages, with some of everything else
+    static const uint8_t status[] = {0x80, 0x90, 0xA0, 0xB0, 0xC0, 0xD0, 0xE0, 0xF0, 0xF1,
+                                     0xF2, 0xF3, 0xF6, 0xF7, 0xF8, 0xFA, 0xFC, 0xFE};
+    srand(42);
+    for (int round = 0; round < 200; round++) {
+        std::vector<uint8_t> bytes;
+        for (int i = 0; i < 150; i++) {
+            if (rand() % 4 == 0) {
+                bytes.push_back(status[rand() % sizeof(status)] | (rand() % 2));
+            } else {
+                bytes.push_back(rand() % 128);
+            }
+        }
+        std::vector<Message> expected = parse_bytes(bytes);
+
+        // In uneven pieces, so that messages are split between calls and
+        // around the end of the queue
+        received.clear();
+        size_t position = 0;
+        while (position < bytes.size()) {
+            size_t length = std::min<size_t>(1 + rand() % 40, bytes.size() - position);
+            midi_device_input(&device, length, bytes.data() + position);
+            midi_device_process(&device);
+            position += length;
+        }
+        for (size_t i = 0; i < std::min(received.size(), expected.size()); i++) {
+            ASSERT_EQ(received[i], expected[i]) << "round " << round << ", message " << i;
+        }
+        ASSERT_EQ(received.size(), expected.size()) << "round " << round;
+        midi_device_init(&device);
+        midi_register_catchall_callback(&device, catchall);
+    }
+}
@@ -0,0 +1,17 @@
+midi_bytequeue_SRC :=\
+	$(TMK_PATH)/protocol/midi/tests/bytequeue_tests.cpp \
+	$(TMK_PATH)/protocol/midi/bytequeue/bytequeue.c
+
+midi_device_SRC :=\
+	$(TMK_PATH)/protocol/midi/tests/midi_device_tests.cpp \
+	$(TMK_PATH)/protocol/midi/midi.c \
+	$(TMK_PATH)/protocol/midi/midi_device.c \
+	$(TMK_PATH)/protocol/midi/bytequeue/bytequeue.c
+
+midi_sysex_tools_SRC :=\
+	$(TMK_PATH)/protocol/midi/tests/sysex_tools_tests.cpp \
+	$(TMK_PATH)/protocol/midi/sysex_tools.c
+
+midi_bytequeue_INC := $(TMK_PATH)/protocol/midi
+midi_device_INC := $(TMK_PATH)/protocol/midi
+midi_sysex_tools_INC := $(TMK_PATH)/protocol/midi
@@ -0,0 +1,86 @@
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include <vector>
+extern "C" {
+#include "sysex_tools.h"
+}
+
+static std::vector<uint8_t> make_message(uint16_t length) {
+    std::vector<uint8_t> message(length);
+    for (uint16_t i = 0; i < length; i++) {
+        message[i] = i * 73 + 0x85;
+    }
+    return message;
+}
+
+TEST(SysexTools, EncoderMatchesSysexEncode) {
+    for (uint16_t length = 0; length < 40; length++) {
+        std::vector<uint8_t> message = make_message(length);
+        std::vector<uint8_t> expected(sysex_encoded_length(length));
+        EXPECT_EQ(sysex_encode(expected.data(), message.data(), length), expected.size());
+
+        std::vector<uint8_t> encoded;
+        sysex_encoder_t encoder;
+        sysex_encoder_init(&encoder);
+        for (uint8_t byte : message) {
+            uint8_t count = sysex_encoder_push(&encoder, byte);
+            encoded.insert(encoded.end(), encoder.group, encoder.group + count);
+        }
+        uint8_t count = sysex_encoder_flush(&encoder);
+        encoded.insert(encoded.end(), encoder.group, encoder.group + count);
+        EXPECT_EQ(encoded, expected) << length;
+        for (uint8_t byte : encoded) {
+            EXPECT_LT(byte, 0x80);
+        }
+    }
+}
+
+TEST(SysexTools, DecoderMatchesSysexDecode) {
+    for (uint16_t length = 0; length < 40; length++) {
+        std::vector<uint8_t> message = make_message(length);
+        std::vector<uint8_t> encoded(sysex_encoded_length(length));
+        sysex_encode(encoded.data(), message.data(), length);
+
+        std::vector<uint8_t> decoded(length);
+        sysex_decoder_t decoder;
+        sysex_decoder_init(&decoder, decoded.data(), decoded.size());
+        for (uint8_t byte : encoded) {
+            sysex_decoder_push(&decoder, byte);
+        }
+        EXPECT_EQ(decoder.length, length);
+        EXPECT_FALSE(decoder.overflow);
+        EXPECT_EQ(decoded, message) << length;
+    }
+}
+
+TEST(SysexTools, DecoderStopsAtTheEndOfTheBuffer) {
+    std::vector<uint8_t> message = make_message(20);
+    std::vector<uint8_t> encoded(sysex_encoded_length(20));
+    sysex_encode(encoded.data(), message.data(), 20);
+
+    // One extra byte to catch writes past the end
+    std::vector<uint8_t> decoded(11, 0xAA);
+    sysex_decoder_t decoder;
+    sysex_decoder_init(&decoder, decoded.data(), 10);
+    for (uint8_t byte : encoded) {
+        sysex_decoder_push(&decoder, byte);
+    }
+    EXPECT_TRUE(decoder.overflow);
+    EXPECT_EQ(decoder.length, 10);
+    EXPECT_EQ(std::vector<uint8_t>(decoded.begin(), decoded.begin() + 10),
+              std::vector<uint8_t>(message.begin(), message.begin() + 10));
+    EXPECT_EQ(decoded[10], 0xAA);
+}
@@ -0,0 +1,4 @@
+TEST_LIST +=\
+	midi_bytequeue\
+	midi_device\
+	midi_sysex_tools
@@ -92,6 +92,20 @@ uint8_t ps2_host_recv_response(void);
 uint8_t ps2_host_recv(void);
 void ps2_host_set_led(uint8_t usb_led);
 
+#ifdef PS2_USE_INT
+/* Packet assembly in the interrupt handler, used by mouse stream mode */
+#define PS2_PACKET_SIZE_MAX 4
+
+typedef struct {
+    uint16_t resyncs;   // partial or out of sync packets that were thrown away
+    uint16_t overflows; // complete packets dropped because the buffer was full
+} ps2_packet_stats_t;
+
+void ps2_host_set_packet_size(uint8_t size);
+bool ps2_host_recv_packet(uint8_t *packet);
+void ps2_host_get_packet_stats(ps2_packet_stats_t *stats);
+#endif
+
 
 /*--------------------------------------------------------------------
  * static functions
@@ -45,6 +45,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "ps2.h"
 #include "ps2_io.h"
 #include "print.h"
+#include "timer.h"
 
 
 #define WAIT(stat, us, err) do { \
@@ -62,6 +63,11 @@ static inline uint8_t pbuf_dequeue(void);
 static inline void pbuf_enqueue(uint8_t data);
 static inline bool pbuf_has_data(void);
 static inline void pbuf_clear(void);
+static inline void packet_recv_byte(uint8_t data);
+static inline void packet_abort(void);
+
+/* 0 when packet assembly is off and every byte goes to pbuf */
+static volatile uint8_t packet_size = 0;
 
 
 void ps2_host_init(void)
@@ -80,6 +86,11 @@ uint8_t ps2_host_send(uint8_t data)
 
     PS2_INT_OFF();
 
+    /* the response to a command never belongs to a packet */
+    uint8_t saved_packet_size = packet_size;
+    packet_size = 0;
+    packet_abort();
+
     /* terminate a transmission if we have */
     inhibit();
     _delay_us(100); // 100us [4]p.13, [5]p.50
@@ -122,10 +133,13 @@ uint8_t ps2_host_send(uint8_t data)
 
     idle();
     PS2_INT_ON();
-    return ps2_host_recv_response();
+    uint8_t res = ps2_host_recv_response();
+    packet_size = saved_packet_size;
+    return res;
 ERROR:
     idle();
     PS2_INT_ON();
+    packet_size = saved_packet_size;
     return 0;
 }
 
@@ -202,7 +216,11 @@ ISR(PS2_INT_VECT)
         case STOP:
             if (!data_in())
                 goto ERROR;
-            pbuf_enqueue(data);
+            if (packet_size) {
+                packet_recv_byte(data);
+            } else {
+                pbuf_enqueue(data);
+            }
             goto DONE;
             break;
         default:
@@ -211,6 +229,8 @@ ISR(PS2_INT_VECT)
     goto RETURN;
 ERROR:
     ps2_error = state;
+    /* a packet with a corrupt byte can't be trusted */
+    packet_abort();
 DONE:
     state = INIT;
     data = 0;
@@ -277,3 +297,103 @@ static inline void pbuf_clear(void)
     SREG = sreg;
 }
 
+
+/*--------------------------------------------------------------------
+ * Ring buffer to store complete mouse packets
+ *------------------------------------------------------------------*/
+#ifndef PS2_PACKET_BUF_SIZE
+#define PS2_PACKET_BUF_SIZE 8
+#endif
+/* bytes of one packet are sent back to back, a longer gap means we lost sync */
+#ifndef PS2_PACKET_TIMEOUT
+#define PS2_PACKET_TIMEOUT 5
+#endif
+/* bit 3 of the first byte of a standard mouse packet is always set */
+#define PS2_PACKET_SYNC_BIT (1<<3)
+
+static uint8_t packet_buf[PS2_PACKET_BUF_SIZE][PS2_PACKET_SIZE_MAX];
+static uint8_t packet_head = 0;
+static uint8_t packet_tail = 0;
+static uint8_t packet_pos = 0;
+static uint16_t packet_time = 0;
+static ps2_packet_stats_t packet_stats = {};
+
+/* Called from the ISR only */
+static inline void packet_recv_byte(uint8_t data)
+{
+    uint16_t now = timer_read();
+    if (packet_pos && TIMER_DIFF_16(now, packet_time) > PS2_PACKET_TIMEOUT) {
+        packet_abort();
+    }
+    packet_time = now;
+
+    if (packet_pos == 0 && !(data & PS2_PACKET_SYNC_BIT)) {
+        /* can't be the start of a packet, skip until we find one */
+        packet_stats.resyncs++;
+        return;
+    }
+
+    packet_buf[packet_head][packet_pos++] = data;
+    if (packet_pos < packet_size) {
+        return;
+    }
+    packet_pos = 0;
+
+    uint8_t next = (packet_head + 1) % PS2_PACKET_BUF_SIZE;
+    if (next != packet_tail) {
+        packet_head = next;
+    } else {
+        /* the slot is reused for the next packet, dropping this one */
+        packet_stats.overflows++;
+    }
+}
+
+static inline void packet_abort(void)
+{
+    uint8_t sreg = SREG;
+    cli();
+    if (packet_pos) {
+        packet_stats.resyncs++;
+        packet_pos = 0;
+    }
+    SREG = sreg;
+}
+
+void ps2_host_set_packet_size(uint8_t size)
+{
+    if (size > PS2_PACKET_SIZE_MAX) {
+        size = PS2_PACKET_SIZE_MAX;
+    }
+    uint8_t sreg = SREG;
+    cli();
+    packet_size = size;
+    packet_pos = 0;
+    packet_head = packet_tail = 0;
+    SREG = sreg;
+}
+
+bool ps2_host_recv_packet(uint8_t *packet)
+{
+    bool has_packet = false;
+
+    uint8_t sreg = SREG;
+    cli();
+    if (packet_head != packet_tail) {
+        for (uint8_t i = 0; i < packet_size; i++) {
+            packet[i] = packet_buf[packet_tail][i];
+        }
+        packet_tail = (packet_tail + 1) % PS2_PACKET_BUF_SIZE;
+        has_packet = true;
+    }
+    SREG = sreg;
+
+    return has_packet;
+}
+
+void ps2_host_get_packet_stats(ps2_packet_stats_t *stats)
+{
+    uint8_t sreg = SREG;
+    cli();
+    *stats = packet_stats;
+    SREG = sreg;
+}
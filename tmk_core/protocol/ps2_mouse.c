@@ -35,6 +35,7 @@ static inline void ps2_mouse_convert_report_to_hid(report_mouse_t *mouse_report)
 static inline void ps2_mouse_clear_report(report_mouse_t *mouse_report);
 static inline void ps2_mouse_enable_scrolling(void);
 static inline void ps2_mouse_scroll_button_task(report_mouse_t *mouse_report);
+static inline void ps2_mouse_send_report(report_mouse_t *mouse_report);
 
 /* ============================= IMPLEMENTATION ============================ */
 
@@ -63,6 +64,12 @@ void ps2_mouse_init(void) {
     ps2_mouse_set_scaling_2_1();
 #endif
 
+#ifdef PS2_MOUSE_USE_PACKET_BUFFER
+    if (PS2_MOUSE_STREAM_MODE == ps2_mouse_mode) {
+        ps2_host_set_packet_size(PS2_MOUSE_PACKET_SIZE);
+    }
+#endif
+
     ps2_mouse_init_user();
 }
 
@@ -71,9 +78,25 @@ void ps2_mouse_init_user(void) {
 }
 
 void ps2_mouse_task(void) {
-    static uint8_t buttons_prev = 0;
     extern int tp_buttons;
 
+#ifdef PS2_MOUSE_USE_PACKET_BUFFER
+    if (PS2_MOUSE_STREAM_MODE == ps2_mouse_mode) {
+        /* packets are assembled by the interrupt handler, only take the finished ones */
+        uint8_t packet[PS2_PACKET_SIZE_MAX];
+        while (ps2_host_recv_packet(packet)) {
+            mouse_report.buttons = packet[0] | tp_buttons;
+            mouse_report.x = packet[1] * PS2_MOUSE_X_MULTIPLIER;
+            mouse_report.y = packet[2] * PS2_MOUSE_Y_MULTIPLIER;
+#ifdef PS2_MOUSE_ENABLE_SCROLLING
+            mouse_report.v = -(packet[3] & PS2_MOUSE_SCROLL_MASK) * PS2_MOUSE_V_MULTIPLIER;
+#endif
+            ps2_mouse_send_report(&mouse_report);
+        }
+        return;
+    }
+#endif
+
     /* receives packet from mouse */
     uint8_t rcv;
     rcv = ps2_host_send(PS2_MOUSE_READ_DATA);
@@ -89,27 +112,16 @@ void ps2_mouse_task(void) {
         return;
     }
 
-    /* if mouse moves or buttons state changes */
-    if (mouse_report.x || mouse_report.y || mouse_report.v ||
-            ((mouse_report.buttons ^ buttons_prev) & PS2_MOUSE_BTN_MASK)) {
-#ifdef PS2_MOUSE_DEBUG_RAW
-        // Used to debug raw ps2 bytes from mouse
-        ps2_mouse_print_report(&mouse_report);
-#endif
-        buttons_prev = mouse_report.buttons;
-        ps2_mouse_convert_report_to_hid(&mouse_report);
-#if PS2_MOUSE_SCROLL_BTN_MASK
-        ps2_mouse_scroll_button_task(&mouse_report);
-#endif
-#ifdef PS2_MOUSE_DEBUG_HID
-        // Used to debug the bytes sent to the host
-        ps2_mouse_print_report(&mouse_report);
-#endif
-        host_mouse_send(&mouse_report);
-    }
+    ps2_mouse_send_report(&mouse_report);
+}
 
-    ps2_mouse_clear_report(&mouse_report);
+#ifdef PS2_MOUSE_USE_PACKET_BUFFER
+void ps2_mouse_print_packet_stats(void) {
+    ps2_packet_stats_t stats;
+    ps2_host_get_packet_stats(&stats);
+    xprintf("ps2_mouse: resyncs: %u, overflows: %u\n", stats.resyncs, stats.overflows);
 }
+#endif
 
 void ps2_mouse_disable_data_reporting(void) {
     PS2_MOUSE_SEND(PS2_MOUSE_DISABLE_DATA_REPORTING, "ps2 mouse disable data reporting");
@@ -122,11 +134,17 @@ void ps2_mouse_enable_data_reporting(void) {
 void ps2_mouse_set_remote_mode(void) {
     PS2_MOUSE_SEND_SAFE(PS2_MOUSE_SET_REMOTE_MODE, "ps2 mouse set remote mode");
     ps2_mouse_mode = PS2_MOUSE_REMOTE_MODE;
+#ifdef PS2_MOUSE_USE_PACKET_BUFFER
+    ps2_host_set_packet_size(0);
+#endif
 }
 
 void ps2_mouse_set_stream_mode(void) {
     PS2_MOUSE_SEND_SAFE(PS2_MOUSE_SET_STREAM_MODE, "ps2 mouse set stream mode");
     ps2_mouse_mode = PS2_MOUSE_STREAM_MODE;
+#ifdef PS2_MOUSE_USE_PACKET_BUFFER
+    ps2_host_set_packet_size(PS2_MOUSE_PACKET_SIZE);
+#endif
 }
 
 void ps2_mouse_set_scaling_2_1(void) {
@@ -147,6 +165,31 @@ void ps2_mouse_set_sample_rate(ps2_mouse_sample_rate_t sample_rate) {
 
 /* ============================= HELPERS ============================ */
 
+static inline void ps2_mouse_send_report(report_mouse_t *mouse_report) {
+    static uint8_t buttons_prev = 0;
+
+    /* if mouse moves or buttons state changes */
+    if (mouse_report->x || mouse_report->y || mouse_report->v ||
+            ((mouse_report->buttons ^ buttons_prev) & PS2_MOUSE_BTN_MASK)) {
+#ifdef PS2_MOUSE_DEBUG_RAW
+        // Used to debug raw ps2 bytes from mouse
+        ps2_mouse_print_report(mouse_report);
+#endif
+        buttons_prev = mouse_report->buttons;
+        ps2_mouse_convert_report_to_hid(mouse_report);
+#if PS2_MOUSE_SCROLL_BTN_MASK
+        ps2_mouse_scroll_button_task(mouse_report);
+#endif
+#ifdef PS2_MOUSE_DEBUG_HID
+        // Used to debug the bytes sent to the host
+        ps2_mouse_print_report(mouse_report);
+#endif
+        host_mouse_send(mouse_report);
+    }
+
+    ps2_mouse_clear_report(mouse_report);
+}
+
 #define X_IS_NEG  (mouse_report->buttons & (1<<PS2_MOUSE_X_SIGN))
 #define Y_IS_NEG  (mouse_report->buttons & (1<<PS2_MOUSE_Y_SIGN))
 #define X_IS_OVF  (mouse_report->buttons & (1<<PS2_MOUSE_X_OVFLW))
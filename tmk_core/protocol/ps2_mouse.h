@@ -117,6 +117,18 @@ static enum ps2_mouse_mode_e {
 #ifndef PS2_MOUSE_INIT_DELAY
 #define PS2_MOUSE_INIT_DELAY            1000
 #endif
+/* bytes in a stream mode packet, the scroll wheel adds a fourth byte */
+#ifndef PS2_MOUSE_PACKET_SIZE
+#   ifdef PS2_MOUSE_ENABLE_SCROLLING
+#       define PS2_MOUSE_PACKET_SIZE    4
+#   else
+#       define PS2_MOUSE_PACKET_SIZE    3
+#   endif
+#endif
+/* the interrupt version assembles stream mode packets in the background */
+#if defined(PS2_USE_INT) && !defined(PS2_MOUSE_DISABLE_PACKET_BUFFER)
+#   define PS2_MOUSE_USE_PACKET_BUFFER
+#endif
 
 enum ps2_mouse_command_e {
     PS2_MOUSE_RESET = 0xFF,
@@ -175,4 +187,8 @@ void ps2_mouse_set_resolution(ps2_mouse_resolution_t resolution);
 
 void ps2_mouse_set_sample_rate(ps2_mouse_sample_rate_t sample_rate);
 
+#ifdef PS2_MOUSE_USE_PACKET_BUFFER
+void ps2_mouse_print_packet_stats(void);
+#endif
+
 #endif
@@ -34,8 +34,8 @@ PROGMEM const char secret[][64] = {
 
 
 #ifdef FAUXCLICKY_ENABLE
-float fauxclicky_pressed_note[2]  = MUSICAL_NOTE(_A6, 2);  // (_D4, 0.25);
-float fauxclicky_released_note[2] = MUSICAL_NOTE(_A6, 2); // (_C4, 0.125);
+float fauxclicky_pressed_note[2]  = {NOTE_A6, 2};  // {NOTE_D4, 0.25};
+float fauxclicky_released_note[2] = {NOTE_A6, 2}; // {NOTE_C4, 0.125};
 #else // FAUXCLICKY_ENABLE
 float fauxclicky_pressed[][2]             = SONG(S__NOTE(_A6)); // change to your tastes
 float fauxclicky_released[][2]             = SONG(S__NOTE(_A6)); // change to your tastes